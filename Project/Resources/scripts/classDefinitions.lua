@@ -323,7 +323,9 @@ function animateSceneL(dt)
 end
 
 function bar()
-	printtable(customFields)
+	for obj, fields in pairs(objectFields) do
+		printtable(fields)
+	end
 	--unitTable['Zombie3']:followPath()
 end
 
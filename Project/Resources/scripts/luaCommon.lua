@@ -27,34 +27,34 @@ mapActiveAnimatedEntitesId = 0
 
 
 
--- fields added to objects in lua
--- prevents garbage collection of objects created in lua functions
--- index format: <object name><fieldname> (eg.: Zombie3onPath)
-customFields = {}
+-- fields added to objects in lua, per object name: objectFields[obj.nameP][fieldname]
+-- prevents garbage collection of objects created in lua functions while the object lives
+-- keyed by the name: luabind may push a new userdata for the same object, the name is the same
+-- the fields of an object are released by unregisterEntity()
+objectFields = {}
 
 -- access custom fields through thesee funcitons
 function _getfield(obj, fieldname)
-	field = getfield(obj.nameP, fieldname)
+	local fields = objectFields[obj.nameP]
 
 	-- if the lua fields of the object has not been initialized
-	if (field == nil) then
+	if (fields == nil) then
 		obj:initFields()
-		field = getfield(obj.nameP, fieldname)
+		fields = objectFields[obj.nameP]
 	end
 
-	return field
+	return fields and fields[fieldname]
 end
 
 function _setfield(obj, fieldname, value)
-	setfield(obj.nameP, fieldname, value)
-end
-
-function getfield(classname, fieldname)
-	return customFields[classname .. fieldname]
-end
+	local name = obj.nameP
+	local fields = objectFields[name]
+	if (fields == nil) then
+		fields = {}
+		objectFields[name] = fields
+	end
 
-function setfield(classname, fieldname, value)
-	customFields[classname .. fieldname] = value
+	fields[fieldname] = value
 end
 
 
@@ -170,6 +170,7 @@ function unregisterEntity(entity)
 
 	entityTableSize = entityTableSize - 1
 	entityTable[entity.nameP] = nil
+	objectFields[entity.nameP] = nil
 	
 	if entity:isUnit() then
 		unitTable[entity.nameP] = nil
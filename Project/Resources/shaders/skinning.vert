@@ -1,7 +1,6 @@
-const int MAX_BONE_COUNT = 100;
+// MAX_BONE_COUNT: defined by EngineCore::setupShaders() from ModelMd5::MAX_GPU_JOINTS
 
-uniform mat4 gWVP;
-uniform mat4 gWorld;
+// the joint palette: bind pose -> current pose
 uniform mat4 u_bones[MAX_BONE_COUNT];
 
 void main()
@@ -16,10 +15,22 @@ void main()
 	vec4 tangentL		= boneTransform * vec4(a_tangentL, 0.0);
 	vec4 bitangentL		= boneTransform * vec4(a_bitangentL, 0.0);
 
+	v_posL				= posL.xyz;
+	v_normalL			= normalL.xyz;
+	v_tangentL			= tangentL.xyz;
+	v_bitangentL		= bitangentL.xyz;
+	v_texcoordL			= a_texcoordL;
+	v_lightMapTexcoordL	= a_lightMapTexcoordL;
+
 	v_posW				= u_M_Mat * posL;
+	v_viewW				= v_posW.xyz - u_eyePositionW;
+
 	v_normalW			= normalize(u_N_Mat * normalL).xyz;
 	v_tangentW			= normalize(u_N_Mat * tangentL).xyz;
 	v_bitangentW		= normalize(u_N_Mat * bitangentL).xyz;
 
+	mat3 TBN			= mat3(v_tangentW, v_bitangentW, v_normalW);
+	v_viewTBN			= (-vec3(v_viewW)) * TBN;
+
 	gl_Position  = u_MVP_Mat * posL;
 }
@@ -5,10 +5,14 @@
 #include <IL/ilut.h>
 
 #include <iostream>
+#include <mutex>
 #include <string>
 
 bool enableDebugMessages = false;
 
+// the state of DevIL is global: one image at a time
+std::mutex devilMutex;
+
 void devilInit(bool enableDebugMessages0) {
 	ilInit();
 	iluInit();
@@ -24,15 +28,15 @@ std::string getExt(const std::string& path) {
 	return path.substr(path.find_last_of('.') + 1, path.size());
 }
 
-bool loadTexture(const std::string& filename, GLuint& texid, bool resize, int resolutionDiv) {
-	ilLoadImage(filename.c_str());
-	ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+bool decodeImage(const std::string& filename, DecodedImage& image, bool resize, int resolutionDiv) {
+	std::lock_guard<std::mutex> lock(devilMutex);
 
-	if (!resize) glGenTextures(1, &texid);
+	ILuint imageName;
+	ilGenImages(1, &imageName);
+	ilBindImage(imageName);
 
-	glBindTexture(GL_TEXTURE_2D, texid);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	ilLoadImage(filename.c_str());
+	ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
 
 	std::string fileExtension = getExt(filename);
 
@@ -44,18 +48,30 @@ bool loadTexture(const std::string& filename, GLuint& texid, bool resize, int re
 	}
 
 	if (fileExtension == "bmp" || fileExtension == "tga") {
-		//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ilGetInteger(IL_IMAGE_WIDTH), ilGetInteger(IL_IMAGE_HEIGHT), 0, IL_BGR, GL_UNSIGNED_BYTE, ilGetData());
 		//iluFlipImage();
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ilGetInteger(IL_IMAGE_WIDTH), ilGetInteger(IL_IMAGE_HEIGHT), 0, ilGetInteger(IL_IMAGE_FORMAT), GL_UNSIGNED_BYTE, ilGetData());
+		image.internalFormat = GL_RGB;
 	} else if (fileExtension == "jpg" || fileExtension == "png") {
 		iluFlipImage();
-		glTexImage2D(GL_TEXTURE_2D, 0, ilGetInteger(IL_IMAGE_FORMAT), ilGetInteger(IL_IMAGE_WIDTH), ilGetInteger(IL_IMAGE_HEIGHT), 0, ilGetInteger(IL_IMAGE_FORMAT), GL_UNSIGNED_BYTE, ilGetData());
+		image.internalFormat = ilGetInteger(IL_IMAGE_FORMAT);
 	} else {
-		glTexImage2D(GL_TEXTURE_2D, 0, ilGetInteger(IL_IMAGE_FORMAT), ilGetInteger(IL_IMAGE_WIDTH), ilGetInteger(IL_IMAGE_HEIGHT), 0, ilGetInteger(IL_IMAGE_FORMAT), GL_UNSIGNED_BYTE, ilGetData());
+		image.internalFormat = ilGetInteger(IL_IMAGE_FORMAT);
 	}
 
-	ILenum error;
-	if ((error = ilGetError()) != IL_NO_ERROR) {
+	image.width = ilGetInteger(IL_IMAGE_WIDTH);
+	image.height = ilGetInteger(IL_IMAGE_HEIGHT);
+	image.format = ilGetInteger(IL_IMAGE_FORMAT);
+
+	const ILubyte* data = ilGetData();
+	if (data) {
+		image.texels.assign(data, data + ilGetInteger(IL_IMAGE_SIZE_OF_DATA));
+	} else {
+		image.texels.clear();
+	}
+
+	ILenum error = ilGetError();
+	ilDeleteImages(1, &imageName);
+
+	if (error != IL_NO_ERROR || image.texels.empty()) {
 		if (enableDebugMessages) {
 			std::cout << "\tDevIL error <" << filename << ">:" << std::endl;
 			std::cout << "\t\t " << error << ": " << iluErrorString(error) << std::endl;
@@ -67,6 +83,25 @@ bool loadTexture(const std::string& filename, GLuint& texid, bool resize, int re
 	return true;
 }
 
+void uploadImage(const DecodedImage& image, GLuint texid) {
+	glBindTexture(GL_TEXTURE_2D, texid);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, image.internalFormat, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, image.texels.data());
+}
+
+bool loadTexture(const std::string& filename, GLuint& texid, bool resize, int resolutionDiv) {
+	DecodedImage image;
+	bool isDecoded = decodeImage(filename, image, resize, resolutionDiv);
+
+	if (!resize) glGenTextures(1, &texid);
+
+	if (isDecoded) uploadImage(image, texid);
+
+	return isDecoded;
+}
+
 bool loadTexture(const std::string& filename, GLuint& texid, TextureDirectory& textureDirectory, bool resize, int resolutionDiv) {
 	if (enableDebugMessages)
 		std::cout << "Loading texture <" << filename << ">." << std::endl;
@@ -114,6 +149,8 @@ bool loadCubeMap(const std::string& mapname, const std::string& extension, GLuin
 
 	std::string faceFileName(mapname);
 
+	std::lock_guard<std::mutex> lock(devilMutex);
+
 	glGenTextures(1, &texid);
     glBindTexture(GL_TEXTURE_CUBE_MAP, texid);
 
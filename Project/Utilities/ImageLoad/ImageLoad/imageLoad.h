@@ -13,12 +13,27 @@
 
 #include <map>
 #include <string.h>
+#include <vector>
 
 typedef std::map<const std::string, GLuint>	TextureDirectory;
 typedef std::map<const std::string, GLuint>	CubeTextureDirectory;
 
 void devilInit(bool enableDebugMessages = false);
 
+// the texels of an image as loadTexture() uploads them
+struct DecodedImage {
+	int width;
+	int height;
+	GLint internalFormat;
+	GLenum format;
+	std::vector<unsigned char> texels;
+};
+
+// DevIL is not thread-safe: the images are decoded one at a time, whatever thread asks (the gl upload is left to the
+// thread of the context, uploadImage())
+bool decodeImage(const std::string& filename, DecodedImage& image, bool resize = false, int resolutionDiv = 2);
+void uploadImage(const DecodedImage& image, GLuint texid);
+
 bool loadTexture(const std::string& filename, GLuint& texid, bool resize = false, int resolutionDiv = 2);
 bool loadTexture(const std::string& filename, GLuint& texid, TextureDirectory& textureDirectory, bool resize = false, int resolutionDiv = 2);
 bool loadCubeMap(const std::string& mapname, const std::string& extension, GLuint& texid, TextureDirectory& textureDirectory);
@@ -0,0 +1,110 @@
+#include "GameStdAfx.h"
+#include "Common/AssetPackBuilder.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+
+
+/**
+ * Packs a data directory into the asset pack mounted by the client and the server in place of it (AssetPack).
+ *
+ *     CrimsonAssetPacker <dataDir> [-o <pack.pak>] [-level <0-9>] [-store <extension>]...
+ *
+ * The pack is written next to the directory by default (../Data -> ../Data.pak), where AssetPack::mountDataDir()
+ * looks for it. The settings/ directory is not packed: it is read from the disk.
+ */
+static void printUsage(std::ostream& out)
+{
+	out << "usage: CrimsonAssetPacker <dataDir> [-o <pack.pak>] [-level <0-9>] [-store <extension>]..." << std::endl;
+	out << "  packs the files of the directory but settings/, next to it by default" << std::endl;
+	out << "  -level  the zlib compression level (9 by default)" << std::endl;
+	out << "  -store  the files of the extension are not compressed" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string dataDir;
+	std::string packFile;
+	int compressionLevel = 9;
+	std::vector<std::string> storedExtensions;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-o" && i + 1 < argc)
+		{
+			packFile = argv[++i];
+		}
+		else if (arg == "-level" && i + 1 < argc)
+		{
+			compressionLevel = atoi(argv[++i]);
+		}
+		else if (arg == "-store" && i + 1 < argc)
+		{
+			storedExtensions.push_back(argv[++i]);
+		}
+		else if (arg == "-h" || arg == "--help")
+		{
+			printUsage(std::cout);
+			return EXIT_SUCCESS;
+		}
+		else if (dataDir.empty() && arg[0] != '-')
+		{
+			dataDir = arg;
+		}
+		else
+		{
+			printUsage(std::cerr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (dataDir.empty() || compressionLevel < 0 || compressionLevel > 9)
+	{
+		printUsage(std::cerr);
+		return EXIT_FAILURE;
+	}
+
+	while (dataDir.size() > 1 && (dataDir.back() == '/' || dataDir.back() == '\\'))
+	{
+		dataDir.pop_back();
+	}
+
+	if (packFile.empty())
+	{
+		packFile = dataDir + ".pak";
+	}
+
+	new LoggerSystem(LogLevel::ERR);
+	new TraceRecorder();
+	new JobPool();
+
+	AssetPackBuilder builder(compressionLevel);
+	for (const std::string& extension : storedExtensions)
+	{
+		builder.addStoredExtension(extension);
+	}
+
+	int result = EXIT_SUCCESS;
+	if (builder.addDirectory(dataDir) == 0)
+	{
+		std::cerr << "no files in " << dataDir << std::endl;
+		result = EXIT_FAILURE;
+	}
+	else if (!builder.save(packFile))
+	{
+		std::cerr << "can't write " << packFile << std::endl;
+		result = EXIT_FAILURE;
+	}
+	else
+	{
+		std::cout << packFile << ": " << builder.getNumFiles() << " files (" << builder.getNumStoredFiles() << " stored), "
+			<< builder.getSize() / 1024 << " KB -> " << builder.getPackedSize() / 1024 << " KB" << std::endl;
+	}
+
+	JobPool::destroyInstance();
+	LoggerSystem::getInstance()->flush();
+
+	return result;
+}
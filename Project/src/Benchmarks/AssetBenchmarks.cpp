@@ -0,0 +1,108 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "Common/AssetPack.h"
+#include "Common/AssetPackBuilder.h"
+
+#include <boost/filesystem.hpp>
+
+
+// the files of the md5 models: the text meshes and clips (compressed in the pack) and their textures
+static const char* s_assetDir = "/models/Md5";
+static const char* s_packFile = "benchmark.pak";
+
+static std::vector<std::string> listAssets(const std::string& dir)
+{
+	std::vector<std::string> fileNames;
+
+	boost::system::error_code error;
+	for (boost::filesystem::directory_iterator it(dir, error), end; it != end && !error; it.increment(error))
+	{
+		if (boost::filesystem::is_regular_file(it->status()))
+		{
+			fileNames.push_back(it->path().generic_string());
+		}
+	}
+
+	return fileNames;
+}
+
+
+/**
+ * One file at a time from the disk: open, read into a new buffer, close (utils::file::readFile()).
+ */
+BENCHMARK(Asset_ReadLoose)
+{
+	const std::vector<std::string> fileNames = listAssets(CONST_STR("dataDir") + s_assetDir);
+	if (fileNames.empty())
+	{
+		state.skip("no files in " + CONST_STR("dataDir") + s_assetDir);
+		return;
+	}
+
+	uint64_t numBytes = 0;
+	while (state.keepRunning())
+	{
+		for (const std::string& fileName : fileNames)
+		{
+			const char* pData = utils::file::readFile(fileName);
+			benchmark::doNotOptimize(pData);
+			delete[] pData;
+		}
+	}
+
+	for (const std::string& fileName : fileNames)
+	{
+		numBytes += boost::filesystem::file_size(fileName);
+	}
+
+	state.setBytesProcessed(state.getIterations() * numBytes);
+	state.setLabel("files=" + std::to_string(fileNames.size()));
+}
+
+/**
+ * The same files from a mounted pack (MappedFile::open()): the stored ones are views of the mapping, the compressed
+ * ones are decompressed by chunks.
+ */
+BENCHMARK(Asset_ReadPacked)
+{
+	const std::string assetDir = CONST_STR("dataDir") + s_assetDir;
+	const std::vector<std::string> fileNames = listAssets(assetDir);
+
+	AssetPackBuilder builder;
+	if (fileNames.empty() || builder.addDirectory(assetDir) == 0 || !builder.save(s_packFile))
+	{
+		state.skip("can't pack " + assetDir);
+		return;
+	}
+
+	const bool hasPack = AssetPack::hasInstance();
+	if (!hasPack)
+	{
+		new AssetPack();
+	}
+	AssetPack::getInstance()->mount(s_packFile, assetDir);
+
+	while (state.keepRunning())
+	{
+		for (const std::string& fileName : fileNames)
+		{
+			MappedFile file;
+			file.open(fileName);
+			benchmark::doNotOptimize(file.getData());
+		}
+	}
+
+	state.setBytesProcessed(state.getIterations() * builder.getSize());
+	state.setLabel("files=" + std::to_string(fileNames.size()) + " stored=" + std::to_string(builder.getNumStoredFiles())
+		+ " packedKB=" + std::to_string(builder.getPackedSize() / 1024));
+
+	if (hasPack)
+	{
+		AssetPack::getInstance()->unmount();
+	}
+	else
+	{
+		AssetPack::destroyInstance();
+	}
+	std::remove(s_packFile);
+}
@@ -0,0 +1,545 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <regex>
+#include <sstream>
+
+#include <boost/thread/thread.hpp>
+
+#ifndef WIN32
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+namespace benchmark
+{
+
+#ifdef _MSC_VER
+const volatile void* g_pSink = nullptr;
+#endif
+
+static const uint64_t s_maxIterations = 1000000000;
+
+typedef std::vector<std::pair<std::string, BenchmarkFunction>> BenchmarkList;
+
+// filled by the static initializers of the benchmark files: a function local static is ready whatever their order is
+static BenchmarkList& getBenchmarks()
+{
+	static BenchmarkList benchmarks;
+	return benchmarks;
+}
+
+int registerBenchmark(const char* name, BenchmarkFunction function)
+{
+	getBenchmarks().push_back(std::make_pair(std::string(name), function));
+	return (int)getBenchmarks().size();
+}
+
+double getThreadCpuTime()
+{
+#ifdef WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		const uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+		const uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+		return (kernel + user) * 1e-7;		// 100 ns units
+	}
+	return 0.0;
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+	{
+		return time.tv_sec + time.tv_nsec * 1e-9;
+	}
+	return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+State::State(uint64_t numIterations)
+	: m_numIterations(numIterations)
+	, m_numIterationsLeft(numIterations)
+	, m_numItems(0)
+	, m_numBytes(0)
+	, m_isSkipped(false)
+	, m_cpuStartTime(0.0)
+	, m_realTime(0.0)
+	, m_cpuTime(0.0)
+	, m_isTiming(false)
+{
+}
+
+void State::startTiming()
+{
+	m_isTiming = true;
+	m_cpuStartTime = getThreadCpuTime();
+	m_realStartTime = std::chrono::high_resolution_clock::now();
+}
+
+void State::stopTiming()
+{
+	if (!m_isTiming)
+	{
+		return;
+	}
+
+	const std::chrono::high_resolution_clock::time_point realStopTime = std::chrono::high_resolution_clock::now();
+	m_cpuTime = getThreadCpuTime() - m_cpuStartTime;
+	m_realTime = std::chrono::duration<double>(realStopTime - m_realStartTime).count();
+	m_isTiming = false;
+}
+
+
+BenchmarkRunner::BenchmarkRunner()
+	: m_filter(".*")
+	, m_minTime(0.5)
+	, m_numRepetitions(1)
+	, m_isJson(false)
+	, m_isListing(false)
+{
+}
+
+bool BenchmarkRunner::parseArguments(int argc, char* argv[])
+{
+	m_executable = argc > 0 ? argv[0] : "";
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument(argv[i]);
+		const size_t separator = argument.find('=');
+		const std::string key = argument.substr(0, separator);
+		const std::string value = separator != std::string::npos ? argument.substr(separator + 1) : "";
+
+		if (key == "--benchmark_filter")
+		{
+			m_filter = value;
+		}
+		else if (key == "--benchmark_min_time")
+		{
+			// "0.5" and "0.5s" are both accepted
+			m_minTime = std::max(atof(value.c_str()), 0.001);
+		}
+		else if (key == "--benchmark_repetitions")
+		{
+			m_numRepetitions = std::max(atoi(value.c_str()), 1);
+		}
+		else if (key == "--benchmark_format")
+		{
+			if (value != "json" && value != "console")
+			{
+				std::cerr << "Unknown format: " << value << std::endl;
+				return false;
+			}
+			m_isJson = value == "json";
+		}
+		else if (key == "--benchmark_out")
+		{
+			m_outFile = value;
+		}
+		else if (key == "--benchmark_list_tests")
+		{
+			m_isListing = value.empty() || value == "true";
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << argument << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void BenchmarkRunner::printUsage(std::ostream& stream)
+{
+	stream << "usage: CrimsonBenchmarks [--benchmark_filter=<regex>] [--benchmark_min_time=<s>] [--benchmark_repetitions=<n>]" << std::endl
+		<< "                         [--benchmark_format=<console|json>] [--benchmark_out=<file>] [--benchmark_list_tests]" << std::endl;
+}
+
+int BenchmarkRunner::run()
+{
+	BenchmarkList benchmarks = getBenchmarks();
+	std::stable_sort(benchmarks.begin(), benchmarks.end(),
+		[](const BenchmarkList::value_type& a, const BenchmarkList::value_type& b) { return a.first < b.first; });
+
+	std::regex filter;
+	try
+	{
+		filter = std::regex(m_filter);
+	}
+	catch (const std::regex_error&)
+	{
+		std::cerr << "Bad filter: " << m_filter << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Result> results;
+
+	if (!m_isJson && !m_isListing)
+	{
+		writeConsoleHeader(std::cout);
+	}
+
+	for (const BenchmarkList::value_type& benchmark : benchmarks)
+	{
+		if (!std::regex_search(benchmark.first, filter))
+		{
+			continue;
+		}
+
+		if (m_isListing)
+		{
+			std::cout << benchmark.first << std::endl;
+			continue;
+		}
+
+		const size_t firstResult = results.size();
+		runBenchmark(benchmark.first, benchmark.second, results);
+
+		if (!m_isJson)
+		{
+			for (size_t i = firstResult; i < results.size(); i++)
+			{
+				writeConsoleResult(std::cout, results[i]);
+			}
+		}
+	}
+
+	if (m_isListing)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	if (m_isJson)
+	{
+		writeJson(std::cout, results);
+	}
+
+	if (!m_outFile.empty())
+	{
+		std::ofstream file(m_outFile.c_str());
+		if (!file)
+		{
+			std::cerr << "Error: Cannot write " << m_outFile << std::endl;
+			return EXIT_FAILURE;
+		}
+		writeJson(file, results);
+	}
+
+	const bool hasError = std::any_of(results.begin(), results.end(), [](const Result& result) { return result.isError; });
+	return hasError ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Grows the iteration count until a run takes the minimum time (like Google Benchmark does), then measures
+ * the repetitions with that count.
+ */
+void BenchmarkRunner::runBenchmark(const std::string& name, BenchmarkFunction function, std::vector<Result>& results)
+{
+	uint64_t numIterations = 1;
+	Result result;
+
+	for (;;)
+	{
+		result = measure(name, function, numIterations);
+		if (result.isError)
+		{
+			results.push_back(result);
+			return;
+		}
+
+		const double seconds = result.realTime * numIterations * 1e-9;
+		if (seconds >= m_minTime || numIterations >= s_maxIterations)
+		{
+			break;
+		}
+
+		// aim a bit over the minimum time, a short run is not trusted to predict more than 10x
+		double multiplier = m_minTime * 1.4 / std::max(seconds, 1e-9);
+		if (seconds / m_minTime <= 0.1)
+		{
+			multiplier = std::min(multiplier, 10.0);
+		}
+		if (multiplier <= 1.0)
+		{
+			multiplier = 2.0;
+		}
+
+		numIterations = std::min(std::max((uint64_t)(numIterations * multiplier), numIterations + 1), s_maxIterations);
+	}
+
+	std::vector<Result> runs(1, result);
+	for (int i = 1; i < m_numRepetitions; i++)
+	{
+		runs.push_back(measure(name, function, numIterations));
+		runs.back().repetitionIndex = i;
+	}
+
+	results.insert(results.end(), runs.begin(), runs.end());
+
+	if (m_numRepetitions > 1)
+	{
+		addAggregates(runs, results);
+	}
+}
+
+BenchmarkRunner::Result BenchmarkRunner::measure(const std::string& name, BenchmarkFunction function, uint64_t numIterations) const
+{
+	State state(numIterations);
+	function(state);
+
+	Result result;
+	result.name				= name;
+	result.runName			= name;
+	result.repetitionIndex	= 0;
+	result.numIterations	= numIterations;
+	result.realTime			= state.getRealTime() * 1e9 / numIterations;
+	result.cpuTime			= state.getCpuTime() * 1e9 / numIterations;
+	result.itemsPerSecond	= state.getItemsProcessed() > 0 && state.getRealTime() > 0.0 ? state.getItemsProcessed() / state.getRealTime() : 0.0;
+	result.bytesPerSecond	= state.getBytesProcessed() > 0 && state.getRealTime() > 0.0 ? state.getBytesProcessed() / state.getRealTime() : 0.0;
+	result.label			= state.getLabel();
+	result.isError			= state.isSkipped();
+	result.errorMessage		= state.getErrorMessage();
+
+	return result;
+}
+
+void BenchmarkRunner::addAggregates(const std::vector<Result>& runs, std::vector<Result>& results) const
+{
+	std::vector<double> realTimes, cpuTimes, itemsPerSecond, bytesPerSecond;
+	for (const Result& run : runs)
+	{
+		realTimes.push_back(run.realTime);
+		cpuTimes.push_back(run.cpuTime);
+		itemsPerSecond.push_back(run.itemsPerSecond);
+		bytesPerSecond.push_back(run.bytesPerSecond);
+	}
+
+	auto mean = [](const std::vector<double>& values)
+	{
+		double sum = 0.0;
+		for (double value : values)
+		{
+			sum += value;
+		}
+		return sum / values.size();
+	};
+
+	auto median = [](std::vector<double> values)
+	{
+		std::sort(values.begin(), values.end());
+		const size_t middle = values.size() / 2;
+		return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+	};
+
+	auto stddev = [&mean](const std::vector<double>& values)
+	{
+		const double average = mean(values);
+		double sum = 0.0;
+		for (double value : values)
+		{
+			sum += (value - average) * (value - average);
+		}
+		return values.size() > 1 ? std::sqrt(sum / (values.size() - 1)) : 0.0;
+	};
+
+	Result aggregate = runs.front();
+	aggregate.numIterations = runs.size();
+	aggregate.label.clear();
+
+	aggregate.aggregateName	= "mean";
+	aggregate.realTime		= mean(realTimes);
+	aggregate.cpuTime		= mean(cpuTimes);
+	aggregate.itemsPerSecond = mean(itemsPerSecond);
+	aggregate.bytesPerSecond = mean(bytesPerSecond);
+	results.push_back(aggregate);
+
+	aggregate.aggregateName	= "median";
+	aggregate.realTime		= median(realTimes);
+	aggregate.cpuTime		= median(cpuTimes);
+	aggregate.itemsPerSecond = median(itemsPerSecond);
+	aggregate.bytesPerSecond = median(bytesPerSecond);
+	results.push_back(aggregate);
+
+	aggregate.aggregateName	= "stddev";
+	aggregate.realTime		= stddev(realTimes);
+	aggregate.cpuTime		= stddev(cpuTimes);
+	aggregate.itemsPerSecond = aggregate.bytesPerSecond = 0.0;
+	results.push_back(aggregate);
+
+	for (size_t i = results.size() - 3; i < results.size(); i++)
+	{
+		results[i].name = results[i].runName + "_" + results[i].aggregateName;
+	}
+}
+
+
+void BenchmarkRunner::writeConsoleHeader(std::ostream& stream) const
+{
+	stream << getDate() << std::endl
+		<< "Running " << m_executable << std::endl
+		<< "Run on (" << boost::thread::hardware_concurrency() << " X CPU s)" << std::endl
+		<< std::string(80, '-') << std::endl
+		<< std::left << std::setw(40) << "Benchmark" << std::right << std::setw(13) << "Time" << std::setw(13) << "CPU" << std::setw(14) << "Iterations" << std::endl
+		<< std::string(80, '-') << std::endl;
+}
+
+void BenchmarkRunner::writeConsoleResult(std::ostream& stream, const Result& result) const
+{
+	stream << std::left << std::setw(40) << result.name << std::right;
+
+	if (result.isError)
+	{
+		stream << " ERROR OCCURRED: '" << result.errorMessage << "'" << std::endl;
+		return;
+	}
+
+	stream << std::fixed << std::setprecision(1)
+		<< std::setw(10) << result.realTime << " ns"
+		<< std::setw(10) << result.cpuTime << " ns"
+		<< std::setw(14) << result.numIterations;
+
+	if (result.itemsPerSecond > 0.0)
+	{
+		stream << " items_per_second=" << std::setprecision(3) << result.itemsPerSecond / 1e6 << "M/s";
+	}
+	if (result.bytesPerSecond > 0.0)
+	{
+		stream << " bytes_per_second=" << std::setprecision(3) << result.bytesPerSecond / (1024.0 * 1024.0) << "MiB/s";
+	}
+	if (!result.label.empty())
+	{
+		stream << " " << result.label;
+	}
+
+	stream << std::defaultfloat << std::endl;
+}
+
+void BenchmarkRunner::writeJson(std::ostream& stream, const std::vector<Result>& results) const
+{
+	stream << std::setprecision(10);
+
+	stream << "{" << std::endl
+		<< "  \"context\": {" << std::endl
+		<< "    \"date\": \"" << escapeJson(getDate()) << "\"," << std::endl
+		<< "    \"host_name\": \"" << escapeJson(getHostName()) << "\"," << std::endl
+		<< "    \"executable\": \"" << escapeJson(m_executable) << "\"," << std::endl
+		<< "    \"num_cpus\": " << boost::thread::hardware_concurrency() << "," << std::endl
+#if defined(DEBUG) | defined(_DEBUG)
+		<< "    \"library_build_type\": \"debug\"" << std::endl
+#else
+		<< "    \"library_build_type\": \"release\"" << std::endl
+#endif
+		<< "  }," << std::endl
+		<< "  \"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& result = results[i];
+
+		stream << (i == 0 ? "" : ",") << std::endl
+			<< "    {" << std::endl
+			<< "      \"name\": \"" << escapeJson(result.name) << "\"," << std::endl
+			<< "      \"run_name\": \"" << escapeJson(result.runName) << "\"," << std::endl;
+
+		if (result.aggregateName.empty())
+		{
+			stream << "      \"run_type\": \"iteration\"," << std::endl
+				<< "      \"repetitions\": " << m_numRepetitions << "," << std::endl
+				<< "      \"repetition_index\": " << result.repetitionIndex << "," << std::endl;
+		}
+		else
+		{
+			stream << "      \"run_type\": \"aggregate\"," << std::endl
+				<< "      \"repetitions\": " << m_numRepetitions << "," << std::endl
+				<< "      \"aggregate_name\": \"" << result.aggregateName << "\"," << std::endl;
+		}
+
+		stream << "      \"threads\": 1," << std::endl;
+
+		if (result.isError)
+		{
+			stream << "      \"error_occurred\": true," << std::endl
+				<< "      \"error_message\": \"" << escapeJson(result.errorMessage) << "\"" << std::endl
+				<< "    }";
+			continue;
+		}
+
+		stream << "      \"iterations\": " << result.numIterations << "," << std::endl
+			<< "      \"real_time\": " << result.realTime << "," << std::endl
+			<< "      \"cpu_time\": " << result.cpuTime << "," << std::endl;
+
+		if (result.bytesPerSecond > 0.0)
+		{
+			stream << "      \"bytes_per_second\": " << result.bytesPerSecond << "," << std::endl;
+		}
+		if (result.itemsPerSecond > 0.0)
+		{
+			stream << "      \"items_per_second\": " << result.itemsPerSecond << "," << std::endl;
+		}
+		if (!result.label.empty())
+		{
+			stream << "      \"label\": \"" << escapeJson(result.label) << "\"," << std::endl;
+		}
+
+		stream << "      \"time_unit\": \"ns\"" << std::endl
+			<< "    }";
+	}
+
+	stream << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+std::string BenchmarkRunner::escapeJson(const std::string& str)
+{
+	std::ostringstream escaped;
+	for (const char c : str)
+	{
+		switch (c)
+		{
+		case '"':	escaped << "\\\"";	break;
+		case '\\':	escaped << "\\\\";	break;
+		case '\n':	escaped << "\\n";	break;
+		case '\r':	escaped << "\\r";	break;
+		case '\t':	escaped << "\\t";	break;
+		default:
+			if ((uint8_t)c < 0x20)
+			{
+				escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+			}
+			else
+			{
+				escaped << c;
+			}
+		}
+	}
+	return escaped.str();
+}
+
+std::string BenchmarkRunner::getDate()
+{
+	const std::time_t now = std::time(nullptr);
+	char date[64];
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+	return date;
+}
+
+std::string BenchmarkRunner::getHostName()
+{
+	char hostName[256] = "";
+#ifdef WIN32
+	DWORD size = sizeof(hostName);
+	GetComputerNameA(hostName, &size);
+#else
+	gethostname(hostName, sizeof(hostName) - 1);
+#endif
+	return hostName;
+}
+
+} // namespace benchmark
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace benchmark
+{
+
+/**
+ * @brief The timed loop of a benchmark run: the body of while (state.keepRunning()) runs getIterations() times.
+ *
+ * The clocks start at the first keepRunning() call, so the setup before the loop is not measured. The iteration count
+ * is chosen by the runner (it grows the count until a run takes the minimum time).
+ */
+class State
+{
+public:
+	explicit State(uint64_t numIterations);
+
+	inline bool keepRunning()
+	{
+		if (m_numIterationsLeft != 0)
+		{
+			if (m_numIterationsLeft == m_numIterations)
+			{
+				startTiming();
+			}
+
+			--m_numIterationsLeft;
+			return true;
+		}
+
+		stopTiming();
+		return false;
+	}
+
+	// the work of a run, reported per second (eg. vertices skinned, bytes marshalled)
+	void	setItemsProcessed(uint64_t numItems) { m_numItems = numItems; }
+	void	setBytesProcessed(uint64_t numBytes) { m_numBytes = numBytes; }
+	void	setLabel(const std::string& label) { m_label = label; }
+
+	// the benchmark can't run (eg. missing data), reported as an error
+	void	skip(const std::string& message) { m_isSkipped = true; m_errorMessage = message; m_numIterationsLeft = 0; }
+
+	// getters-setters
+	uint64_t	getIterations() const { return m_numIterations; }
+	uint64_t	getItemsProcessed() const { return m_numItems; }
+	uint64_t	getBytesProcessed() const { return m_numBytes; }
+	const std::string& getLabel() const { return m_label; }
+
+	bool		isSkipped() const { return m_isSkipped; }
+	const std::string& getErrorMessage() const { return m_errorMessage; }
+
+	double		getRealTime() const { return m_realTime; }		// s
+	double		getCpuTime() const { return m_cpuTime; }		// s
+
+private:
+	void	startTiming();
+	void	stopTiming();
+
+private:
+	uint64_t	m_numIterations;
+	uint64_t	m_numIterationsLeft;
+
+	uint64_t	m_numItems;
+	uint64_t	m_numBytes;
+	std::string	m_label;
+
+	bool		m_isSkipped;
+	std::string	m_errorMessage;
+
+	std::chrono::high_resolution_clock::time_point	m_realStartTime;
+	double		m_cpuStartTime;
+	double		m_realTime;
+	double		m_cpuTime;
+	bool		m_isTiming;
+};
+
+typedef void (*BenchmarkFunction)(State& state);
+
+int		registerBenchmark(const char* name, BenchmarkFunction function);
+
+// the cpu time of the calling thread in seconds
+double	getThreadCpuTime();
+
+#ifdef _MSC_VER
+extern const volatile void* g_pSink;
+#endif
+
+/**
+ * Keeps the compiler from optimizing away the computation of value (it may be stored, read or printed).
+ */
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#ifdef _MSC_VER
+	g_pSink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+/**
+ * Forces the pending writes to memory, eg. the results written into a buffer that is not read later.
+ */
+inline void clobberMemory()
+{
+#ifdef _MSC_VER
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : : "memory");
+#endif
+}
+
+
+/**
+ * @brief Runs the registered benchmarks and reports the results.
+ *
+ * The command line follows Google Benchmark, so the results can be compared with its tools (eg. compare.py):
+ *	--benchmark_filter=<regex>			runs the benchmarks with a matching name
+ *	--benchmark_min_time=<s>			the minimum time of a measured run (default 0.5 s)
+ *	--benchmark_repetitions=<n>			measured runs per benchmark, their mean/median/stddev is reported too
+ *	--benchmark_format=<console|json>	the format on the standard output
+ *	--benchmark_out=<file>				writes the json report to the file too
+ *	--benchmark_list_tests				lists the benchmarks without running them
+ * The json report has the layout of Google Benchmark: a context object and a benchmarks array, times in ns.
+ */
+class BenchmarkRunner
+{
+public:
+	BenchmarkRunner();
+
+	bool	parseArguments(int argc, char* argv[]);
+	int		run();
+
+	static void	printUsage(std::ostream& stream);
+
+private:
+	struct Result
+	{
+		std::string	name;
+		std::string	runName;
+		std::string	aggregateName;		// empty: a measured run
+		int			repetitionIndex;
+
+		uint64_t	numIterations;
+		double		realTime;			// ns per iteration
+		double		cpuTime;			// ns per iteration
+		double		itemsPerSecond;		// 0: not set
+		double		bytesPerSecond;		// 0: not set
+		std::string	label;
+
+		bool		isError;
+		std::string	errorMessage;
+	};
+
+	void	runBenchmark(const std::string& name, BenchmarkFunction function, std::vector<Result>& results);
+	Result	measure(const std::string& name, BenchmarkFunction function, uint64_t numIterations) const;
+	void	addAggregates(const std::vector<Result>& runs, std::vector<Result>& results) const;
+
+	void	writeConsoleHeader(std::ostream& stream) const;
+	void	writeConsoleResult(std::ostream& stream, const Result& result) const;
+	void	writeJson(std::ostream& stream, const std::vector<Result>& results) const;
+
+	static std::string	escapeJson(const std::string& str);
+	static std::string	getDate();
+	static std::string	getHostName();
+
+private:
+	std::string	m_filter;
+	double		m_minTime;
+	int			m_numRepetitions;
+	bool		m_isJson;
+	bool		m_isListing;
+	std::string	m_outFile;
+	std::string	m_executable;
+};
+
+} // namespace benchmark
+
+
+#define BENCHMARK_CONCAT_(a, b)		a##b
+#define BENCHMARK_CONCAT(a, b)		BENCHMARK_CONCAT_(a, b)
+
+// defines and registers a benchmark: BENCHMARK(Math_QuatSlerp) { ... while (state.keepRunning()) { ... } }
+#define BENCHMARK(name)				static void name(benchmark::State& state);																		\
+									static const int BENCHMARK_CONCAT(name, _registration) = benchmark::registerBenchmark(#name, &name);		\
+									static void name(benchmark::State& state)
@@ -0,0 +1,40 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Common/LuaManager.h"
+#include "Common/TraceRecorder.h"
+#include "Common/PerformanceMetrics.h"
+#include "GameLogic/ComponentFactory.h"
+
+
+int main(int argc, char* argv[])
+{
+	benchmark::BenchmarkRunner runner;
+	if (!runner.parseArguments(argc, argv))
+	{
+		benchmark::BenchmarkRunner::printUsage(std::cerr);
+		return EXIT_FAILURE;
+	}
+
+	// the report may be written to the standard output: the log goes to a file
+	new LoggerSystem(LogLevel::ERR);
+	LoggerSystem::getInstance()->setOutputFile("benchmarks.log");
+
+	new TraceRecorder();
+	new PerformanceMetrics();
+	new JobPool();
+	new ConstantManager();
+	new ComponentFactory();
+
+	new LuaManager();
+	LuaManager::getInstance()->init();
+
+	const int result = runner.run();
+
+	LuaManager::getInstance()->close();
+	JobPool::destroyInstance();
+	LoggerSystem::getInstance()->flush();
+
+	return result;
+}
@@ -0,0 +1,69 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+
+
+// set once: every set publishes a new snapshot, which is kept until the manager is destroyed
+static void setBenchmarkConstants()
+{
+	static bool isSet = false;
+	if (!isSet)
+	{
+		ConstantManager::getInstance()->setFloatConstant("Benchmark::Float", 1.5f);
+		ConstantManager::getInstance()->setVectorConstant("Benchmark::Vector", vec3(1.0f, 2.0f, 3.0f));
+		ConstantManager::getInstance()->setStringConstant("Benchmark::String", "benchmark");
+		isSet = true;
+	}
+}
+
+
+BENCHMARK(Constant_FloatByMacro)
+{
+	setBenchmarkConstants();
+
+	while (state.keepRunning())
+	{
+		benchmark::doNotOptimize(CONST_FLOAT("Benchmark::Float"));
+	}
+}
+
+BENCHMARK(Constant_FloatByHandle)
+{
+	setBenchmarkConstants();
+	const ConstantHandle handle = ConstantManager::getInstance()->getHandle("Benchmark::Float");
+
+	while (state.keepRunning())
+	{
+		benchmark::doNotOptimize(ConstantManager::getInstance()->getFloat(handle));
+	}
+}
+
+BENCHMARK(Constant_FloatByName)
+{
+	setBenchmarkConstants();
+	const std::string name = "Benchmark::Float";
+
+	while (state.keepRunning())
+	{
+		benchmark::doNotOptimize(ConstantManager::getInstance()->getFloatConstant(name));
+	}
+}
+
+BENCHMARK(Constant_Vec3ByMacro)
+{
+	setBenchmarkConstants();
+
+	while (state.keepRunning())
+	{
+		benchmark::doNotOptimize(CONST_VEC3("Benchmark::Vector"));
+	}
+}
+
+BENCHMARK(Constant_StringByMacro)
+{
+	setBenchmarkConstants();
+
+	while (state.keepRunning())
+	{
+		benchmark::doNotOptimize(CONST_STR("Benchmark::String"));
+	}
+}
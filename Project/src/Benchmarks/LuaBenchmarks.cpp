@@ -0,0 +1,86 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "Common/LuaManager.h"
+
+
+static const char* s_benchmarkFunctions =
+	"function benchmarkEmpty() end\n"
+	"function benchmarkAdd(a, b) benchmarkSum = a + b end\n"
+	"function benchmarkLoop(n) local sum = 0 for i = 1, n do sum = sum + i end benchmarkSum = sum end\n";
+
+static void defineBenchmarkFunctions()
+{
+	LuaManager::getInstance()->doString(s_benchmarkFunctions);
+}
+
+
+/**
+ * The cost of the bridge: the check of the cached function and the luabind call, the function does nothing.
+ */
+BENCHMARK(Lua_CallFunction)
+{
+	defineBenchmarkFunctions();
+	LuaManager* pLuaManager = LuaManager::getInstance();
+	const LuaFunctionHandle function = pLuaManager->getFunctionHandle("benchmarkEmpty");
+
+	while (state.keepRunning())
+	{
+		pLuaManager->callFunction(function);
+	}
+}
+
+/**
+ * The same call by name (the GUI callbacks): the name is looked up every call.
+ */
+BENCHMARK(Lua_CallFunctionByName)
+{
+	defineBenchmarkFunctions();
+	LuaManager* pLuaManager = LuaManager::getInstance();
+
+	while (state.keepRunning())
+	{
+		pLuaManager->callFunction("benchmarkEmpty");
+	}
+}
+
+BENCHMARK(Lua_CallFunctionArgs)
+{
+	defineBenchmarkFunctions();
+	LuaManager* pLuaManager = LuaManager::getInstance();
+	const LuaFunctionHandle function = pLuaManager->getFunctionHandle("benchmarkAdd");
+
+	while (state.keepRunning())
+	{
+		pLuaManager->callFunction(function, 1.5f, 2.5f);
+	}
+}
+
+/**
+ * A call doing lua work (like the scene callbacks do), to compare the bridge overhead with.
+ */
+BENCHMARK(Lua_CallFunctionLoop)
+{
+	defineBenchmarkFunctions();
+	LuaManager* pLuaManager = LuaManager::getInstance();
+	const LuaFunctionHandle function = pLuaManager->getFunctionHandle("benchmarkLoop");
+
+	while (state.keepRunning())
+	{
+		pLuaManager->callFunction(function, 100);
+	}
+
+	state.setItemsProcessed(state.getIterations() * 100);
+}
+
+/**
+ * A console command run again: the compiled chunk is taken from the chunk cache.
+ */
+BENCHMARK(Lua_DoStringCached)
+{
+	LuaManager* pLuaManager = LuaManager::getInstance();
+
+	while (state.keepRunning())
+	{
+		pLuaManager->doString("benchmarkValue = 1");
+	}
+}
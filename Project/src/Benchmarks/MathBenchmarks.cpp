@@ -0,0 +1,303 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "Math/quaternion.h"
+
+#include <random>
+
+
+// the operations run over arrays of inputs (like the skinning does), not on one value the compiler could fold
+static const size_t s_numValues = 1024;
+
+static std::vector<vec3> createVectors()
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+	std::vector<vec3> vectors(s_numValues);
+	for (vec3& v : vectors)
+	{
+		v = vec3(distribution(random), distribution(random), distribution(random));
+	}
+	return vectors;
+}
+
+static std::vector<Quat> createQuats()
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	std::vector<Quat> quats(s_numValues);
+	for (Quat& q : quats)
+	{
+		q = Quat::fromAxis(distribution(random) * 180.0f, normalize(vec3(distribution(random), distribution(random), distribution(random) + 2.0f)));
+	}
+	return quats;
+}
+
+static std::vector<Matrix> createMatrices()
+{
+	const std::vector<vec3> vectors = createVectors();
+
+	std::vector<Matrix> matrices(s_numValues);
+	for (size_t i = 0; i < s_numValues; i++)
+	{
+		matrices[i] = Matrix(vectors[i], vectors[(i + 1) % s_numValues], vec3(1.0f));
+	}
+	return matrices;
+}
+
+
+// vec3
+
+BENCHMARK(Math_Vec3AddScale)
+{
+	const std::vector<vec3> a = createVectors();
+	const std::vector<vec3> b = createVectors();
+	std::vector<vec3> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = (a[i] + b[s_numValues - 1 - i]) * 0.5f;
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_Vec3DotCross)
+{
+	const std::vector<vec3> a = createVectors();
+	const std::vector<vec3> b = createVectors();
+
+	while (state.keepRunning())
+	{
+		float sum = 0.0f;
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			sum += dot(a[i], cross(a[i], b[s_numValues - 1 - i]));
+		}
+		benchmark::doNotOptimize(sum);
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_Vec3Normalize)
+{
+	const std::vector<vec3> a = createVectors();
+	std::vector<vec3> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = normalize(a[i]);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+
+// Matrix
+
+BENCHMARK(Math_MatrixMultiply)
+{
+	const std::vector<Matrix> a = createMatrices();
+	std::vector<Matrix> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = a[i] * a[s_numValues - 1 - i];
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_MatrixInverse)
+{
+	const std::vector<Matrix> a = createMatrices();
+	std::vector<Matrix> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = a[i].inverse();
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_MatrixTransform)
+{
+	const std::vector<Matrix> a = createMatrices();
+	const std::vector<vec3> v = createVectors();
+	std::vector<vec3> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = a[i].transform(v[i]);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+/**
+ * The points of a mesh by one matrix, one call: compare with Math_MatrixTransformLoop.
+ */
+BENCHMARK(Math_MatrixTransformArray)
+{
+	const Matrix matrix = createMatrices()[0];
+	const std::vector<vec3> v = createVectors();
+	std::vector<vec3> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		matrix.transformArray(v.data(), result.data(), s_numValues);
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_MatrixTransformLoop)
+{
+	const Matrix matrix = createMatrices()[0];
+	const std::vector<vec3> v = createVectors();
+	std::vector<vec3> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = matrix.transform(v[i]);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+/**
+ * A scene traversal: the world matrices of a node tree (parents first), then the bounding points of every node.
+ */
+BENCHMARK(Math_SceneTraversal)
+{
+	static const size_t numPoints = 8;
+
+	const std::vector<Matrix> local = createMatrices();
+	const std::vector<vec3> bounds = createVectors();
+
+	std::vector<size_t> parents(s_numValues);
+	for (size_t i = 1; i < s_numValues; i++)
+	{
+		parents[i] = (i - 1) / 4;
+	}
+
+	std::vector<Matrix> world(s_numValues);
+	std::vector<vec3> points(s_numValues * numPoints);
+
+	while (state.keepRunning())
+	{
+		world[0] = local[0];
+		for (size_t i = 1; i < s_numValues; i++)
+		{
+			world[i] = world[parents[i]] * local[i];
+		}
+
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			world[i].transformArray(&bounds[(i * numPoints) % (s_numValues - numPoints)], &points[i * numPoints], numPoints);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+
+// Quat
+
+BENCHMARK(Math_QuatMultiply)
+{
+	const std::vector<Quat> a = createQuats();
+	std::vector<Quat> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = a[i] * a[s_numValues - 1 - i];
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_QuatRotateVec)
+{
+	const std::vector<Quat> a = createQuats();
+	const std::vector<vec3> v = createVectors();
+	std::vector<vec3> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = a[i].rotateVec(v[i]);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_QuatSlerp)
+{
+	const std::vector<Quat> a = createQuats();
+	std::vector<Quat> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = Quat::slerp(a[i], a[s_numValues - 1 - i], (i % 16) / 16.0f);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
+
+BENCHMARK(Math_QuatGetMatrix)
+{
+	const std::vector<Quat> a = createQuats();
+	std::vector<Matrix> result(s_numValues);
+
+	while (state.keepRunning())
+	{
+		for (size_t i = 0; i < s_numValues; i++)
+		{
+			result[i] = a[i].getMatrix();
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numValues);
+}
@@ -0,0 +1,419 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "Common/JobPool.h"
+#include "Models/md2/ModelMd2.h"
+#include "Models/md5/ModelMd5.h"
+#include "Models/mesh/MeshOptimizer.h"
+
+#include <algorithm>
+#include <random>
+
+
+// the models are loaded without their textures and gl buffers (like on the server): the benchmarks need no gl context
+static const char* s_md5MeshFile = "/models/Md5/zombie3.md5mesh";
+static const char* s_md5AnimFile = "/models/Md5/zombie_walk.md5anim";
+static const char* s_md2File = "/models/Md2/tris.md2";
+
+static const float s_frameTime = 1.0f / 60.0f;
+
+static void deleteMeshes(MeshDirectory& meshDirectory)
+{
+	for (auto& mesh : meshDirectory)
+	{
+		delete mesh.second;
+	}
+	meshDirectory.clear();
+}
+
+/**
+ * The playing md5 model of a benchmark, deleted with the fixture. The benchmark is skipped if it can't be loaded.
+ */
+class Md5Fixture
+{
+public:
+	explicit Md5Fixture(benchmark::State& state)
+		: m_textures("textures")
+		, m_pModel(nullptr)
+	{
+		const std::string meshFile = CONST_STR("dataDir") + s_md5MeshFile;
+		const std::string animFile = CONST_STR("dataDir") + s_md5AnimFile;
+
+		if (!models::ModelMd5::load(meshFile.c_str(), animFile.c_str(), m_meshDirectory, m_textures, "benchmark", true))
+		{
+			state.skip("can't load " + meshFile);
+			return;
+		}
+
+		m_pModel = static_cast<models::ModelMd5*>(m_meshDirectory["benchmark"]);
+		m_pModel->setAnimationLooping(true);
+		m_pModel->play();
+	}
+
+	~Md5Fixture()
+	{
+		deleteMeshes(m_meshDirectory);
+	}
+
+	bool				isLoaded() const { return m_pModel != nullptr; }
+	models::ModelMd5*	getModel() const { return m_pModel; }
+
+private:
+	Md5Fixture(const Md5Fixture& other);
+	Md5Fixture& operator=(const Md5Fixture& other);
+
+private:
+	MeshDirectory		m_meshDirectory;
+	TexturePool			m_textures;
+	models::ModelMd5*	m_pModel;
+};
+
+
+/**
+ * Advances the clip and finds the pose: a slerp per joint, from the pose cache after the first loop of the clip.
+ */
+BENCHMARK(Model_Md5Animate)
+{
+	Md5Fixture fixture(state);
+	if (!fixture.isLoaded())
+	{
+		return;
+	}
+
+	models::ModelMd5* pModel = fixture.getModel();
+
+	while (state.keepRunning())
+	{
+		pModel->animate(s_frameTime);
+		models::ModelMd5::updatePoses();
+		benchmark::doNotOptimize(*pModel->getSkeleton());
+	}
+}
+
+/**
+ * The cpu skinning of prepareMesh(): every vertex is blended from its weights, without the upload.
+ * The soa kernels on the threads of the JobPool.
+ */
+BENCHMARK(Model_Md5PrepareMesh)
+{
+	Md5Fixture fixture(state);
+	if (!fixture.isLoaded())
+	{
+		return;
+	}
+
+	models::ModelMd5* pModel = fixture.getModel();
+
+	pModel->animate(s_frameTime);
+	models::ModelMd5::updatePoses();
+
+	std::vector<models::Vertex> vertices;
+	pModel->skinMeshes(vertices);
+
+	while (state.keepRunning())
+	{
+		pModel->skinMeshes(vertices);
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * vertices.size());
+	state.setLabel("vertices=" + std::to_string(vertices.size()));
+}
+
+/**
+ * The skinning before the soa kernels: the weight structs of a vertex, one vertex at a time.
+ */
+BENCHMARK(Model_Md5SkinAoS)
+{
+	Md5Fixture fixture(state);
+	if (!fixture.isLoaded())
+	{
+		return;
+	}
+
+	models::ModelMd5* pModel = fixture.getModel();
+
+	pModel->animate(s_frameTime);
+	models::ModelMd5::updatePoses();
+
+	std::vector<models::Vertex> vertices;
+	pModel->skinMeshesAoS(vertices);
+
+	while (state.keepRunning())
+	{
+		pModel->skinMeshesAoS(vertices);
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * vertices.size());
+	state.setLabel("vertices=" + std::to_string(vertices.size()));
+}
+
+/**
+ * The soa kernels of the skinning on the calling thread: 4 (sse) or 8 (avx) vertices at once.
+ */
+BENCHMARK(Model_Md5SkinSoA)
+{
+	Md5Fixture fixture(state);
+	if (!fixture.isLoaded())
+	{
+		return;
+	}
+
+	models::ModelMd5* pModel = fixture.getModel();
+
+	pModel->animate(s_frameTime);
+	models::ModelMd5::updatePoses();
+
+	const std::vector<const models::ModelMd5*> models = { pModel };
+	std::vector<std::vector<models::Vertex>> vertices;
+	models::ModelMd5::skinModels(models, vertices, false);
+
+	while (state.keepRunning())
+	{
+		models::ModelMd5::skinModels(models, vertices, false);
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * vertices[0].size());
+	state.setLabel("vertices=" + std::to_string(vertices[0].size()));
+}
+
+/**
+ * A crowd: the model instances (copies sharing one ModelMd5Resource, each in its own pose) are skinned together,
+ * their vertex groups shared between the threads of the JobPool.
+ */
+BENCHMARK(Model_Md5SkinInstances)
+{
+	static const uint numInstances = 64;
+
+	Md5Fixture fixture(state);
+	if (!fixture.isLoaded())
+	{
+		return;
+	}
+
+	models::ModelMd5* pModel = fixture.getModel();
+
+	std::vector<std::unique_ptr<models::ModelMd5>> instances;
+	std::vector<const models::ModelMd5*> models;
+	for (uint i = 0; i < numInstances; i++)
+	{
+		instances.emplace_back(pModel->copy());
+		instances.back()->animate(s_frameTime * (i + 1));
+		models.push_back(instances.back().get());
+	}
+	models::ModelMd5::updatePoses();
+
+	std::vector<std::vector<models::Vertex>> vertices;
+	models::ModelMd5::skinModels(models, vertices);
+
+	while (state.keepRunning())
+	{
+		models::ModelMd5::skinModels(models, vertices);
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * numInstances * vertices[0].size());
+	state.setLabel("instances=" + std::to_string(numInstances) + " threads=" + std::to_string(JobPool::getInstance()->getNumThreads()));
+}
+
+/**
+ * A crowd of the maxNumZombies of bsp.lua walking out of step: the instances showing the same quantized clip time
+ * share a cached pose, the missing poses are evaluated together on the JobPool.
+ */
+BENCHMARK(Model_Md5AnimateCrowd)
+{
+	static const uint numInstances = 100;
+
+	Md5Fixture fixture(state);
+	if (!fixture.isLoaded())
+	{
+		return;
+	}
+
+	models::ModelMd5* pModel = fixture.getModel();
+
+	std::vector<std::unique_ptr<models::ModelMd5>> instances;
+	for (uint i = 0; i < numInstances; i++)
+	{
+		instances.emplace_back(pModel->copy());
+		for (uint j = 0; j < i; j++)
+		{
+			instances.back()->animate(s_frameTime);
+		}
+	}
+	models::ModelMd5::updatePoses();
+
+	while (state.keepRunning())
+	{
+		for (const std::unique_ptr<models::ModelMd5>& pInstance : instances)
+		{
+			pInstance->animate(s_frameTime);
+		}
+		models::ModelMd5::updatePoses();
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * numInstances);
+	state.setLabel("instances=" + std::to_string(numInstances) + " cachedPoses=" + std::to_string(pModel->getResource()->getNumCachedPoses()));
+}
+
+/**
+ * Parses the text md5mesh and md5anim files: the mesh, its weights and skinning layouts, the skeletons of the frames.
+ */
+BENCHMARK(Model_Md5LoadText)
+{
+	const std::string meshFile = CONST_STR("dataDir") + s_md5MeshFile;
+	const std::string animFile = CONST_STR("dataDir") + s_md5AnimFile;
+
+	while (state.keepRunning())
+	{
+		models::ModelMd5Resource resource;
+		if (!resource.loadMesh(meshFile.c_str()) || !resource.loadAnim(animFile.c_str()))
+		{
+			state.skip("can't load " + meshFile);
+			return;
+		}
+		benchmark::doNotOptimize(resource);
+	}
+}
+
+/**
+ * The same model baked by the CrimsonModelConverter: the sections copied from the file mapping.
+ */
+BENCHMARK(Model_Md5LoadBinary)
+{
+	static const char* binaryFile = "benchmark.md5bin";
+
+	const std::string meshFile = CONST_STR("dataDir") + s_md5MeshFile;
+	const std::string animFile = CONST_STR("dataDir") + s_md5AnimFile;
+
+	{
+		models::ModelMd5Resource resource;
+		if (!resource.loadMesh(meshFile.c_str()) || !resource.loadAnim(animFile.c_str()) || !resource.saveBinary(binaryFile))
+		{
+			state.skip("can't bake " + meshFile);
+			return;
+		}
+	}
+
+	while (state.keepRunning())
+	{
+		models::ModelMd5Resource resource;
+		if (!resource.loadBinary(binaryFile))
+		{
+			state.skip("can't load " + std::string(binaryFile));
+			break;
+		}
+		benchmark::doNotOptimize(resource);
+	}
+
+	std::remove(binaryFile);
+}
+
+/**
+ * Interpolates the key frames of every triangle corner and recalculates the tangents.
+ */
+BENCHMARK(Model_Md2Animate)
+{
+	MeshDirectory meshDirectory;
+	TexturePool textures("textures");
+
+	// the data has no md2 model by default
+	const std::string file = CONST_STR("dataDir") + s_md2File;
+	if (!utils::file::existFile(file))
+	{
+		state.skip("no " + file);
+		return;
+	}
+
+	if (!models::ModelMd2::load(file.c_str(), meshDirectory, textures, "benchmark", true))
+	{
+		state.skip("can't load " + file);
+		return;
+	}
+
+	models::ModelMd2* pModel = static_cast<models::ModelMd2*>(meshDirectory["benchmark"]);
+	pModel->setCurrentAnimationName("stand");
+	pModel->setAnimationLooping(true);
+	pModel->play();
+
+	while (state.keepRunning())
+	{
+		pModel->animate(s_frameTime);
+		benchmark::clobberMemory();
+	}
+
+	deleteMeshes(meshDirectory);
+}
+
+/**
+ * Welds, orders for the vertex cache and indexes a triangle soup like the ones of the 3ds files: a 64x64 quad grid
+ * with smooth normals, its triangles shuffled. The label tells the vertices transformed per triangle (a 16 entry fifo)
+ * of the soup, of the welded triangles in the order of the file and of the optimized ones.
+ */
+BENCHMARK(Model_OptimizeMesh)
+{
+	static const uint gridSize = 64;
+
+	std::vector<models::Vertex> corners;
+	for (uint y = 0; y < gridSize; y++)
+	{
+		for (uint x = 0; x < gridSize; x++)
+		{
+			const models::Vertex quad[4] = {
+				models::Vertex(vec3((float)x, 0.0f, (float)y), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f), texCoord((float)x / gridSize, (float)y / gridSize)),
+				models::Vertex(vec3((float)x + 1, 0.0f, (float)y), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f), texCoord((float)(x + 1) / gridSize, (float)y / gridSize)),
+				models::Vertex(vec3((float)x, 0.0f, (float)y + 1), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f), texCoord((float)x / gridSize, (float)(y + 1) / gridSize)),
+				models::Vertex(vec3((float)x + 1, 0.0f, (float)y + 1), vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f), texCoord((float)(x + 1) / gridSize, (float)(y + 1) / gridSize))
+			};
+
+			corners.push_back(quad[0]);
+			corners.push_back(quad[2]);
+			corners.push_back(quad[1]);
+
+			corners.push_back(quad[1]);
+			corners.push_back(quad[2]);
+			corners.push_back(quad[3]);
+		}
+	}
+
+	// the triangles in the order of an exporter: no locality
+	std::vector<uint> triangles(corners.size() / 3);
+	for (uint i = 0; i < triangles.size(); i++)
+	{
+		triangles[i] = i;
+	}
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+
+	std::vector<models::Vertex> soup;
+	soup.reserve(corners.size());
+	for (const uint triangle : triangles)
+	{
+		soup.insert(soup.end(), corners.begin() + triangle * 3, corners.begin() + triangle * 3 + 3);
+	}
+
+	const std::vector<uint> numSubsetVertices(1, (uint)soup.size());
+
+	std::vector<models::Vertex> vertices;
+	std::vector<GLuint> indices;
+	std::vector<models::Mesh::Subset> subsets;
+
+	while (state.keepRunning())
+	{
+		models::MeshOptimizer::build(soup.data(), numSubsetVertices, vertices, indices, subsets);
+		benchmark::doNotOptimize(indices.data());
+	}
+	state.setItemsProcessed(state.getIterations() * soup.size() / 3);
+
+	std::vector<models::Vertex> weldedVertices;
+	std::vector<GLuint> weldedIndices;
+	models::MeshOptimizer::weldVertices(soup.data(), (uint)soup.size(), weldedVertices, weldedIndices);
+
+	std::ostringstream label;
+	label.precision(2);
+	label << std::fixed << "vertices=" << soup.size() << "->" << vertices.size()
+		<< " acmr=3.00/" << models::MeshOptimizer::getAverageCacheMissRatio(weldedIndices.data(), (uint)weldedIndices.size())
+		<< "/" << models::MeshOptimizer::getAverageCacheMissRatio(indices.data(), (uint)indices.size());
+	state.setLabel(label.str());
+}
@@ -0,0 +1,159 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "GameLogic/Components.h"
+#include "Network/connection.h"
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+
+// a broadcast sized batch of component updates: every drone moved
+static const size_t s_numComponents = 64;
+
+static std::vector<Movement> createMovements()
+{
+	std::vector<Movement> movements;
+	for (size_t i = 0; i < s_numComponents; i++)
+	{
+		Movement movement;
+		movement.set_pos(vec2(i * 10.5f, i * -3.25f));
+		movement.set_vel(vec2(1.0f, 0.5f));
+		movements.push_back(movement);
+	}
+	return movements;
+}
+
+enum class MarshalFormat
+{
+	TEXT = 0,
+	BINARY,
+};
+
+static std::string marshalMovements(std::vector<Movement>& movements, MarshalFormat format, short compressionScheme)
+{
+	return format == MarshalFormat::TEXT ? network::marshalText(movements, compressionScheme) : network::marshalBinary(movements, compressionScheme);
+}
+
+static void benchmarkMarshal(benchmark::State& state, MarshalFormat format, short compressionScheme)
+{
+	std::vector<Movement> movements = createMovements();
+	size_t packetSize = 0;
+
+	while (state.keepRunning())
+	{
+		const std::string packet = marshalMovements(movements, format, compressionScheme);
+		packetSize = packet.size();
+		benchmark::doNotOptimize(packet);
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numComponents);
+	state.setBytesProcessed(state.getIterations() * packetSize);
+	state.setLabel("packet=" + std::to_string(packetSize) + "B");
+}
+
+static void benchmarkUnmarshal(benchmark::State& state, MarshalFormat format, short compressionScheme)
+{
+	std::vector<Movement> movements = createMovements();
+	const std::string packet = marshalMovements(movements, format, compressionScheme);
+
+	while (state.keepRunning())
+	{
+		const bool isUnmarshalled = format == MarshalFormat::TEXT ? network::unmarshalText(movements, packet, compressionScheme) : network::unmarshalBinary(movements, packet, compressionScheme);
+		if (!isUnmarshalled)
+		{
+			state.skip("the packet can't be unmarshalled");
+			return;
+		}
+		benchmark::doNotOptimize(movements);
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numComponents);
+	state.setBytesProcessed(state.getIterations() * packet.size());
+	state.setLabel("packet=" + std::to_string(packet.size()) + "B");
+}
+
+
+// marshalling
+
+BENCHMARK(Serialization_MarshalText)				{ benchmarkMarshal(state, MarshalFormat::TEXT, 0); }
+BENCHMARK(Serialization_MarshalBinary)				{ benchmarkMarshal(state, MarshalFormat::BINARY, 0); }
+BENCHMARK(Serialization_MarshalTextCompressed)		{ benchmarkMarshal(state, MarshalFormat::TEXT, 1); }
+BENCHMARK(Serialization_MarshalBinaryCompressed)	{ benchmarkMarshal(state, MarshalFormat::BINARY, 1); }
+
+BENCHMARK(Serialization_UnmarshalText)				{ benchmarkUnmarshal(state, MarshalFormat::TEXT, 0); }
+BENCHMARK(Serialization_UnmarshalBinary)			{ benchmarkUnmarshal(state, MarshalFormat::BINARY, 0); }
+BENCHMARK(Serialization_UnmarshalTextCompressed)	{ benchmarkUnmarshal(state, MarshalFormat::TEXT, 1); }
+BENCHMARK(Serialization_UnmarshalBinaryCompressed)	{ benchmarkUnmarshal(state, MarshalFormat::BINARY, 1); }
+
+
+// vec3 attribute compression: the stream is rewound every iteration, the archives have no header
+
+static const size_t s_numVectors = 1024;
+
+static void benchmarkSaveVec3(benchmark::State& state, bool useF16)
+{
+	std::vector<vec3> vectors(s_numVectors, vec3(12.5f, -0.75f, 1024.0f));
+
+	std::stringstream stream;
+	boost::archive::binary_oarchive archive(stream, boost::archive::no_header);
+
+	std::bitset<ATTRIB_NUM> attribMask;
+	attribMask.set();
+	attribMask.reset(0);		// save
+
+	while (state.keepRunning())
+	{
+		stream.seekp(0);
+		for (vec3& v : vectors)
+		{
+			uint8_t attribIndex = 1;
+			serializeVec3(archive, v, attribMask, attribIndex, useF16);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numVectors);
+}
+
+static void benchmarkLoadVec3(benchmark::State& state, bool useF16)
+{
+	std::vector<vec3> vectors(s_numVectors, vec3(12.5f, -0.75f, 1024.0f));
+
+	std::stringstream stream;
+	{
+		boost::archive::binary_oarchive archive(stream, boost::archive::no_header);
+
+		std::bitset<ATTRIB_NUM> attribMask;
+		attribMask.set();
+		attribMask.reset(0);
+
+		for (vec3& v : vectors)
+		{
+			uint8_t attribIndex = 1;
+			serializeVec3(archive, v, attribMask, attribIndex, useF16);
+		}
+	}
+
+	boost::archive::binary_iarchive archive(stream, boost::archive::no_header);
+
+	std::bitset<ATTRIB_NUM> attribMask;
+	attribMask.set();			// bit 0: load
+
+	while (state.keepRunning())
+	{
+		stream.seekg(0);
+		for (vec3& v : vectors)
+		{
+			uint8_t attribIndex = 1;
+			serializeVec3(archive, v, attribMask, attribIndex, useF16);
+		}
+		benchmark::clobberMemory();
+	}
+
+	state.setItemsProcessed(state.getIterations() * s_numVectors);
+}
+
+BENCHMARK(Serialization_SaveVec3F32)	{ benchmarkSaveVec3(state, false); }
+BENCHMARK(Serialization_SaveVec3F16)	{ benchmarkSaveVec3(state, true); }
+BENCHMARK(Serialization_LoadVec3F32)	{ benchmarkLoadVec3(state, false); }
+BENCHMARK(Serialization_LoadVec3F16)	{ benchmarkLoadVec3(state, true); }
@@ -0,0 +1,59 @@
+#include "GameStdAfx.h"
+#include "Benchmarks/Benchmark.h"
+#include "Graphics/TextureCacheBuilder.h"
+
+#include <random>
+
+
+// a 512x512 image: smooth gradients (the most of the textures) with some noise in them
+static const uint s_imageSize = 512;
+
+static std::vector<uint8_t> createImage()
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> noise(-8, 8);
+
+	std::vector<uint8_t> texels(s_imageSize * s_imageSize * 4);
+	for (uint y = 0; y < s_imageSize; y++)
+	{
+		for (uint x = 0; x < s_imageSize; x++)
+		{
+			uint8_t* pTexel = &texels[(y * s_imageSize + x) * 4];
+			pTexel[0] = (uint8_t)std::min(255, std::max(0, (int)(x / 2) + noise(random)));
+			pTexel[1] = (uint8_t)std::min(255, std::max(0, (int)(y / 2) + noise(random)));
+			pTexel[2] = (uint8_t)std::min(255, std::max(0, (int)((x + y) / 4) + noise(random)));
+			pTexel[3] = (uint8_t)(255 - y / 2);
+		}
+	}
+	return texels;
+}
+
+static void buildTextureCache(benchmark::State& state, const graphics::ctex::Format format)
+{
+	const std::vector<uint8_t> texels = createImage();
+
+	graphics::TextureCacheBuilder builder;
+	while (state.keepRunning())
+	{
+		builder.build(texels.data(), s_imageSize, s_imageSize, format);
+		benchmark::doNotOptimize(builder.getSize());
+	}
+
+	state.setBytesProcessed(state.getIterations() * texels.size());
+	state.setLabel("levels=" + std::to_string(builder.getNumLevels()) + " KB=" + std::to_string(texels.size() / 1024) + "->" + std::to_string(builder.getSize() / 1024));
+}
+
+
+/**
+ * The mip chain of an image, compressed: what the CrimsonTextureConverter does once per image instead of the
+ * decoding and the scaling of every texture reload.
+ */
+BENCHMARK(Texture_BuildCacheBc1)
+{
+	buildTextureCache(state, graphics::ctex::FORMAT_BC1);
+}
+
+BENCHMARK(Texture_BuildCacheBc3)
+{
+	buildTextureCache(state, graphics::ctex::FORMAT_BC3);
+}
@@ -48,6 +48,7 @@ public:
 	void initGraphics();
 	bool initEngineCore();
 	void initLocalPlayer();
+	void applyEffectConstants();
 
 	void release();
 
@@ -187,6 +188,7 @@ private:
 	GameConsole*						m_pGameConsole;
 
 	ClientConfigs						m_configs;
+	uint32_t							m_constantsSubscription;	// the effect constants, 0: none
 
 #ifdef ENABLE_MYGUI
 	// gui attributes
@@ -7,6 +7,9 @@
 #include <GL/glut.h>
 
 #include "Common/LoggerSystem.h"
+#include "Common/LuaManager.h"
+#include "Common/TraceRecorder.h"
+#include "Common/PerformanceMetrics.h"
 #include "GameLogic/EngineCore.h"
 
 #include "Graphics/Camera.h"
@@ -30,49 +33,49 @@ bool isWireframeRenderEnabled = false;
 
 void Client::registerActionKeys()
 {
-	// read from xml
+	// the key codes of the settings file (the key names are parsed by the ConstantManager)
 	using namespace events;
 
-	m_registeredActionKeys[CONST_INT("ControlsKeys::Use")]					= InputEvent::INPUTEVENT_USE;
-	m_registeredActionKeys[CONST_INT("ControlsKeys::MoveForward")]			= InputEvent::INPUTEVENT_MOVE_FORWARD;
-	m_registeredActionKeys[CONST_INT("ControlsKeys::MoveBackward")]			= InputEvent::INPUTEVENT_MOVE_BACKWARD;
-	m_registeredActionKeys[CONST_INT("ControlsKeys::MoveRight")]			= InputEvent::INPUTEVENT_MOVE_RIGHT;
-	m_registeredActionKeys[CONST_INT("ControlsKeys::MoveLeft")]				= InputEvent::INPUTEVENT_MOVE_LEFT;
-
-	m_registeredActionKeys[CONST_INT("ControlsKeys::Rush")]					= InputEvent::INPUTEVENT_RUSH;
-	m_registeredActionKeys[CONST_INT("ControlsKeys::Jump")]					= InputEvent::INPUTEVENT_JUMP;
-	m_registeredActionKeys[CONST_INT("ControlsKeys::ToggleCrouch")]			= InputEvent::INPUTEVENT_TOGGLE_CROUCH;
-
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE]						= CONST_INT("ControlsKeys::Use");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_FORWARD]				= CONST_INT("ControlsKeys::MoveForward");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_BACKWARD]			= CONST_INT("ControlsKeys::MoveBackward");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_RIGHT]				= CONST_INT("ControlsKeys::MoveRight");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_LEFT]				= CONST_INT("ControlsKeys::MoveLeft");
-
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_RUSH]						= CONST_INT("ControlsKeys::Rush");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_JUMP]						= CONST_INT("ControlsKeys::Jump");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_TOGGLE_CROUCH]			= CONST_INT("ControlsKeys::ToggleCrouch");
-
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_ATTACK_PRIMARY]			= CONST_INT("ControlsKeys::AttackPrimary");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_ATTACK_SECONDARY]			= CONST_INT("ControlsKeys::AttackSecondary");
-
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_RELOAD]					= CONST_INT("ControlsKeys::Reload");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_THROW]					= CONST_INT("ControlsKeys::Throw");
-
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_FLASHLIGHT]				= CONST_INT("ControlsKeys::Flashlight");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE_ITEM_SLOT0]			= CONST_INT("ControlsKeys::UseItemSlot0");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE_ITEM_SLOT1]			= CONST_INT("ControlsKeys::UseItemSlot1");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE_ITEM_SLOT2]			= CONST_INT("ControlsKeys::UseItemSlot2");
-
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_LAST]		= CONST_INT("ControlsKeys::ChangeWeaponLast");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_PREV]		= CONST_INT("ControlsKeys::ChangeWeaponPrev");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_NEXT]		= CONST_INT("ControlsKeys::ChangeWeaponNext");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_PRIMARY]	= CONST_INT("ControlsKeys::ChangeWeaponPrimary");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_SECONDARY]	= CONST_INT("ControlsKeys::ChangeWeaponSecondary");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_MELEE]		= CONST_INT("ControlsKeys::ChangeWeaponMelee");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_ITEM_SLOT0]	= CONST_INT("ControlsKeys::ChangeWeaponSlot0");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_ITEM_SLOT1]	= CONST_INT("ControlsKeys::ChangeWeaponSlot1");
-	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_ITEM_SLOT2]	= CONST_INT("ControlsKeys::ChangeWeaponSlot2");
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::Use")]					= InputEvent::INPUTEVENT_USE;
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::MoveForward")]			= InputEvent::INPUTEVENT_MOVE_FORWARD;
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::MoveBackward")]			= InputEvent::INPUTEVENT_MOVE_BACKWARD;
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::MoveRight")]			= InputEvent::INPUTEVENT_MOVE_RIGHT;
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::MoveLeft")]				= InputEvent::INPUTEVENT_MOVE_LEFT;
+
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::Rush")]					= InputEvent::INPUTEVENT_RUSH;
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::Jump")]					= InputEvent::INPUTEVENT_JUMP;
+	m_registeredActionKeys[CONST_INT("Controls::ControlsKeys::ToggleCrouch")]			= InputEvent::INPUTEVENT_TOGGLE_CROUCH;
+
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE]						= CONST_INT("Controls::ControlsKeys::Use");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_FORWARD]				= CONST_INT("Controls::ControlsKeys::MoveForward");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_BACKWARD]			= CONST_INT("Controls::ControlsKeys::MoveBackward");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_RIGHT]				= CONST_INT("Controls::ControlsKeys::MoveRight");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_MOVE_LEFT]				= CONST_INT("Controls::ControlsKeys::MoveLeft");
+
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_RUSH]						= CONST_INT("Controls::ControlsKeys::Rush");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_JUMP]						= CONST_INT("Controls::ControlsKeys::Jump");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_TOGGLE_CROUCH]			= CONST_INT("Controls::ControlsKeys::ToggleCrouch");
+
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_ATTACK_PRIMARY]			= CONST_INT("Controls::ControlsKeys::AttackPrimary");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_ATTACK_SECONDARY]			= CONST_INT("Controls::ControlsKeys::AttackSecondary");
+
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_RELOAD]					= CONST_INT("Controls::ControlsKeys::Reload");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_THROW]					= CONST_INT("Controls::ControlsKeys::Throw");
+
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_FLASHLIGHT]				= CONST_INT("Controls::ControlsKeys::Flashlight");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE_ITEM_SLOT0]			= CONST_INT("Controls::ControlsKeys::UseItemSlot0");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE_ITEM_SLOT1]			= CONST_INT("Controls::ControlsKeys::UseItemSlot1");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_USE_ITEM_SLOT2]			= CONST_INT("Controls::ControlsKeys::UseItemSlot2");
+
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_LAST]		= CONST_INT("Controls::ControlsKeys::ChangeWeaponLast");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_PREV]		= CONST_INT("Controls::ControlsKeys::ChangeWeaponPrev");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_NEXT]		= CONST_INT("Controls::ControlsKeys::ChangeWeaponNext");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_PRIMARY]	= CONST_INT("Controls::ControlsKeys::ChangeWeaponPrimary");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_SECONDARY]	= CONST_INT("Controls::ControlsKeys::ChangeWeaponSecondary");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_MELEE]		= CONST_INT("Controls::ControlsKeys::ChangeWeaponMelee");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_ITEM_SLOT0]	= CONST_INT("Controls::ControlsKeys::ChangeWeaponSlot0");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_ITEM_SLOT1]	= CONST_INT("Controls::ControlsKeys::ChangeWeaponSlot1");
+	//m_registeredActionKeys[InputEvent::INPUTEVENT_CHANGE_WEAPON_ITEM_SLOT2]	= CONST_INT("Controls::ControlsKeys::ChangeWeaponSlot2");
 }
 
 #ifdef ENABLE_MYGUI
@@ -145,6 +148,41 @@ void Client::keyDown(uint8_t key, int x, int y)
 
 			flushPackets();
 		}
+		else if (command == "profile")
+		{
+			// the server toggles its own profiler too
+			LuaManager::getInstance()->toggleProfiling("lua_profile_client.folded");
+
+			flushPackets();
+		}
+		else if (command == "stats" || command == "stats reset")
+		{
+			// the server answers with its own report
+			std::stringstream report;
+			PerformanceMetrics::getInstance()->writeReport(report);
+			TRACE_INFO(report.str(), 0);
+
+			if (command == "stats reset")
+			{
+				PerformanceMetrics::getInstance()->reset();
+			}
+
+			flushPackets();
+		}
+		else if (command == "graph")
+		{
+			const bool isGraphEnabled = m_pEngineCore->getRenderContext()->getEnableBit("statsGraph");
+			m_pEngineCore->getRenderContext()->setEnableBit("statsGraph", !isGraphEnabled);
+
+			flushPackets();
+		}
+		else if (command == "trace")
+		{
+			// the server toggles its own recording too
+			TraceRecorder::getInstance()->toggle("trace_client.json");
+
+			flushPackets();
+		}
 
 		m_pGameConsole->keyDown(key, x, y);
 	}
@@ -1,6 +1,8 @@
 #include "GameStdAfx.h"
 #include "Client/Client.h"
 
+#include "Common/AssetLoader.h"
+#include "Common/AssetPack.h"
 #include "Common/LuaManager.h"
 #include "Common/LoggerSystem.h"
 
@@ -26,6 +28,7 @@ Client::Client(const bool isThickClient)
 	, m_gamePaused(true)
 	, m_processInput(true)
 	, m_pEngineCore(nullptr)
+	, m_constantsSubscription(0)
 
 #ifdef ENABLE_MYGUI
 	, m_pGui(nullptr)
@@ -60,9 +63,17 @@ void Client::release()
 
 	SAFEDEL(m_pGameConsole);
 
+	// the callback calls this
+	if (m_constantsSubscription && ConstantManager::hasInstance())
+	{
+		ConstantManager::getInstance()->unsubscribe(m_constantsSubscription);
+	}
+	m_constantsSubscription = 0;
+
 	ConstantManager::destroyInstance();
 	EngineCore::destroyInstance();
 	LuaManager::destroyInstance();
+	AssetPack::destroyInstance();
 }
 
 // init
@@ -72,7 +83,11 @@ bool Client::init(const ClientConfigs& configs, const std::string& hostAddress,
 	m_hostAddress = hostAddress;
 	m_hostPort = port;
 
+	new AssetPack();
+	AssetPack::getInstance()->mountDataDir();
+
 	ConstantManager::getInstance()->loadConstants(CONST_STR("dataDir") + "/settings/constants.json");
+	ConstantManager::getInstance()->watchConstants();
 
 
 	if (!initConsole())
@@ -157,27 +172,52 @@ bool Client::initEngineCore()
 	setLoadingProgress(45, "Initializing game..");
 	const bool initLogicSucceeded			= m_pEngineCore->initLogic();
 
-	setLoadingProgress(65, "Finishing steps..");
-
 	if (!initLogicSucceeded || !initAudioVisualsSucceeded)
 	{
 		TRACE_ERROR("Error: Cannot initialize world.", 0);
 		release();
 	}
 
+	// the assets asked for by the init: loaded by the workers meanwhile, uploaded here between the redraws of the bar
+	if (AssetLoader::hasInstance())
+	{
+		// the bar is redrawn every redrawTime ms at least
+		static const uint redrawTime = 50;
+
+		AssetLoader* pAssetLoader = AssetLoader::getInstance();
+		while (!pAssetLoader->isIdle())
+		{
+			setLoadingProgress(65 + (int)(30.0f * pAssetLoader->getProgress()),
+				utils::formatStr("Loading assets (%u/%u)..", pAssetLoader->getNumUploaded(), pAssetLoader->getNumRequested()));
+
+			pAssetLoader->waitForUploads(redrawTime);
+			pAssetLoader->processUploads(CONST_FLOAT("Loading::UploadBudget"));
+		}
+	}
+
+	m_pEngineCore->logMemoryReports();
+
 	setLoadingProgress(95, "Initializing player..");
 
 	// init player
 
-	m_pEngineCore->getRenderContext()->setContextFloatParam("bloomLimit", CONST_FLOAT("Effects::Shaders::Bloom::Limit"));
-	m_pEngineCore->getRenderContext()->setContextFloatParam("dofFadeDist", CONST_FLOAT("Effects::Shaders::DOF::FadeDist"));
-	m_pEngineCore->getRenderContext()->setContextFloatParam("dofSaturation", CONST_FLOAT("Effects::Shaders::DOF::Saturation"));
+	applyEffectConstants();
+
+	// the effects follow the reloads of the constants file
+	m_constantsSubscription = ConstantManager::getInstance()->subscribe([this](const std::vector<ConstantHandle>&) { applyEffectConstants(); });
 
 	setLoadingProgress(100, "Done.");
 
 	return true;
 }
 
+void Client::applyEffectConstants()
+{
+	m_pEngineCore->getRenderContext()->setContextFloatParam("bloomLimit", CONST_FLOAT("Effects::Shaders::Bloom::Limit"));
+	m_pEngineCore->getRenderContext()->setContextFloatParam("dofFadeDist", CONST_FLOAT("Effects::Shaders::DOF::FadeDist"));
+	m_pEngineCore->getRenderContext()->setContextFloatParam("dofSaturation", CONST_FLOAT("Effects::Shaders::DOF::Saturation"));
+}
+
 // render
 void Client::render()
 {
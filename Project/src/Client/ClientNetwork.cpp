@@ -174,7 +174,7 @@ void Client::listen()
 							case events::LuaCommand::NETOBJ_LUACOMM:
 								if (unmarshal(m_luaResponse, std::string((char*) m_event.packet->data, m_event.packet->dataLength)))
 								{
-									///logToConsole(m_luaResponse.command);
+									TRACE_INFO(m_luaResponse.command, 0);
 								}
 
 								break;
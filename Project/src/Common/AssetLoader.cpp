@@ -0,0 +1,205 @@
+#include "GameStdAfx.h"
+#include "Common/AssetLoader.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <boost/bind.hpp>
+
+
+/**
+ * @param numThreads	the loading threads, 0: half the hardware threads (the other half is left to the frames).
+ */
+AssetLoader::AssetLoader(uint32_t numThreads)
+	: m_numRequested(0)
+	, m_numUploaded(0)
+	, m_isQuitting(false)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, boost::thread::hardware_concurrency() / 2);
+	}
+
+	for (uint32_t i = 0; i < numThreads; ++i)
+	{
+		m_workers.push_back(boost::thread(boost::bind(&AssetLoader::workerLoop, this, i)));
+	}
+
+	TRACE_INFO("The assets are loaded on " << numThreads << " threads.", 0);
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_isQuitting = true;
+		m_loadQueue.clear();
+	}
+	m_jobAdded.notify_all();
+
+	for (boost::thread& worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+	m_uploadQueue.clear();
+}
+
+/**
+ * Queues the asset: loadFunction runs on a worker, then uploadFunction on the main thread (processUploads()).
+ * The assets are loaded in the order they are asked for, they may finish in an other one.
+ */
+void AssetLoader::load(const std::string& name, const LoadFunction& loadFunction, const UploadFunction& uploadFunction)
+{
+	Job job;
+	job.name = name;
+	job.loadFunction = loadFunction;
+	job.uploadFunction = uploadFunction;
+	job.isLoaded = false;
+
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_loadQueue.push_back(job);
+		m_numRequested++;
+	}
+	m_jobAdded.notify_one();
+}
+
+/**
+ * Called by the main thread every frame: a few big uploads are spread over the frames instead of stalling one.
+ */
+uint AssetLoader::processUploads(const float budgetMs)
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point startTime = Clock::now();
+
+	uint numUploads = 0;
+	for (;;)
+	{
+		Job job;
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			if (m_uploadQueue.empty())
+			{
+				break;
+			}
+
+			job = m_uploadQueue.front();
+			m_uploadQueue.pop_front();
+		}
+
+		if (!job.isLoaded)
+		{
+			TRACE_ERROR("Error: can't load " << job.name, 0);
+		}
+
+		{
+			TRACE_ZONE("AssetLoader::upload");
+			job.uploadFunction(job.isLoaded);
+		}
+		numUploads++;
+
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			m_numUploaded++;
+
+			// a new batch of requests starts from 0
+			if (m_numUploaded == m_numRequested)
+			{
+				m_numRequested = 0;
+				m_numUploaded = 0;
+			}
+		}
+
+		if (std::chrono::duration<float, std::milli>(Clock::now() - startTime).count() >= budgetMs)
+		{
+			break;
+		}
+	}
+
+	return numUploads;
+}
+
+void AssetLoader::waitForUploads(const uint timeoutMs)
+{
+	boost::unique_lock<boost::mutex> lock(m_mutex);
+	if (m_uploadQueue.empty() && m_numUploaded != m_numRequested)
+	{
+		m_jobLoaded.timed_wait(lock, boost::posix_time::milliseconds(timeoutMs));
+	}
+}
+
+uint AssetLoader::getNumRequested() const
+{
+	boost::lock_guard<boost::mutex> lock(m_mutex);
+	return m_numRequested;
+}
+
+uint AssetLoader::getNumUploaded() const
+{
+	boost::lock_guard<boost::mutex> lock(m_mutex);
+	return m_numUploaded;
+}
+
+float AssetLoader::getProgress() const
+{
+	boost::lock_guard<boost::mutex> lock(m_mutex);
+	return m_numRequested > 0 ? (float)m_numUploaded / m_numRequested : 1.0f;
+}
+
+bool AssetLoader::isIdle() const
+{
+	boost::lock_guard<boost::mutex> lock(m_mutex);
+	return m_numUploaded == m_numRequested;
+}
+
+/**
+ * The thread of a worker: loads the queued assets one by one and hands them to the main thread.
+ */
+void AssetLoader::workerLoop(uint32_t workerIndex)
+{
+	if (TraceRecorder::hasInstance())
+	{
+		TraceRecorder::getInstance()->setThreadName(utils::formatStr("asset loader %u", workerIndex));
+	}
+
+	for (;;)
+	{
+		Job job;
+		{
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while (!m_isQuitting && m_loadQueue.empty())
+			{
+				m_jobAdded.wait(lock);
+			}
+
+			if (m_isQuitting)
+			{
+				return;
+			}
+
+			job = m_loadQueue.front();
+			m_loadQueue.pop_front();
+		}
+
+		{
+			TRACE_ZONE("AssetLoader::load");
+			job.isLoaded = job.loadFunction();
+		}
+
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			if (m_isQuitting)
+			{
+				return;
+			}
+
+			m_uploadQueue.push_back(job);
+		}
+		m_jobLoaded.notify_all();
+	}
+}
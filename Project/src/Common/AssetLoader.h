@@ -0,0 +1,74 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+/**
+ * @brief Loads the assets in the background: worker threads read and decode the files, the main thread makes the gl
+ * and al objects of the results between two frames (processUploads(), a time budget per frame).
+ *
+ * The caller puts a placeholder where the asset goes when it asks for it (eg. an empty model in the mesh pool), the
+ * upload swaps the data in if the placeholder is still alive (a weak pointer, a pending texture id). The load
+ * functions must not touch the gl/al contexts nor the pools, the upload functions may. The jobs left when the loader is destroyed are dropped: it goes before what its jobs refer to.
+ */
+class AssetLoader : public Singleton<AssetLoader>
+{
+public:
+	// on a worker: reads and decodes the asset, false if it can't be loaded
+	typedef std::function<bool()> LoadFunction;
+
+	// on the main thread: uploads what the load function decoded (isLoaded is its result)
+	typedef std::function<void(const bool isLoaded)> UploadFunction;
+
+	AssetLoader(uint32_t numThreads = 0);
+	~AssetLoader();
+
+	void	load(const std::string& name, const LoadFunction& loadFunction, const UploadFunction& uploadFunction);
+
+	// the uploads of the loaded assets until budgetMs is spent (one at least), returns their number
+	uint	processUploads(const float budgetMs);
+
+	// sleeps until an asset is loaded (or there is nothing to load) for timeoutMs at most
+	void	waitForUploads(const uint timeoutMs);
+
+	// getters-setters
+
+	// the assets asked for since the loader was idle the last time, and the ones uploaded of them
+	uint	getNumRequested() const;
+	uint	getNumUploaded() const;
+	float	getProgress() const;
+
+	bool	isIdle() const;
+
+	uint32_t getNumThreads() const { return (uint32_t)m_workers.size(); }
+
+private:
+	struct Job
+	{
+		std::string		name;
+		LoadFunction	loadFunction;
+		UploadFunction	uploadFunction;
+		bool			isLoaded;
+	};
+
+	void	workerLoop(uint32_t workerIndex);
+
+private:
+	std::vector<boost::thread>	m_workers;
+
+	mutable boost::mutex		m_mutex;
+	boost::condition_variable	m_jobAdded;
+	boost::condition_variable	m_jobLoaded;
+
+	std::deque<Job>				m_loadQueue;
+	std::deque<Job>				m_uploadQueue;
+
+	uint						m_numRequested;
+	uint						m_numUploaded;
+	bool						m_isQuitting;
+};
@@ -0,0 +1,265 @@
+#include "GameStdAfx.h"
+#include "Common/AssetPack.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Network/zlib/zlib.h"
+
+#include <algorithm>
+#include <atomic>
+
+
+AssetPack::AssetPack()
+	: m_pHeader(nullptr)
+	, m_pEntries(nullptr)
+	, m_pChunks(nullptr)
+	, m_pNames(nullptr)
+{
+}
+
+AssetPack::~AssetPack()
+{
+	unmount();
+}
+
+/**
+ * Maps the pack built from rootDir (CrimsonAssetPacker): its files are read from it from now on.
+ * A pack that is not whole (or of an other version) is not mounted, the files stay on the disk.
+ */
+bool AssetPack::mount(const std::string& packFile, const std::string& rootDir)
+{
+	TRACE_ZONE("AssetPack::mount");
+
+	unmount();
+
+	if (!m_file.map(packFile))
+	{
+		return false;
+	}
+
+	using namespace assetpack;
+
+	const Header* pHeader = m_file.getArray<Header>(0, 1);
+	if (!pHeader || pHeader->magic != PACK_MAGIC || pHeader->version != PACK_VERSION || pHeader->fileSize != m_file.getSize())
+	{
+		TRACE_ERROR(packFile << " is not an asset pack of version " << PACK_VERSION << ", build it again.", 0);
+		m_file.close();
+		return false;
+	}
+
+	const Entry* pEntries = m_file.getArray<Entry>((size_t)pHeader->entriesOffset, pHeader->numEntries);
+	const Chunk* pChunks = m_file.getArray<Chunk>((size_t)pHeader->chunksOffset, pHeader->numChunks);
+	const char* pNames = m_file.getArray<char>((size_t)pHeader->namesOffset, pHeader->namesSize);
+
+	bool isValid = pEntries && pChunks && pNames && (pHeader->namesSize == 0 || pNames[pHeader->namesSize - 1] == '\0');
+	for (uint i = 0; i < pHeader->numChunks && isValid; i++)
+	{
+		isValid = pChunks[i].size <= pHeader->chunkSize && m_file.getArray<uint8_t>((size_t)pChunks[i].offset, pChunks[i].packedSize);
+	}
+	for (uint i = 0; i < pHeader->numEntries && isValid; i++)
+	{
+		const Entry& entry = pEntries[i];
+
+		isValid = entry.nameOffset < pHeader->namesSize && (i == 0 || pEntries[i - 1].pathHash <= entry.pathHash);
+		if (entry.codec == CODEC_STORED)
+		{
+			isValid = isValid && m_file.getArray<uint8_t>((size_t)entry.offset, (size_t)entry.size);
+		}
+		else
+		{
+			isValid = isValid && entry.codec == CODEC_ZLIB && entry.firstChunk <= pHeader->numChunks && entry.numChunks <= pHeader->numChunks - entry.firstChunk
+				&& (uint64_t)entry.numChunks * pHeader->chunkSize >= entry.size;
+		}
+	}
+
+	if (!isValid)
+	{
+		TRACE_ERROR(packFile << " is damaged, build it again.", 0);
+		m_file.close();
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	m_pEntries = pEntries;
+	m_pChunks = pChunks;
+	m_pNames = pNames;
+
+	m_rootDir = normalizePath(rootDir);
+	if (!m_rootDir.empty() && m_rootDir.back() != '/')
+	{
+		m_rootDir += '/';
+	}
+
+	TRACE_INFO("Mounted " << packFile << ": " << pHeader->numEntries << " files of " << rootDir, 0);
+
+	return true;
+}
+
+bool AssetPack::mountDataDir()
+{
+	const std::string dataDir = CONST_STR("dataDir");
+	const std::string packFile = dataDir + ".pak";
+
+	return utils::file::existFile(packFile) && mount(packFile, dataDir);
+}
+
+void AssetPack::unmount()
+{
+	m_pHeader = nullptr;
+	m_pEntries = nullptr;
+	m_pChunks = nullptr;
+	m_pNames = nullptr;
+
+	m_rootDir.clear();
+	m_file.close();
+}
+
+bool AssetPack::contains(const std::string& fileName) const
+{
+	return findEntry(fileName) != nullptr;
+}
+
+bool AssetPack::view(const std::string& fileName, const uint8_t*& pData, size_t& size) const
+{
+	const assetpack::Entry* pEntry = findEntry(fileName);
+	if (!pEntry || pEntry->codec != assetpack::CODEC_STORED)
+	{
+		return false;
+	}
+
+	pData = m_file.getData() + pEntry->offset;
+	size = (size_t)pEntry->size;
+
+	return true;
+}
+
+bool AssetPack::read(const std::string& fileName, const uint8_t*& pData, size_t& size, std::vector<uint8_t>& buffer) const
+{
+	const assetpack::Entry* pEntry = findEntry(fileName);
+	if (!pEntry)
+	{
+		return false;
+	}
+
+	if (pEntry->codec == assetpack::CODEC_STORED)
+	{
+		pData = m_file.getData() + pEntry->offset;
+		size = (size_t)pEntry->size;
+		return true;
+	}
+
+	TRACE_ZONE("AssetPack::read");
+
+	buffer.resize((size_t)pEntry->size);
+
+	// the chunks are independent: a big file is decompressed on the job pool
+	std::atomic<bool> isDecompressed(true);
+	const auto decompressChunks = [this, pEntry, &buffer, &isDecompressed](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const assetpack::Chunk& chunk = m_pChunks[pEntry->firstChunk + i];
+			const size_t chunkOffset = i * m_pHeader->chunkSize;
+
+			uLongf chunkSize = chunk.size;
+			if (chunkOffset + chunk.size > buffer.size()
+				|| uncompress(&buffer[chunkOffset], &chunkSize, m_file.getData() + chunk.offset, chunk.packedSize) != Z_OK
+				|| chunkSize != chunk.size)
+			{
+				isDecompressed = false;
+			}
+		}
+	};
+
+	if (pEntry->numChunks > 1)
+	{
+		JobPool::run(pEntry->numChunks, 1, decompressChunks);
+	}
+	else
+	{
+		decompressChunks(0, pEntry->numChunks);
+	}
+
+	if (!isDecompressed)
+	{
+		TRACE_ERROR("Can't decompress " << fileName << " from the asset pack.", 0);
+		std::vector<uint8_t>().swap(buffer);
+		return false;
+	}
+
+	pData = buffer.data();
+	size = buffer.size();
+
+	return true;
+}
+
+const assetpack::Entry* AssetPack::findEntry(const std::string& fileName) const
+{
+	if (!m_pHeader)
+	{
+		return nullptr;
+	}
+
+	const std::string path = normalizePath(fileName);
+	if (path.compare(0, m_rootDir.size(), m_rootDir) != 0)
+	{
+		return nullptr;
+	}
+
+	const std::string key = path.substr(m_rootDir.size());
+	const uint64_t hash = hashPath(key);
+
+	const assetpack::Entry* pEnd = m_pEntries + m_pHeader->numEntries;
+	const assetpack::Entry* pEntry = std::lower_bound(m_pEntries, pEnd, hash,
+		[](const assetpack::Entry& entry, const uint64_t hash) { return entry.pathHash < hash; });
+
+	for (; pEntry != pEnd && pEntry->pathHash == hash; ++pEntry)
+	{
+		if (key == m_pNames + pEntry->nameOffset)
+		{
+			return pEntry;
+		}
+	}
+
+	return nullptr;
+}
+
+std::string AssetPack::normalizePath(const std::string& path)
+{
+	std::string key;
+	key.reserve(path.size());
+
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		const char c = path[i] == '\\' ? '/' : path[i];
+
+		// "//" and "/./" are one separator
+		if (c == '/' && !key.empty() && key.back() == '/')
+		{
+			continue;
+		}
+		if (c == '.' && (key.empty() || key.back() == '/') && (i + 1 == path.size() || path[i + 1] == '/' || path[i + 1] == '\\'))
+		{
+			i++;
+			continue;
+		}
+
+		key += c;
+	}
+
+	utils::toLowerCase(key);
+	return key;
+}
+
+// fnv-1a
+uint64_t AssetPack::hashPath(const std::string& key)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c : key)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Common/AssetPackFormat.h"
+#include "Common/MappedFile.h"
+
+
+/**
+ * @brief The data directory packed into one mapped file (AssetPackFormat.h): one mapping and no file handles per
+ * asset, the loaders get views of the mapping instead of copies.
+ *
+ * The paths under the directory the pack was built from (mount()) are looked up in the pack, MappedFile::open(),
+ * utils::file::readFile() and utils::file::existFile() go to the files on the disk for the others (and for every path
+ * if no pack is mounted). The lookups are thread safe, mount() and unmount() are not.
+ */
+class AssetPack : public Singleton<AssetPack>
+{
+public:
+	AssetPack();
+	~AssetPack();
+
+	bool	mount(const std::string& packFile, const std::string& rootDir);
+	void	unmount();
+
+	// the pack of the data dir (dataDir + ".pak"), if there is one
+	bool	mountDataDir();
+
+	bool	contains(const std::string& fileName) const;
+
+	// the bytes of a stored file in the mapping, without a copy: false if it is not in the pack or it is compressed
+	bool	view(const std::string& fileName, const uint8_t*& pData, size_t& size) const;
+
+	// the bytes of a packed file: in the mapping if it is stored, else decompressed into buffer
+	bool	read(const std::string& fileName, const uint8_t*& pData, size_t& size, std::vector<uint8_t>& buffer) const;
+
+	// the key of a path in the pack: relative to the root dir, lower case, '/' separated
+	static std::string	normalizePath(const std::string& path);
+	static uint64_t		hashPath(const std::string& key);
+
+	// getters-setters
+	bool	isMounted() const { return m_pHeader != nullptr; }
+	uint	getNumEntries() const { return m_pHeader ? m_pHeader->numEntries : 0; }
+
+	const std::string& getRootDir() const { return m_rootDir; }
+
+private:
+	const assetpack::Entry* findEntry(const std::string& fileName) const;
+
+private:
+	MappedFile					m_file;
+	std::string					m_rootDir;		// normalized, with a trailing '/'
+
+	const assetpack::Header*	m_pHeader;
+	const assetpack::Entry*		m_pEntries;
+	const assetpack::Chunk*		m_pChunks;
+	const char*					m_pNames;
+};
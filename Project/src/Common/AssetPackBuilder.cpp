@@ -0,0 +1,270 @@
+#include "GameStdAfx.h"
+#include "Common/AssetPackBuilder.h"
+#include "Common/AssetPack.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Network/zlib/zlib.h"
+
+#include <algorithm>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+
+const float AssetPackBuilder::MAX_PACKED_RATIO = 0.9f;
+
+AssetPackBuilder::AssetPackBuilder(int compressionLevel)
+	: m_compressionLevel(compressionLevel)
+	, m_numStoredFiles(0)
+	, m_size(0)
+	, m_packedSize(0)
+{
+	// compressed already
+	for (const char* extension : { "png", "jpg", "jpeg", "ogg" })
+	{
+		addStoredExtension(extension);
+	}
+
+	// mapped by the loadBinary() of the models, uploaded from the mapping by the TextureCache (at every reload)
+	addStoredExtension("md5bin");
+	addStoredExtension("md2bin");
+	addStoredExtension("3dsbin");
+	addStoredExtension("ctex");
+}
+
+void AssetPackBuilder::addStoredExtension(const std::string& extension)
+{
+	std::string lowerExtension = extension;
+	utils::toLowerCase(lowerExtension);
+
+	m_storedExtensions.insert(lowerExtension);
+}
+
+/**
+ * Adds a file to the pack under path (relative to the root dir of the pack).
+ * Two files under the same path (the paths are not case sensitive) are an error.
+ */
+bool AssetPackBuilder::addFile(const std::string& fileName, const std::string& path)
+{
+	File file;
+	file.fileName = fileName;
+	file.key = AssetPack::normalizePath(path);
+	file.pathHash = AssetPack::hashPath(file.key);
+
+	for (const File& other : m_files)
+	{
+		if (other.key == file.key)
+		{
+			TRACE_ERROR("Error: " << fileName << " and " << other.fileName << " have the same path in the pack.", 0);
+			return false;
+		}
+	}
+
+	m_files.push_back(file);
+	return true;
+}
+
+/**
+ * Adds the files under the dir (recursively) with their paths relative to it, but the packs and the settings: the
+ * constants, configs and console commands stay on the disk, where they are edited and reloaded.
+ */
+uint AssetPackBuilder::addDirectory(const std::string& rootDir)
+{
+	namespace fs = boost::filesystem;
+
+	uint numFiles = 0;
+
+	std::string rootPath = fs::path(rootDir).generic_string();
+	if (!rootPath.empty() && rootPath.back() != '/')
+	{
+		rootPath += '/';
+	}
+
+	boost::system::error_code error;
+	for (fs::recursive_directory_iterator it(rootDir, error), end; it != end && !error; it.increment(error))
+	{
+		if (!fs::is_regular_file(it->status()) || utils::file::getExtension(it->path().string()) == "pak")
+		{
+			continue;
+		}
+
+		const fs::path& filePath = it->path();
+		const std::string path = filePath.generic_string().substr(rootPath.size());
+		if (path.compare(0, 9, "settings/") == 0)
+		{
+			continue;
+		}
+
+		if (addFile(filePath.string(), path))
+		{
+			numFiles++;
+		}
+	}
+
+	if (error)
+	{
+		TRACE_ERROR("Error: can't list " << rootDir << ": " << error.message(), 0);
+	}
+
+	return numFiles;
+}
+
+/**
+ * Writes the pack: the files, then the index (AssetPackFormat.h), then the header.
+ */
+bool AssetPackBuilder::save(const std::string& packFile)
+{
+	using namespace assetpack;
+
+	std::sort(m_files.begin(), m_files.end(), [](const File& a, const File& b) { return a.pathHash < b.pathHash || (a.pathHash == b.pathHash && a.key < b.key); });
+
+	FILE* fp = fopen(packFile.c_str(), "wb");
+	if (!fp)
+	{
+		TRACE_ERROR("Error: can't write " << packFile, 0);
+		return false;
+	}
+
+	uint64_t offset = 0;
+	bool isWritten = true;
+
+	const auto write = [fp, &offset, &isWritten](const void* pData, const size_t size)
+	{
+		isWritten = isWritten && fwrite(pData, 1, size, fp) == size;
+		offset += size;
+	};
+	const auto align = [&write, &offset]()
+	{
+		static const uint8_t padding[PACK_ALIGNMENT] = {};
+		write(padding, (size_t)((PACK_ALIGNMENT - offset % PACK_ALIGNMENT) % PACK_ALIGNMENT));
+	};
+
+	Header header = {};
+	write(&header, sizeof(header));
+
+	std::vector<Entry> entries;
+	std::vector<Chunk> chunks;
+	std::string names;
+
+	m_numStoredFiles = 0;
+	m_size = 0;
+	m_packedSize = 0;
+
+	for (const File& file : m_files)
+	{
+		std::ifstream stream(file.fileName.c_str(), std::ios::binary);
+		const std::vector<uint8_t> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		if (!stream.good() && !stream.eof())
+		{
+			TRACE_ERROR("Error: can't read " << file.fileName, 0);
+			isWritten = false;
+			break;
+		}
+
+		Entry entry = {};
+		entry.pathHash = file.pathHash;
+		entry.size = data.size();
+		entry.nameOffset = (uint32_t)names.size();
+		names.append(file.key.c_str(), file.key.size() + 1);
+
+		// the chunks are compressed on the job pool
+		const size_t numChunks = (data.size() + PACK_CHUNK_SIZE - 1) / PACK_CHUNK_SIZE;
+		std::vector<std::vector<uint8_t>> packedChunks(numChunks);
+		size_t packedSize = 0;
+		bool isPacked = false;
+
+		const std::string extension = utils::file::getExtension(file.key);
+		if (!m_storedExtensions.count(extension) && numChunks > 0)
+		{
+			JobPool::run(numChunks, 1, [this, &data, &packedChunks](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const size_t chunkOffset = i * PACK_CHUNK_SIZE;
+					const size_t chunkSize = std::min<size_t>(PACK_CHUNK_SIZE, data.size() - chunkOffset);
+
+					uLongf packedChunkSize = compressBound((uLong)chunkSize);
+					packedChunks[i].resize(packedChunkSize);
+					if (compress2(packedChunks[i].data(), &packedChunkSize, &data[chunkOffset], (uLong)chunkSize, m_compressionLevel) == Z_OK)
+					{
+						packedChunks[i].resize(packedChunkSize);
+					}
+					else
+					{
+						packedChunks[i].clear();
+					}
+				}
+			});
+
+			isPacked = true;
+			for (const std::vector<uint8_t>& packedChunk : packedChunks)
+			{
+				isPacked = isPacked && !packedChunk.empty();
+				packedSize += packedChunk.size();
+			}
+		}
+
+		if (isPacked && packedSize < data.size() * MAX_PACKED_RATIO)
+		{
+			entry.codec = CODEC_ZLIB;
+			entry.firstChunk = (uint32_t)chunks.size();
+			entry.numChunks = (uint32_t)numChunks;
+
+			for (size_t i = 0; i < numChunks; i++)
+			{
+				Chunk chunk;
+				chunk.offset = offset;
+				chunk.packedSize = (uint32_t)packedChunks[i].size();
+				chunk.size = (uint32_t)std::min<size_t>(PACK_CHUNK_SIZE, data.size() - i * PACK_CHUNK_SIZE);
+				chunks.push_back(chunk);
+
+				write(packedChunks[i].data(), packedChunks[i].size());
+			}
+
+			m_packedSize += packedSize;
+		}
+		else
+		{
+			entry.codec = CODEC_STORED;
+
+			align();
+			entry.offset = offset;
+			write(data.data(), data.size());
+
+			m_packedSize += data.size();
+			m_numStoredFiles++;
+		}
+
+		m_size += data.size();
+		entries.push_back(entry);
+	}
+
+	align();
+	header.chunksOffset = offset;
+	write(chunks.data(), chunks.size() * sizeof(Chunk));
+
+	align();
+	header.entriesOffset = offset;
+	write(entries.data(), entries.size() * sizeof(Entry));
+
+	header.namesOffset = offset;
+	write(names.data(), names.size());
+
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.fileSize = offset;
+	header.numEntries = (uint32_t)entries.size();
+	header.numChunks = (uint32_t)chunks.size();
+	header.chunkSize = PACK_CHUNK_SIZE;
+	header.namesSize = (uint32_t)names.size();
+
+	isWritten = isWritten && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+	isWritten = fclose(fp) == 0 && isWritten;
+
+	if (!isWritten)
+	{
+		TRACE_ERROR("Error: can't write " << packFile, 0);
+		remove(packFile.c_str());
+	}
+
+	return isWritten;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Common/AssetPackFormat.h"
+
+
+/**
+ * @brief Writes the asset pack mounted by the AssetPack (AssetPackFormat.h), used by the CrimsonAssetPacker.
+ *
+ * The files are compressed by chunks (on the threads of the JobPool) unless they are of a stored extension or they do
+ * not get smaller than MAX_PACKED_RATIO of their size: those are stored as they are, to be used in place.
+ */
+class AssetPackBuilder
+{
+public:
+	AssetPackBuilder(int compressionLevel = 9);
+
+	// the files of the extension are not compressed (compressed already, or mapped by their loader)
+	void	addStoredExtension(const std::string& extension);
+
+	bool	addFile(const std::string& fileName, const std::string& path);
+	uint	addDirectory(const std::string& rootDir);
+
+	bool	save(const std::string& packFile);
+
+	// getters-setters
+	uint		getNumFiles() const { return (uint)m_files.size(); }
+	uint		getNumStoredFiles() const { return m_numStoredFiles; }
+	uint64_t	getSize() const { return m_size; }
+	uint64_t	getPackedSize() const { return m_packedSize; }
+
+private:
+	struct File
+	{
+		std::string		fileName;
+		std::string		key;		// AssetPack::normalizePath()
+		uint64_t		pathHash;
+	};
+
+	static const float			MAX_PACKED_RATIO;
+
+	std::vector<File>			m_files;
+	std::set<std::string>		m_storedExtensions;
+	int							m_compressionLevel;
+
+	// the last save()
+	uint						m_numStoredFiles;
+	uint64_t					m_size;
+	uint64_t					m_packedSize;
+};
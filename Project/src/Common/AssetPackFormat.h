@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+
+/**
+ * The asset pack (.pak), written by the CrimsonAssetPacker from a data directory and mounted by the AssetPack.
+ *
+ *     Header | the files | Chunk[numChunks] | Entry[numEntries] | the names
+ *
+ * The entries are sorted by the hash of their path (AssetPack::hashPath()), a lookup is a binary search. A stored file
+ * is one blob aligned to PACK_ALIGNMENT (the baked models are used in place from the mapping of the pack), a compressed
+ * file is a run of chunks of PACK_CHUNK_SIZE bytes compressed one by one (decompressed on the threads of the JobPool).
+ */
+namespace assetpack
+{
+
+static const uint32_t PACK_MAGIC		= 0x4b504343;	// "CCPK"
+static const uint32_t PACK_VERSION		= 1;
+static const uint32_t PACK_ALIGNMENT	= 32;
+static const uint32_t PACK_CHUNK_SIZE	= 64 * 1024;
+
+enum Codec
+{
+	CODEC_STORED	= 0,
+	CODEC_ZLIB		= 1,
+};
+
+struct Header
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint64_t	fileSize;
+
+	uint32_t	numEntries;
+	uint32_t	numChunks;
+	uint32_t	chunkSize;
+	uint32_t	namesSize;
+
+	uint64_t	entriesOffset;			// Entry[numEntries]
+	uint64_t	chunksOffset;			// Chunk[numChunks]
+	uint64_t	namesOffset;			// the '\0' terminated paths of the entries
+};
+
+struct Entry
+{
+	uint64_t	pathHash;
+	uint64_t	offset;					// the stored blob (CODEC_STORED)
+	uint64_t	size;					// the size of the file
+
+	uint32_t	codec;
+	uint32_t	firstChunk;				// the chunks of a compressed file
+	uint32_t	numChunks;
+	uint32_t	nameOffset;				// from namesOffset: the path, compared on a lookup (hash collisions)
+};
+
+struct Chunk
+{
+	uint64_t	offset;
+	uint32_t	packedSize;
+	uint32_t	size;
+};
+
+} // namespace assetpack
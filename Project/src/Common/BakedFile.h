@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Common/MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief The sections of a baked file (md5bin::Header, meshbin::Header): a header, then arrays each aligned to the
+ * alignment of the format, their offsets from the start of the file stored in the records before them.
+ *
+ * The baked files are used in place from a MappedFile, readArray() copies a section out of it.
+ */
+class BakedFileWriter
+{
+public:
+	BakedFileWriter(const size_t headerSize, const uint32_t alignment)
+		: m_data(headerSize, 0)
+		, m_alignment(alignment)
+	{
+	}
+
+	template <typename T>
+	uint32_t append(const T* pData, const size_t count)
+	{
+		m_data.resize((m_data.size() + m_alignment - 1) / m_alignment * m_alignment, 0);
+
+		const uint32_t offset = (uint32_t)m_data.size();
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+		m_data.insert(m_data.end(), pBytes, pBytes + count * sizeof(T));
+
+		return offset;
+	}
+
+	template <typename T>
+	uint32_t append(const std::vector<T>& values)
+	{
+		return append(values.data(), values.size());
+	}
+
+	// a section filled later (the records referring to the sections after them)
+	template <typename T>
+	uint32_t reserve(const size_t count)
+	{
+		const std::vector<T> values(count);
+		return append(values);
+	}
+
+	template <typename T>
+	void write(const uint32_t offset, const T* pData, const size_t count)
+	{
+		memcpy(&m_data[offset], pData, count * sizeof(T));
+	}
+
+	bool save(const char* filename) const
+	{
+		FILE* fp = fopen(filename, "wb");
+		if (!fp)
+		{
+			return false;
+		}
+
+		const bool isWritten = fwrite(m_data.data(), 1, m_data.size(), fp) == m_data.size();
+		fclose(fp);
+
+		return isWritten;
+	}
+
+	uint32_t getSize() const { return (uint32_t)m_data.size(); }
+
+private:
+	std::vector<uint8_t>	m_data;
+	uint32_t				m_alignment;
+};
+
+// copies count T from the file into the container, false if they are not in the file
+template <typename T, typename Container>
+inline bool readArray(const MappedFile& file, const uint32_t offset, const size_t count, Container& container)
+{
+	const T* pData = file.getArray<T>(offset, count);
+	if (!pData)
+	{
+		return false;
+	}
+
+	container.assign(pData, pData + count);
+	return true;
+}
+
+// the name cut to the record, terminated
+template <size_t N>
+inline void copyName(const std::string& name, char (&dest)[N])
+{
+	const size_t length = std::min<size_t>(name.size(), N - 1);
+	memcpy(dest, name.data(), length);
+	dest[length] = '\0';
+}
+
+template <size_t N>
+inline std::string readName(const char (&name)[N])
+{
+	return std::string(name, std::find(name, name + N, '\0'));
+}
@@ -2,60 +2,221 @@
 #include "Common/ConstantManager.h"
 
 #include "Common/LuaManager.h"
+#include "Common/LoggerSystem.h"
+
+#include <algorithm>
+
+
+// the names are reserved up front, so they never move
+static const size_t s_maxConstants = 4096;
+
+// the generation of the last created manager
+static uint32_t s_lastGeneration = 0;
+
+// the key bindings: their strings are the keys ("w", "SPACE"), stored as the key codes
+static const char* s_keyBindingsPath = "Controls::ControlsKeys";
+
+/**
+ * The code of a key name: a character is itself, the special keys of glut (glutSpecialFunc()) follow the 256
+ * characters. False if the name is not a key.
+ */
+static bool getKeyCode(const std::string& keyName, int& keyCode)
+{
+	static const std::map<std::string, int> namedKeys = {
+		{ "SPACE",		' ' },
+		{ "TAB",		'\t' },
+		{ "ENTER",		'\r' },
+		{ "BACKSPACE",	8 },
+		{ "ESCAPE",		27 },
+		{ "DELETE",		127 },
+		{ "SHIFT",		256 + 0x0070 },	// GLUT_KEY_SHIFT_L
+		{ "CTRL",		256 + 0x0072 },	// GLUT_KEY_CTRL_L
+		{ "ALT",		256 + 0x0074 },	// GLUT_KEY_ALT_L
+	};
+
+	if (keyName.size() == 1)
+	{
+		keyCode = (unsigned char)keyName[0];
+		return true;
+	}
+
+	const auto it = namedKeys.find(keyName);
+	if (it == namedKeys.end())
+	{
+		return false;
+	}
+
+	keyCode = it->second;
+	return true;
+}
+
+
+bool ConstantManager::ConstantValue::operator==(const ConstantValue& other) const
+{
+	return type == other.type && boolValue == other.boolValue && intValue == other.intValue && floatValue == other.floatValue
+		&& stringValue == other.stringValue && vectorValue == other.vectorValue;
+}
 
 
 ConstantManager::ConstantManager()
+	: m_isLoaded(false)
+	, m_pSnapshot(nullptr)
+	, m_nextSubscriptionId(1)
 {
+	m_generation = ++s_lastGeneration;
+	if (m_generation == 0)
+	{
+		m_generation = ++s_lastGeneration;
+	}
+
+	m_names.reserve(s_maxConstants);
+
+	Snapshot* pSnapshot = new Snapshot();
+	addSlot(hashConstantName(""), "", *pSnapshot);
+	publish(pSnapshot, std::vector<ConstantHandle>());
+
 	setStringConstant("dataDir", "../Data");
 	setStringConstant("resourcesDir", "../Resources");
 }
 
 ConstantManager::~ConstantManager()
 {
+	// the watcher thread reloads into this
+	m_fileWatcher.stop();
 }
 
 /**
  * Loading the constants from the settings file.
+ * Fails if a constant that was asked for through a handle before the loading is not defined by the file.
  */
 bool ConstantManager::loadConstants(const std::string& filename)
+{
+	ParsedConstants constants;
+	if (!parseFile(filename, constants))
+	{
+		GX_ASSERT(false && "Error: resources cannot be loaded from constants.json");
+		return false;
+	}
+
+	m_fileName = filename;
+	applyConstants(constants);
+
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_isLoaded = true;
+	}
+
+	bool isComplete = true;
+	const Snapshot& snapshot = getSnapshot();
+	for (size_t handle = UNKNOWN_HANDLE + 1; handle < snapshot.values.size(); ++handle)
+	{
+		if (snapshot.values[handle].type == ConstantType::NONE)
+		{
+			TRACE_ERROR("Error: unknown constant: " << m_names[handle], 0);
+			isComplete = false;
+		}
+	}
+
+	GX_ASSERT(isComplete && "Error: unknown constants are used");
+	return isComplete;
+}
+
+/**
+ * Parses the loaded settings file again and publishes the changed values. A file that can't be parsed is ignored,
+ * the current values stay.
+ */
+bool ConstantManager::reloadConstants()
+{
+	ParsedConstants constants;
+	if (m_fileName.empty() || !parseFile(m_fileName, constants))
+	{
+		TRACE_ERROR("Error: Cannot reload the constants, the current ones are kept.", 0);
+		return false;
+	}
+
+	const size_t numChanges = applyConstants(constants);
+	TRACE_INFO("Constants reloaded from " << m_fileName << ": " << numChanges << " changed.", 0);
+
+	return true;
+}
+
+/**
+ * Reloads the constants in the background when the loaded settings file is written.
+ */
+bool ConstantManager::watchConstants()
+{
+	if (m_fileName.empty())
+	{
+		return false;
+	}
+
+	return m_fileWatcher.start(m_fileName, [this](const std::string&) { reloadConstants(); });
+}
+
+bool ConstantManager::parseFile(const std::string& filename, ParsedConstants& constants)
 {
 	char* buffer = utils::file::readFile(filename.c_str());
-	GX_ASSERT(buffer && "Error: resources cannot be loaded from constants.json");
+	if (!buffer)
+	{
+		TRACE_ERROR("Error: Cannot read " << filename, 0);
+		return false;
+	}
 
 	rapidjson::Document d;
 	d.ParseInsitu(buffer);
-	parseObject(d);
+
+	const bool isParsed = !d.HasParseError();
+	if (isParsed)
+	{
+		parseObject(d, constants);
+	}
+	else
+	{
+		TRACE_ERROR("Error: Cannot parse " << filename << " at " << d.GetErrorOffset(), 0);
+	}
 
 	delete[] buffer;
 
-	return true;
+	return isParsed;
 }
 
-void ConstantManager::parseObject(const rapidjson::Value& object, const std::string& path)
+void ConstantManager::parseObject(const rapidjson::Value& object, ParsedConstants& constants, const std::string& path)
 {
 	for(rapidjson::Value::ConstMemberIterator m = object.MemberBegin(); m != object.MemberEnd(); ++m)
 	{
-		const char* name = path.empty() ? m->name.GetString() : utils::formatStr("%s::%s", path.c_str(), m->name.GetString());
+		const std::string name = path.empty() ? m->name.GetString() : utils::formatStr("%s::%s", path.c_str(), m->name.GetString());
 
 		if(m->value.IsObject())
 		{
-			parseObject(m->value, name);
+			parseObject(m->value, constants, name);
 		}
 		else if(m->value.IsBool())
 		{
-			m_boolDirectory[name] = m->value.GetBool();
+			constants[name] = makeBoolValue(m->value.GetBool());
 		}
 		else if(m->value.IsInt())
 		{
-			m_intDirectory[name] = m->value.GetInt();
+			constants[name] = makeIntValue(m->value.GetInt());
 		}
 		else if(m->value.IsDouble())
 		{
-			m_floatDirectory[name] = m->value.GetDouble();
+			constants[name] = makeFloatValue((float)m->value.GetDouble());
+		}
+		else if(m->value.IsString() && path == s_keyBindingsPath)
+		{
+			int keyCode;
+			if (getKeyCode(m->value.GetString(), keyCode))
+			{
+				constants[name] = makeIntValue(keyCode);
+			}
+			else
+			{
+				TRACE_ERROR("Error: unknown key " << m->value.GetString() << " of " << name, 0);
+			}
 		}
 		else if(m->value.IsString())
 		{
-			m_stringDirectory[name] = std::string(m->value.GetString(), m->value.GetStringLength());
+			constants[name] = makeStringValue(std::string(m->value.GetString(), m->value.GetStringLength()));
 		}
 		else
 		{
@@ -64,16 +225,358 @@ void ConstantManager::parseObject(const rapidjson::Value& object, const std::str
 	}
 }
 
+/**
+ * Publishes the parsed constants in one new snapshot.
+ *
+ * @return The number of the changed constants.
+ */
+size_t ConstantManager::applyConstants(const ParsedConstants& constants)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	Snapshot* pSnapshot = copySnapshot();
+	const size_t numSlots = pSnapshot->values.size();
+
+	std::vector<ConstantHandle> changedHandles;
+	for (const auto& entry : constants)
+	{
+		const ConstantHandle handle = findOrAddSlot(entry.first, *pSnapshot);
+		if (!(pSnapshot->values[handle] == entry.second))
+		{
+			pSnapshot->values[handle] = entry.second;
+			changedHandles.push_back(handle);
+		}
+	}
+
+	if (changedHandles.empty() && pSnapshot->values.size() == numSlots)
+	{
+		delete pSnapshot;
+	}
+	else
+	{
+		publish(pSnapshot, changedHandles);
+	}
+
+	return changedHandles.size();
+}
+
+/**
+ * Resolves a constant name to its slot. The CONST_ macros call it once per call site.
+ * Before loadConstants() an unknown name gets an empty slot that the loading has to define, after it an unknown name
+ * is an error: it is logged (every time, it is not inserted) and gets UNKNOWN_HANDLE.
+ *
+ * @param hash	hashConstantName(name)
+ */
+ConstantHandle ConstantManager::getHandle(uint32_t hash, const char* name)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	auto slotIt = m_slots.find(hash);
+	if (slotIt != m_slots.end())
+	{
+		GX_ASSERT(m_names[slotIt->second] == name && "Error: constant name hash collision");
+		return slotIt->second;
+	}
+
+	if (m_isLoaded)
+	{
+		TRACE_ERROR("Error: unknown constant: " << name, 0);
+		GX_ASSERT(false && "Error: unknown constant");
+		return UNKNOWN_HANDLE;
+	}
+
+	// the new slot is published before its handle is returned
+	Snapshot* pSnapshot = copySnapshot();
+	const ConstantHandle handle = addSlot(hash, name, *pSnapshot);
+	publish(pSnapshot, std::vector<ConstantHandle>());
+
+	return handle;
+}
+
+/**
+ * Finds the slot of a defined constant, without adding a slot for an unknown name.
+ */
+bool ConstantManager::findHandle(const char* name, ConstantHandle& handle)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	auto slotIt = m_slots.find(hashConstantName(name));
+	if (slotIt == m_slots.end() || getSnapshot().values[slotIt->second].type == ConstantType::NONE || m_names[slotIt->second] != name)
+	{
+		return false;
+	}
+
+	handle = slotIt->second;
+	return true;
+}
+
+ConstantHandle ConstantManager::findOrAddSlot(const std::string& name, Snapshot& snapshot)
+{
+	const uint32_t hash = hashConstantName(name.c_str());
+
+	auto slotIt = m_slots.find(hash);
+	if (slotIt != m_slots.end())
+	{
+		GX_ASSERT(m_names[slotIt->second] == name && "Error: constant name hash collision");
+		return slotIt->second;
+	}
+
+	return addSlot(hash, name, snapshot);
+}
+
+ConstantHandle ConstantManager::addSlot(uint32_t hash, const std::string& name, Snapshot& snapshot)
+{
+	GX_ASSERT(m_names.size() < s_maxConstants && "Error: too many constants");
+
+	const ConstantHandle handle = (ConstantHandle)m_names.size();
+	m_names.push_back(name);
+	m_slots[hash] = handle;
+
+	snapshot.values.push_back(makeValue(ConstantType::NONE));
+
+	return handle;
+}
+
+ConstantManager::Snapshot* ConstantManager::copySnapshot() const
+{
+	const Snapshot* pCurrent = m_pSnapshot.load(std::memory_order_relaxed);
+	return pCurrent ? new Snapshot(*pCurrent) : new Snapshot();
+}
+
+/**
+ * Makes a snapshot the current one. The replaced one is kept alive, readers may still use it.
+ * Has to be called with m_mutex locked (or from the constructor).
+ */
+void ConstantManager::publish(Snapshot* pSnapshot, const std::vector<ConstantHandle>& changedHandles)
+{
+	m_snapshots.push_back(std::unique_ptr<const Snapshot>(pSnapshot));
+	m_pSnapshot.store(pSnapshot, std::memory_order_release);
+
+	m_pendingChanges.insert(m_pendingChanges.end(), changedHandles.begin(), changedHandles.end());
+}
+
+void ConstantManager::setConstant(const std::string& name, const ConstantValue& value)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	Snapshot* pSnapshot = copySnapshot();
+	const ConstantHandle handle = findOrAddSlot(name, *pSnapshot);
+
+	pSnapshot->values[handle] = value;
+	publish(pSnapshot, std::vector<ConstantHandle>(1, handle));
+}
+
+void ConstantManager::setIntConstant(const std::string& name, int value)
+{
+	setConstant(name, makeIntValue(value));
+}
+
+void ConstantManager::setFloatConstant(const std::string& name, float value)
+{
+	setConstant(name, makeFloatValue(value));
+}
+
+void ConstantManager::setBoolConstant(const std::string& name, bool value)
+{
+	setConstant(name, makeBoolValue(value));
+}
+
+void ConstantManager::setStringConstant(const std::string& name, const std::string& value)
+{
+	setConstant(name, makeStringValue(value));
+}
+
+void ConstantManager::setVectorConstant(const std::string& name, const vec3& value)
+{
+	setConstant(name, makeVectorValue(value));
+}
+
+/**
+ * Subscribes to the changes of the constants (sets and reloads).
+ *
+ * @param callback Called by dispatchChanges() with the handles of the changed constants.
+ * @return The id of the subscription.
+ */
+uint32_t ConstantManager::subscribe(const ChangeCallback& callback)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	const uint32_t subscriptionId = m_nextSubscriptionId++;
+	m_subscribers[subscriptionId] = callback;
+
+	return subscriptionId;
+}
+
+void ConstantManager::unsubscribe(uint32_t subscriptionId)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_subscribers.erase(subscriptionId);
+}
+
+/**
+ * Notifies the subscribers of the changes since the last call. Called on the sim thread (EngineCore::animate),
+ * so the subscribers don't have to care about the thread of the reload.
+ */
+void ConstantManager::dispatchChanges()
+{
+	std::vector<ConstantHandle> changedHandles;
+	std::map<uint32_t, ChangeCallback> subscribers;
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		if (m_pendingChanges.empty())
+		{
+			return;
+		}
+
+		changedHandles.swap(m_pendingChanges);
+		subscribers = m_subscribers;
+	}
+
+	std::sort(changedHandles.begin(), changedHandles.end());
+	changedHandles.erase(std::unique(changedHandles.begin(), changedHandles.end()), changedHandles.end());
+
+	for (const auto& entry : subscribers)
+	{
+		entry.second(changedHandles);
+	}
+}
+
+ConstantManager::ConstantValue ConstantManager::makeValue(ConstantType type)
+{
+	ConstantValue value;
+	value.type = type;
+	value.boolValue = false;
+	value.intValue = 0;
+	value.floatValue = 0.0f;
+	value.vectorValue = vec3(0.0f, 0.0f, 0.0f);
+
+	return value;
+}
+
+ConstantManager::ConstantValue ConstantManager::makeBoolValue(bool boolValue)
+{
+	ConstantValue value = makeValue(ConstantType::BOOL);
+	value.boolValue = boolValue;
+	value.intValue = boolValue ? 1 : 0;
+	value.floatValue = boolValue ? 1.0f : 0.0f;
+
+	return value;
+}
+
+ConstantManager::ConstantValue ConstantManager::makeIntValue(int intValue)
+{
+	ConstantValue value = makeValue(ConstantType::INT);
+	value.intValue = intValue;
+	value.floatValue = (float)intValue;
+	value.boolValue = intValue != 0;
+
+	return value;
+}
+
+ConstantManager::ConstantValue ConstantManager::makeFloatValue(float floatValue)
+{
+	ConstantValue value = makeValue(ConstantType::FLOAT);
+	value.floatValue = floatValue;
+	value.intValue = (int)floatValue;
+	value.boolValue = floatValue != 0.0f;
+
+	return value;
+}
+
+ConstantManager::ConstantValue ConstantManager::makeStringValue(const std::string& stringValue)
+{
+	ConstantValue value = makeValue(ConstantType::STRING);
+	value.stringValue = stringValue;
+
+	return value;
+}
+
+ConstantManager::ConstantValue ConstantManager::makeVectorValue(const vec3& vectorValue)
+{
+	ConstantValue value = makeValue(ConstantType::VEC3);
+	value.vectorValue = vectorValue;
+
+	return value;
+}
+
 // register methods to lua
-void ConstantManager::registerMethodsToLua()
+void ConstantManager::registerMethodsToLua(lua_State* state)
+{
+	registerGetter(state, "CONST_INT",		ConstantType::INT);
+	registerGetter(state, "CONST_BOOL",		ConstantType::BOOL);
+	registerGetter(state, "CONST_FLOAT",	ConstantType::FLOAT);
+	registerGetter(state, "CONST_STR",		ConstantType::STRING);
+	registerGetter(state, "CONST_VEC3",		ConstantType::VEC3);
+}
+
+/**
+ * Registers a CONST_ function. Its upvalues are the name -> handle cache of the state and the type it returns.
+ */
+void ConstantManager::registerGetter(lua_State* state, const char* functionName, ConstantType type)
 {
-	using namespace luabind;
+	lua_newtable(state);
+	lua_pushinteger(state, (lua_Integer)type);
+	lua_pushcclosure(state, &ConstantManager::luaGetConstant, 2);
+	lua_setglobal(state, functionName);
+}
+
+/**
+ * CONST_INT(name) etc. in lua: the names are interned lua strings, so after the first call the handle is one table
+ * lookup away, the name is not hashed again.
+ */
+int ConstantManager::luaGetConstant(lua_State* state)
+{
+	const char* name = luaL_checkstring(state, 1);
+	ConstantManager* pManager = getInstance();
+
+	ConstantHandle handle;
+
+	lua_pushvalue(state, 1);
+	lua_rawget(state, lua_upvalueindex(1));
+	if (lua_isnumber(state, -1))
+	{
+		handle = (ConstantHandle)lua_tointeger(state, -1);
+		lua_pop(state, 1);
+	}
+	else
+	{
+		lua_pop(state, 1);
+
+		if (!pManager->findHandle(name, handle))
+		{
+			return luaL_error(state, "unknown constant: %s", name);
+		}
+
+		lua_pushvalue(state, 1);
+		lua_pushinteger(state, (lua_Integer)handle);
+		lua_rawset(state, lua_upvalueindex(1));
+	}
+
+	switch ((ConstantType)lua_tointeger(state, lua_upvalueindex(2)))
+	{
+		case ConstantType::INT:
+			lua_pushinteger(state, pManager->getInt(handle));
+			break;
+		case ConstantType::BOOL:
+			lua_pushboolean(state, pManager->getBool(handle));
+			break;
+		case ConstantType::FLOAT:
+			lua_pushnumber(state, pManager->getFloat(handle));
+			break;
+		case ConstantType::STRING:
+		{
+			const std::string& value = pManager->getString(handle);
+			lua_pushlstring(state, value.c_str(), value.size());
+		}
+			break;
+		case ConstantType::VEC3:
+			luabind::object(state, pManager->getVector(handle)).push(state);
+			break;
+		default:
+			lua_pushnil(state);
+			break;
+	}
 
-	luabind::module(LuaManager::getInstance()->getState()) [
-	    luabind::def("CONST_INT",	&CONST_INT),
-	    luabind::def("CONST_BOOL",	&CONST_BOOL),
-	    luabind::def("CONST_FLOAT",	&CONST_FLOAT),
-	    luabind::def("CONST_STR",	&CONST_STR),
-	    luabind::def("CONST_VEC3",	&CONST_VEC3)
-	];
+	return 1;
 }
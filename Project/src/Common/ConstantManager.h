@@ -3,104 +3,200 @@
 #include "Common/Directory.h"
 #include "Common/Singleton.h"
 
+#include "Common/FileWatcher.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <rapidjson/document.h>
+#include <boost/thread/mutex.hpp>
+
+struct lua_State;
+
+
+// the slot of a constant, stable while the manager lives
+typedef uint32_t ConstantHandle;
 
+/**
+ * FNV-1a hash of a constant name, evaluated by the compiler for the literal names of the CONST_ macros.
+ */
+constexpr uint32_t hashConstantName(const char* name, uint32_t hash = 2166136261u)
+{
+	return *name ? hashConstantName(name + 1, (hash ^ (uint8_t)*name) * 16777619u) : hash;
+}
 
+enum class ConstantType
+{
+	NONE = 0,		// requested through a handle, but not defined (yet)
+	BOOL,
+	INT,
+	FLOAT,
+	STRING,
+	VEC3,
+};
+
+/**
+ * @brief Stores the constants of the settings file in slots.
+ *
+ * A constant name is hashed (at compile time for the CONST_ macros) and resolved to a slot once, the handle of the
+ * call site is cached, so the later reads are one array access. The numeric values of a slot are all stored when it is
+ * set (eg. an int constant can be read as a float) so the reads don't branch on the type.
+ * Reading an unknown name does not insert it: the handles requested before loadConstants() are checked by it,
+ * the names requested after it have to exist (an unknown one is logged and gets the UNKNOWN_HANDLE slot, whose values
+ * are all 0). The handles cached by the call sites carry the generation of the manager that resolved them, so they
+ * are resolved again by a new manager (destroyInstance() and a new ConstantManager).
+ *
+ * The values are published RCU style: a change (a set, a reload of the watched file) copies the current snapshot,
+ * changes the copy and swaps the snapshot pointer, so the readers never lock and never see a half written value.
+ * The replaced snapshots stay alive until the manager is destroyed (the readers may hold references into them,
+ * eg. CONST_STR().c_str()), they are only created by changes, so there are few of them.
+ * The changed handles are delivered to the subscribers by dispatchChanges() on the sim thread.
+ */
 class ConstantManager : public Singleton<ConstantManager>
 {
 public:
+	typedef std::function<void(const std::vector<ConstantHandle>& changedHandles)> ChangeCallback;
+
+	// the slot of the unknown names: never defined, every value is 0 (false, empty)
+	static const ConstantHandle UNKNOWN_HANDLE = 0;
+
 	ConstantManager();
 	~ConstantManager();
 
-	bool loadConstants(const std::string& filename = "contants.xml");
+	bool loadConstants(const std::string& filename = "constants.json");
+	bool reloadConstants();
 
-	inline void setIntConstant(const std::string& name, int value)
-	{
-		m_intDirectory[name] = value;
-	}
+	bool watchConstants();
 
-	inline void setFloatConstant(const std::string& name, float value)
-	{
-		m_floatDirectory[name] = value;
-	}
+	ConstantHandle	getHandle(uint32_t hash, const char* name);
+	ConstantHandle	getHandle(const char* name) { return getHandle(hashConstantName(name), name); }
 
-	inline void setBoolConstant(const std::string& name, bool value)
-	{
-		m_boolDirectory[name] = value;
-	}
+	// change notification
+	uint32_t	subscribe(const ChangeCallback& callback);
+	void		unsubscribe(uint32_t subscriptionId);
+	void		dispatchChanges();
 
-	inline void setStringConstant(const std::string& name, const std::string& value)
-	{
-		m_stringDirectory[name] = value;
-	}
+	// by handle
+	inline bool getBool(ConstantHandle handle) const				{ return getSnapshot().values[handle].boolValue; }
+	inline int getInt(ConstantHandle handle) const					{ return getSnapshot().values[handle].intValue; }
+	inline float getFloat(ConstantHandle handle) const				{ return getSnapshot().values[handle].floatValue; }
+	inline const std::string& getString(ConstantHandle handle) const	{ return getSnapshot().values[handle].stringValue; }
+	inline const vec3& getVector(ConstantHandle handle) const		{ return getSnapshot().values[handle].vectorValue; }
 
-	inline void setVectorConstant(const std::string& name, const vec3& value)
-	{
-		m_vectorDirectory[name] = value;
-	}
+	const std::string& getName(ConstantHandle handle) const			{ return m_names[handle]; }
 
-	inline int getIntConstant(const std::string& name)
-	{
-		return m_intDirectory[name];
-	}
+	// a new one for every manager, 0 is none of them
+	uint32_t getGeneration() const									{ return m_generation; }
 
-	inline bool getBoolConstant(const std::string& name)
-	{
-		return m_boolDirectory[name];
-	}
+	// by name (the name is hashed and looked up at every call)
+	void setIntConstant(const std::string& name, int value);
+	void setFloatConstant(const std::string& name, float value);
+	void setBoolConstant(const std::string& name, bool value);
+	void setStringConstant(const std::string& name, const std::string& value);
+	void setVectorConstant(const std::string& name, const vec3& value);
+
+	inline int getIntConstant(const std::string& name)					{ return getInt(getHandle(name.c_str())); }
+	inline bool getBoolConstant(const std::string& name)				{ return getBool(getHandle(name.c_str())); }
+	inline float getFloatConstant(const std::string& name)				{ return getFloat(getHandle(name.c_str())); }
+	inline const std::string& getStringConstant(const std::string& name)	{ return getString(getHandle(name.c_str())); }
+	inline vec3 getVectorConstant(const std::string& name)				{ return getVector(getHandle(name.c_str())); }
 
-	inline float getFloatConstant(const std::string& name)
-	{
-		return m_floatDirectory[name];
-	}
 
-	inline std::string& getStringConstant(const std::string& name)
+	// register methods to lua
+	static void registerMethodsToLua(lua_State* state);
+
+private:
+	struct ConstantValue
 	{
-		return m_stringDirectory[name];
-	}
+		ConstantType	type;
+
+		bool			boolValue;
+		int				intValue;
+		float			floatValue;
+		std::string		stringValue;
+		vec3			vectorValue;
 
-	inline vec3 getVectorConstant(const std::string& name)
+		bool operator==(const ConstantValue& other) const;
+	};
+
+	// immutable after it is published
+	struct Snapshot
 	{
-		return m_vectorDirectory[name];
-	}
+		std::vector<ConstantValue>	values;			// by handle
+	};
 
+	typedef std::map<std::string, ConstantValue> ParsedConstants;
 
-	// register methods to lua
-	static void registerMethodsToLua();
+	inline const Snapshot& getSnapshot() const { return *m_pSnapshot.load(std::memory_order_acquire); }
 
-private:
-	void parseObject(const rapidjson::Value& object, const std::string& path = "");
+	bool parseFile(const std::string& filename, ParsedConstants& constants);
+	void parseObject(const rapidjson::Value& object, ParsedConstants& constants, const std::string& path = "");
+
+	void	setConstant(const std::string& name, const ConstantValue& value);
+	size_t	applyConstants(const ParsedConstants& constants);
+
+	ConstantHandle	findOrAddSlot(const std::string& name, Snapshot& snapshot);
+	ConstantHandle	addSlot(uint32_t hash, const std::string& name, Snapshot& snapshot);
+	bool		findHandle(const char* name, ConstantHandle& handle);
+
+	Snapshot*	copySnapshot() const;
+	void		publish(Snapshot* pSnapshot, const std::vector<ConstantHandle>& changedHandles);
+
+	static ConstantValue makeValue(ConstantType type);
+	static ConstantValue makeBoolValue(bool value);
+	static ConstantValue makeIntValue(int value);
+	static ConstantValue makeFloatValue(float value);
+	static ConstantValue makeStringValue(const std::string& value);
+	static ConstantValue makeVectorValue(const vec3& value);
+
+	static void	registerGetter(lua_State* state, const char* functionName, ConstantType type);
+	static int	luaGetConstant(lua_State* state);
 
 private:
-	BoolDirectory			m_boolDirectory;
-	IntDirectory			m_intDirectory;
-	FloatDirectory			m_floatDirectory;
-	StringDirectory			m_stringDirectory;
-	VectorDirectory			m_vectorDirectory;
+	// reserved up front: the names never move, so they can be read without locking while slots are added
+	std::vector<std::string>			m_names;			// by handle
+	std::map<uint32_t, ConstantHandle>	m_slots;			// name hash -> slot
+	bool								m_isLoaded;
+	std::string							m_fileName;
+	uint32_t							m_generation;
+
+	std::atomic<const Snapshot*>		m_pSnapshot;
+	std::vector<std::unique_ptr<const Snapshot>>	m_snapshots;	// the published ones, the last is the current
+
+	std::map<uint32_t, ChangeCallback>	m_subscribers;
+	uint32_t							m_nextSubscriptionId;
+	std::vector<ConstantHandle>			m_pendingChanges;	// not dispatched yet
+
+	FileWatcher							m_fileWatcher;
+
+	boost::mutex						m_mutex;			// the writers (the readers of the snapshot don't lock)
 };
 
-// short helper methods
-inline int CONST_INT(const std::string& name)
+/**
+ * The handle of a call site: cached with the generation of the manager in the upper 32 bits (0: not resolved yet),
+ * resolved again when the manager was replaced.
+ */
+inline ConstantHandle resolveConstantHandle(std::atomic<uint64_t>& cache, uint32_t hash, const char* name)
 {
-	return ConstantManager::getInstance()->getIntConstant(name);
-}
+	ConstantManager* pManager = ConstantManager::getInstance();
 
-inline bool CONST_BOOL(const std::string& name)
-{
-	return ConstantManager::getInstance()->getBoolConstant(name);
-}
+	const uint64_t cached = cache.load(std::memory_order_relaxed);
+	if ((uint32_t)(cached >> 32) == pManager->getGeneration())
+	{
+		return (ConstantHandle)cached;
+	}
 
-inline float CONST_FLOAT(const std::string& name)
-{
-	return ConstantManager::getInstance()->getFloatConstant(name);
-}
+	const ConstantHandle handle = pManager->getHandle(hash, name);
+	cache.store(((uint64_t)pManager->getGeneration() << 32) | handle, std::memory_order_relaxed);
 
-inline vec3 CONST_VEC3(const std::string& name)
-{
-	return ConstantManager::getInstance()->getVectorConstant(name);
+	return handle;
 }
 
-inline const std::string& CONST_STR(const std::string& name)
-{
-	return ConstantManager::getInstance()->getStringConstant(name);
-}
+// short helper methods: the handle of the call site is resolved at the first call
+#define CONST_HANDLE(name)	([]() -> ConstantHandle { static std::atomic<uint64_t> cache(0); return resolveConstantHandle(cache, std::integral_constant<uint32_t, hashConstantName(name)>::value, name); }())
+
+#define CONST_INT(name)		(ConstantManager::getInstance()->getInt(CONST_HANDLE(name)))
+#define CONST_BOOL(name)	(ConstantManager::getInstance()->getBool(CONST_HANDLE(name)))
+#define CONST_FLOAT(name)	(ConstantManager::getInstance()->getFloat(CONST_HANDLE(name)))
+#define CONST_VEC3(name)	(ConstantManager::getInstance()->getVector(CONST_HANDLE(name)))
+#define CONST_STR(name)		(ConstantManager::getInstance()->getString(CONST_HANDLE(name)))
@@ -28,9 +28,11 @@
 #include <GL/glut.h>
 #endif
 
-#define USE_GLM
+// USE_GLM (build flag): the math types are glm types, the kernels glm calls (otherwise: our sse/avx kernels)
 #ifdef USE_GLM
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #endif
 
 #include "Math/vec2.h"
@@ -1,11 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
 
-#include <GL/gl.h>
-
 #include "Math/vec3.h"
 
 
@@ -17,9 +16,15 @@ typedef std::map<const std::string, std::string>								StringDirectory;
 
 typedef std::map<unsigned short, const std::string>								StringMap;
 
-// Textures
-typedef std::map<const std::string, GLuint>										TextureDirectory;
-typedef std::map<const std::string, GLuint>										CubeTextureDirectory;
+// Textures: the gl texture names (a GLuint), without pulling the gl headers into the server
+typedef std::map<const std::string, uint32_t>									TextureDirectory;
+typedef std::map<const std::string, uint32_t>									CubeTextureDirectory;
+
+// the shared textures of the EngineCore and of the models (TextureCache::acquireTexture(), Common/ResourcePool.h)
+template <typename T> struct ResourceHandle;
+template <typename T> class ResourcePool;
+typedef ResourcePool<uint32_t>													TexturePool;
+typedef ResourceHandle<uint32_t>												TextureHandle;
 
 
 // Graphics
@@ -29,20 +34,8 @@ class Shader;
 typedef std::shared_ptr<graphics::Shader> ShaderPtr;
 }
 
-typedef std::map<const std::string, graphics::ShaderPtr>						ShaderDirectory;
-
-namespace graphics
-{
-class ShadedMesh;
-typedef std::shared_ptr<graphics::ShadedMesh> ShadedMeshPtr;
-}
-typedef std::map<const std::string, graphics::ShadedMeshPtr>					ShadedMeshDirectory;
-
 namespace models
 {
 class Mesh;
 }
 typedef std::map<const std::string, models::Mesh*>								MeshDirectory;
-
-class SoundSource;
-typedef std::map<const std::string, std::shared_ptr<SoundSource>>				SoundDirectory;
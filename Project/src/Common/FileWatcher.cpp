@@ -0,0 +1,213 @@
+#include "GameStdAfx.h"
+#include "Common/FileWatcher.h"
+#include "Common/LoggerSystem.h"
+
+#include <boost/bind.hpp>
+
+#ifndef WIN32
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+
+// how often the watch thread checks whether it has to stop
+static const int s_pollPeriod = 250;
+
+// the writes of one save (eg. truncate, write, close) are reported once after this quiet time
+static const int s_settleTime = 100;
+
+
+FileWatcher::FileWatcher()
+	: m_isWatching(false)
+#ifdef WIN32
+	, m_changeHandle(INVALID_HANDLE_VALUE)
+#else
+	, m_inotifyFd(-1)
+	, m_watchDescriptor(-1)
+#endif
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	stop();
+}
+
+/**
+ * Starts watching a file.
+ *
+ * @param fileName	The watched file.
+ * @param callback	Called on the watch thread after the file was written.
+ */
+bool FileWatcher::start(const std::string& fileName, const Callback& callback)
+{
+	stop();
+
+	m_fileName = fileName;
+	m_dirName = utils::file::getDir(fileName);
+	m_callback = callback;
+
+	if (m_dirName.empty())
+	{
+		m_dirName = ".";
+	}
+
+	if (!openWatch())
+	{
+		TRACE_ERROR("Error: Cannot watch " << fileName, 0);
+		return false;
+	}
+
+	m_isWatching = true;
+	m_thread = boost::thread(boost::bind(&FileWatcher::watchLoop, this));
+
+	return true;
+}
+
+void FileWatcher::stop()
+{
+	if (!m_isWatching)
+	{
+		return;
+	}
+
+	m_isWatching = false;
+	m_thread.join();
+
+	closeWatch();
+}
+
+void FileWatcher::watchLoop()
+{
+	while (m_isWatching)
+	{
+		if (!waitForChange())
+		{
+			continue;
+		}
+
+		// let the writer finish, then drop the events of the same save
+		boost::this_thread::sleep(boost::posix_time::milliseconds(s_settleTime));
+		while (m_isWatching && waitForChange())
+		{
+			boost::this_thread::sleep(boost::posix_time::milliseconds(s_settleTime));
+		}
+
+		if (m_isWatching && utils::file::existFile(m_fileName))
+		{
+			m_callback(m_fileName);
+		}
+	}
+}
+
+#ifdef WIN32
+
+bool FileWatcher::openWatch()
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (GetFileAttributesExA(m_fileName.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		m_lastWriteTime = attributes.ftLastWriteTime;
+	}
+
+	m_changeHandle = FindFirstChangeNotificationA(m_dirName.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	return m_changeHandle != INVALID_HANDLE_VALUE;
+}
+
+void FileWatcher::closeWatch()
+{
+	if (m_changeHandle != INVALID_HANDLE_VALUE)
+	{
+		FindCloseChangeNotification(m_changeHandle);
+		m_changeHandle = INVALID_HANDLE_VALUE;
+	}
+}
+
+/**
+ * Waits for a change in the directory (at most s_pollPeriod), true if the watched file changed.
+ */
+bool FileWatcher::waitForChange()
+{
+	if (WaitForSingleObject(m_changeHandle, s_pollPeriod) != WAIT_OBJECT_0)
+	{
+		return false;
+	}
+
+	FindNextChangeNotification(m_changeHandle);
+
+	// the notification is for the whole directory
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(m_fileName.c_str(), GetFileExInfoStandard, &attributes) || CompareFileTime(&attributes.ftLastWriteTime, &m_lastWriteTime) == 0)
+	{
+		return false;
+	}
+
+	m_lastWriteTime = attributes.ftLastWriteTime;
+	return true;
+}
+
+#else
+
+bool FileWatcher::openWatch()
+{
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFd < 0)
+	{
+		return false;
+	}
+
+	m_watchDescriptor = inotify_add_watch(m_inotifyFd, m_dirName.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (m_watchDescriptor < 0)
+	{
+		closeWatch();
+		return false;
+	}
+
+	return true;
+}
+
+void FileWatcher::closeWatch()
+{
+	if (m_inotifyFd >= 0)
+	{
+		close(m_inotifyFd);
+		m_inotifyFd = -1;
+		m_watchDescriptor = -1;
+	}
+}
+
+/**
+ * Waits for inotify events of the directory (at most s_pollPeriod), true if one of them is for the watched file.
+ */
+bool FileWatcher::waitForChange()
+{
+	pollfd pollDescriptor = { m_inotifyFd, POLLIN, 0 };
+	if (poll(&pollDescriptor, 1, s_pollPeriod) <= 0)
+	{
+		return false;
+	}
+
+	const std::string fileName = utils::file::getFileNameWithExtension(m_fileName);
+	bool isChanged = false;
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length;
+	while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+	{
+		for (const char* pData = buffer; pData < buffer + length; )
+		{
+			const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(pData);
+			if (pEvent->len > 0 && fileName == pEvent->name)
+			{
+				isChanged = true;
+			}
+
+			pData += sizeof(inotify_event) + pEvent->len;
+		}
+	}
+
+	return isChanged;
+}
+
+#endif
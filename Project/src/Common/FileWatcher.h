@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <boost/thread/thread.hpp>
+
+
+/**
+ * @brief Calls back from its own thread when a file is written.
+ *
+ * The directory of the file is watched (inotify on linux, a change notification on windows), so the file is still
+ * seen when an editor saves it by replacing it. The writes that come in quick succession are reported once.
+ */
+class FileWatcher
+{
+public:
+	typedef std::function<void(const std::string& fileName)> Callback;
+
+	FileWatcher();
+	~FileWatcher();
+
+	bool	start(const std::string& fileName, const Callback& callback);
+	void	stop();
+
+	// getters-setters
+	bool	isWatching() const { return m_isWatching; }
+
+private:
+	void	watchLoop();
+	bool	waitForChange();
+
+	bool	openWatch();
+	void	closeWatch();
+
+private:
+	std::string			m_fileName;
+	std::string			m_dirName;
+	Callback			m_callback;
+
+	std::atomic<bool>	m_isWatching;		// cleared by the owner, read by the watch thread
+	boost::thread		m_thread;
+
+#ifdef WIN32
+	HANDLE				m_changeHandle;
+	FILETIME			m_lastWriteTime;
+#else
+	int					m_inotifyFd;
+	int					m_watchDescriptor;
+#endif
+};
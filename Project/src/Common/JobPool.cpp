@@ -0,0 +1,190 @@
+#include "GameStdAfx.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+
+
+/**
+ * @param numThreads	the threads of the loops with the calling one, 0: one per hardware thread.
+ */
+JobPool::JobPool(uint32_t numThreads)
+	: m_pFunction(nullptr)
+	, m_count(0)
+	, m_grainSize(1)
+	, m_nextBegin(0)
+	, m_loop(0)
+	, m_numBusyWorkers(0)
+	, m_isQuitting(false)
+{
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, boost::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 1; i < numThreads; ++i)
+	{
+		m_workers.push_back(boost::thread(boost::bind(&JobPool::workerLoop, this, i)));
+	}
+
+	TRACE_INFO("The parallel loops run on " << numThreads << " threads.", 0);
+}
+
+JobPool::~JobPool()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_isQuitting = true;
+	}
+	m_loopStarted.notify_all();
+
+	for (boost::thread& worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+}
+
+/**
+ * Calls function on the ranges of [0, count) in parallel and returns when all of them are done.
+ * The ranges are grainSize long (the last one may be shorter), their order is not defined.
+ */
+void JobPool::parallelFor(size_t count, size_t grainSize, const RangeFunction& function)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grainSize = std::max<size_t>(1, grainSize);
+
+	// a single range or a nested loop: no need to wake the workers
+	boost::unique_lock<boost::mutex> loopLock(m_loopMutex, boost::defer_lock);
+	if (count <= grainSize || m_workers.empty() || !loopLock.try_lock())
+	{
+		function(0, count);
+		return;
+	}
+
+	m_pFunction = &function;
+	m_count = count;
+	m_grainSize = grainSize;
+	m_nextBegin = 0;
+	m_exception = nullptr;
+
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_numBusyWorkers = (uint32_t)m_workers.size();
+		m_loop++;
+	}
+	m_loopStarted.notify_all();
+
+	runRanges();
+
+	// the workers use the function until they are done, even when the loop failed
+	std::exception_ptr exception;
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while (m_numBusyWorkers > 0)
+		{
+			m_loopFinished.wait(lock);
+		}
+
+		exception = m_exception;
+		m_exception = nullptr;
+	}
+
+	m_pFunction = nullptr;
+	loopLock.unlock();
+
+	if (exception)
+	{
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobPool::run(size_t count, size_t grainSize, const RangeFunction& function)
+{
+	if (JobPool::hasInstance())
+	{
+		JobPool::getInstance()->parallelFor(count, grainSize, function);
+	}
+	else if (count > 0)
+	{
+		function(0, count);
+	}
+}
+
+/**
+ * Takes the ranges of the running loop until there are none left. An exception of the function is kept for the
+ * calling thread of the loop, the ranges not taken yet are skipped.
+ */
+void JobPool::runRanges()
+{
+	try
+	{
+		for (;;)
+		{
+			const size_t begin = m_nextBegin.fetch_add(m_grainSize);
+			if (begin >= m_count)
+			{
+				return;
+			}
+
+			(*m_pFunction)(begin, std::min(begin + m_grainSize, m_count));
+		}
+	}
+	catch (...)
+	{
+		m_nextBegin = m_count;
+
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		if (!m_exception)
+		{
+			m_exception = std::current_exception();
+		}
+	}
+}
+
+/**
+ * The thread of a worker: helps with every loop.
+ */
+void JobPool::workerLoop(uint32_t workerIndex)
+{
+	uint64_t lastLoop = 0;
+
+	if (TraceRecorder::hasInstance())
+	{
+		TraceRecorder::getInstance()->setThreadName(utils::formatStr("job worker %u", workerIndex));
+	}
+
+	for (;;)
+	{
+		{
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while (!m_isQuitting && m_loop == lastLoop)
+			{
+				m_loopStarted.wait(lock);
+			}
+
+			if (m_isQuitting)
+			{
+				return;
+			}
+
+			lastLoop = m_loop;
+		}
+
+		runRanges();
+
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			m_numBusyWorkers--;
+		}
+		m_loopFinished.notify_one();
+	}
+}
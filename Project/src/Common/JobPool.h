@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+/**
+ * @brief Worker threads for the data parallel loops of a frame (eg. the cpu skinning of the models).
+ *
+ * parallelFor() splits [0, count) into ranges of grainSize elements, the workers and the calling thread take the ranges
+ * one by one until all of them are done. One loop runs at a time: a loop started while an other one is running
+ * (eg. from its body, or from an other thread) runs on the calling thread.
+ * An exception thrown by the function on any thread stops the loop (the ranges not started are skipped), it is
+ * rethrown by parallelFor() on the calling thread once the workers are done.
+ */
+class JobPool : public Singleton<JobPool>
+{
+public:
+	typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+	JobPool(uint32_t numThreads = 0);
+	~JobPool();
+
+	void		parallelFor(size_t count, size_t grainSize, const RangeFunction& function);
+
+	// on the job pool if there is one, else on the calling thread
+	static void	run(size_t count, size_t grainSize, const RangeFunction& function);
+
+	// getters-setters
+	uint32_t	getNumThreads() const { return (uint32_t)m_workers.size() + 1; }
+
+private:
+	void		workerLoop(uint32_t workerIndex);
+	void		runRanges();
+
+private:
+	std::vector<boost::thread>	m_workers;
+
+	// the running loop
+	boost::mutex				m_loopMutex;
+	const RangeFunction*		m_pFunction;
+	size_t						m_count;
+	size_t						m_grainSize;
+	std::atomic<size_t>			m_nextBegin;
+	std::exception_ptr			m_exception;		// the first one thrown by the loop (guarded by m_mutex)
+
+	// worker synchronization
+	boost::mutex				m_mutex;
+	boost::condition_variable	m_loopStarted;
+	boost::condition_variable	m_loopFinished;
+	uint64_t					m_loop;
+	uint32_t					m_numBusyWorkers;
+	bool						m_isQuitting;
+};
@@ -1,12 +1,42 @@
 #include "GameStdAfx.h"
 #include "Common/LoggerSystem.h"
 
-#define	TRACE_COLOR(color, msg, indent) LoggerSystem::getInstance()->log(msg, color, indent);
+#include <algorithm>
+#include <boost/bind.hpp>
 
 
-LoggerSystem::LoggerSystem(LogLevel logLevel) : logLevel(logLevel)
+// records per thread (power of two), a thread that logs more between two drains loses the rest
+static const size_t s_threadLogSize = 1024;
+
+// the writer sleeps this long when the rings are empty
+static const int s_writerPeriod = 5;
+
+
+LoggerSystem::ThreadLog::ThreadLog()
+	: records(s_threadLogSize)
+	, head(0)
+	, tail(0)
+{
+}
+
+
+LoggerSystem::LoggerSystem(LogLevel logLevel)
+	: m_logLevel(logLevel)
+	, m_indentNum(0)
+	, m_nextSequence(0)
+	, m_numDroppedRecords(0)
+	, m_numReportedDrops(0)
+	, m_isRunning(true)
+{
+	m_writerThread = boost::thread(boost::bind(&LoggerSystem::writerLoop, this));
+}
+
+LoggerSystem::~LoggerSystem()
 {
+	m_isRunning = false;
+	m_writerThread.join();
 
+	flush();
 }
 
 void LoggerSystem::configure(entityx::EventManager& eventManager)
@@ -23,26 +53,220 @@ void LoggerSystem::receive(const LogMessage& logMessage)
 	log(logMessage.logLevel, logMessage.message);
 }
 
-void LoggerSystem::prepareLog(LogLevel messageLogLevel, int indent, short color)
+/**
+ * Queues a message for the writer thread. Never blocks: the message is dropped if the ring of the thread is full.
+ *
+ * @param indent	Added to the indentation of this and the following messages.
+ * @param color		Console color of the message.
+ */
+void LoggerSystem::log(LogLevel messageLogLevel, const std::string& message, int indent, short color)
 {
-	if (messageLogLevel > logLevel)
+	if (!isEnabled(messageLogLevel))
+	{
+		return;
+	}
+
+	ThreadLog& threadLog = getThreadLog();
+
+	const uint64_t head = threadLog.head.load(std::memory_order_relaxed);
+	if (head - threadLog.tail.load(std::memory_order_acquire) >= threadLog.records.size())
 	{
+		m_numDroppedRecords++;
 		return;
 	}
 
-	setConsoleColors(color, 0);
+	// the string of the slot keeps its capacity, so a warm ring doesn't allocate
+	LogRecord& record = threadLog.records[head & (threadLog.records.size() - 1)];
+	record.sequence = m_nextSequence++;
+	record.logLevel = messageLogLevel;
+	record.indent = indent;
+	record.color = color;
+	record.text = message;
+
+	threadLog.head.store(head + 1, std::memory_order_release);
+}
 
-	indentNum += indent;
-	for (int i = 0; i < indentNum; ++i)
+/**
+ * Writes everything queued so far (eg. before an exit).
+ */
+void LoggerSystem::flush()
+{
+	while (drain())
 	{
-		std::cout << '\t';
 	}
 }
 
-void LoggerSystem::log(LogLevel messageLogLevel, const std::string& message, int indent, short color)
+/**
+ * Redirects the output to a file, an empty name sets it back to the console.
+ */
+bool LoggerSystem::setOutputFile(const std::string& fileName)
 {
-	prepareLog(messageLogLevel, indent, color);
-	std::cout << message << std::endl;
+	boost::mutex::scoped_lock lock(m_writeMutex);
+
+	if (m_outputFile.is_open())
+	{
+		m_outputFile.close();
+	}
+
+	if (fileName.empty())
+	{
+		return true;
+	}
+
+	m_outputFile.open(fileName.c_str(), std::ios::out | std::ios::trunc);
+	return m_outputFile.is_open();
+}
+
+/**
+ * The formatting stream of the calling thread, emptied.
+ */
+std::ostringstream& LoggerSystem::getThreadStream()
+{
+	static thread_local std::ostringstream stream;
+	stream.str("");
+	stream.clear();
+
+	return stream;
+}
+
+/**
+ * The ring of the calling thread. The thread holds a reference to it until it exits, the writer recycles the rings
+ * only it holds.
+ */
+LoggerSystem::ThreadLog& LoggerSystem::getThreadLog()
+{
+	static thread_local std::shared_ptr<ThreadLog> s_pThreadLog;
+	static thread_local LoggerSystem* s_pOwner = nullptr;
+
+	if (s_pOwner != this)
+	{
+		boost::mutex::scoped_lock lock(m_threadLogsMutex);
+
+		if (!m_freeThreadLogs.empty())
+		{
+			s_pThreadLog = m_freeThreadLogs.back();
+			m_freeThreadLogs.pop_back();
+
+			s_pThreadLog->head.store(0, std::memory_order_relaxed);
+			s_pThreadLog->tail.store(0, std::memory_order_relaxed);
+		}
+		else
+		{
+			s_pThreadLog = std::make_shared<ThreadLog>();
+		}
+
+		m_threadLogs.push_back(s_pThreadLog);
+		s_pOwner = this;
+	}
+
+	return *s_pThreadLog;
+}
+
+void LoggerSystem::writerLoop()
+{
+	while (m_isRunning)
+	{
+		if (!drain())
+		{
+			boost::this_thread::sleep(boost::posix_time::milliseconds(s_writerPeriod));
+		}
+	}
+}
+
+/**
+ * Writes the records queued in the rings of the threads as one batch, in the order they were logged.
+ *
+ * @return Whether there was anything to write.
+ */
+bool LoggerSystem::drain()
+{
+	boost::mutex::scoped_lock lock(m_writeMutex);
+
+	{
+		boost::mutex::scoped_lock threadLogsLock(m_threadLogsMutex);
+
+		for (size_t i = 0; i < m_threadLogs.size(); )
+		{
+			// the last reference of an exited thread is dropped before this: nothing is logged into it any more
+			const bool isThreadExited = m_threadLogs[i].use_count() == 1;
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			ThreadLog& threadLog = *m_threadLogs[i];
+			const uint64_t tail = threadLog.tail.load(std::memory_order_relaxed);
+			const uint64_t head = threadLog.head.load(std::memory_order_acquire);
+
+			for (uint64_t record = tail; record < head; ++record)
+			{
+				m_batch.push_back(threadLog.records[record & (threadLog.records.size() - 1)]);
+			}
+
+			threadLog.tail.store(head, std::memory_order_release);
+
+			if (isThreadExited)
+			{
+				m_freeThreadLogs.push_back(m_threadLogs[i]);
+				m_threadLogs[i] = m_threadLogs.back();
+				m_threadLogs.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	const uint64_t numDroppedRecords = m_numDroppedRecords;
+	if (m_batch.empty() && numDroppedRecords == m_numReportedDrops)
+	{
+		return false;
+	}
+
+	std::sort(m_batch.begin(), m_batch.end(), [](const LogRecord& a, const LogRecord& b) { return a.sequence < b.sequence; });
+
+	for (const LogRecord& record : m_batch)
+	{
+		write(record);
+	}
+
+	if (numDroppedRecords != m_numReportedDrops)
+	{
+		LogRecord dropRecord = { 0, LogLevel::WARNING, 0, (short)ConsoleColor::RED | (short)ConsoleColor::GREEN | (short)ConsoleColor::BRIGHT };
+		dropRecord.text = utils::formatStr("Logger: %llu messages dropped (full thread buffer).", (unsigned long long)(numDroppedRecords - m_numReportedDrops));
+		write(dropRecord);
+
+		m_numReportedDrops = numDroppedRecords;
+	}
+
+	if (m_outputFile.is_open())
+	{
+		m_outputFile.flush();
+	}
+	else
+	{
+		std::cout.flush();
+	}
+
+	m_batch.clear();
+
+	return true;
+}
+
+void LoggerSystem::write(const LogRecord& record)
+{
+	std::ostream& stream = m_outputFile.is_open() ? (std::ostream&)m_outputFile : std::cout;
+
+	if (!m_outputFile.is_open())
+	{
+		setConsoleColors(record.color, 0);
+	}
+
+	m_indentNum = std::max(0, m_indentNum + record.indent);
+	for (int i = 0; i < m_indentNum; ++i)
+	{
+		stream << '\t';
+	}
+
+	stream << record.text << '\n';
 }
 
 short LoggerSystem::getConsoleColor()
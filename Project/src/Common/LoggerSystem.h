@@ -3,6 +3,11 @@
 #include "Common/Singleton.h"
 #include <entityx/System.h>
 
+#include <atomic>
+#include <memory>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
 
 enum class LogLevel
 {
@@ -30,31 +35,99 @@ struct LogMessage
 	std::string message;
 };
 
+/**
+ * @brief A formatted log message waiting for the writer thread.
+ */
+struct LogRecord
+{
+	uint64_t	sequence;		// the order of the records of all the threads
+	LogLevel	logLevel;
+	int			indent;
+	short		color;
+	std::string	text;
+};
+
+/**
+ * @brief Writes the log on a background thread.
+ *
+ * The TRACE_ macros check the level first, so a filtered message is never formatted. A message that passes is
+ * formatted into a stream of the logging thread and queued in the lock-free ring buffer of the thread (one producer:
+ * the thread, one consumer: the writer), the logging thread never waits for the output. When a ring is full the
+ * message is dropped and counted, the writer reports the drops.
+ * The writer thread drains the rings in batches, restores the order of the records of the threads, and writes them
+ * (indentation, console colors) to the console or to the log file with one flush per batch.
+ * The ring of a thread is shared by the thread and the logger: once the thread exited and its ring is drained, the
+ * ring is recycled for the next new thread.
+ */
 class LoggerSystem : public entityx::System<LoggerSystem>, public entityx::Receiver<LoggerSystem>, public Singleton<LoggerSystem>
 {
 public:
 	LoggerSystem(LogLevel logLevel = LogLevel::NUM);
+	~LoggerSystem();
 
 	void configure(entityx::EventManager& eventManager);
 	void update(entityx::EntityManager& entityManager, entityx::EventManager& eventManager, entityx::TimeDelta dt);
 	void receive(const LogMessage& logMessage);
 
-	void prepareLog(LogLevel messageLogLevel, int indent = 0, short color = 0);
 	void log(LogLevel messageLogLevel, const std::string& message, int indent = 0, short color = 0);
+	void flush();
 
+	bool setOutputFile(const std::string& fileName);
+
+	// read by every thread on every trace, only ordered against itself: a relaxed load
+	inline bool isEnabled(LogLevel messageLogLevel) const { return messageLogLevel <= m_logLevel.load(std::memory_order_relaxed); }
+
+	// getters-setters
+	void setLogLevel(LogLevel logLevel) { m_logLevel.store(logLevel, std::memory_order_relaxed); }
+	uint64_t getNumDroppedRecords() const { return m_numDroppedRecords; }
+
+	static std::ostringstream& getThreadStream();
 	static void setConsoleColors(short fg, short bg);
 
 private:
+	/**
+	 * @brief Single producer, single consumer ring of the records of one thread.
+	 */
+	struct ThreadLog
+	{
+		ThreadLog();
+
+		std::vector<LogRecord>	records;			// power of two size
+		std::atomic<uint64_t>	head;				// written by the thread
+		std::atomic<uint64_t>	tail;				// written by the writer
+	};
+
+	ThreadLog& getThreadLog();
+
+	void writerLoop();
+	bool drain();
+	void write(const LogRecord& record);
+
 	static void setConsoleColor(short c);
 	static short getConsoleColor();
 
 private:
-	LogLevel logLevel;
-	int indentNum;
+	std::atomic<LogLevel>		m_logLevel;
+	int							m_indentNum;		// only used by the writer
+
+	std::vector<std::shared_ptr<ThreadLog>>	m_threadLogs;		// the live threads, and the exited ones not drained yet
+	std::vector<std::shared_ptr<ThreadLog>>	m_freeThreadLogs;	// drained, of exited threads
+	boost::mutex				m_threadLogsMutex;	// adding and recycling a thread
+
+	std::atomic<uint64_t>		m_nextSequence;
+	std::atomic<uint64_t>		m_numDroppedRecords;
+	uint64_t					m_numReportedDrops;
+
+	std::vector<LogRecord>		m_batch;
+	std::ofstream				m_outputFile;
+	boost::mutex				m_writeMutex;		// the batch and the output (the writer, flush())
+
+	std::atomic<bool>			m_isRunning;
+	boost::thread				m_writerThread;
 };
 
-#define QLOG(msg)								std::cout << msg << std::endl;
-#define QLOG_(logLevel, msg, indent, color)		{ LoggerSystem::getInstance()->prepareLog(logLevel, indent, color); QLOG(msg); }
+#define QLOG_(logLevel, msg, indent, color)		{ if (LoggerSystem::getInstance()->isEnabled(logLevel)) { std::ostringstream& logStream = LoggerSystem::getThreadStream(); logStream << msg; LoggerSystem::getInstance()->log(logLevel, logStream.str(), indent, color); } }
+#define QLOG(msg)								QLOG_(LogLevel::INFO, msg, 0, (short)ConsoleColor::RED | (short)ConsoleColor::GREEN | (short)ConsoleColor::BLUE);
 #define MQLOG(logLevel, msg, indent, color)		QLOG_(logLevel, __FUNCTION__ << "<" << this << ">: " << msg, indent, color);
 
 #define	TRACE_COLOR(level, msg, indent, color)	QLOG_(level, msg, indent, color);
@@ -0,0 +1,142 @@
+#include "GameStdAfx.h"
+#include "Common/LuaAllocator.h"
+
+#include <algorithm>
+#include <cstddef>
+
+
+/**
+ * Prefix of every block allocated by the lua state: the owner account of the block.
+ */
+union LuaAllocHeader
+{
+	struct
+	{
+		uint32_t account;
+		uint32_t generation;
+	} tag;
+
+	std::max_align_t align;		// keeps the user part of the block aligned
+};
+
+
+LuaAllocator::LuaAllocator()
+	: m_usage(0)
+	, m_currentAccount(0)
+{
+	reset();
+}
+
+/**
+ * Forgets every block and account. Has to be called after the lua state is closed.
+ */
+void LuaAllocator::reset()
+{
+	m_accounts.assign(1, { 0, 0, 0 });
+	m_freeAccounts.clear();
+	m_currentAccount = 0;
+	m_usage = 0;
+}
+
+/**
+ * Creates a new memory account. The allocations made while the account is current are charged to it.
+ *
+ * @param limit	The maximum number of bytes the account can hold (0: unlimited).
+ */
+uint32_t LuaAllocator::createAccount(size_t limit)
+{
+	uint32_t account;
+	if (!m_freeAccounts.empty())
+	{
+		account = m_freeAccounts.back();
+		m_freeAccounts.pop_back();
+	}
+	else
+	{
+		account = (uint32_t)m_accounts.size();
+		m_accounts.push_back({ 0, 0, 0 });
+	}
+
+	m_accounts[account].used = 0;
+	m_accounts[account].limit = limit;
+
+	return account;
+}
+
+void LuaAllocator::releaseAccount(uint32_t account)
+{
+	GX_ASSERT(account > 0 && account < m_accounts.size());
+
+	if (m_currentAccount == account)
+	{
+		m_currentAccount = 0;
+	}
+
+	// the living blocks of the account are not credited to anyone after this
+	m_accounts[account].used = 0;
+	m_accounts[account].limit = 0;
+	m_accounts[account].generation++;
+
+	m_freeAccounts.push_back(account);
+}
+
+/**
+ * The lua_Alloc of the lua state: tags the blocks with the current memory account and refuses
+ * the growth of an account over its limit (lua raises a memory error in the running script).
+ */
+void* LuaAllocator::allocate(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	LuaAllocator* pAllocator = static_cast<LuaAllocator*>(ud);
+	LuaAllocHeader* pHeader = ptr ? static_cast<LuaAllocHeader*>(ptr) - 1 : nullptr;
+
+	LuaMemoryAccount& account = pAllocator->m_accounts[pAllocator->m_currentAccount];
+	if (nsize > osize && account.limit > 0)
+	{
+		const bool isOwnBlock = pHeader && pHeader->tag.account == pAllocator->m_currentAccount && pHeader->tag.generation == account.generation;
+		if (account.used - (isOwnBlock ? osize : 0) + nsize > account.limit)
+		{
+			return nullptr;
+		}
+	}
+
+	// credit the old block to its owner
+	if (pHeader)
+	{
+		LuaMemoryAccount& owner = pAllocator->m_accounts[pHeader->tag.account];
+		if (owner.generation == pHeader->tag.generation)
+		{
+			owner.used -= std::min(owner.used, osize);
+		}
+		pAllocator->m_usage -= osize;
+	}
+
+	if (nsize == 0)
+	{
+		free(pHeader);
+		return nullptr;
+	}
+
+	LuaAllocHeader* pNewHeader = static_cast<LuaAllocHeader*>(realloc(pHeader, sizeof(LuaAllocHeader) + nsize));
+	if (!pNewHeader)
+	{
+		// the old block is untouched: charge it back
+		if (pHeader)
+		{
+			LuaMemoryAccount& owner = pAllocator->m_accounts[pHeader->tag.account];
+			if (owner.generation == pHeader->tag.generation)
+			{
+				owner.used += osize;
+			}
+			pAllocator->m_usage += osize;
+		}
+		return nullptr;
+	}
+
+	pNewHeader->tag.account = pAllocator->m_currentAccount;
+	pNewHeader->tag.generation = account.generation;
+
+	account.used += nsize;
+	pAllocator->m_usage += nsize;
+
+	return pNewHeader + 1;
+}
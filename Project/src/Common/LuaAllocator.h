@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Memory budget of a group of lua allocations (eg. a drone script).
+ */
+struct LuaMemoryAccount
+{
+	size_t		used;
+	size_t		limit;			// 0: unlimited
+	uint32_t	generation;		// blocks of a released account are not credited to its next owner
+};
+
+/**
+ * @brief The lua_Alloc of a lua state with per account memory limits.
+ *
+ * Every block is tagged with the account that was current when it was allocated, so the block is credited back
+ * to the same account when it is freed, no matter which script runs the gc. Account 0 is the unlimited shared heap.
+ * One allocator belongs to one lua state: it is not thread safe.
+ */
+class LuaAllocator
+{
+public:
+	LuaAllocator();
+
+	void		reset();
+
+	uint32_t	createAccount(size_t limit);
+	void		releaseAccount(uint32_t account);
+
+	// getters-setters
+	void		setCurrentAccount(uint32_t account)					{ m_currentAccount = account; }
+	const LuaMemoryAccount& getAccount(uint32_t account) const	{ return m_accounts[account]; }
+	size_t		getUsage() const										{ return m_usage; }
+
+	static void* allocate(void* ud, void* ptr, size_t osize, size_t nsize);
+
+private:
+	size_t							m_usage;
+	uint32_t						m_currentAccount;
+	std::vector<LuaMemoryAccount>	m_accounts;
+	std::vector<uint32_t>			m_freeAccounts;
+};
@@ -1,11 +1,40 @@
 #include "GameStdAfx.h"
 #include "Common/LuaManager.h"
 #include "Common/LoggerSystem.h"
+#include "Common/ScriptSandbox.h"
+
+#ifdef CLIENT_SIDE
+#include "Console/GameConsole.h"
+#endif
+
+#include <chrono>
+#include <functional>
+
+
+// the doString() chunk cache is dropped when it grows over this (eg. many different console commands)
+static const size_t s_maxCachedChunks = 256;
+
+// incremental gc: a new cycle starts when the heap grew by 50% since the last one (lua default: 100%)
+static const int s_gcPause = 150;
+static const int s_gcStepMultiplier = 200;
+
+// the work of one explicit gc step (kb of allocation it pays for)
+static const int s_gcStepSize = 16;
+
+static int writeBytecode(lua_State* state, const void* data, size_t size, void* userData)
+{
+	static_cast<std::string*>(userData)->append(static_cast<const char*>(data), size);
+	return 0;
+}
+
 
 LuaManager::LuaManager()
 	: m_state(nullptr)
 	, m_isOpened(false)
+	, m_isProfiling(false)
+	, m_profilerSamplePeriod(1000)
 {
+	m_gcStats = { 0, 0, 0, 0.0f, 0.0f, 0, false };
 }
 
 /**
@@ -20,62 +49,239 @@ void LuaManager::init()
 		close();
 	}
 
-	m_state = luaL_newstate();
+	m_state = lua_newstate(&LuaAllocator::allocate, &m_allocator);
 	luaL_openlibs(m_state);
 	luabind::open(m_state);
 
+	configureGarbageCollector(m_state);
+	m_gcStats.liveMemory = 0;
+	m_gcStats.isCycleRunning = false;
+
+	if (m_isProfiling)
+	{
+		lua_sethook(m_state, &LuaManager::profilerHook, LUA_MASKCOUNT, m_profilerSamplePeriod);
+	}
+
 	createTable("entityTable");
 
+	lua_pushnil(m_state);
+	m_nil = luabind::object(luabind::from_stack(m_state, -1));
+	lua_pop(m_state, 1);
+
 	m_isOpened = true;
 }
 
 void LuaManager::close()
 {
+	clearCaches();
+
 	lua_close(m_state);
 	m_isOpened = false;
+
+	// every block is freed with the state
+	m_allocator.reset();
+	m_tableSizes.clear();
 }
 
 /**
- * Runs the given lua file.
+ * Runs the given lua file. The bytecode of the file is kept: running it again while it is unchanged skips the parsing.
  *
  * @param file	The file to be run.
  */
 void LuaManager::doFile(const std::string& file)
 {
-	//int luaError = luaL_loadfile(m_state, file.c_str());
-	luaL_loadfile(m_state, file.c_str());
-
-	try
+	if (loadFile(file))
 	{
-		luabind::object compiledScript(luabind::from_stack(m_state, -1));
-		luabind::call_function<void>(compiledScript);
-	}
-	catch (const luabind::error& e)
-	{
-		printError(e);
+		runLoadedChunk();
 	}
 }
 
 /**
- * Adds the given command to the lua interpreter.
+ * Adds the given command to the lua interpreter. The compiled chunks are cached by the hash of the source.
  *
  * @param command	The command to be run.
  */
 void LuaManager::doString(const std::string& command)
 {
-	//int luaError = luaL_loadstring(m_state, command.c_str());
-	luaL_loadstring(m_state, command.c_str());
+	if (loadString(command))
+	{
+		runLoadedChunk();
+	}
+}
+
+/**
+ * Pushes the compiled chunk of a command: from the chunk cache or compiled (and cached).
+ */
+bool LuaManager::loadString(const std::string& command)
+{
+	const size_t sourceHash = std::hash<std::string>()(command);
+
+	auto chunkIt = m_chunkCache.find(sourceHash);
+	if (chunkIt != m_chunkCache.end() && chunkIt->second.source == command)
+	{
+		lua_rawgeti(m_state, LUA_REGISTRYINDEX, chunkIt->second.functionRef);
+		return true;
+	}
+
+	const bool isCollision = chunkIt != m_chunkCache.end();
+
+	if (luaL_loadstring(m_state, command.c_str()) != 0)
+	{
+		TRACE_ERROR("Lua Error: " << lua_tostring(m_state, -1), 0);
+		lua_pop(m_state, 1);
+		return false;
+	}
+
+	if (!isCollision)
+	{
+		if (m_chunkCache.size() >= s_maxCachedChunks)
+		{
+			for (const auto& entry : m_chunkCache)
+			{
+				luaL_unref(m_state, LUA_REGISTRYINDEX, entry.second.functionRef);
+			}
+			m_chunkCache.clear();
+		}
+
+		CachedChunk& chunk = m_chunkCache[sourceHash];
+		chunk.source = command;
+
+		lua_pushvalue(m_state, -1);
+		chunk.functionRef = luaL_ref(m_state, LUA_REGISTRYINDEX);
+	}
+
+	return true;
+}
+
+/**
+ * Pushes the compiled chunk of a file: loaded from its bytecode if the file did not change since its last run,
+ * otherwise compiled from the source (and dumped to bytecode).
+ */
+bool LuaManager::loadFile(const std::string& file)
+{
+	// from the mounted asset pack or the disk
+	std::string source;
+	if (!utils::file::readFile(file, source))
+	{
+		TRACE_ERROR("Lua Error: cannot open " << file, 0);
+		return false;
+	}
+
+	// like luaL_loadfile: a first line starting with # is skipped (commented out, the line numbers stay the same)
+	if (!source.empty() && source[0] == '#')
+	{
+		source.insert(0, "--");
+	}
+
+	const size_t sourceHash = std::hash<std::string>()(source);
+	const std::string chunkName = "@" + file;
+
+	CompiledFile& compiledFile = m_compiledFiles[file];
+	if (!compiledFile.bytecode.empty() && compiledFile.sourceHash == sourceHash)
+	{
+		if (luaL_loadbuffer(m_state, compiledFile.bytecode.data(), compiledFile.bytecode.size(), chunkName.c_str()) == 0)
+		{
+			return true;
+		}
+		lua_pop(m_state, 1);
+	}
+
+	if (luaL_loadbuffer(m_state, source.data(), source.size(), chunkName.c_str()) != 0)
+	{
+		TRACE_ERROR("Lua Error: " << lua_tostring(m_state, -1), 0);
+		lua_pop(m_state, 1);
+		m_compiledFiles.erase(file);
+		return false;
+	}
+
+	compiledFile.sourceHash = sourceHash;
+	compiledFile.bytecode.clear();
+	lua_dump(m_state, &writeBytecode, &compiledFile.bytecode);
+
+	return true;
+}
+
+/**
+ * Calls the compiled chunk on the top of the stack.
+ */
+void LuaManager::runLoadedChunk()
+{
+	beginCall("chunk");
 
 	try
 	{
 		luabind::object compiledScript(luabind::from_stack(m_state, -1));
-		//if (compiledScript.is_valid())
+		lua_pop(m_state, 1);
+
 		luabind::call_function<void>(compiledScript);
 	}
 	catch (const luabind::error& e)
 	{
 		printError(e);
 	}
+
+	// the chunk may have defined the functions again
+	invalidateFunctions();
+}
+
+/**
+ * Removes an element of a global array like table.remove() does: the elements after it are shifted down.
+ */
+void LuaManager::removeTableElement(const std::string& tableName, int index)
+{
+	lua_getglobal(m_state, tableName.c_str());
+	if (!lua_istable(m_state, -1))
+	{
+		lua_pop(m_state, 1);
+		return;
+	}
+
+	const int size = (int)lua_objlen(m_state, -1);
+	if (index >= 1 && index <= size)
+	{
+		for (int i = index; i < size; ++i)
+		{
+			lua_rawgeti(m_state, -1, i + 1);
+			lua_rawseti(m_state, -2, i);
+		}
+
+		lua_pushnil(m_state);
+		lua_rawseti(m_state, -2, size);
+	}
+
+	lua_pop(m_state, 1);
+}
+
+/**
+ * Changes the size counter of a global table and writes it to its <table>Size global.
+ *
+ * @return The new size.
+ */
+int LuaManager::addToTableSize(const std::string& tableName, int delta)
+{
+	int& size = m_tableSizes[tableName];
+	size += delta;
+
+	lua_pushinteger(m_state, size);
+	lua_setglobal(m_state, (tableName + "Size").c_str());
+
+	return size;
+}
+
+/**
+ * Drops the cached chunks and functions of the current state. The bytecode of the files is kept.
+ */
+void LuaManager::clearCaches()
+{
+	// the handles stay, the functions are looked up in the next state
+	invalidateFunctions();
+	m_nil = luabind::object();
+
+	for (const auto& entry : m_chunkCache)
+	{
+		luaL_unref(m_state, LUA_REGISTRYINDEX, entry.second.functionRef);
+	}
+	m_chunkCache.clear();
 }
 
 void LuaManager::createTable(const std::string & tableName)
@@ -83,10 +289,169 @@ void LuaManager::createTable(const std::string & tableName)
 	luabind::object table = luabind::newtable(m_state);
 	luabind::globals(m_state)[tableName] = table;
 	luabind::globals(m_state)[tableName + "Size"] = 0;
+	m_tableSizes[tableName] = 0;
 
-#ifdef CLIENT_SIDE
-	GameConsole::addKeywordToConsole(tableName);
-#endif
+	addKeywordToConsole(tableName);
+}
+
+/**
+ * Runs the garbage collector of the main state for the given time (the idle time of the tick).
+ *
+ * @param budget The time budget in ms.
+ */
+void LuaManager::stepGarbageCollector(float budget)
+{
+	stepGarbageCollector(m_state, budget, m_gcStats);
+}
+
+/**
+ * Sets the incremental gc parameters of a lua state (lua 5.1 has no generational mode).
+ */
+void LuaManager::configureGarbageCollector(lua_State* state)
+{
+	lua_gc(state, LUA_GCSETPAUSE, s_gcPause);
+	lua_gc(state, LUA_GCSETSTEPMUL, s_gcStepMultiplier);
+}
+
+/**
+ * Runs incremental gc steps on a lua state until the time budget is used up or the current cycle finishes.
+ * The steps done here are not done in the allocations of the next tick, so the gc work moves into the idle time.
+ * There is nothing to do while the heap is under the pause threshold and no cycle is running: a step would start
+ * the next cycle earlier than the tuned pause.
+ *
+ * @param budget	The time budget in ms.
+ * @param stats		Updated with the steps, the finished cycles, the time and the memory of the state.
+ * @return			Whether a cycle finished.
+ */
+bool LuaManager::stepGarbageCollector(lua_State* state, float budget, LuaGcStats& stats)
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point startTime = Clock::now();
+
+	stats.memory = (size_t)lua_gc(state, LUA_GCCOUNT, 0) * 1024 + (size_t)lua_gc(state, LUA_GCCOUNTB, 0);
+
+	const bool hasDebt = stats.isCycleRunning || stats.memory >= stats.liveMemory / 100 * s_gcPause;
+	if (!hasDebt || budget <= 0.0f)
+	{
+		stats.lastStepTime = 0.0f;
+		return false;
+	}
+
+	bool isCycleFinished = false;
+	float elapsedMs = 0.0f;
+
+	while (!isCycleFinished && elapsedMs < budget)
+	{
+		isCycleFinished = lua_gc(state, LUA_GCSTEP, s_gcStepSize) != 0;
+		stats.numSteps++;
+
+		elapsedMs = std::chrono::duration<float, std::milli>(Clock::now() - startTime).count();
+	}
+
+	stats.lastStepTime = elapsedMs;
+	stats.maxStepTime = std::max(stats.maxStepTime, elapsedMs);
+	stats.memory = (size_t)lua_gc(state, LUA_GCCOUNT, 0) * 1024 + (size_t)lua_gc(state, LUA_GCCOUNTB, 0);
+
+	if (isCycleFinished)
+	{
+		stats.numCycles++;
+		stats.liveMemory = stats.memory;
+	}
+	stats.isCycleRunning = !isCycleFinished;
+
+	return isCycleFinished;
+}
+
+/**
+ * Starts the sampling profiler of the main state and the drone script shards. The collected samples are dropped.
+ *
+ * @param samplePeriod	The number of lua instructions between two samples.
+ */
+void LuaManager::startProfiling(int samplePeriod)
+{
+	m_profiler.clear();
+	m_profilerSamplePeriod = samplePeriod;
+	m_isProfiling = true;
+
+	// the coroutines created after this inherit the hook
+	lua_sethook(m_state, &LuaManager::profilerHook, LUA_MASKCOUNT, m_profilerSamplePeriod);
+
+	if (ScriptSandbox::hasInstance())
+	{
+		ScriptSandbox::getInstance()->setProfiling(true, samplePeriod);
+	}
+
+	TRACE_LUA("Lua profiling started.", 0);
+}
+
+void LuaManager::stopProfiling()
+{
+	m_isProfiling = false;
+	lua_sethook(m_state, nullptr, 0, 0);
+
+	if (ScriptSandbox::hasInstance())
+	{
+		ScriptSandbox::getInstance()->setProfiling(false, m_profilerSamplePeriod);
+	}
+
+	TRACE_LUA("Lua profiling stopped.", 0);
+}
+
+/**
+ * Starts the profiling, or stops it and writes the profile (the console command).
+ *
+ * @param fileName	The folded stacks file written when the profiling stops.
+ * @return			Whether the profiler runs now.
+ */
+bool LuaManager::toggleProfiling(const std::string& fileName)
+{
+	if (!m_isProfiling)
+	{
+		startProfiling(m_profilerSamplePeriod);
+		return true;
+	}
+
+	stopProfiling();
+	writeProfile(fileName);
+	return false;
+}
+
+/**
+ * Writes the samples of the main state and the drone script shards into a folded stacks file
+ * (input of the flame graph tools) and logs the summary: time per root (callback or drone script) and the hot functions.
+ */
+void LuaManager::writeProfile(const std::string& fileName)
+{
+	LuaProfiler profile;
+	profile.merge(m_profiler);
+
+	if (ScriptSandbox::hasInstance())
+	{
+		ScriptSandbox::getInstance()->collectProfile(profile);
+	}
+
+	std::ofstream file(fileName.c_str());
+	if (file)
+	{
+		profile.writeFoldedStacks(file);
+	}
+	else
+	{
+		TRACE_ERROR("Error: cannot write the lua profile to " << fileName, 0);
+	}
+
+	std::stringstream report;
+	profile.writeReport(report);
+
+	TRACE_LUA("Lua profile (" << fileName << "):\n" << report.str(), 0);
+}
+
+void LuaManager::profilerHook(lua_State* state, lua_Debug* debugInfo)
+{
+	if (debugInfo->event == LUA_HOOKCOUNT)
+	{
+		LuaManager::getInstance()->m_profiler.sample(state);
+	}
 }
 
 int LuaManager::handleError(lua_State* state)
@@ -129,12 +494,58 @@ lua_State* LuaManager::getState()
 
 bool LuaManager::functionExist(const std::string& functionName)
 {
-	using namespace luabind;
+	const luabind::object& func = getFunction(functionName);
+
+	return (func && luabind::type(func) == LUA_TFUNCTION);
+}
 
-	const object g = globals(m_state);
-	const object func = g[ functionName.c_str() ];
+LuaFunctionHandle LuaManager::getFunctionHandle(const std::string& functionName)
+{
+	const auto handleIt = m_functionHandles.find(functionName);
+	if (handleIt != m_functionHandles.end())
+	{
+		return handleIt->second;
+	}
 
-	return (func && type(func) == LUA_TFUNCTION);
+	const LuaFunctionHandle function = (LuaFunctionHandle)m_functions.size();
+
+	CachedFunction cachedFunction;
+	cachedFunction.name = functionName;
+	cachedFunction.traceName = TraceRecorder::hasInstance() ? TraceRecorder::getInstance()->intern(functionName) : nullptr;
+	m_functions.push_back(cachedFunction);
+	m_functionHandles.insert(std::make_pair(functionName, function));
+
+	return function;
+}
+
+/**
+ * Returns the global function of the handle (nil if there is none). The reference is cached: the hot callbacks
+ * (eg. animateSceneL) are one index away, the global is only looked up by name after the scripts were run again.
+ */
+const luabind::object& LuaManager::getFunction(const LuaFunctionHandle function)
+{
+	CachedFunction& cachedFunction = m_functions[function];
+	if (cachedFunction.function.is_valid())
+	{
+		return cachedFunction.function;
+	}
+
+	lua_getglobal(m_state, cachedFunction.name.c_str());
+	if (!lua_isnil(m_state, -1))
+	{
+		cachedFunction.function = luabind::object(luabind::from_stack(m_state, -1));
+	}
+	lua_pop(m_state, 1);
+
+	return cachedFunction.function.is_valid() ? cachedFunction.function : m_nil;
+}
+
+void LuaManager::invalidateFunctions()
+{
+	for (CachedFunction& cachedFunction : m_functions)
+	{
+		cachedFunction.function = luabind::object();
+	}
 }
 
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <set>
 #include <string>
 #include <iostream>
@@ -18,12 +19,36 @@ extern "C"
 #include <luabind/operator.hpp>
 #include <luabind/shared_ptr_converter.hpp>
 
-#include "Console/GameConsole.h"
+#include "Common/LuaAllocator.h"
+#include "Common/LuaProfiler.h"
+#include "Common/TraceRecorder.h"
 
 
 // creates a boost reference from the pointer
 #define REF_POINTER(T, p)	if (std::is_pointer<T>())	p = std::ref<T>(p);
 
+// adds the keyword to the console autocompletion, does nothing on the server (it has no console)
+void addKeywordToConsole(const std::string& keyword);
+
+
+/**
+ * @brief Garbage collector metrics of a lua state.
+ */
+struct LuaGcStats
+{
+	size_t		memory;				// bytes, after the last step
+	uint32_t	numSteps;
+	uint32_t	numCycles;			// finished by the explicit steps
+	float		lastStepTime;		// ms, the last stepGarbageCollector() call
+	float		maxStepTime;		// ms
+
+	size_t		liveMemory;			// bytes, after the last cycle finished by the explicit steps
+	bool		isCycleRunning;		// a cycle was started by the explicit steps and is not finished yet
+};
+
+// the slot of a global function called from c++, stable while the manager lives (init() and close() keep it)
+typedef uint32_t LuaFunctionHandle;
+
 
 class LuaManager : public Singleton<LuaManager>
 {
@@ -33,6 +58,22 @@ public:
 	void	init();
 	void	close();
 
+	size_t	getMemoryUsage() const { return m_allocator.getUsage(); }
+
+	// garbage collection
+	void	stepGarbageCollector(float budget);
+	const LuaGcStats& getGcStats() const { return m_gcStats; }
+
+	static void	configureGarbageCollector(lua_State* state);
+	static bool	stepGarbageCollector(lua_State* state, float budget, LuaGcStats& stats);
+
+	// profiling
+	void	startProfiling(int samplePeriod = 1000);
+	void	stopProfiling();
+	bool	toggleProfiling(const std::string& fileName);
+	void	writeProfile(const std::string& fileName);
+	bool	isProfiling() const { return m_isProfiling; }
+
 	void	doFile(const std::string& file);
 	void	doString(const std::string& command);
 
@@ -77,28 +118,26 @@ public:
 	template <typename Type>
 	int registerEntity(const Type element, const std::string& name = "")
 	{
-		const int size = luabind::object_cast<int>( luabind::globals(m_state)["entityTableSize"] );
-		luabind::globals(m_state)["entityTableSize"] = size + 1;
+		const int size = addToTableSize("entityTable", 1);
 		luabind::globals(m_state)["entityTable"] [ name ] = element;
 
-		GameConsole::addKeywordToConsole(name);
+		addKeywordToConsole(name);
 
-		return size + 1;
+		return size;
 	}
 
 	template <typename Type, typename Id>
 	int registerEntityToTable(const std::string& tableName, const Type& element, const Id id, const bool registerToActorTable = false)
 	{
-		const int entityTableSize = luabind::object_cast<int>( luabind::globals(m_state)["entityTableSize"] );
+		const int entityTableSize = m_tableSizes["entityTable"];
 
 		if (registerToActorTable)
 		{
-			luabind::globals(m_state)["entityTableSize"] = entityTableSize + 1;
+			addToTableSize("entityTable", 1);
 			luabind::globals(m_state)["entityTable"] [ id ] = element;
 		}
 
-		const int tableSize = luabind::object_cast<int>( luabind::globals(m_state)[tableName + "Size"] );
-		luabind::globals(m_state)[tableName + "Size"] = tableSize + 1;
+		addToTableSize(tableName, 1);
 		luabind::globals(m_state)[tableName.c_str()] [ id ] = element;
 
 		return entityTableSize + 1;
@@ -107,25 +146,16 @@ public:
 	template <typename Id>
 	int unregisterActorFromTable(const std::string& tableName, const Id id, const bool unregisterFromActorTable = false)
 	{
-		const int entityTableSize = luabind::object_cast<int>( luabind::globals(m_state)["entityTableSize"] );
-
-		std::stringstream removeCommandSS;
+		const int entityTableSize = m_tableSizes["entityTable"];
 
 		if (unregisterFromActorTable)
 		{
-			removeCommandSS << "table.remove(entityTable, " << id << ")";
-
-			luabind::globals(m_state)["entityTableSize"] = entityTableSize - 1;
-			doString(removeCommandSS.str());
-
-			removeCommandSS.clear();
+			addToTableSize("entityTable", -1);
+			removeTableElement("entityTable", (int)id);
 		}
 
-		removeCommandSS << "table.remove(" << tableName << ", " << id << ")";
-
-		const int tableSize = luabind::object_cast<int>( luabind::globals(m_state)[tableName + "Size"] );
-		luabind::globals(m_state)[tableName + "Size"] = tableSize - 1;
-		doString(removeCommandSS.str());
+		addToTableSize(tableName, -1);
+		removeTableElement(tableName, (int)id);
 
 		return entityTableSize - 1;
 	}
@@ -139,12 +169,35 @@ public:
 
 	bool functionExist(const std::string& functionName);
 
-	// Call function
-	void callFunction(const std::string& methodName)
+	/**
+	 * The handle of a global function: the name is looked up once, the callers of the hot callbacks keep the handle.
+	 */
+	LuaFunctionHandle getFunctionHandle(const std::string& functionName);
+	const std::string& getFunctionName(const LuaFunctionHandle function) const { return m_functions[function].name; }
+	// the name interned once for the trace zones of the calls (nullptr without a TraceRecorder)
+	const char* getFunctionTraceName(const LuaFunctionHandle function) const { return m_functions[function].traceName; }
+
+	const luabind::object& getFunction(const LuaFunctionHandle function);
+	const luabind::object& getFunction(const std::string& functionName) { return getFunction(getFunctionHandle(functionName)); }
+
+	// the functions are looked up again at their next call (a global function was set from c++)
+	void invalidateFunctions();
+
+	// Call function (by name: the name is looked up at every call)
+	template <typename... Args>
+	void callFunction(const std::string& functionName, Args&&... args)
+	{
+		callFunction(getFunctionHandle(functionName), std::forward<Args>(args)...);
+	}
+
+	void callFunction(const LuaFunctionHandle function)
 	{
+		TRACE_ZONE(getFunctionTraceName(function));
+		beginCall(getFunctionName(function));
+
 		try
 		{
-			luabind::call_function<void>(m_state, methodName.c_str());
+			luabind::call_function<void>(getFunction(function));
 		}
 		catch (luabind::error e)
 		{
@@ -153,13 +206,16 @@ public:
 	}
 
 	template <typename Ref1>
-	void callFunction(const std::string& methodName, Ref1 ref1)
+	void callFunction(const LuaFunctionHandle function, Ref1 ref1)
 	{
 		REF_POINTER(Ref1, ref1);
 
+		TRACE_ZONE(getFunctionTraceName(function));
+		beginCall(getFunctionName(function));
+
 		try
 		{
-			luabind::call_function<void>(m_state, methodName.c_str(), ref1);
+			luabind::call_function<void>(getFunction(function), ref1);
 		}
 		catch (luabind::error e)
 		{
@@ -168,14 +224,17 @@ public:
 	}
 
 	template <typename Ref1, typename Ref2>
-	void callFunction(const std::string& methodName, Ref1 ref1, Ref2 ref2)
+	void callFunction(const LuaFunctionHandle function, Ref1 ref1, Ref2 ref2)
 	{
 		REF_POINTER(Ref1, ref1);
 		REF_POINTER(Ref2, ref2);
 
+		TRACE_ZONE(getFunctionTraceName(function));
+		beginCall(getFunctionName(function));
+
 		try
 		{
-			luabind::call_function<void>(m_state, methodName.c_str(), ref1, ref2);
+			luabind::call_function<void>(getFunction(function), ref1, ref2);
 		}
 		catch (luabind::error e)
 		{
@@ -184,15 +243,18 @@ public:
 	}
 
 	template <typename Ref1, typename Ref2, typename Ref3>
-	void callFunction(const std::string& methodName, Ref1 ref1, Ref2 ref2, Ref3 ref3)
+	void callFunction(const LuaFunctionHandle function, Ref1 ref1, Ref2 ref2, Ref3 ref3)
 	{
 		REF_POINTER(Ref1, ref1);
 		REF_POINTER(Ref2, ref2);
 		REF_POINTER(Ref3, ref3);
 
+		TRACE_ZONE(getFunctionTraceName(function));
+		beginCall(getFunctionName(function));
+
 		try
 		{
-			luabind::call_function<void>(m_state, methodName.c_str(), ref1, ref2, ref3);
+			luabind::call_function<void>(getFunction(function), ref1, ref2, ref3);
 		}
 		catch (luabind::error e)
 		{
@@ -201,16 +263,19 @@ public:
 	}
 
 	template <typename Ref1, typename Ref2, typename Ref3, typename Ref4>
-	void callFunction(const std::string& methodName, Ref1& ref1, Ref2& ref2, Ref3& ref3, Ref4& ref4)
+	void callFunction(const LuaFunctionHandle function, Ref1& ref1, Ref2& ref2, Ref3& ref3, Ref4& ref4)
 	{
 		REF_POINTER(Ref1, ref1);
 		REF_POINTER(Ref2, ref2);
 		REF_POINTER(Ref3, ref3);
 		REF_POINTER(Ref4, ref4);
 
+		TRACE_ZONE(getFunctionTraceName(function));
+		beginCall(getFunctionName(function));
+
 		try
 		{
-			luabind::call_function<void>(m_state, methodName.c_str(), ref1, ref2, ref3, ref4);
+			luabind::call_function<void>(getFunction(function), ref1, ref2, ref3, ref4);
 		}
 		catch (luabind::error e)
 		{
@@ -224,6 +289,9 @@ public:
 	template <typename Callee>
 	void callMethod(Callee object, const std::string& methodName)
 	{
+		TRACE_ZONE_STR(methodName);
+		beginCall(methodName);
+
 		try
 		{
 			luabind::globals(m_state)["myObj"] = object;
@@ -240,6 +308,9 @@ public:
 	{
 		REF_POINTER(Ref1, ref1);
 
+		TRACE_ZONE_STR(methodName);
+		beginCall(methodName);
+
 		try
 		{
 			luabind::globals(m_state)["myObj"] = object;
@@ -257,6 +328,9 @@ public:
 		REF_POINTER(Ref1, ref1);
 		REF_POINTER(Ref2, ref2);
 
+		TRACE_ZONE_STR(methodName);
+		beginCall(methodName);
+
 		try
 		{
 			luabind::globals(m_state)["myObj"] = object;
@@ -275,6 +349,9 @@ public:
 		REF_POINTER(Ref2, ref2);
 		REF_POINTER(Ref3, ref3);
 
+		TRACE_ZONE_STR(methodName);
+		beginCall(methodName);
+
 		try
 		{
 			luabind::globals(m_state)["myObj"] = object;
@@ -294,6 +371,9 @@ public:
 		REF_POINTER(Ref3, ref3);
 		REF_POINTER(Ref4, ref4);
 
+		TRACE_ZONE_STR(methodName);
+		beginCall(methodName);
+
 		try
 		{
 			luabind::globals(m_state)["myObj"] = object;
@@ -310,15 +390,69 @@ public:
 	lua_State* getState();
 
 private:
+	bool	loadString(const std::string& command);
+	bool	loadFile(const std::string& file);
+	void	runLoadedChunk();
+
+	void	removeTableElement(const std::string& tableName, int index);
+	int		addToTableSize(const std::string& tableName, int delta);
+	void	clearCaches();
+
+	void	beginCall(const std::string& rootName) { if (m_isProfiling) m_profiler.beginSlice(rootName); }
+	static void	profilerHook(lua_State* state, lua_Debug* debugInfo);
+
 	void	printError(const luabind::error& e);
 	int		handleError(lua_State* state);
 
 private:
+	/**
+	 * A compiled doString() chunk, kept in the registry.
+	 */
+	struct CachedChunk
+	{
+		std::string	source;			// hash collisions are compiled again
+		int			functionRef;
+	};
+
+	/**
+	 * The bytecode of a doFile() script. It survives init()/close(): a reload of an unchanged script is not parsed again.
+	 */
+	struct CompiledFile
+	{
+		size_t		sourceHash;
+		std::string	bytecode;
+	};
+
+	/**
+	 * A global function called from c++. The reference is looked up at the first call and kept until the scripts are
+	 * run again (doFile(), doString(), init()): a global reassigned inside a callback is seen after the next script
+	 * run, not at once. A missing one is not cached.
+	 */
+	struct CachedFunction
+	{
+		std::string			name;
+		const char*			traceName;		// TraceRecorder::intern()ed at getFunctionHandle()
+		luabind::object		function;		// not valid until the global is found, dropped by close()
+	};
+
 	lua_State*	m_state;
 	bool		m_isOpened;
-};
 
-void addKeywordToConsole(const std::string& keyword);
+	LuaAllocator	m_allocator;
+
+	LuaGcStats		m_gcStats;
+
+	LuaProfiler		m_profiler;
+	bool			m_isProfiling;
+	int				m_profilerSamplePeriod;		// instructions
+
+	std::map<std::string, int>				m_tableSizes;		// the <table>Size globals, kept here so they are never read back
+	std::map<size_t, CachedChunk>			m_chunkCache;		// key: the hash of the source
+	std::map<std::string, CompiledFile>		m_compiledFiles;	// key: the file name
+	std::vector<CachedFunction>				m_functions;		// by handle
+	std::map<std::string, LuaFunctionHandle>	m_functionHandles;	// the name -> the slot
+	luabind::object							m_nil;				// the function of the missing globals
+};
 
 #define REG_CONSTR(C)			thisClass.def(C);
 #define REG_FUNC(name, F)		{ thisClass.def(name, F);				addKeywordToConsole(utils::formatStr("%( )", name)); }
@@ -0,0 +1,161 @@
+#include "GameStdAfx.h"
+#include "Common/LuaProfiler.h"
+
+extern "C"
+{
+#include "lua.h"
+}
+
+#include <algorithm>
+
+
+// deeper frames are not walked (eg. runaway recursion)
+static const int s_maxStackDepth = 64;
+
+
+LuaProfiler::LuaProfiler()
+	: m_lastSampleTime(Clock::now())
+{
+}
+
+void LuaProfiler::clear()
+{
+	m_functions.clear();
+	m_roots.clear();
+	m_foldedStacks.clear();
+}
+
+/**
+ * Adds the samples of another profiler (eg. the profiler of another lua state) to this one.
+ */
+void LuaProfiler::merge(const LuaProfiler& other)
+{
+	for (const auto& entry : other.m_functions)
+	{
+		FunctionStats& stats = m_functions[entry.first];
+		stats.selfTime += entry.second.selfTime;
+		stats.totalTime += entry.second.totalTime;
+		stats.numSamples += entry.second.numSamples;
+	}
+
+	for (const auto& entry : other.m_roots)
+	{
+		m_roots[entry.first] += entry.second;
+	}
+
+	for (const auto& entry : other.m_foldedStacks)
+	{
+		m_foldedStacks[entry.first] += entry.second;
+	}
+}
+
+/**
+ * Starts a run of lua code: the next sample is measured from here.
+ *
+ * @param root The name the stacks of the slice are charged to (eg. the name of a drone script).
+ */
+void LuaProfiler::beginSlice(const std::string& root)
+{
+	m_root = root;
+	m_lastSampleTime = Clock::now();
+}
+
+/**
+ * Takes a sample of the running lua stack. Called from the count hook of the state.
+ */
+void LuaProfiler::sample(lua_State* state)
+{
+	const Clock::time_point now = Clock::now();
+	const uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lastSampleTime).count();
+	m_lastSampleTime = now;
+
+	m_frames.clear();
+
+	lua_Debug debugInfo;
+	for (int level = 0; level < s_maxStackDepth && lua_getstack(state, level, &debugInfo); ++level)
+	{
+		lua_getinfo(state, "Sn", &debugInfo);
+
+		const char* name = debugInfo.name;
+		if (!name)
+		{
+			name = (*debugInfo.what == 'm') ? "main chunk" : "?";
+		}
+
+		std::string frame = utils::formatStr("%s (%s:%d)", name, debugInfo.short_src, debugInfo.linedefined);
+		std::replace(frame.begin(), frame.end(), ';', ':');
+
+		m_frames.push_back(frame);
+	}
+
+	if (m_frames.empty())
+	{
+		return;
+	}
+
+	// self time of the innermost function, total time of every function on the stack (once per sample)
+	FunctionStats& innermost = m_functions[m_frames.front()];
+	innermost.selfTime += elapsed;
+	innermost.numSamples++;
+
+	for (size_t i = 0; i < m_frames.size(); ++i)
+	{
+		if (std::find(m_frames.begin(), m_frames.begin() + i, m_frames[i]) == m_frames.begin() + i)
+		{
+			m_functions[m_frames[i]].totalTime += elapsed;
+		}
+	}
+
+	m_roots[m_root] += elapsed;
+
+	// root first, innermost last
+	std::string stack = m_root;
+	for (auto frameIt = m_frames.rbegin(); frameIt != m_frames.rend(); ++frameIt)
+	{
+		stack += ';';
+		stack += *frameIt;
+	}
+
+	m_foldedStacks[stack] += elapsed;
+}
+
+/**
+ * Writes the stacks in the folded format of the flame graph tools: "root;outer;...;inner <microseconds>" per line.
+ */
+void LuaProfiler::writeFoldedStacks(std::ostream& stream) const
+{
+	for (const auto& entry : m_foldedStacks)
+	{
+		const uint64_t microseconds = std::max<uint64_t>(1, (entry.second + 500) / 1000);
+		stream << entry.first << " " << microseconds << "\n";
+	}
+}
+
+/**
+ * Writes the slice roots and the functions with the most self time.
+ */
+void LuaProfiler::writeReport(std::ostream& stream, uint32_t maxFunctions) const
+{
+	std::vector<std::pair<std::string, uint64_t>> roots(m_roots.begin(), m_roots.end());
+	std::sort(roots.begin(), roots.end(), [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) { return a.second > b.second; });
+
+	stream << "root\ttime (ms)\n";
+	for (const auto& root : roots)
+	{
+		stream << (root.first.empty() ? "?" : root.first) << "\t" << root.second / 1e6 << "\n";
+	}
+
+	std::vector<std::pair<std::string, FunctionStats>> functions(m_functions.begin(), m_functions.end());
+	std::sort(functions.begin(), functions.end(), [](const std::pair<std::string, FunctionStats>& a, const std::pair<std::string, FunctionStats>& b) { return a.second.selfTime > b.second.selfTime; });
+
+	if (functions.size() > maxFunctions)
+	{
+		functions.resize(maxFunctions);
+	}
+
+	stream << "\nself (ms)\ttotal (ms)\tsamples\tfunction\n";
+	for (const auto& function : functions)
+	{
+		stream << function.second.selfTime / 1e6 << "\t" << function.second.totalTime / 1e6 << "\t" << function.second.numSamples << "\t" << function.first << "\n";
+	}
+}
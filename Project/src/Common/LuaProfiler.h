@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct lua_State;
+
+
+/**
+ * @brief Sampling profiler of lua code, driven by a count hook.
+ *
+ * Every sample walks the lua stack and charges the time since the previous sample to it: to the innermost function
+ * as self time, to every function on the stack as total time and to the root of the slice (eg. a drone script).
+ * A slice is a continuous run of lua code, beginSlice() has to be called when the lua code is entered, so the time
+ * spent outside lua is not charged to the first sample.
+ * One profiler belongs to one lua state: it is not thread safe, the profilers of the states are merged for the reports.
+ */
+class LuaProfiler
+{
+public:
+	struct FunctionStats
+	{
+		uint64_t	selfTime;		// ns
+		uint64_t	totalTime;		// ns
+		uint32_t	numSamples;
+	};
+
+	LuaProfiler();
+
+	void		clear();
+	void		merge(const LuaProfiler& other);
+
+	void		beginSlice(const std::string& root);
+	void		sample(lua_State* state);
+
+	void		writeFoldedStacks(std::ostream& stream) const;
+	void		writeReport(std::ostream& stream, uint32_t maxFunctions = 20) const;
+
+	// getters-setters
+	const std::map<std::string, FunctionStats>& getFunctions() const	{ return m_functions; }
+	const std::map<std::string, uint64_t>& getRoots() const				{ return m_roots; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	std::string						m_root;
+	Clock::time_point				m_lastSampleTime;
+
+	std::map<std::string, FunctionStats>	m_functions;		// key: "name (source:line)"
+	std::map<std::string, uint64_t>			m_roots;			// time per slice root (ns)
+	std::map<std::string, uint64_t>			m_foldedStacks;		// "root;outer;...;inner" -> time (ns)
+
+	std::vector<std::string>		m_frames;			// scratch: the stack of the current sample, innermost first
+};
@@ -0,0 +1,66 @@
+#include "GameStdAfx.h"
+#include "Common/MappedFile.h"
+#include "Common/AssetPack.h"
+#include "Common/LoggerSystem.h"
+
+
+MappedFile::MappedFile()
+	: m_pData(nullptr)
+	, m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& fileName)
+{
+	close();
+
+	if (AssetPack::hasInstance() && AssetPack::getInstance()->read(fileName, m_pData, m_size, m_buffer))
+	{
+		m_fileName = fileName;
+		return true;
+	}
+
+	return map(fileName);
+}
+
+bool MappedFile::map(const std::string& fileName)
+{
+	close();
+
+	try
+	{
+		boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+
+		m_mapping.swap(mapping);
+		m_region.swap(region);
+	}
+	catch (const boost::interprocess::interprocess_exception& e)
+	{
+		TRACE_ERROR("Can't map " << fileName << ": " << e.what(), 0);
+		return false;
+	}
+
+	m_fileName = fileName;
+	m_pData = static_cast<const uint8_t*>(m_region.get_address());
+	m_size = m_region.get_size();
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	boost::interprocess::mapped_region().swap(m_region);
+	boost::interprocess::file_mapping().swap(m_mapping);
+
+	std::vector<uint8_t>().swap(m_buffer);
+
+	m_fileName.clear();
+	m_pData = nullptr;
+	m_size = 0;
+}
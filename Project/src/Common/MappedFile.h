@@ -0,0 +1,59 @@
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+
+/**
+ * @brief A read only file mapped into the memory: the baked assets are used in place, without reading them.
+ *
+ * The pages are loaded by the os on the first access, the mapping lives until close() or the destructor.
+ * open() takes the file from the mounted AssetPack if it is in it (a view of the pack, or the decompressed copy),
+ * map() maps the file on the disk.
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool	open(const std::string& fileName);
+	bool	map(const std::string& fileName);
+	void	close();
+
+	// getters-setters
+	bool			isOpen() const { return m_pData != nullptr; }
+
+	const uint8_t*	getData() const { return m_pData; }
+	size_t			getSize() const { return m_size; }
+
+	const std::string& getFileName() const { return m_fileName; }
+
+	// the bytes [offset, offset + count * sizeof(T)) as T, nullptr if they are not in the file
+	template <typename T>
+	const T*		getArray(const size_t offset, const size_t count) const
+	{
+		if (offset > m_size || count > (m_size - offset) / sizeof(T))
+		{
+			return nullptr;
+		}
+
+		return reinterpret_cast<const T*>(m_pData + offset);
+	}
+
+private:
+	MappedFile(const MappedFile& other);
+	MappedFile& operator=(const MappedFile& other);
+
+private:
+	std::string								m_fileName;
+
+	boost::interprocess::file_mapping		m_mapping;
+	boost::interprocess::mapped_region		m_region;
+
+	// a compressed file of the AssetPack
+	std::vector<uint8_t>					m_buffer;
+
+	const uint8_t*							m_pData;
+	size_t									m_size;
+};
@@ -0,0 +1,172 @@
+#include "GameStdAfx.h"
+#include "Common/PerformanceMetrics.h"
+
+#include <algorithm>
+#include <iomanip>
+
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+/**
+ * Drops the recorded values. Not synchronized with record(): a value recorded meanwhile may be partly kept.
+ */
+void LatencyHistogram::reset()
+{
+	for (std::atomic<uint32_t>& count : m_counts)
+	{
+		count.store(0, std::memory_order_relaxed);
+	}
+
+	for (std::atomic<uint32_t>& value : m_recentValues)
+	{
+		value.store(0, std::memory_order_relaxed);
+	}
+
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+	m_nextRecentValue.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(uint64_t value)
+{
+	m_counts[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(value, std::memory_order_relaxed);
+
+	if (value > m_max.load(std::memory_order_relaxed))
+	{
+		m_max.store(value, std::memory_order_relaxed);
+	}
+
+	const uint32_t recentIndex = m_nextRecentValue.fetch_add(1, std::memory_order_relaxed) % s_numRecentValues;
+	m_recentValues[recentIndex].store((uint32_t)std::min<uint64_t>(value, UINT32_MAX), std::memory_order_relaxed);
+}
+
+/**
+ * The value under which the given percent of the recorded values are (the upper end of its bucket, at most the max).
+ *
+ * @param percentile [0, 100]
+ */
+uint64_t LatencyHistogram::getPercentile(float percentile) const
+{
+	const uint64_t count = getCount();
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(percentile / 100.0f * count + 0.5f));
+
+	uint64_t seen = 0;
+	for (uint32_t index = 0; index < s_numBuckets; ++index)
+	{
+		seen += m_counts[index].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			return std::min(getBucketValue(index + 1) - 1, getMax());
+		}
+	}
+
+	return getMax();
+}
+
+double LatencyHistogram::getMean() const
+{
+	const uint64_t count = getCount();
+	return count ? (double)m_sum.load(std::memory_order_relaxed) / count : 0.0;
+}
+
+void LatencyHistogram::getRecentValues(std::vector<uint32_t>& values) const
+{
+	const uint32_t next = m_nextRecentValue.load(std::memory_order_relaxed);
+
+	values.resize(s_numRecentValues);
+	for (uint32_t i = 0; i < s_numRecentValues; ++i)
+	{
+		values[i] = m_recentValues[(next + i) % s_numRecentValues].load(std::memory_order_relaxed);
+	}
+}
+
+/**
+ * Under 32 the value is the index, above that the top 5 bits of the value select one of the 16 buckets of its
+ * power of two range.
+ */
+uint32_t LatencyHistogram::getBucketIndex(uint64_t value)
+{
+	uint32_t shift = 0;
+	while ((value >> shift) >= (1u << s_subBucketBits))
+	{
+		shift++;
+	}
+
+	return std::min(shift * s_halfSubBucketCount + (uint32_t)(value >> shift), s_numBuckets - 1);
+}
+
+/**
+ * The lowest value of a bucket.
+ */
+uint64_t LatencyHistogram::getBucketValue(uint32_t index)
+{
+	if (index < (1u << s_subBucketBits))
+	{
+		return index;
+	}
+
+	const uint32_t shift = index / s_halfSubBucketCount - 1;
+	return (uint64_t)(index - shift * s_halfSubBucketCount) << shift;
+}
+
+
+PerformanceMetrics::PerformanceMetrics()
+{
+}
+
+void PerformanceMetrics::reset()
+{
+	for (LatencyHistogram& histogram : m_histograms)
+	{
+		histogram.reset();
+	}
+}
+
+/**
+ * Writes a line per recorded metric: the number of the samples and the percentiles in ms.
+ */
+void PerformanceMetrics::writeReport(std::ostream& stream) const
+{
+	stream << std::fixed << std::setprecision(2);
+	stream << std::left << std::setw(18) << "metric (ms)" << "count\tmean\tp50\tp95\tp99\tmax\n";
+
+	for (int i = 0; i < (int)Metric::NUM; ++i)
+	{
+		const LatencyHistogram& histogram = m_histograms[i];
+		if (histogram.getCount() == 0)
+		{
+			continue;
+		}
+
+		stream << std::left << std::setw(18) << getMetricName((Metric)i) << histogram.getCount()
+			<< "\t" << histogram.getMean() / 1000.0
+			<< "\t" << histogram.getPercentile(50.0f) / 1000.0
+			<< "\t" << histogram.getPercentile(95.0f) / 1000.0
+			<< "\t" << histogram.getPercentile(99.0f) / 1000.0
+			<< "\t" << histogram.getMax() / 1000.0 << "\n";
+	}
+}
+
+const char* PerformanceMetrics::getMetricName(Metric metric)
+{
+	switch (metric)
+	{
+		case Metric::FRAME_TIME:			return "frame";
+		case Metric::TICK_TIME:				return "tick";
+		case Metric::BROADCAST_TIME:		return "broadcast";
+		case Metric::LUA_TIME:				return "lua";
+		case Metric::NETWORK_RECEIVE_TIME:	return "network receive";
+		default:							return "?";
+	}
+}
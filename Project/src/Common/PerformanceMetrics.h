@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Common/Singleton.h"
+
+#include <atomic>
+#include <chrono>
+
+
+/**
+ * @brief HDR style histogram of durations in microseconds.
+ *
+ * The buckets are log-linear: the values under 32 us have their own bucket, above that every power of two range is
+ * split into 16 buckets, so a percentile is exact to ~6% at any magnitude (a 40 us and a 4 s sample are both
+ * measured well) in a fixed 4 kb. One thread records, any thread can read (the counters are atomic).
+ */
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void		reset();
+	void		record(uint64_t value);
+
+	uint64_t	getPercentile(float percentile) const;
+	uint64_t	getMax() const { return m_max.load(std::memory_order_relaxed); }
+	uint64_t	getCount() const { return m_count.load(std::memory_order_relaxed); }
+	double		getMean() const;
+
+	// the last values, oldest first (eg. for a graph)
+	void		getRecentValues(std::vector<uint32_t>& values) const;
+
+	static const uint32_t s_numRecentValues = 256;
+
+private:
+	static uint32_t	getBucketIndex(uint64_t value);
+	static uint64_t	getBucketValue(uint32_t index);
+
+	static const uint32_t s_subBucketBits = 5;
+	static const uint32_t s_halfSubBucketCount = 1 << (s_subBucketBits - 1);
+	static const uint32_t s_numBuckets = 64 * s_halfSubBucketCount;
+
+private:
+	std::atomic<uint32_t>	m_counts[s_numBuckets];
+	std::atomic<uint64_t>	m_count;
+	std::atomic<uint64_t>	m_sum;
+	std::atomic<uint64_t>	m_max;
+
+	std::atomic<uint32_t>	m_recentValues[s_numRecentValues];
+	std::atomic<uint32_t>	m_nextRecentValue;
+};
+
+enum class Metric
+{
+	FRAME_TIME = 0,
+	TICK_TIME,
+	BROADCAST_TIME,
+	LUA_TIME,
+	NETWORK_RECEIVE_TIME,
+	NUM,
+};
+
+/**
+ * @brief The timing histograms of the client and the server, reported by the "stats" console command.
+ */
+class PerformanceMetrics : public Singleton<PerformanceMetrics>
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	PerformanceMetrics();
+
+	void	reset();
+	void	record(Metric metric, uint64_t microseconds) { m_histograms[(int)metric].record(microseconds); }
+
+	void	writeReport(std::ostream& stream) const;
+
+	// getters-setters
+	const LatencyHistogram& getHistogram(Metric metric) const { return m_histograms[(int)metric]; }
+
+	static const char* getMetricName(Metric metric);
+
+private:
+	LatencyHistogram	m_histograms[(int)Metric::NUM];
+};
+
+/**
+ * @brief Records the time from its construction to its destruction into a metric.
+ */
+class MetricTimer
+{
+public:
+	explicit MetricTimer(Metric metric)
+		: m_metric(metric)
+		, m_startTime(PerformanceMetrics::Clock::now())
+	{
+	}
+
+	~MetricTimer()
+	{
+		const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(PerformanceMetrics::Clock::now() - m_startTime);
+		PerformanceMetrics::getInstance()->record(m_metric, (uint64_t)duration.count());
+	}
+
+private:
+	Metric							m_metric;
+	PerformanceMetrics::Clock::time_point	m_startTime;
+};
+
+#define MEASURE_METRIC_CONCAT_(a, b)	a##b
+#define MEASURE_METRIC_CONCAT(a, b)		MEASURE_METRIC_CONCAT_(a, b)
+
+// measures the time till the end of the scope
+#define MEASURE_METRIC(metric)			MetricTimer MEASURE_METRIC_CONCAT(metricTimer, __LINE__)(metric)
@@ -0,0 +1,144 @@
+#include "GameStdAfx.h"
+#include "Common/ResourcePool.h"
+#include "Common/AssetPack.h"
+
+
+ResourcePoolBase::ResourcePoolBase(const std::string& typeName)
+	: m_typeName(typeName)
+{
+}
+
+std::string ResourcePoolBase::getCanonicalName(const std::string& name)
+{
+	const std::string path = AssetPack::normalizePath(name);
+
+	// "dir/../" is nothing (the ".." of the root are kept)
+	std::vector<std::string> parts;
+	size_t begin = 0;
+	while (begin <= path.size())
+	{
+		size_t end = path.find('/', begin);
+		if (end == std::string::npos)
+		{
+			end = path.size();
+		}
+
+		const std::string part = path.substr(begin, end - begin);
+		if (part == ".." && !parts.empty() && parts.back() != ".." && !parts.back().empty())
+		{
+			parts.pop_back();
+		}
+		else
+		{
+			parts.push_back(part);
+		}
+
+		begin = end + 1;
+	}
+
+	std::string canonicalName;
+	canonicalName.reserve(path.size());
+	for (size_t i = 0; i < parts.size(); i++)
+	{
+		if (i > 0)
+		{
+			canonicalName += '/';
+		}
+		canonicalName += parts[i];
+	}
+
+	return canonicalName;
+}
+
+ResourcePoolBase::MemoryReport ResourcePoolBase::getMemoryReport() const
+{
+	MemoryReport report;
+	report.typeName = m_typeName;
+	report.numResources = 0;
+	report.numReferences = 0;
+	report.size = 0;
+
+	for (const Slot& slot : m_slots)
+	{
+		if (slot.numReferences > 0)
+		{
+			report.numResources++;
+			report.numReferences += slot.numReferences;
+			report.size += slot.size;
+		}
+	}
+
+	return report;
+}
+
+uint32_t ResourcePoolBase::findSlot(const std::string& canonicalName) const
+{
+	const auto range = m_slotsByName.equal_range(AssetPack::hashPath(canonicalName));
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (m_slots[it->second].canonicalName == canonicalName)
+		{
+			return it->second;
+		}
+	}
+
+	return INVALID_INDEX;
+}
+
+uint32_t ResourcePoolBase::allocateSlot(const std::string& name, const std::string& canonicalName, const size_t size)
+{
+	uint32_t index;
+	if (!m_freeSlots.empty())
+	{
+		index = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)m_slots.size();
+
+		Slot slot;
+		slot.generation = 1;
+		m_slots.push_back(slot);
+	}
+
+	Slot& slot = m_slots[index];
+	slot.name = name;
+	slot.canonicalName = canonicalName;
+	slot.numReferences = 1;
+	slot.size = size;
+
+	m_slotsByName.insert(std::make_pair(AssetPack::hashPath(canonicalName), index));
+
+	return index;
+}
+
+/**
+ * The next generation of the slot: the handles of the released resource are stale.
+ */
+void ResourcePoolBase::freeSlot(const uint32_t index)
+{
+	Slot& slot = m_slots[index];
+
+	const auto range = m_slotsByName.equal_range(AssetPack::hashPath(slot.canonicalName));
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == index)
+		{
+			m_slotsByName.erase(it);
+			break;
+		}
+	}
+
+	slot.name.clear();
+	slot.canonicalName.clear();
+	slot.size = 0;
+
+	// 0 is the generation of the invalid handles
+	if (++slot.generation == 0)
+	{
+		slot.generation = 1;
+	}
+
+	m_freeSlots.push_back(index);
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * The id of a resource of a ResourcePool: the index of its slot and the generation of the slot when it was added.
+ * The slot of a released resource is reused with the next generation, the old handles of it get nothing.
+ */
+template <typename T>
+struct ResourceHandle
+{
+	ResourceHandle() : index(0), generation(0) {}
+	ResourceHandle(const uint32_t index, const uint32_t generation) : index(index), generation(generation) {}
+
+	bool isValid() const { return generation != 0; }
+
+	bool operator==(const ResourceHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+
+	uint32_t	index;
+	uint32_t	generation;
+};
+
+/**
+ * The bookkeeping of the slots of a ResourcePool, shared by the types of the resources.
+ */
+class ResourcePoolBase
+{
+public:
+	struct MemoryReport
+	{
+		std::string	typeName;
+		size_t		numResources;
+		size_t		numReferences;
+		size_t		size;
+	};
+
+	explicit ResourcePoolBase(const std::string& typeName);
+
+	// the name the same file has whatever path it is loaded by: normalized (AssetPack), without "dir/.."
+	static std::string	getCanonicalName(const std::string& name);
+
+	// getters-setters
+	const std::string&	getTypeName() const { return m_typeName; }
+	size_t				getNumResources() const { return m_slots.size() - m_freeSlots.size(); }
+
+	// the resources, their references and their bytes (as told by add() and setSize())
+	MemoryReport		getMemoryReport() const;
+
+protected:
+	static const uint32_t INVALID_INDEX = 0xffffffff;
+
+	struct Slot
+	{
+		std::string	name;
+		std::string	canonicalName;
+		uint32_t	generation;
+		uint32_t	numReferences;
+		size_t		size;
+	};
+
+	uint32_t	findSlot(const std::string& canonicalName) const;
+	uint32_t	allocateSlot(const std::string& name, const std::string& canonicalName, const size_t size);
+	void		freeSlot(const uint32_t index);
+
+	bool		isAlive(const uint32_t index, const uint32_t generation) const
+	{
+		return index < m_slots.size() && m_slots[index].generation == generation && m_slots[index].numReferences > 0;
+	}
+
+protected:
+	std::string							m_typeName;
+
+	std::vector<Slot>					m_slots;
+	std::vector<uint32_t>				m_freeSlots;
+
+	// the hash of the canonical name -> the slot
+	std::unordered_multimap<uint64_t, uint32_t>	m_slotsByName;
+};
+
+/**
+ * @brief The resources of a type by name, loaded once and shared: the textures, shaders, meshes and sounds of the
+ * EngineCore.
+ *
+ * The name is looked up (hashed) when the resource is acquired, get() of the handle is an index and a generation
+ * check: the render loop keeps the handles, not the names. The names are canonical (getCanonicalName()), the same
+ * file loaded by another path is the same resource.
+ *
+ * The resources are refcounted: add() and acquire() take a reference, release() drops one, the last one hands the
+ * resource to the release function (glDeleteTextures, delete, ...) and frees its slot.
+ */
+template <typename T>
+class ResourcePool : public ResourcePoolBase
+{
+public:
+	typedef ResourceHandle<T>					Handle;
+	typedef std::function<void(T& resource)>	ReleaseFunction;
+
+	explicit ResourcePool(const std::string& typeName, const ReleaseFunction& releaseFunction = ReleaseFunction())
+		: ResourcePoolBase(typeName)
+		, m_releaseFunction(releaseFunction)
+	{
+	}
+
+	~ResourcePool()
+	{
+		clear();
+	}
+
+	/**
+	 * The resource of the name with one more reference, an invalid handle if there is none: it is to be loaded and
+	 * added.
+	 */
+	Handle acquire(const std::string& name)
+	{
+		const uint32_t index = findSlot(getCanonicalName(name));
+		if (index == INVALID_INDEX)
+		{
+			return Handle();
+		}
+
+		m_slots[index].numReferences++;
+		return Handle(index, m_slots[index].generation);
+	}
+
+	// the resource of the name without a reference
+	Handle find(const std::string& name) const
+	{
+		const uint32_t index = findSlot(getCanonicalName(name));
+		return index == INVALID_INDEX ? Handle() : Handle(index, m_slots[index].generation);
+	}
+
+	/**
+	 * The loaded resource with one reference. The name is to be acquire()d first: a name loaded twice is an error,
+	 * an invalid handle, and the resource stays the caller's.
+	 */
+	Handle add(const std::string& name, const T& resource, const size_t size = 0)
+	{
+		const std::string canonicalName = getCanonicalName(name);
+
+		const uint32_t existingIndex = findSlot(canonicalName);
+		if (existingIndex != INVALID_INDEX)
+		{
+			GX_ASSERT(0 && "Error: the resource is added twice, acquire() it first");
+			return Handle();
+		}
+
+		const uint32_t index = allocateSlot(name, canonicalName, size);
+		if (index == m_resources.size())
+		{
+			m_resources.push_back(resource);
+		}
+		else
+		{
+			m_resources[index] = resource;
+		}
+
+		return Handle(index, m_slots[index].generation);
+	}
+
+	// nullptr if the resource of the handle is released
+	T* get(const Handle& handle)
+	{
+		return isAlive(handle.index, handle.generation) ? &m_resources[handle.index] : nullptr;
+	}
+
+	const T* get(const Handle& handle) const
+	{
+		return isAlive(handle.index, handle.generation) ? &m_resources[handle.index] : nullptr;
+	}
+
+	bool contains(const Handle& handle) const { return isAlive(handle.index, handle.generation); }
+
+	void addReference(const Handle& handle)
+	{
+		if (isAlive(handle.index, handle.generation))
+		{
+			m_slots[handle.index].numReferences++;
+		}
+	}
+
+	// the last reference releases the resource
+	void release(const Handle& handle)
+	{
+		if (isAlive(handle.index, handle.generation) && --m_slots[handle.index].numReferences == 0)
+		{
+			releaseResource(m_resources[handle.index]);
+			m_resources[handle.index] = T();
+			freeSlot(handle.index);
+		}
+	}
+
+	// releases every resource, whatever its references
+	void clear()
+	{
+		for (uint32_t i = 0; i < m_slots.size(); i++)
+		{
+			if (m_slots[i].numReferences > 0)
+			{
+				releaseResource(m_resources[i]);
+				m_resources[i] = T();
+
+				m_slots[i].numReferences = 0;
+				freeSlot(i);
+			}
+		}
+	}
+
+	// a reloaded resource (the textures of another resolution)
+	void setSize(const Handle& handle, const size_t size)
+	{
+		if (isAlive(handle.index, handle.generation))
+		{
+			m_slots[handle.index].size = size;
+		}
+	}
+
+	// the name the resource was added by (the path it was loaded from)
+	const std::string& getName(const Handle& handle) const
+	{
+		static const std::string noName;
+		return isAlive(handle.index, handle.generation) ? m_slots[handle.index].name : noName;
+	}
+
+	// function(handle, resource) for the resources alive
+	template <typename Function>
+	void forEach(Function function)
+	{
+		for (uint32_t i = 0; i < m_slots.size(); i++)
+		{
+			if (m_slots[i].numReferences > 0)
+			{
+				function(Handle(i, m_slots[i].generation), m_resources[i]);
+			}
+		}
+	}
+
+private:
+	void releaseResource(T& resource)
+	{
+		if (m_releaseFunction)
+		{
+			m_releaseFunction(resource);
+		}
+	}
+
+private:
+	std::vector<T>		m_resources;
+	ReleaseFunction		m_releaseFunction;
+};
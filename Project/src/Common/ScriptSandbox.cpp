@@ -0,0 +1,793 @@
+#include "GameStdAfx.h"
+#include "Common/ScriptSandbox.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "GameLogic/EngineCore.h"
+#include "GameLogic/GameObject.h"
+#include "GameLogic/LuaComponentBridge.h"
+
+#include <algorithm>
+#include <chrono>
+#include <boost/bind.hpp>
+
+
+// globals the drone scripts can see (the rest of the state is hidden)
+// (no pcall/xpcall: they would catch the preemption of the instruction budget hook)
+static const char* const s_safeGlobals[] =
+{
+	"assert", "error", "ipairs", "next", "pairs", "select", "tonumber", "tostring", "type", "unpack",
+
+	// drone api
+	"GameObject", "getElapsedTime",
+	"MODULE_BATTERY", "MODULE_MOBYLITY", "MODULE_MEMORY", "MODULE_HDD", "MODULE_WELDER", "MODULE_JACKHAMMER",
+	"MODULE_RADIO_TRANSMITTER", "MODULE_RADIO_RECEIVER", "MODULE_RADAR", "MODULE_LADAR", "MODULE_FUEL_CREATOR",
+	"move", "activateModule", "getContacts", "getComponent", "getComponentColumn",
+	"CONST_INT", "CONST_BOOL", "CONST_FLOAT", "CONST_STR", "CONST_VEC3",
+};
+
+// libraries copied into the environment of every script
+static const char* const s_safeLibraries[] =
+{
+	"coroutine", "math", "string", "table",
+};
+
+// a script can't flood the command buffer in one tick
+static const uint32_t s_maxCommandsPerTick = 64;
+
+// the address is the registry key of the owner shard of a lua state
+static const char s_shardKey = 0;
+
+
+ScriptSandbox::ScriptSandbox(uint32_t numShards, int instructionBudget, float tickTimeBudget, size_t memoryLimit)
+	: m_instructionBudget(instructionBudget)
+	, m_tickTimeBudget(tickTimeBudget)
+	, m_memoryLimit(memoryLimit)
+	, m_isProfiling(false)
+	, m_samplePeriod(1000)
+	, m_nextScriptId(1)
+	, m_pEntities(nullptr)
+	, m_tickTime(0)
+	, m_tick(0)
+	, m_numBusyWorkers(0)
+	, m_isQuitting(false)
+{
+	if (numShards == 0)
+	{
+		numShards = std::max(1u, boost::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 0; i < numShards; ++i)
+	{
+		m_shards.emplace_back(new Shard());
+		openShard(*m_shards.back());
+	}
+
+	for (uint32_t i = 1; i < numShards; ++i)
+	{
+		m_shards[i]->worker = boost::thread(boost::bind(&ScriptSandbox::workerLoop, this, i));
+	}
+
+	TRACE_INFO("Drone scripts run on " << numShards << " lua states.", 0);
+}
+
+ScriptSandbox::~ScriptSandbox()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(m_mutex);
+		m_isQuitting = true;
+	}
+	m_tickStarted.notify_all();
+
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		if (shard->worker.joinable())
+		{
+			shard->worker.join();
+		}
+	}
+
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		closeShard(*shard);
+	}
+}
+
+/**
+ * Creates the lua state of a shard and loads the drone api into it.
+ */
+void ScriptSandbox::openShard(Shard& shard)
+{
+	shard.pSandbox = this;
+	shard.nextScript = 0;
+	shard.pRunningScript = nullptr;
+
+	shard.allocator.reset();
+	shard.state = lua_newstate(&LuaAllocator::allocate, &shard.allocator);
+
+	lua_State* state = shard.state;
+	luaL_openlibs(state);
+	luabind::open(state);
+
+	LuaManager::configureGarbageCollector(state);
+	shard.gcStats = { 0, 0, 0, 0.0f, 0.0f, 0, false };
+
+	lua_pushlightuserdata(state, (void*)&s_shardKey);
+	lua_pushlightuserdata(state, &shard);
+	lua_rawset(state, LUA_REGISTRYINDEX);
+
+	GameObject::registerMethodsToLua(state);
+	ConstantManager::registerMethodsToLua(state);
+	LuaComponentBridge::getInstance()->registerToLua(state, true);
+
+	lua_register(state, "move", &ScriptSandbox::luaMove);
+	lua_register(state, "activateModule", &ScriptSandbox::luaActivateModule);
+	lua_register(state, "getContacts", &ScriptSandbox::luaGetContacts);
+	lua_register(state, "getElapsedTime", &ScriptSandbox::luaGetElapsedTime);
+}
+
+void ScriptSandbox::closeShard(Shard& shard)
+{
+	for (DroneScript& script : shard.scripts)
+	{
+		release(shard, script);
+	}
+	shard.scripts.clear();
+
+	lua_close(shard.state);
+	shard.state = nullptr;
+	shard.allocator.reset();
+}
+
+/**
+ * Removes all the scripts. The lua states of the shards stay open.
+ */
+void ScriptSandbox::clear()
+{
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		for (DroneScript& script : shard->scripts)
+		{
+			release(*shard, script);
+		}
+
+		shard->scripts.clear();
+		shard->nextScript = 0;
+
+		lua_gc(shard->state, LUA_GCCOLLECT, 0);
+	}
+}
+
+/**
+ * Compiles a drone script and schedules it on the shard of its drone. The script starts running in the next
+ * resumeScripts() call. Has to be called between the ticks (not while resumeScripts() runs).
+ *
+ * @param ownerId	The id of the owner (the client connection).
+ * @param droneId	The entity id of the drone the script controls (0: none).
+ * @param source	The lua source of the script.
+ * @param name		The chunk name used in the error messages.
+ * @return			The id of the script, 0 if it could not be compiled.
+ */
+uint32_t ScriptSandbox::addScript(uint32_t ownerId, uint64_t droneId, const std::string& source, const std::string& name)
+{
+	// precompiled chunks are not verified by lua 5.1: only the source is accepted
+	if (!source.empty() && source[0] == LUA_SIGNATURE[0])
+	{
+		TRACE_ERROR("Error: binary chunks are not allowed in drone scripts (" << name << ").", 0);
+		return 0;
+	}
+
+	// the scripts of a drone always run on the same state
+	Shard& shard = *m_shards[(droneId ? droneId : ownerId) % m_shards.size()];
+	lua_State* state = shard.state;
+
+	DroneScript script;
+	script.id = m_nextScriptId++;
+	script.ownerId = ownerId;
+	script.droneId = droneId;
+	script.name = name;
+	script.state = ScriptState::RUNNING;
+	script.numPreemptions = 0;
+	script.numCommands = 0;
+	script.hookCount = 0;
+	script.budgetLeft = 0;
+	script.memoryAccount = shard.allocator.createAccount(m_memoryLimit);
+
+	// the thread, the compiled chunk and the environment already count against the script's memory
+	shard.allocator.setCurrentAccount(script.memoryAccount);
+
+	script.pThread = lua_newthread(state);
+	script.threadRef = luaL_ref(state, LUA_REGISTRYINDEX);
+
+	const int loadResult = luaL_loadbuffer(script.pThread, source.c_str(), source.size(), name.c_str());
+	if (loadResult == 0)
+	{
+		pushEnvironment(script.pThread, script);
+		lua_setfenv(script.pThread, -2);
+	}
+
+	shard.allocator.setCurrentAccount(0);
+
+	if (loadResult != 0)
+	{
+		TRACE_ERROR("Error: cannot compile drone script: " << lua_tostring(script.pThread, -1), 0);
+		release(shard, script);
+		return 0;
+	}
+
+	shard.scripts.push_back(script);
+
+	return script.id;
+}
+
+void ScriptSandbox::removeScript(uint32_t scriptId)
+{
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		for (DroneScript& script : shard->scripts)
+		{
+			if (script.id == scriptId)
+			{
+				script.state = ScriptState::FINISHED;
+			}
+		}
+
+		removeStoppedScripts(*shard);
+	}
+}
+
+void ScriptSandbox::removeScriptsOf(uint32_t ownerId)
+{
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		for (DroneScript& script : shard->scripts)
+		{
+			if (script.ownerId == ownerId)
+			{
+				script.state = ScriptState::FINISHED;
+			}
+		}
+
+		removeStoppedScripts(*shard);
+	}
+}
+
+uint32_t ScriptSandbox::getNumScripts() const
+{
+	uint32_t numScripts = 0;
+	for (const std::unique_ptr<Shard>& shard : m_shards)
+	{
+		numScripts += (uint32_t)shard->scripts.size();
+	}
+
+	return numScripts;
+}
+
+/**
+ * Runs one tick of the drone scripts: the shards resume their scripts in parallel (shard 0 on the calling thread),
+ * then the queued commands are applied to the world.
+ *
+ * @param es The entities of the world. The scripts only read them while the shards run.
+ */
+void ScriptSandbox::resumeScripts(entityx::EntityManager& es)
+{
+	if (getNumScripts() == 0)
+	{
+		return;
+	}
+
+	m_pEntities = &es;
+	m_tickTime = EngineCore::getInstance()->getElapsedTime();
+
+	const uint32_t numWorkers = (uint32_t)m_shards.size() - 1;
+	if (numWorkers > 0)
+	{
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			m_numBusyWorkers = numWorkers;
+			m_tick++;
+		}
+		m_tickStarted.notify_all();
+	}
+
+	runShard(*m_shards[0]);
+
+	if (numWorkers > 0)
+	{
+		boost::unique_lock<boost::mutex> lock(m_mutex);
+		while (m_numBusyWorkers > 0)
+		{
+			m_tickFinished.wait(lock);
+		}
+	}
+
+	m_pEntities = nullptr;
+
+	applyCommands(es);
+
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		removeStoppedScripts(*shard);
+	}
+}
+
+/**
+ * Runs the garbage collectors of the shards, the budget is shared by them. Has to be called between the ticks.
+ *
+ * @param budget The time budget in ms.
+ */
+void ScriptSandbox::stepGarbageCollector(float budget)
+{
+	const float shardBudget = budget / m_shards.size();
+
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		LuaManager::stepGarbageCollector(shard->state, shardBudget, shard->gcStats);
+	}
+}
+
+/**
+ * The gc metrics of the shards summed up (the step times are the maximums).
+ */
+LuaGcStats ScriptSandbox::getGcStats() const
+{
+	LuaGcStats stats = { 0, 0, 0, 0.0f, 0.0f, 0, false };
+
+	for (const std::unique_ptr<Shard>& shard : m_shards)
+	{
+		stats.memory += shard->gcStats.memory;
+		stats.numSteps += shard->gcStats.numSteps;
+		stats.numCycles += shard->gcStats.numCycles;
+		stats.lastStepTime = std::max(stats.lastStepTime, shard->gcStats.lastStepTime);
+		stats.maxStepTime = std::max(stats.maxStepTime, shard->gcStats.maxStepTime);
+		stats.liveMemory += shard->gcStats.liveMemory;
+		stats.isCycleRunning = stats.isCycleRunning || shard->gcStats.isCycleRunning;
+	}
+
+	return stats;
+}
+
+/**
+ * Turns the sampling of the scripts on or off. Has to be called between the ticks.
+ *
+ * @param isProfiling	Starting the profiling drops the samples collected so far.
+ * @param samplePeriod	The number of lua instructions between two samples.
+ */
+void ScriptSandbox::setProfiling(bool isProfiling, int samplePeriod)
+{
+	if (isProfiling && !m_isProfiling)
+	{
+		for (std::unique_ptr<Shard>& shard : m_shards)
+		{
+			shard->profiler.clear();
+		}
+	}
+
+	m_isProfiling = isProfiling;
+	m_samplePeriod = std::max(1, samplePeriod);
+}
+
+/**
+ * Adds the samples of the shards to the given profile. Has to be called between the ticks.
+ */
+void ScriptSandbox::collectProfile(LuaProfiler& profile) const
+{
+	for (const std::unique_ptr<Shard>& shard : m_shards)
+	{
+		profile.merge(shard->profiler);
+	}
+}
+
+/**
+ * The thread of a worker shard: runs the shard once per tick.
+ */
+void ScriptSandbox::workerLoop(uint32_t shardIndex)
+{
+	Shard& shard = *m_shards[shardIndex];
+	uint64_t lastTick = 0;
+
+	TraceRecorder::getInstance()->setThreadName(utils::formatStr("lua shard %u", shardIndex));
+
+	for (;;)
+	{
+		{
+			boost::unique_lock<boost::mutex> lock(m_mutex);
+			while (!m_isQuitting && m_tick == lastTick)
+			{
+				m_tickStarted.wait(lock);
+			}
+
+			if (m_isQuitting)
+			{
+				return;
+			}
+
+			lastTick = m_tick;
+		}
+
+		runShard(shard);
+
+		{
+			boost::lock_guard<boost::mutex> lock(m_mutex);
+			m_numBusyWorkers--;
+		}
+		m_tickFinished.notify_one();
+	}
+}
+
+/**
+ * Resumes the scripts of a shard round-robin until every script ran once or the tick time budget is used up.
+ */
+void ScriptSandbox::runShard(Shard& shard)
+{
+	TRACE_ZONE("ScriptSandbox::runShard");
+
+	typedef std::chrono::steady_clock Clock;
+	const Clock::time_point startTime = Clock::now();
+
+	shard.commands.clear();
+
+	for (size_t i = 0; i < shard.scripts.size(); ++i)
+	{
+		if (shard.nextScript >= shard.scripts.size())
+		{
+			shard.nextScript = 0;
+		}
+
+		DroneScript& script = shard.scripts[shard.nextScript++];
+		if (script.state == ScriptState::RUNNING)
+		{
+			resume(shard, script);
+		}
+
+		const float elapsedMs = std::chrono::duration<float, std::milli>(Clock::now() - startTime).count();
+		if (elapsedMs > m_tickTimeBudget)
+		{
+			break;
+		}
+	}
+}
+
+/**
+ * Merges the command buffers of the shards in script id order (the order of the commands of one script is kept)
+ * and applies them to the drones.
+ */
+void ScriptSandbox::applyCommands(entityx::EntityManager& es)
+{
+	m_mergedCommands.clear();
+	for (std::unique_ptr<Shard>& shard : m_shards)
+	{
+		m_mergedCommands.insert(m_mergedCommands.end(), shard->commands.begin(), shard->commands.end());
+		shard->commands.clear();
+	}
+
+	std::stable_sort(m_mergedCommands.begin(), m_mergedCommands.end(),
+		[](const ScriptCommand& a, const ScriptCommand& b) { return a.scriptId < b.scriptId; });
+
+	for (const ScriptCommand& command : m_mergedCommands)
+	{
+		// the drone could be destroyed since the script ran
+		const entityx::Entity::Id droneId(command.droneId);
+		if (!es.valid(droneId))
+		{
+			continue;
+		}
+
+		GameObject drone(es.get(droneId));
+
+		switch (command.type)
+		{
+			case ScriptCommandType::MOVE:				drone.move(command.vel);								break;
+			case ScriptCommandType::ACTIVATE_MODULE:	drone.activateModule(command.moduleType);				break;
+			default:
+				break;
+		}
+	}
+}
+
+/**
+ * Runs the script until it yields, finishes, fails or uses up its instruction budget.
+ */
+void ScriptSandbox::resume(Shard& shard, DroneScript& script)
+{
+	// drop the values of the last yield, restart the instruction count
+	if (lua_status(script.pThread) == LUA_YIELD)
+	{
+		lua_settop(script.pThread, 0);
+	}
+
+	// while profiling the hook is called more often: it samples, and counts down the budget
+	script.budgetLeft = m_instructionBudget;
+	script.hookCount = m_isProfiling ? std::min(m_samplePeriod, m_instructionBudget) : m_instructionBudget;
+	lua_sethook(script.pThread, &ScriptSandbox::instructionBudgetHook, LUA_MASKCOUNT, script.hookCount);
+
+	if (m_isProfiling)
+	{
+		shard.profiler.beginSlice(script.name);
+	}
+
+	script.numCommands = 0;
+
+	shard.pRunningScript = &script;
+	shard.allocator.setCurrentAccount(script.memoryAccount);
+
+	const int result = lua_resume(script.pThread, 0);
+
+	shard.allocator.setCurrentAccount(0);
+	shard.pRunningScript = nullptr;
+
+	if (result == LUA_YIELD)
+	{
+		return;
+	}
+
+	if (result == 0)
+	{
+		script.state = ScriptState::FINISHED;
+		return;
+	}
+
+	script.state = ScriptState::FAILED;
+
+	const char* errorMessage = lua_tostring(script.pThread, -1);
+	if (result == LUA_ERRMEM)
+	{
+		TRACE_LUA("Drone script " << script.name << " stopped: memory limit (" << m_memoryLimit << " bytes) exceeded.", 0);
+	}
+	else
+	{
+		TRACE_LUA("Drone script " << script.name << " stopped: " << (errorMessage ? errorMessage : "unknown error"), 0);
+	}
+}
+
+void ScriptSandbox::release(Shard& shard, DroneScript& script)
+{
+	// the thread is collected by the next gc cycles, its blocks are not credited to the next owner of the account
+	luaL_unref(shard.state, LUA_REGISTRYINDEX, script.threadRef);
+	shard.allocator.releaseAccount(script.memoryAccount);
+}
+
+void ScriptSandbox::removeStoppedScripts(Shard& shard)
+{
+	size_t writeIndex = 0;
+	size_t nextScript = shard.nextScript;
+
+	for (size_t readIndex = 0; readIndex < shard.scripts.size(); ++readIndex)
+	{
+		if (shard.scripts[readIndex].state == ScriptState::RUNNING)
+		{
+			shard.scripts[writeIndex++] = shard.scripts[readIndex];
+		}
+		else
+		{
+			release(shard, shard.scripts[readIndex]);
+
+			// keep the cursor on the same script
+			if (readIndex < shard.nextScript)
+			{
+				nextScript--;
+			}
+		}
+	}
+
+	shard.scripts.resize(writeIndex);
+	shard.nextScript = nextScript;
+}
+
+/**
+ * Pushes a new environment table for a script: the whitelisted globals, copies of the safe libraries,
+ * yield (coroutine.yield), ownerId and droneId.
+ */
+void ScriptSandbox::pushEnvironment(lua_State* state, const DroneScript& script)
+{
+	lua_newtable(state);
+
+	for (const char* name : s_safeGlobals)
+	{
+		lua_getglobal(state, name);
+		lua_setfield(state, -2, name);
+	}
+
+	// the libraries are copied, so a script can't patch them for the others
+	for (const char* libraryName : s_safeLibraries)
+	{
+		lua_newtable(state);
+		lua_getglobal(state, libraryName);
+
+		if (lua_istable(state, -1))
+		{
+			lua_pushnil(state);
+			while (lua_next(state, -2))
+			{
+				lua_pushvalue(state, -2);
+				lua_insert(state, -2);
+				lua_settable(state, -5);
+			}
+		}
+
+		lua_pop(state, 1);
+		lua_setfield(state, -2, libraryName);
+	}
+
+	// string.dump would give the script bytecode
+	lua_getfield(state, -1, "string");
+	lua_pushnil(state);
+	lua_setfield(state, -2, "dump");
+	lua_pop(state, 1);
+
+	lua_getfield(state, -1, "coroutine");
+	lua_getfield(state, -1, "yield");
+	lua_setfield(state, -3, "yield");
+	lua_pop(state, 1);
+
+	lua_pushnumber(state, script.ownerId);
+	lua_setfield(state, -2, "ownerId");
+
+	lua_pushnumber(state, (lua_Number)script.droneId);
+	lua_setfield(state, -2, "droneId");
+
+	lua_pushvalue(state, -1);
+	lua_setfield(state, -2, "_G");
+}
+
+ScriptSandbox::Shard* ScriptSandbox::getShard(lua_State* state)
+{
+	lua_pushlightuserdata(state, (void*)&s_shardKey);
+	lua_rawget(state, LUA_REGISTRYINDEX);
+
+	Shard* pShard = static_cast<Shard*>(lua_touserdata(state, -1));
+	lua_pop(state, 1);
+
+	return pShard;
+}
+
+ScriptSandbox::DroneScript& ScriptSandbox::getRunningScript(lua_State* state)
+{
+	Shard* pShard = getShard(state);
+	if (!pShard || !pShard->pRunningScript)
+	{
+		luaL_error(state, "the drone api can only be called from a drone script");
+	}
+
+	return *pShard->pRunningScript;
+}
+
+/**
+ * Queues a command of the running script for its drone.
+ */
+void ScriptSandbox::pushCommand(lua_State* state, ScriptCommand& command)
+{
+	DroneScript& script = getRunningScript(state);
+	if (script.droneId == 0)
+	{
+		luaL_error(state, "the script has no drone");
+	}
+
+	if (++script.numCommands > s_maxCommandsPerTick)
+	{
+		luaL_error(state, "too many commands in one tick (max %d)", (int)s_maxCommandsPerTick);
+	}
+
+	command.scriptId = script.id;
+	command.droneId = script.droneId;
+
+	getShard(state)->commands.push_back(command);
+}
+
+// move(x, y): sets the velocity of the drone
+int ScriptSandbox::luaMove(lua_State* state)
+{
+	ScriptCommand command;
+	command.type = ScriptCommandType::MOVE;
+	command.vel = vec2((float)luaL_checknumber(state, 1), (float)luaL_checknumber(state, 2));
+	command.moduleType = 0;
+
+	pushCommand(state, command);
+	return 0;
+}
+
+// activateModule(moduleType)
+int ScriptSandbox::luaActivateModule(lua_State* state)
+{
+	ScriptCommand command;
+	command.type = ScriptCommandType::ACTIVATE_MODULE;
+	command.vel = vec2(0.0f, 0.0f);
+	command.moduleType = luaL_checkint(state, 1);
+
+	pushCommand(state, command);
+	return 0;
+}
+
+// getContacts(moduleType): the contacts of the Radar or Ladar of the drone as an array of {id, x, y, distance} tables
+int ScriptSandbox::luaGetContacts(lua_State* state)
+{
+	const int moduleType = luaL_checkint(state, 1);
+	const DroneScript& script = getRunningScript(state);
+	entityx::EntityManager* pEntities = getShard(state)->pSandbox->m_pEntities;
+
+	lua_newtable(state);
+
+	const entityx::Entity::Id droneId(script.droneId);
+	if (script.droneId == 0 || !pEntities || !pEntities->valid(droneId))
+	{
+		return 1;
+	}
+
+	const GameObject drone(pEntities->get(droneId));
+	const Sensor* sensor = drone.getSensor(moduleType);
+	if (!sensor)
+	{
+		return 1;
+	}
+
+	int i = 1;
+	for (const SensorContact& contact : sensor->contacts)
+	{
+		// destroyed since the sensors ran
+		if (!pEntities->valid(entityx::Entity::Id(contact.id)))
+		{
+			continue;
+		}
+
+		lua_createtable(state, 0, 4);
+
+		lua_pushnumber(state, contact.id);
+		lua_setfield(state, -2, "id");
+		lua_pushnumber(state, contact.pos.x);
+		lua_setfield(state, -2, "x");
+		lua_pushnumber(state, contact.pos.y);
+		lua_setfield(state, -2, "y");
+		lua_pushnumber(state, contact.distance);
+		lua_setfield(state, -2, "distance");
+
+		lua_rawseti(state, -2, i++);
+	}
+
+	return 1;
+}
+
+// getElapsedTime(): the time at the start of the tick (the engine clock is not read from the workers)
+int ScriptSandbox::luaGetElapsedTime(lua_State* state)
+{
+	lua_pushnumber(state, (lua_Number)getShard(state)->pSandbox->m_tickTime);
+	return 1;
+}
+
+/**
+ * Count hook of the script threads: takes a profiler sample when profiling,
+ * and preempts the running script when its instruction budget is used up.
+ * A script that can't be preempted is killed: yielding across a C call (eg. a sort comparator) or from a coroutine
+ * of the script is an error, and once the budget is used up every further count event raises one, so a script
+ * catching the error (coroutine.resume) is stopped at its next instructions.
+ */
+void ScriptSandbox::instructionBudgetHook(lua_State* state, lua_Debug* debugInfo)
+{
+	if (debugInfo->event == LUA_HOOKCOUNT)
+	{
+		Shard* pShard = getShard(state);
+		DroneScript* pScript = pShard ? pShard->pRunningScript : nullptr;
+
+		if (pScript)
+		{
+			if (pShard->pSandbox->m_isProfiling)
+			{
+				pShard->profiler.sample(state);
+			}
+
+			pScript->budgetLeft -= pScript->hookCount;
+			if (pScript->budgetLeft > 0)
+			{
+				return;
+			}
+
+			// the budget ran out before (the yield did not happen), or a coroutine of the script used it up
+			if (pScript->budgetLeft + pScript->hookCount <= 0 || state != pScript->pThread)
+			{
+				luaL_error(state, "instruction budget exceeded (%d per tick)", pShard->pSandbox->m_instructionBudget);
+			}
+
+			pScript->numPreemptions++;
+		}
+
+		lua_yield(state, 0);
+	}
+}
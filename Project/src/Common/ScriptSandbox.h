@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Common/LuaManager.h"
+
+#include <entityx/entityx.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+enum class ScriptState
+{
+	RUNNING = 0,
+	FINISHED,
+	FAILED,
+};
+
+enum class ScriptCommandType
+{
+	MOVE = 0,
+	ACTIVATE_MODULE,
+};
+
+/**
+ * @brief An effect of a drone script on the world, applied on the sim thread after all the scripts ran.
+ */
+struct ScriptCommand
+{
+	uint32_t			scriptId;
+	uint64_t			droneId;
+	ScriptCommandType	type;
+
+	vec2				vel;			// MOVE
+	int					moduleType;		// ACTIVATE_MODULE
+};
+
+/**
+ * @brief Runs the player written drone scripts in budgeted lua coroutines, sharded across worker lua states.
+ *
+ * The scripts are partitioned across independent lua states (shards), one per worker thread. Every shard is loaded
+ * with the drone api (registerMethodsToLua) and runs its scripts in parallel with the others:
+ *	- every script is a coroutine of its shard with its own environment table (a whitelisted copy of the globals)
+ *	- a count hook preempts a script when its instruction budget runs out, the script continues in the next tick
+ *	- a shard stops resuming when its time budget runs out, the next tick continues with the next script in line
+ *	- the allocations of a script are charged to its own LuaMemoryAccount, a script over its limit gets a memory error
+ *
+ * The scripts only read the world (eg. the sensor contacts of their drone). Their effects are queued as ScriptCommands,
+ * the command buffers of the shards are merged in script id order and applied on the sim thread, so the result
+ * does not depend on the scheduling of the workers.
+ */
+class ScriptSandbox : public Singleton<ScriptSandbox>
+{
+public:
+	ScriptSandbox(uint32_t numShards = 0, int instructionBudget = 10000, float tickTimeBudget = 5.0f, size_t memoryLimit = 1024 * 1024);
+	~ScriptSandbox();
+
+	void		clear();
+
+	uint32_t	addScript(uint32_t ownerId, uint64_t droneId, const std::string& source, const std::string& name = "script");
+	void		removeScript(uint32_t scriptId);
+	void		removeScriptsOf(uint32_t ownerId);
+
+	void		resumeScripts(entityx::EntityManager& es);
+
+	void		stepGarbageCollector(float budget);
+	LuaGcStats	getGcStats() const;
+
+	void		setProfiling(bool isProfiling, int samplePeriod);
+	void		collectProfile(LuaProfiler& profile) const;
+
+	// getters-setters
+	uint32_t	getNumScripts() const;
+	uint32_t	getNumShards() const { return (uint32_t)m_shards.size(); }
+
+	void		setInstructionBudget(int instructionBudget) { m_instructionBudget = instructionBudget; }
+	void		setTickTimeBudget(float tickTimeBudget) { m_tickTimeBudget = tickTimeBudget; }
+	void		setMemoryLimit(size_t memoryLimit) { m_memoryLimit = memoryLimit; }
+
+private:
+	struct DroneScript
+	{
+		uint32_t	id;
+		uint32_t	ownerId;
+		uint64_t	droneId;			// 0: the script has no drone
+		std::string	name;
+
+		lua_State*	pThread;
+		int			threadRef;
+		uint32_t	memoryAccount;
+
+		ScriptState	state;
+		uint32_t	numPreemptions;
+		uint32_t	numCommands;		// in the current tick
+
+		int			hookCount;			// instructions between two calls of the count hook
+		int			budgetLeft;			// instructions left in the current tick
+	};
+
+	struct Shard
+	{
+		ScriptSandbox*				pSandbox;
+		lua_State*					state;
+		LuaAllocator				allocator;
+
+		std::vector<DroneScript>	scripts;
+		size_t						nextScript;			// round-robin cursor
+		DroneScript*				pRunningScript;
+
+		std::vector<ScriptCommand>	commands;
+		LuaProfiler					profiler;
+		LuaGcStats					gcStats;
+		boost::thread				worker;				// not started for shard 0: it runs on the sim thread
+	};
+
+	void		openShard(Shard& shard);
+	void		closeShard(Shard& shard);
+
+	void		workerLoop(uint32_t shardIndex);
+	void		runShard(Shard& shard);
+	void		applyCommands(entityx::EntityManager& es);
+
+	void		resume(Shard& shard, DroneScript& script);
+	void		release(Shard& shard, DroneScript& script);
+	void		removeStoppedScripts(Shard& shard);
+
+	void		pushEnvironment(lua_State* state, const DroneScript& script);
+
+	static Shard*	getShard(lua_State* state);
+	static DroneScript& getRunningScript(lua_State* state);
+	static void	pushCommand(lua_State* state, ScriptCommand& command);
+
+	// drone api of the shards
+	static int	luaMove(lua_State* state);
+	static int	luaActivateModule(lua_State* state);
+	static int	luaGetContacts(lua_State* state);
+	static int	luaGetElapsedTime(lua_State* state);
+
+	static void	instructionBudgetHook(lua_State* state, lua_Debug* debugInfo);
+
+private:
+	int							m_instructionBudget;	// per script per tick
+	float						m_tickTimeBudget;		// ms per shard
+	size_t						m_memoryLimit;			// bytes per script
+
+	bool						m_isProfiling;
+	int							m_samplePeriod;			// instructions
+
+	std::vector<std::unique_ptr<Shard>>	m_shards;
+	uint32_t					m_nextScriptId;
+
+	// the world of the current tick, read by the scripts
+	entityx::EntityManager*		m_pEntities;
+	long						m_tickTime;
+
+	std::vector<ScriptCommand>	m_mergedCommands;
+
+	// worker synchronization
+	boost::mutex				m_mutex;
+	boost::condition_variable	m_tickStarted;
+	boost::condition_variable	m_tickFinished;
+	uint64_t					m_tick;
+	uint32_t					m_numBusyWorkers;
+	bool						m_isQuitting;
+};
@@ -0,0 +1,210 @@
+#include "GameStdAfx.h"
+#include "Common/TraceRecorder.h"
+#include "Common/LoggerSystem.h"
+
+#include <algorithm>
+
+
+// events per thread (power of two), the oldest ones are overwritten
+static const size_t s_threadTraceSize = 1 << 16;
+
+// the oldest events of a wrapped ring are not exported, a thread may be overwriting them
+static const uint64_t s_exportMargin = 64;
+
+std::atomic<bool> TraceRecorder::s_isRecording(false);
+
+
+// a json string: the names are written as they are but for the quotes, the backslashes and the control chars
+static void writeJsonString(std::ostream& out, const char* str)
+{
+	out << '"';
+	for (const char* pChar = str; *pChar; ++pChar)
+	{
+		const unsigned char c = (unsigned char)*pChar;
+		if (c == '"' || c == '\\')
+		{
+			out << '\\' << *pChar;
+		}
+		else if (c < 0x20)
+		{
+			static const char* s_hexDigits = "0123456789abcdef";
+			out << "\\u00" << s_hexDigits[c >> 4] << s_hexDigits[c & 0xf];
+		}
+		else
+		{
+			out << *pChar;
+		}
+	}
+	out << '"';
+}
+
+
+TraceRecorder::ThreadTrace::ThreadTrace(uint32_t threadId)
+	: threadId(threadId)
+	, events(s_threadTraceSize)
+	, head(0)
+	, firstEvent(0)
+{
+}
+
+
+TraceRecorder::TraceRecorder()
+	: m_startTicks(Clock::now().time_since_epoch().count())
+{
+}
+
+/**
+ * Starts a new recording, the events of the previous one are dropped.
+ */
+void TraceRecorder::start()
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	// published before the flag: a thread that sees the recording on sees its start
+	m_startTicks.store(Clock::now().time_since_epoch().count(), std::memory_order_release);
+	for (const std::unique_ptr<ThreadTrace>& threadTrace : m_threadTraces)
+	{
+		threadTrace->firstEvent = threadTrace->head.load(std::memory_order_acquire);
+	}
+
+	s_isRecording = true;
+}
+
+void TraceRecorder::stop()
+{
+	s_isRecording = false;
+}
+
+/**
+ * Starts the recording, or stops it and exports the capture.
+ *
+ * @return Whether the recording runs.
+ */
+bool TraceRecorder::toggle(const std::string& fileName)
+{
+	if (!isRecording())
+	{
+		start();
+		TRACE_INFO("Trace recording started.", 0);
+		return true;
+	}
+
+	stop();
+	if (exportChromeTrace(fileName))
+	{
+		TRACE_INFO("Trace written to " << fileName, 0);
+	}
+
+	return false;
+}
+
+/**
+ * Writes the events of the current (or the last) recording as a chrome trace json: complete ("X") events with
+ * microsecond timestamps, and the names of the threads as metadata events.
+ */
+bool TraceRecorder::exportChromeTrace(const std::string& fileName)
+{
+	std::ofstream file(fileName.c_str());
+	if (!file.is_open())
+	{
+		TRACE_ERROR("Error: Cannot write " << fileName, 0);
+		return false;
+	}
+
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	file << "{\"traceEvents\":[\n";
+
+	bool isFirst = true;
+	for (const std::unique_ptr<ThreadTrace>& threadTrace : m_threadTraces)
+	{
+		if (!threadTrace->threadName.empty())
+		{
+			file << (isFirst ? "" : ",\n");
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadTrace->threadId << ",\"args\":{\"name\":";
+			writeJsonString(file, threadTrace->threadName.c_str());
+			file << "}}";
+			isFirst = false;
+		}
+
+		const uint64_t head = threadTrace->head.load(std::memory_order_acquire);
+		const uint64_t size = threadTrace->events.size();
+
+		uint64_t first = threadTrace->firstEvent;
+		if (head - first > size - s_exportMargin)
+		{
+			first = head - (size - s_exportMargin);
+		}
+
+		for (uint64_t i = first; i < head; ++i)
+		{
+			const TraceEvent& event = threadTrace->events[i & (size - 1)];
+
+			file << (isFirst ? "" : ",\n");
+			file << "{\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadTrace->threadId
+				<< ",\"ts\":" << event.startTime / 1000.0 << ",\"dur\":" << event.duration / 1000.0 << "}";
+			isFirst = false;
+		}
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return true;
+}
+
+/**
+ * Adds a finished zone to the ring of the calling thread.
+ */
+void TraceRecorder::record(const char* name, Clock::time_point startTime, Clock::time_point endTime)
+{
+	ThreadTrace& threadTrace = getThreadTrace();
+
+	const uint64_t head = threadTrace.head.load(std::memory_order_relaxed);
+	const Clock::time_point recordingStart(Clock::duration(m_startTicks.load(std::memory_order_acquire)));
+
+	TraceEvent& event = threadTrace.events[head & (threadTrace.events.size() - 1)];
+	event.name = name;
+	event.startTime = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(startTime, recordingStart) - recordingStart).count();
+	event.duration = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - std::max(startTime, recordingStart)).count();
+
+	threadTrace.head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * A zone name that lives as long as the recorder (eg. the name of a called lua function).
+ */
+const char* TraceRecorder::intern(const std::string& name)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_names.insert(name).first->c_str();
+}
+
+/**
+ * Names the calling thread in the exported traces.
+ */
+void TraceRecorder::setThreadName(const std::string& threadName)
+{
+	ThreadTrace& threadTrace = getThreadTrace();
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	threadTrace.threadName = threadName;
+}
+
+TraceRecorder::ThreadTrace& TraceRecorder::getThreadTrace()
+{
+	static thread_local ThreadTrace* s_pThreadTrace = nullptr;
+	static thread_local TraceRecorder* s_pOwner = nullptr;
+
+	if (s_pOwner != this)
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+
+		m_threadTraces.push_back(std::unique_ptr<ThreadTrace>(new ThreadTrace((uint32_t)m_threadTraces.size() + 1)));
+		s_pThreadTrace = m_threadTraces.back().get();
+		s_pOwner = this;
+	}
+
+	return *s_pThreadTrace;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Common/Singleton.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <boost/thread/mutex.hpp>
+
+
+/**
+ * @brief A finished zone: what ran on a thread, when and how long.
+ */
+struct TraceEvent
+{
+	const char*	name;			// a literal or an interned string, never freed while the recorder lives
+	uint64_t	startTime;		// ns since the start of the recording
+	uint64_t	duration;		// ns
+};
+
+/**
+ * @brief Records the scoped trace zones of the threads and exports them in the chrome trace format.
+ *
+ * Every thread writes its zones into its own ring (only the thread writes it, no locking), the rings keep the
+ * last events, so a capture started before a spike shows the spike. A disabled recorder costs one atomic load per
+ * zone: the zone does not read the clock and does not touch the ring.
+ * The exported json opens in chrome://tracing and in the perfetto ui.
+ */
+class TraceRecorder : public Singleton<TraceRecorder>
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	TraceRecorder();
+
+	void	start();
+	void	stop();
+	bool	toggle(const std::string& fileName);
+
+	bool	exportChromeTrace(const std::string& fileName);
+
+	void	record(const char* name, Clock::time_point startTime, Clock::time_point endTime);
+	const char*	intern(const std::string& name);
+
+	void	setThreadName(const std::string& threadName);
+
+	static inline bool isRecording() { return s_isRecording.load(std::memory_order_relaxed); }
+
+private:
+	struct ThreadTrace
+	{
+		ThreadTrace(uint32_t threadId);
+
+		uint32_t				threadId;
+		std::string				threadName;
+
+		std::vector<TraceEvent>	events;			// power of two size
+		std::atomic<uint64_t>	head;			// the number of the events written
+		uint64_t				firstEvent;		// the first event of the current recording
+	};
+
+	ThreadTrace& getThreadTrace();
+
+private:
+	static std::atomic<bool>	s_isRecording;
+
+	std::atomic<Clock::rep>		m_startTicks;		// the start of the recording, read by the recording threads
+
+	std::vector<std::unique_ptr<ThreadTrace>>	m_threadTraces;
+	std::set<std::string>		m_names;
+	boost::mutex				m_mutex;			// adding threads and names, exporting
+};
+
+/**
+ * @brief Records the time from its construction to its destruction as a trace zone.
+ */
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name)
+		: m_name(name)
+	{
+		if (m_name)
+		{
+			m_startTime = TraceRecorder::Clock::now();
+		}
+	}
+
+	~TraceZone()
+	{
+		if (m_name && TraceRecorder::isRecording())
+		{
+			TraceRecorder::getInstance()->record(m_name, m_startTime, TraceRecorder::Clock::now());
+		}
+	}
+
+private:
+	const char*						m_name;			// nullptr: the recorder was off at the start of the zone
+	TraceRecorder::Clock::time_point	m_startTime;
+};
+
+#define TRACE_ZONE_CONCAT_(a, b)	a##b
+#define TRACE_ZONE_CONCAT(a, b)		TRACE_ZONE_CONCAT_(a, b)
+
+// a zone till the end of the scope, the name is a literal or an interned string
+#define TRACE_ZONE(name)			TraceZone TRACE_ZONE_CONCAT(traceZone, __LINE__)(TraceRecorder::isRecording() ? (name) : nullptr)
+
+// a zone till the end of the scope, the name is a std::string (interned only while recording)
+#define TRACE_ZONE_STR(name)		TraceZone TRACE_ZONE_CONCAT(traceZone, __LINE__)(TraceRecorder::isRecording() ? TraceRecorder::getInstance()->intern(name) : nullptr)
@@ -1,12 +1,15 @@
 #include "GameStdAfx.h"
 #include "Common/Utils.h"
+#include "Common/AssetPack.h"
 
 #ifdef CLIENT_SIDE
 #include "Graphics/shaders/Shader.h"
 #include "GameLogic/EngineCore.h"
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <iterator>
 #include <boost/filesystem.hpp>
 
 #ifdef WIN32
@@ -262,7 +265,14 @@ namespace utils
 
 		bool existFile(const std::string& filename)
 		{
-			return boost::filesystem::exists(filename);
+			return (AssetPack::hasInstance() && AssetPack::getInstance()->contains(filename)) || boost::filesystem::exists(filename);
+		}
+
+		time_t getModificationTime(const std::string& filename)
+		{
+			boost::system::error_code error;
+			const time_t time = boost::filesystem::last_write_time(filename, error);
+			return error ? 0 : time;
 		}
 
 		char* readFile(const std::string& filename)
@@ -270,6 +280,19 @@ namespace utils
 			int length;
 			char* buffer;
 
+			// from the mounted asset pack
+			const uint8_t* pPackedData = nullptr;
+			size_t packedSize = 0;
+			std::vector<uint8_t> packedBuffer;
+			if (AssetPack::hasInstance() && AssetPack::getInstance()->read(filename, pPackedData, packedSize, packedBuffer))
+			{
+				buffer = new char[packedSize + 1];
+				memcpy(buffer, pPackedData, packedSize);
+				buffer[packedSize] = '\0';
+
+				return buffer;
+			}
+
 			std::ifstream is;
 			is.open(filename, std::ios::binary);
 
@@ -293,6 +316,37 @@ namespace utils
 
 			return buffer;
 		}
+
+		bool readFile(const std::string& filename, std::string& data)
+		{
+			const uint8_t* pPackedData = nullptr;
+			size_t packedSize = 0;
+			std::vector<uint8_t> packedBuffer;
+			if (AssetPack::hasInstance() && AssetPack::getInstance()->read(filename, pPackedData, packedSize, packedBuffer))
+			{
+				data.assign((const char*)pPackedData, packedSize);
+				return true;
+			}
+
+			std::ifstream is(filename, std::ios::binary);
+			if (!is.is_open())
+			{
+				return false;
+			}
+
+			data.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+			return true;
+		}
+
+		void getLine(std::istream& file, char* buffer, const size_t size)
+		{
+			std::string line;
+			std::getline(file, line);
+
+			const size_t length = std::min(line.size(), size - 1);
+			memcpy(buffer, line.data(), length);
+			buffer[length] = '\0';
+		}
 	}
 
 
@@ -338,6 +392,41 @@ namespace utils
 			delete[] pTexture;
 		}
 
+		size_t getTextureSize(const GLuint textureId)
+		{
+			glBindTexture(GL_TEXTURE_2D, textureId);
+
+			size_t size = 0;
+			for (GLint level = 0; level < 16; level++)
+			{
+				GLint width = 0;
+				GLint height = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+				if (width == 0 || height == 0)
+				{
+					break;
+				}
+
+				GLint isCompressed = GL_FALSE;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &isCompressed);
+				if (isCompressed)
+				{
+					GLint compressedSize = 0;
+					glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+					size += compressedSize;
+				}
+				else
+				{
+					size += (size_t)width * height * 4;
+				}
+			}
+
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			return size;
+		}
+
 
 		// viewmodes
 		/**
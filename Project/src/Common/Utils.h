@@ -51,7 +51,13 @@ namespace utils
 		void skipLine(std::ifstream& file);
 
 		bool existFile(const std::string& filename);
+		// the last write of the file on the disk, 0 if it is not there (the packed files have none)
+		time_t getModificationTime(const std::string& filename);
 		char* readFile(const std::string& filename);
+		// the bytes of the file, from the mounted asset pack if it has it (the loaders parse them from memory)
+		bool readFile(const std::string& filename, std::string& data);
+		// a line of at most size - 1 chars, the rest of a longer one is skipped (fgets of the text loaders)
+		void getLine(std::istream& file, char* buffer, const size_t size);
 
 		int getInt(std::ifstream& file);
 		float getFloat(std::ifstream& file);
@@ -64,6 +70,9 @@ namespace utils
 	{
 		void blankTexture(GLuint* textureId, int size, int channels, int type);
 
+		// the bytes of the levels of the texture (the uncompressed ones as rgba)
+		size_t getTextureSize(const GLuint textureId);
+
 		void orthoMode(int left, int top, int right, int bottom);
 		void perspectiveMode();
 
@@ -39,6 +39,8 @@ public:
 	}
 
 private:
+	friend class LuaComponentBridge;
+
 	vec2 pos;
 	vec2 vel;
 
@@ -59,6 +61,8 @@ public:
 	}
 
 private:
+	friend class LuaComponentBridge;
+
 	uint8_t maxHealth;
 	uint8_t health;
 
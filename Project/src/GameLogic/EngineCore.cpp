@@ -1,8 +1,17 @@
 #include "GameStdAfx.h"
 #include "GameLogic/EngineCore.h"
 #include "Common/LuaManager.h"
+#include "Common/ScriptSandbox.h"
+#include "Common/TraceRecorder.h"
+#include "Common/PerformanceMetrics.h"
+#include "GameLogic/LuaComponentBridge.h"
+#include "GameLogic/Systems/SensorSystem.h"
 
+#ifdef CLIENT_SIDE
+#include "Common/AssetLoader.h"
 #include "Graphics/RenderContext.h"
+#include "Models/md5/ModelMd5.h"
+#endif
 
 /**
  * Animates the game scene.
@@ -11,9 +20,35 @@
  */
 void EngineCore::animate(float dt)
 {
+	TRACE_ZONE("EngineCore::animate");
+
+	// the constants changed since the last tick (reloads on the watcher thread, console commands)
+	ConstantManager::getInstance()->dispatchChanges();
+
 	dt *= CONST_FLOAT("Gameplay::GameSpeedMultiplier");
 
-	LuaManager::getInstance()->callFunction("animateSceneL", dt);
+	// sensor contacts are ready before the scripts run
+	m_world.systems.update<SensorSystem>(dt);
+	LuaComponentBridge::getInstance()->update(m_world.entities);
+
+	{
+		MEASURE_METRIC(Metric::LUA_TIME);
+
+		ScriptSandbox::getInstance()->resumeScripts(m_world.entities);
+
+		LuaManager::getInstance()->callFunction(m_animateSceneFunction, dt);
+	}
+
+#ifdef CLIENT_SIDE
+	// the poses of the models animated by the scripts, together
+	models::ModelMd5::updatePoses();
+
+	// the assets loaded since the last frame, as many as the budget allows
+	if (AssetLoader::hasInstance())
+	{
+		AssetLoader::getInstance()->processUploads(ConstantManager::getInstance()->getFloat(m_uploadBudget));
+	}
+#endif
 
 	// TODO: animate components
 }
@@ -26,6 +61,11 @@ void EngineCore::animate(float dt)
 */
 void EngineCore::render(const int debugLevel)
 {
+	TRACE_ZONE("EngineCore::render");
+
+	// the animation lods of the models rendered in this frame
+	models::ModelMd5::beginRenderFrame();
+
 	if(m_pRenderContext->getEnableBit("wireframe"))
 	{
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
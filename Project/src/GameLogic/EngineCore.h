@@ -1,16 +1,27 @@
 #pragma once
 
 #include "Common/ClientConfigs.h"
+#include "Common/LuaManager.h"
+#include "Common/ResourcePool.h"
+
+#include <entityx/entityx.h>
+#include <chrono>
+#include <functional>
 
 #ifdef CLIENT_SIDE
 #define	NUM_FBOS 4
 
 class Camera;
 
+class SoundSource;
+
 namespace graphics
 {
 	class RenderContext;
 }
+
+typedef ResourcePool<graphics::ShaderPtr>::Handle		ShaderHandle;
+typedef ResourcePool<models::Mesh*>::Handle				MeshHandle;
 #endif
 
 class EngineCore : public Singleton<EngineCore>
@@ -34,6 +45,8 @@ public:
 	const ClientConfigs& getConfigs() const;
 	long getElapsedTime() const;
 
+	entityx::EntityX& getWorld() { return m_world; }
+
 #ifdef CLIENT_SIDE
 	void onScreenResize(const int width, const int height);
 	void reloadTextures(const float textureResolutionDiv, const bool levelTextures);
@@ -41,22 +54,36 @@ public:
 	Camera* getCamera() const;
 	graphics::RenderContext* getRenderContext();
 
-	models::Mesh* getMesh(const std::string& name) const { return m_meshDirectory.at(name); }
-	MeshDirectory& getMeshDirectory() { return m_meshDirectory; }
-	graphics::ShadedMeshPtr getShadedMesh(const std::string& name) const { return m_shadedMeshDirectory.at(name); };
-	ShadedMeshDirectory& getShadedMeshDirectory() { return m_shadedMeshDirectory; };
+	// resources: the names are looked up when they are loaded, the handles every frame
+	// the model of the name by its extension (md5mesh, md2, 3ds), its textures in the pool: an md5 one is empty until loaded
+	MeshHandle acquireModel(const std::string& name, const std::string& meshFile, const std::string& animFile = "");
+
+	models::Mesh* getMesh(const std::string& name) const;
 
-	graphics::ShaderPtr getShader(const std::string& name) const { return m_shaderDirectory.at(name); };
+	graphics::ShaderPtr getShader(const std::string& name) const;
+	graphics::Shader* getShader(const ShaderHandle& handle) const;
+	// the shader of the shadow maps and of the meshes without roles
+	graphics::Shader* getSimplestShader() const { return getShader(m_simplestShader); }
+	// the shader of the meshes skinned on the gpu (Mesh::isGpuSkinnable())
+	graphics::Shader* getSkinningShader() const { return getShader(m_skinningShader); }
+
+	// the resources, their references and their bytes by type
+	std::vector<ResourcePoolBase::MemoryReport> getMemoryReports() const;
+	void logMemoryReports() const;
 
 private:
 	// setup
 	bool setupShaders();
+	ShaderHandle addShader(const std::string& name, graphics::Shader* pShader);
+
+	void reloadFilteredTextures(const float textureResolutionDiv, const std::function<bool(const std::string& fileName)>& filter);
 	void setupFBOs();
 	void setupPostProcessing();
 
 	// render
 	void renderScene(const GLuint fboTarget = 0, int debugLevel = 0);
 	void renderFPS();
+	void renderStatsGraph();
 	//void renderMotionBlur(GLuint textureID);
 
 	// post processing
@@ -70,14 +97,22 @@ private:
 
 private:
 	ClientConfigs				m_configs;
+
+	// entities, components and systems of the game
+	entityx::EntityX			m_world;
 	
 	// lua scripts
 	std::vector<std::string>	m_luaDefinitonScripts;
 	std::vector<std::string>	m_luaInitializerScripts;
+	LuaFunctionHandle			m_animateSceneFunction;
 
 #ifdef CLIENT_SIDE
 	float						m_fps;
 	uint32_t					m_frame, m_elapsedTime, m_timeBase;
+	std::chrono::steady_clock::time_point	m_lastFrameTime;
+
+	// the ms of the asset uploads per frame
+	ConstantHandle				m_uploadBudget;
 
 	Camera*						m_pCamera;
 	graphics::RenderContext*	m_pRenderContext;
@@ -94,11 +129,20 @@ private:
 	GLuint						m_fboColorTextures[NUM_FBOS];
 	GLuint						m_fboDepthTextures[NUM_FBOS];
 
-
-	TextureDirectory			m_textureDirectory;
-	ShaderDirectory				m_shaderDirectory;
-	MeshDirectory				m_meshDirectory;
-	ShadedMeshDirectory			m_shadedMeshDirectory;
-	SoundDirectory				m_soundDirectory;
+	// resources
+	TexturePool								m_textures;
+	ResourcePool<graphics::ShaderPtr>		m_shaders;
+	ResourcePool<models::Mesh*>				m_meshes;
+	ResourcePool<std::shared_ptr<SoundSource>>	m_sounds;
+
+	// the shaders of the render loop
+	ShaderHandle				m_simplestShader;
+	ShaderHandle				m_skinningShader;
+	ShaderHandle				m_grayScaleShader;
+	ShaderHandle				m_bloomPreShader;
+	ShaderHandle				m_bloomPostShader;
+	ShaderHandle				m_blurShaderX;
+	ShaderHandle				m_blurShaderY;
+	ShaderHandle				m_depthOfFieldShader;
 #endif
 };
@@ -1,15 +1,22 @@
 #include "GameStdAfx.h"
 #include "GameLogic/EngineCore.h"
+#include "Common/JobPool.h"
 #include "Common/LuaManager.h"
+#include "Common/ScriptSandbox.h"
 #include "Common/LoggerSystem.h"
+#include "GameLogic/GameObject.h"
+#include "GameLogic/LuaComponentBridge.h"
+#include "GameLogic/Systems/SensorSystem.h"
 
 #ifdef CLIENT_SIDE
+#include "Common/AssetLoader.h"
 #include "Models/3ds/Model3ds.h"
+#include "Models/md2/ModelMd2.h"
 #include "Models/md5/ModelMd5.h"
 
 #include "Graphics/Camera.h"
-#include "Graphics/ShadedMesh.h"
 #include "Graphics/RenderContext.h"
+#include "Graphics/TextureCache.h"
 #include "Sound/SoundSource.h"
 #endif
 
@@ -24,6 +31,21 @@ EngineCore::EngineCore()
 
 	, m_fps(0)
 	, m_frame(0)
+	, m_lastFrameTime(std::chrono::steady_clock::now())
+
+	, m_uploadBudget(ConstantManager::UNKNOWN_HANDLE)
+
+	, m_textures("textures", [](GLuint& texId)
+		{
+			if (graphics::TextureCache::hasInstance())
+			{
+				graphics::TextureCache::getInstance()->erase(texId);
+			}
+			glDeleteTextures(1, &texId);
+		})
+	, m_shaders("shaders")
+	, m_meshes("meshes", [](models::Mesh*& pMesh) { SAFEDEL(pMesh); })
+	, m_sounds("sounds", [](SoundSourcePtr& pSound) { pSound->release(); })
 #endif
 {
 #ifdef CLIENT_SIDE
@@ -38,29 +60,51 @@ EngineCore::~EngineCore()
 
 void EngineCore::release()
 {
-	if(LuaManager::hasInstance())
+#ifdef CLIENT_SIDE
+	// drops the loads left: their uploads refer to the directories
+	if(AssetLoader::hasInstance())
 	{
-		LuaManager::getInstance()->close();
+		AssetLoader::destroyInstance();
 	}
 
-#ifdef CLIENT_SIDE
-	SAFEDEL(m_pCamera);
-	SAFEDEL(m_pRenderContext);
+	if(graphics::TextureCache::hasInstance())
+	{
+		graphics::TextureCache::destroyInstance();
+	}
+#endif
 
-	for (auto& entry : m_meshDirectory)
+	// stops the script workers
+	if(ScriptSandbox::hasInstance())
 	{
-		SAFEDEL(entry.second);
+		ScriptSandbox::destroyInstance();
 	}
 
-	for (auto& entry : m_textureDirectory)
+	if(LuaComponentBridge::hasInstance())
 	{
-		glDeleteTextures(1, &entry.second);
+		LuaComponentBridge::destroyInstance();
 	}
 
-	if(m_soundDirectory.count("backgroundNoise") > 0)
+	// stops the job workers
+	if(JobPool::hasInstance())
 	{
-		m_soundDirectory["backgroundNoise"]->release();
+		JobPool::destroyInstance();
 	}
+
+	if(LuaManager::hasInstance())
+	{
+		LuaManager::getInstance()->close();
+	}
+
+#ifdef CLIENT_SIDE
+	SAFEDEL(m_pCamera);
+	SAFEDEL(m_pRenderContext);
+
+	// the meshes hold references of their textures
+	m_meshes.clear();
+	m_textures.clear();
+	m_shaders.clear();
+
+	m_sounds.clear();
 	SoundSource::audioExit();
 #endif
 }
@@ -71,11 +115,20 @@ void EngineCore::release()
 bool EngineCore::initLogic()
 {
 	new LuaManager();
+	m_animateSceneFunction = LuaManager::getInstance()->getFunctionHandle("animateSceneL");
+
+	new LuaComponentBridge();
+	new ScriptSandbox();
+	new JobPool();
 
 	m_configs = m_configs;
 
 	TRACE_INFO("Initializing logic.", 0);
 
+	m_world.systems.add<SensorSystem>();
+	m_world.systems.configure();
+
+	resetLuaScripts();
 	reloadLuaScripts();
 
 	TRACE_INFO("World initialized.", 0);
@@ -96,15 +149,18 @@ bool EngineCore::initAudioVisuals(const ClientConfigs& confings)
 	// initialize devIL
 	devilInit(true);
 
+	// the assets asked for from now on load in the background (the init scripts' ones too)
+	new AssetLoader();
+	m_uploadBudget = CONST_HANDLE("Loading::UploadBudget");
+
 	// sounds
 	SoundSource::audioInit();
-	SoundSourcePtr backgroundNoise = SoundSourcePtr(new SoundSource(CONST_STR("dataDir") + "/Desert.wav"));
+	SoundSourcePtr backgroundNoise = SoundSourcePtr(new SoundSource());
 
 	backgroundNoise->set(vec3(0, -20, 0), vec3(0.0f), true);
-	backgroundNoise->update();
-	backgroundNoise->play();
+	SoundSource::loadAsync(backgroundNoise, CONST_STR("dataDir") + "/Desert.wav", true);
 
-	m_soundDirectory["backgroundNoise"] = backgroundNoise;
+	m_sounds.add("backgroundNoise", backgroundNoise);
 
 	SoundSource::setListener(vec3(0.0f), vec3(0.0f), vec3(0, 0, -1), vec3(0, 1, 0));
 
@@ -117,6 +173,9 @@ bool EngineCore::initAudioVisuals(const ClientConfigs& confings)
 		exit(EXIT_FAILURE);
 	}
 
+	// the baked textures of the images (needs the extensions of glew)
+	new graphics::TextureCache();
+
 	if (!setupShaders())
 	{
 		return false;
@@ -132,6 +191,100 @@ bool EngineCore::initAudioVisuals(const ClientConfigs& confings)
 
 	return true;
 }
+
+/**
+ * The model of the name with one more reference, loaded the first time. An md5 model is loaded in the background
+ * (ModelMd5::loadAsync()): the meshes of the name are empty until it is uploaded. The md2 and 3ds models are read
+ * right away, their textures are acquired from the texture pool (reloadTextures() covers them). Invalid if the model
+ * can't be loaded.
+ */
+MeshHandle EngineCore::acquireModel(const std::string& name, const std::string& meshFile, const std::string& animFile)
+{
+	MeshHandle handle = m_meshes.acquire(name);
+	if (handle.isValid())
+	{
+		return handle;
+	}
+
+	models::Mesh* pModel = nullptr;
+
+	std::string extension = utils::file::getExtension(meshFile);
+	utils::toLowerCase(extension);
+
+	if (extension == "md5mesh")
+	{
+		pModel = models::ModelMd5::loadAsync(meshFile, animFile);
+	}
+	else if (extension == "md2")
+	{
+		models::ModelMd2* pModelMd2 = new models::ModelMd2();
+		if (pModelMd2->load(meshFile.c_str(), m_textures))
+		{
+			pModel = pModelMd2;
+		}
+		else
+		{
+			delete pModelMd2;
+		}
+	}
+	else if (extension == "3ds")
+	{
+		models::Model3ds* pModel3ds = new models::Model3ds();
+		if (pModel3ds->loadFile(meshFile.c_str(), m_textures))
+		{
+			pModel = pModel3ds;
+		}
+		else
+		{
+			delete pModel3ds;
+		}
+	}
+
+	if (!pModel)
+	{
+		TRACE_ERROR("Error: Cannot load the model " << meshFile << ".", 0);
+		return MeshHandle();
+	}
+
+	return m_meshes.add(name, pModel);
+}
+
+models::Mesh* EngineCore::getMesh(const std::string& name) const
+{
+	models::Mesh* const* ppMesh = m_meshes.get(m_meshes.find(name));
+	return ppMesh ? *ppMesh : nullptr;
+}
+
+graphics::ShaderPtr EngineCore::getShader(const std::string& name) const
+{
+	const graphics::ShaderPtr* pShader = m_shaders.get(m_shaders.find(name));
+	return pShader ? *pShader : graphics::ShaderPtr();
+}
+
+graphics::Shader* EngineCore::getShader(const ShaderHandle& handle) const
+{
+	const graphics::ShaderPtr* pShader = m_shaders.get(handle);
+	return pShader ? pShader->get() : nullptr;
+}
+
+std::vector<ResourcePoolBase::MemoryReport> EngineCore::getMemoryReports() const
+{
+	return {
+		m_textures.getMemoryReport(),
+		m_shaders.getMemoryReport(),
+		m_meshes.getMemoryReport(),
+		m_sounds.getMemoryReport()
+	};
+}
+
+void EngineCore::logMemoryReports() const
+{
+	for (const ResourcePoolBase::MemoryReport& report : getMemoryReports())
+	{
+		TRACE_INFO("Resources: " << report.typeName << ": " << report.numResources << " (" << report.numReferences << " references), "
+			<< report.size / 1024 << " KB", 0);
+	}
+}
 #endif
 
 void exitGame(int status)
@@ -150,14 +303,9 @@ models::Mesh* getMeshFunc(const std::string& name)
 	return EngineCore::getInstance()->getMesh(name);
 }
 
-graphics::ShadedMeshPtr getShadedMeshFunc(const std::string& name)
-{
-	return EngineCore::getInstance()->getShadedMesh(name);
-}
-
-MeshDirectory& getMeshDirectoryFunc()
+bool loadModelFunc(const std::string& name, const std::string& meshFile, const std::string& animFile)
 {
-	return EngineCore::getInstance()->getMeshDirectory();
+	return EngineCore::getInstance()->acquireModel(name, meshFile, animFile).isValid();
 }
 #endif
 
@@ -165,6 +313,9 @@ void EngineCore::resetLuaScripts()
 {
 	using namespace luabind;
 
+	// the running drone scripts die with the old scripts
+	ScriptSandbox::getInstance()->clear();
+
 	LuaManager::getInstance()->init();
 
 	lua_State* luaManagerState = LuaManager::getInstance()->getState();
@@ -178,7 +329,10 @@ void EngineCore::resetLuaScripts()
 #ifdef CLIENT_SIDE
 	// Mesh
 	module(luaManagerState) [
-	    class_<models::Mesh>("Mesh")
+	    class_<models::Mesh>("Mesh"),
+
+	    def("getMesh", &getMeshFunc),
+	    def("loadModel", &loadModelFunc)
 	];
 
 	models::Model3ds::registerMethodsToLua();
@@ -192,7 +346,9 @@ void EngineCore::resetLuaScripts()
 	];
 #endif
 
-	ConstantManager::registerMethodsToLua();
+	GameObject::registerMethodsToLua(luaManagerState);
+	ConstantManager::registerMethodsToLua(luaManagerState);
+	LuaComponentBridge::getInstance()->registerToLua(luaManagerState, false);
 }
 
 void EngineCore::reloadLuaScripts()
@@ -5,29 +5,44 @@
 
 #include <imageLoad.h>
 #include "Common/LoggerSystem.h"
+#include "Common/PerformanceMetrics.h"
 #include "Graphics/Camera.h"
 #include "Graphics/RenderContext.h"
 #include "Graphics/ShadedMesh.h"
+#include "Graphics/TextureCache.h"
+#include "Models/md5/ModelMd5.h"
 
 
 bool EngineCore::setupShaders()
 {
-	m_shaderDirectory["simplest"] = graphics::ShaderPtr(new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/simplest"));
-	m_shaderDirectory["storeDepth"] = graphics::ShaderPtr(new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/storeDepth"));
+	m_simplestShader = addShader("simplest", new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/simplest"));
+	addShader("storeDepth", new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/storeDepth"));
 
-	m_shaderDirectory["cubeMappingShader"] = graphics::ShaderPtr(new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/skybox"));
+	graphics::Shader* pCubeMappingShader = getShader(addShader("cubeMappingShader", new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/skybox")));
 
-	m_shaderDirectory["cubeMappingShader"]->setupUniforms({ "tex", "environmentMap" });
-	m_shaderDirectory["cubeMappingShader"]->setUniform1i("tex", 0);
-	m_shaderDirectory["cubeMappingShader"]->setUniform1i("environmentMap", 1);
+	pCubeMappingShader->setupUniforms({ "tex", "environmentMap" });
+	pCubeMappingShader->setUniform1i("tex", 0);
+	pCubeMappingShader->setUniform1i("environmentMap", 1);
 
-	m_shaderDirectory["newone"] = graphics::ShaderPtr(new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/newone"));
+	addShader("newone", new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/newone"));
+
+	// the animated models (ModelMd5) are skinned on the gpu with this one, its joint palette sized to theirs
+	m_skinningShader = addShader("skinning", new graphics::Shader(CONST_STR("resourcesDir") + "/shaders/skinning", 330,
+		"#define MAX_BONE_COUNT " + std::to_string(models::ModelMd5::MAX_GPU_JOINTS)));
 
 	setupPostProcessing();
 
 	return true;
 }
 
+/**
+ * The shader by its name: the render loop keeps the handle.
+ */
+ShaderHandle EngineCore::addShader(const std::string& name, graphics::Shader* pShader)
+{
+	return m_shaders.add(name, graphics::ShaderPtr(pShader));
+}
+
 void EngineCore::onScreenResize(const int width, const int height)
 {
 	m_configs.width = width;
@@ -135,19 +150,19 @@ void EngineCore::setupPostProcessing()
 	const std::string postProcVertexShader = postProcShaderPath + "PostProcShaderVS.vert";
 
 	// load shaders
-	m_shaderDirectory["blurShaderX"] = graphics::ShaderPtr(new graphics::Shader(postProcVertexShader, postProcShaderPath + "BlurXShaderFS.frag"));
-	m_shaderDirectory["blurShaderY"] = graphics::ShaderPtr(new graphics::Shader(postProcVertexShader, postProcShaderPath + "BlurYShaderFS.frag"));
+	m_blurShaderX = addShader("blurShaderX", new graphics::Shader(postProcVertexShader, postProcShaderPath + "BlurXShaderFS.frag"));
+	m_blurShaderY = addShader("blurShaderY", new graphics::Shader(postProcVertexShader, postProcShaderPath + "BlurYShaderFS.frag"));
 
-	m_shaderDirectory["grayScaleShader"] = graphics::ShaderPtr(new graphics::Shader(postProcVertexShader, postProcShaderPath + "GrayScaleShaderFS.frag"));
+	m_grayScaleShader = addShader("grayScaleShader", new graphics::Shader(postProcVertexShader, postProcShaderPath + "GrayScaleShaderFS.frag"));
 
-	m_shaderDirectory["bloomPreShader"] = graphics::ShaderPtr(new graphics::Shader(postProcVertexShader, postProcShaderPath + "Bloom/BloomPreShaderFS.frag"));
-	m_shaderDirectory["bloomPreShader"]->setupUniforms({ "u_limit" });
+	m_bloomPreShader = addShader("bloomPreShader", new graphics::Shader(postProcVertexShader, postProcShaderPath + "Bloom/BloomPreShaderFS.frag"));
+	getShader(m_bloomPreShader)->setupUniforms({ "u_limit" });
 
-	m_shaderDirectory["bloomPostShader"] = graphics::ShaderPtr(new graphics::Shader(postProcVertexShader, postProcShaderPath + "Bloom/BloomPostShaderFS.frag"));
-	m_shaderDirectory["bloomPostShader"]->setupUniforms({ "s_blurBuffer" });
+	m_bloomPostShader = addShader("bloomPostShader", new graphics::Shader(postProcVertexShader, postProcShaderPath + "Bloom/BloomPostShaderFS.frag"));
+	getShader(m_bloomPostShader)->setupUniforms({ "s_blurBuffer" });
 
-	m_shaderDirectory["depthOfFieldShader"] = graphics::ShaderPtr(new graphics::Shader(postProcVertexShader, postProcShaderPath + "DepthOfFieldShaderFS.frag"));
-	m_shaderDirectory["depthOfFieldShader"]->setupUniforms({ "u_clarity", "u_near", "u_far", "u_fadeDistance", "s_blurBuffer", "s_depthBuffer" });
+	m_depthOfFieldShader = addShader("depthOfFieldShader", new graphics::Shader(postProcVertexShader, postProcShaderPath + "DepthOfFieldShaderFS.frag"));
+	getShader(m_depthOfFieldShader)->setupUniforms({ "u_clarity", "u_near", "u_far", "u_fadeDistance", "s_blurBuffer", "s_depthBuffer" });
 
 	CheckGLError();
 
@@ -169,6 +184,7 @@ void EngineCore::setupPostProcessing()
 
 /**
 * Reloads the map or model textures with new size. The new size is <imageSize> x <textureResolutionDiv>.
+* The cached textures only change their top mip (TextureCache), the others are decoded again.
 *
 * @param textureResolutionDiv	The texture division factor.
 * @param levelTextures			Reload the level or the model textures.
@@ -184,14 +200,7 @@ void EngineCore::reloadTextures(const float textureResolutionDiv, const bool lev
 
 		m_currentMapTextureResolutionDiv = textureResolutionDiv;
 
-		for(auto entry : m_textureDirectory)
-		{
-			if(entry.first.find("/bsp/") != std::string::npos)
-			{
-				glDeleteTextures(1, &entry.second);
-				loadTexture(entry.first, entry.second, m_textureDirectory, true, textureResolutionDiv);
-			}
-		}
+		reloadFilteredTextures(textureResolutionDiv, [](const std::string& fileName) { return fileName.find("/bsp/") != std::string::npos; });
 	}
 	else
 	{
@@ -202,19 +211,35 @@ void EngineCore::reloadTextures(const float textureResolutionDiv, const bool lev
 
 		m_currentTextureResolutionDiv = textureResolutionDiv;
 
-		for(auto entry : m_textureDirectory)
-		{
-			if(entry.first.find("/bsp/") == std::string::npos)
-			{
-				glDeleteTextures(1, &entry.second);
-				loadTexture(entry.first, entry.second, m_textureDirectory, true, textureResolutionDiv);
-			}
-		}
+		reloadFilteredTextures(textureResolutionDiv, [](const std::string& fileName) { return fileName.find("/bsp/") == std::string::npos; });
 	}
 
 	TRACE_INFO("Textures reloaded.", 0);
 }
 
+/**
+ * Reloads the textures of the filter in place: their handles stay valid.
+ */
+void EngineCore::reloadFilteredTextures(const float textureResolutionDiv, const std::function<bool(const std::string& fileName)>& filter)
+{
+	m_textures.forEach([&](const TextureHandle& handle, GLuint& texId)
+	{
+		const std::string& fileName = m_textures.getName(handle);
+		if(!filter(fileName))
+		{
+			return;
+		}
+
+		if(!graphics::TextureCache::getInstance()->setResolution(fileName, textureResolutionDiv))
+		{
+			glDeleteTextures(1, &texId);
+			loadTexture(fileName, texId, true, (int)textureResolutionDiv);
+		}
+
+		m_textures.setSize(handle, utils::gfx::getTextureSize(texId));
+	});
+}
+
 /**
  * Renders with gray scale effect.
  *
@@ -226,7 +251,7 @@ void EngineCore::renderGrayScale(const GLuint fboTarget, const int debugLevel)
 	renderScene(m_fbos[3], debugLevel);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, fboTarget);
-	renderQuad(m_shaderDirectory["grayScaleShader"]->getProgram(), 3);
+	renderQuad(getShader(m_grayScaleShader)->getProgram(), 3);
 }
 
 /**
@@ -243,18 +268,20 @@ void EngineCore::renderBloom(const GLuint fboTarget, const int debugLevel)
 
 	// bloom pre
 	glBindFramebuffer(GL_FRAMEBUFFER, m_fbos[2]);
-	const GLuint bloomPreShaderProgram = m_shaderDirectory["bloomPreShader"]->getProgram();
-	const GLuint bloomPostShaderProgram = m_shaderDirectory["bloomPostShader"]->getProgram();
+	graphics::Shader* pBloomPreShader = getShader(m_bloomPreShader);
+	graphics::Shader* pBloomPostShader = getShader(m_bloomPostShader);
+	const GLuint bloomPreShaderProgram = pBloomPreShader->getProgram();
+	const GLuint bloomPostShaderProgram = pBloomPostShader->getProgram();
 
-	const GLuint blurShaderXProgram = m_shaderDirectory["blurShaderX"]->getProgram();
-	const GLuint blurShaderYProgram = m_shaderDirectory["blurShaderY"]->getProgram();
+	const GLuint blurShaderXProgram = getShader(m_blurShaderX)->getProgram();
+	const GLuint blurShaderYProgram = getShader(m_blurShaderY)->getProgram();
 
 	glUseProgram(bloomPreShaderProgram);
 
 	const float bloomLimit = m_pRenderContext->getContextFloatParam("bloomLimit");
 
 	// limit
-	m_shaderDirectory["bloomPreShader"]->setUniform1f("u_limit", bloomLimit);
+	pBloomPreShader->setUniform1f("u_limit", bloomLimit);
 
 	renderQuad(bloomPreShaderProgram, 0);
 
@@ -276,7 +303,7 @@ void EngineCore::renderBloom(const GLuint fboTarget, const int debugLevel)
 	glUseProgram(bloomPostShaderProgram);
 
 	// bind color buffer from fbo
-	m_shaderDirectory["bloomPostShader"]->setUniform1i("s_blurBuffer", 7);
+	pBloomPostShader->setUniform1i("s_blurBuffer", 7);
 
 	glActiveTexture(GL_TEXTURE7);
 	glBindTexture(GL_TEXTURE_2D, m_fboColorTextures[2]);
@@ -294,8 +321,8 @@ void EngineCore::renderDOF(const GLuint fboTarget, const int debugLevel)
 {
 	renderBloom(m_fbos[3]);
 
-	const GLuint blurShaderXProgram = m_shaderDirectory["blurShaderX"]->getProgram();
-	const GLuint blurShaderYProgram = m_shaderDirectory["blurShaderY"]->getProgram();
+	const GLuint blurShaderXProgram = getShader(m_blurShaderX)->getProgram();
+	const GLuint blurShaderYProgram = getShader(m_blurShaderY)->getProgram();
 
 	// blur steps
 	static const uint blurSteps = 5;
@@ -324,32 +351,32 @@ void EngineCore::renderDOF(const GLuint fboTarget, const int debugLevel)
 
 
 	// dof
-	const graphics::ShaderPtr depthOfFieldShader = m_shaderDirectory["depthOfFieldShader"];
+	graphics::Shader* pDepthOfFieldShader = getShader(m_depthOfFieldShader);
 
 	const float dofFadeDist	= m_pRenderContext->getContextFloatParam("dofFadeDist");
 	const float dofSaturation = m_pRenderContext->getContextFloatParam("dofSaturation");
 
-	glUseProgram(depthOfFieldShader->getProgram());
+	glUseProgram(pDepthOfFieldShader->getProgram());
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	// clarity		u_near + saturation * (u_far - u_near)
 	const float clarity = 1.0f + dofSaturation * (1000.0f - 1.0f);
 
-	depthOfFieldShader->setUniform1f("u_clarity", clarity);
-	depthOfFieldShader->setUniform1f("u_near", 1.0f);
-	depthOfFieldShader->setUniform1f("u_far", 1000.0f);
-	depthOfFieldShader->setUniform1f("u_fadeDistance", dofFadeDist);
-	depthOfFieldShader->setUniform1i("s_blurBuffer", 7);
+	pDepthOfFieldShader->setUniform1f("u_clarity", clarity);
+	pDepthOfFieldShader->setUniform1f("u_near", 1.0f);
+	pDepthOfFieldShader->setUniform1f("u_far", 1000.0f);
+	pDepthOfFieldShader->setUniform1f("u_fadeDistance", dofFadeDist);
+	pDepthOfFieldShader->setUniform1i("s_blurBuffer", 7);
 
 	glActiveTexture(GL_TEXTURE7);
 	glBindTexture(GL_TEXTURE_2D, m_fboColorTextures[2]);
 
-	depthOfFieldShader->setUniform1i("s_depthBuffer", 6);
+	pDepthOfFieldShader->setUniform1i("s_depthBuffer", 6);
 
 	glActiveTexture(GL_TEXTURE6);
 	glBindTexture(GL_TEXTURE_2D, m_fboDepthTextures[0]);
 
-	renderQuad(depthOfFieldShader->getProgram(), 3);
+	renderQuad(pDepthOfFieldShader->getProgram(), 3);
 }
 
 /**
@@ -436,6 +463,11 @@ void EngineCore::renderScene(const GLuint fboTarget, const int debugLevel)
  */
 void EngineCore::renderFPS()
 {
+	// the time between two frames, the whole frame with the swap
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	PerformanceMetrics::getInstance()->record(Metric::FRAME_TIME, (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastFrameTime).count());
+	m_lastFrameTime = now;
+
 	m_frame++;
 	m_elapsedTime = getElapsedTime();
 	if (m_elapsedTime - m_timeBase > 1000)
@@ -466,11 +498,71 @@ void EngineCore::renderFPS()
 	//utils::gfx::printGL(ss.str(), vec3(1, 2, 0));
 
 	////utils::gfx::printGL(";", textPos);
+
+	if (m_pRenderContext->getEnableBit("statsGraph"))
+	{
+		renderStatsGraph();
+	}
+
 	utils::gfx::flushScreenTextBuffer();
 
 	utils::gfx::drawCrosshair();
 }
 
+/**
+ * Renders the frame times of the last frames as a graph with the 16.6 and 33.3 ms lines, and the percentiles.
+ */
+void EngineCore::renderStatsGraph()
+{
+	const float graphLeft = 10.0f;
+	const float graphBottom = glutGet(GLUT_WINDOW_HEIGHT) - 40.0f;
+	const float graphHeight = 100.0f;
+	const float msToPixels = graphHeight / 50.0f;
+
+	const LatencyHistogram& frameTimes = PerformanceMetrics::getInstance()->getHistogram(Metric::FRAME_TIME);
+
+	std::vector<uint32_t> recentFrameTimes;
+	frameTimes.getRecentValues(recentFrameTimes);
+
+	graphics::Shader* activeShader = graphics::Shader::getActiveShader();
+	graphics::Shader::disableAll();
+
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_LIGHTING);
+
+	utils::gfx::orthoMode(0, 0, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+
+	// 60 and 30 fps
+	glBegin(GL_LINES);
+	glColor3f(0.0f, 0.6f, 0.0f);
+	glVertex2f(graphLeft, graphBottom - 16.6f * msToPixels);
+	glVertex2f(graphLeft + recentFrameTimes.size(), graphBottom - 16.6f * msToPixels);
+	glColor3f(0.6f, 0.0f, 0.0f);
+	glVertex2f(graphLeft, graphBottom - 33.3f * msToPixels);
+	glVertex2f(graphLeft + recentFrameTimes.size(), graphBottom - 33.3f * msToPixels);
+	glEnd();
+
+	glColor3f(1.0f, 1.0f, 0.0f);
+	glBegin(GL_LINE_STRIP);
+	for (size_t i = 0; i < recentFrameTimes.size(); ++i)
+	{
+		const float frameTime = std::min(recentFrameTimes[i] / 1000.0f, 50.0f);
+		glVertex2f(graphLeft + i, graphBottom - frameTime * msToPixels);
+	}
+	glEnd();
+
+	utils::gfx::perspectiveMode();
+
+	glPopAttrib();
+	graphics::Shader::bindShader(activeShader);
+
+	utils::gfx::printGL(utils::formatStr("frame ms  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f",
+		frameTimes.getPercentile(50.0f) / 1000.0f, frameTimes.getPercentile(95.0f) / 1000.0f,
+		frameTimes.getPercentile(99.0f) / 1000.0f, frameTimes.getMax() / 1000.0f), vec3(graphLeft, graphBottom + 20.0f, 0.0f), true);
+}
+
 /**
  * Renders a full screen quad using the given color texture (used for post processing effects).
  *
@@ -1,6 +1,7 @@
 #include "GameStdAfx.h"
 #include "GameLogic/GameObject.h"
 #include "GameLogic/ComponentFactory.h"
+#include "GameLogic/EngineCore.h"
 #include "Common/LuaManager.h"
 
 #include <boost/serialization/bitset.hpp>
@@ -35,22 +36,128 @@ void GameObject::move(const vec2& vel)
 	}
 }
 
-void GameObject::activateModule(const ModuleType moduleType)
+/**
+ * Switches on a module of the entity.
+ *
+ * @param moduleType	A ModuleType (MODULE_* in lua).
+ */
+void GameObject::activateModule(const int moduleType)
 {
+	switch ((ModuleType)moduleType)
+	{
+		case ModuleType::BATTERY:			setModuleActive<Battery>(true);				break;
+		case ModuleType::MOBYLITY:			setModuleActive<Mobility>(true);			break;
+		case ModuleType::MEMORY:			setModuleActive<Memory>(true);				break;
+		case ModuleType::HDD:				setModuleActive<Hdd>(true);					break;
+		case ModuleType::WELDER:			setModuleActive<Welder>(true);				break;
+		case ModuleType::JACKHAMMER:		setModuleActive<Jackhammer>(true);			break;
+		case ModuleType::RADIO_TRANSMITTER:	setModuleActive<RadioTransmitter>(true);	break;
+		case ModuleType::RADIO_RECEIVER:	setModuleActive<RadioReceiver>(true);		break;
+		case ModuleType::RADAR:				setModuleActive<Radar>(true);				break;
+		case ModuleType::LADAR:				setModuleActive<Ladar>(true);				break;
+		case ModuleType::FUEL_CREATOR:		setModuleActive<FuelCreator>(true);			break;
+		default:
+			break;
+	}
+}
 
+template <typename M>
+void GameObject::setModuleActive(const bool isActive)
+{
+	if (m_entity.has_component<M>())
+	{
+		m_entity.component<M>()->isActive = isActive;
+	}
+	else
+	{
+		m_log << "Error in activateModule(): no such module" << std::endl;
+	}
+}
+
+/**
+ * Returns the Radar or Ladar module of the entity, nullptr if it has no such module.
+ *
+ * @param moduleType ModuleType::RADAR or ModuleType::LADAR.
+ */
+const Sensor* GameObject::getSensor(const int moduleType) const
+{
+	if ((ModuleType)moduleType == ModuleType::RADAR && m_entity.has_component<Radar>())
+	{
+		return m_entity.component<const Radar>().get();
+	}
+	else if ((ModuleType)moduleType == ModuleType::LADAR && m_entity.has_component<Ladar>())
+	{
+		return m_entity.component<const Ladar>().get();
+	}
+
+	return nullptr;
+}
+
+/**
+ * Returns the contacts seen by the Radar or Ladar module in the last tick as a lua array of {id, x, y, distance} tables.
+ * The entities destroyed since the sensors ran are left out.
+ *
+ * @param state		The calling lua state (passed by luabind).
+ * @param moduleType	ModuleType::RADAR or ModuleType::LADAR.
+ */
+luabind::object GameObject::getContacts(lua_State* state, const int moduleType) const
+{
+	luabind::object contactTable = luabind::newtable(state);
+
+	const Sensor* sensor = getSensor(moduleType);
+	if (!sensor)
+	{
+		return contactTable;
+	}
+
+	const entityx::EntityManager& entities = EngineCore::getInstance()->getWorld().entities;
+
+	int i = 1;
+	for (const SensorContact& contact : sensor->contacts)
+	{
+		if (!entities.valid(entityx::Entity::Id(contact.id)))
+		{
+			continue;
+		}
+
+		luabind::object entry = luabind::newtable(state);
+		entry["id"] = contact.id;
+		entry["x"] = contact.pos.x;
+		entry["y"] = contact.pos.y;
+		entry["distance"] = contact.distance;
+
+		contactTable[i++] = entry;
+	}
+
+	return contactTable;
 }
 
 
 // register to lua
-void GameObject::registerMethodsToLua()
+void GameObject::registerMethodsToLua(lua_State* state)
 {
 	using namespace luabind;
 
 	class_<GameObject, std::shared_ptr<GameObject>> thisClass("GameObject");
 
 	REG_FUNC("move", &GameObject::move);
+	REG_FUNC("activateModule", &GameObject::activateModule);
+	REG_FUNC("getContacts", &GameObject::getContacts);
+
+	module(state)[thisClass];
 
-	module(LuaManager::getInstance()->getState())[thisClass];
+	// module types for activateModule() and getContacts()
+	globals(state)["MODULE_BATTERY"] = (int)ModuleType::BATTERY;
+	globals(state)["MODULE_MOBYLITY"] = (int)ModuleType::MOBYLITY;
+	globals(state)["MODULE_MEMORY"] = (int)ModuleType::MEMORY;
+	globals(state)["MODULE_HDD"] = (int)ModuleType::HDD;
+	globals(state)["MODULE_WELDER"] = (int)ModuleType::WELDER;
+	globals(state)["MODULE_JACKHAMMER"] = (int)ModuleType::JACKHAMMER;
+	globals(state)["MODULE_RADIO_TRANSMITTER"] = (int)ModuleType::RADIO_TRANSMITTER;
+	globals(state)["MODULE_RADIO_RECEIVER"] = (int)ModuleType::RADIO_RECEIVER;
+	globals(state)["MODULE_RADAR"] = (int)ModuleType::RADAR;
+	globals(state)["MODULE_LADAR"] = (int)ModuleType::LADAR;
+	globals(state)["MODULE_FUEL_CREATOR"] = (int)ModuleType::FUEL_CREATOR;
 }
 
 // serialization
@@ -3,6 +3,7 @@
 #include "GameLogic/Modules.h"
 
 #include <entityx/entityx.h>
+#include <luabind/object.hpp>
 
 typedef std::map<ComponentType, ComponentBase*> ComponentMap;
 
@@ -21,16 +22,22 @@ public:
 	void addComponent(const ComponentType componentType, ComponentBase* componentPtr);
 
 	void removeModule();
-	void activateModule(const ModuleType moduleType);
+	void activateModule(const int moduleType);
 	
 	void move(const vec2& vel);
 
+	const Sensor* getSensor(const int moduleType) const;
+	luabind::object getContacts(lua_State* state, const int moduleType) const;
+
 	entityx::Entity& getEntity() { return m_entity; }
 
 	// register to lua
-	static void registerMethodsToLua();
+	static void registerMethodsToLua(lua_State* state);
 
 private:
+	template <typename M>
+	void setModuleActive(const bool isActive);
+
 	template <typename Archive>
 	void serializeComponents(Archive& ar, const uint version);
 
@@ -0,0 +1,470 @@
+#include "GameStdAfx.h"
+#include "GameLogic/LuaComponentBridge.h"
+#include "Common/LuaManager.h"
+
+#include <cstring>
+
+
+namespace
+{
+	/**
+	 * A view of one component: resolved on every access, so it never dangles.
+	 */
+	struct ComponentView
+	{
+		const LuaComponentLayout*	pLayout;
+		uint64_t					entityId;
+	};
+
+	/**
+	 * A view of one field of every component of a type (the entities of the snapshot of the current tick).
+	 */
+	struct ColumnView
+	{
+		const LuaComponentLayout*	pLayout;
+		int							fieldIndex;		// -1: the entity ids
+	};
+
+	template <typename F> LuaFieldType getLuaFieldType();
+	template <> LuaFieldType getLuaFieldType<bool>()	{ return LuaFieldType::BOOL; }
+	template <> LuaFieldType getLuaFieldType<uint8_t>()	{ return LuaFieldType::UINT8; }
+	template <> LuaFieldType getLuaFieldType<float>()	{ return LuaFieldType::FLOAT; }
+}
+
+
+LuaComponentBridge::LuaComponentBridge()
+	: m_pEntities(nullptr)
+{
+	addLayout<Movement>("Movement");
+	addVec2Field<Movement>("pos", &Movement::pos, 1);
+	addVec2Field<Movement>("vel", &Movement::vel, 0);
+
+	addLayout<Health>("Health");
+	addField<Health>("maxHealth", &Health::maxHealth, 1);
+	addField<Health>("health", &Health::health, 0);
+
+	addLayout<Battery>("Battery");
+	addField<Battery>("isActive", &ModuleBase::isActive, 0);
+	addField<Battery>("maxCapacity", &Battery::maxCapacity, 1);
+	addField<Battery>("capacity", &Battery::capacity, 0);
+
+	addLayout<Mobility>("Mobility");
+	addField<Mobility>("isActive", &ModuleBase::isActive, 0);
+	addField<Mobility>("maxSpeed", &Mobility::maxSpeed, 1);
+	addField<Mobility>("speed", &Mobility::speed, 0);
+
+	addLayout<Radar>("Radar");
+	addField<Radar>("isActive", &ModuleBase::isActive, 0);
+	addField<Radar>("range", &Sensor::range, 2);
+	addField<Radar>("coneAngle", &Sensor::coneAngle, 1);
+	addField<Radar>("heading", &Sensor::heading, 0);
+
+	addLayout<Ladar>("Ladar");
+	addField<Ladar>("isActive", &ModuleBase::isActive, 0);
+	addField<Ladar>("range", &Sensor::range, 2);
+	addField<Ladar>("coneAngle", &Sensor::coneAngle, 1);
+	addField<Ladar>("heading", &Sensor::heading, 0);
+}
+
+template <typename C>
+LuaComponentLayout& LuaComponentBridge::addLayout(const std::string& name)
+{
+	LuaComponentLayout layout;
+	layout.name = name;
+	layout.getComponent = &LuaComponentBridge::getComponentOf<C>;
+	layout.gatherComponents = &LuaComponentBridge::gatherComponentsOf<C>;
+
+	m_layouts.push_back(layout);
+	return m_layouts.back();
+}
+
+/**
+ * Adds a field to the last added layout.
+ *
+ * @param member		The field of C or of a base class of C.
+ * @param attribIndex	The index of the field in its SERIALIZE macro: a write marks it like the set_ accessor (-1: none).
+ */
+template <typename C, typename B, typename F>
+void LuaComponentBridge::addField(const std::string& name, F B::* member, int attribIndex)
+{
+	addFieldAt<C>(name, member, 0, getLuaFieldType<F>(), attribIndex);
+}
+
+template <typename C, typename B>
+void LuaComponentBridge::addVec2Field(const std::string& name, vec2 B::* member, int attribIndex)
+{
+	addFieldAt<C>(name + "X", member, 0, LuaFieldType::FLOAT, attribIndex);
+	addFieldAt<C>(name + "Y", member, sizeof(float), LuaFieldType::FLOAT, attribIndex);
+}
+
+template <typename C, typename B, typename F>
+void LuaComponentBridge::addFieldAt(const std::string& name, F B::* member, size_t subOffset, LuaFieldType type, int attribIndex)
+{
+	// the offset is measured on a sample object: the components are not standard layout (offsetof is not portable)
+	C sample;
+	const ComponentBase* pBase = &sample;
+
+	LuaFieldLayout field;
+	field.name = name;
+	field.offset = (size_t)((const char*)&(sample.*member) - (const char*)pBase) + subOffset;
+	field.type = type;
+	field.attribBit = attribIndex >= 0 ? attribIndex + 2 : -1;
+
+	m_layouts.back().fields.push_back(field);
+}
+
+template <typename C>
+ComponentBase* LuaComponentBridge::getComponentOf(entityx::EntityManager& es, entityx::Entity::Id id)
+{
+	if (!es.valid(id))
+	{
+		return nullptr;
+	}
+
+	entityx::ComponentHandle<C> component = es.component<C>(id);
+	return component ? component.get() : nullptr;
+}
+
+template <typename C>
+void LuaComponentBridge::gatherComponentsOf(entityx::EntityManager& es, LuaComponentLayout& layout)
+{
+	entityx::ComponentHandle<C> component;
+	for (entityx::Entity entity : es.entities_with_components(component))
+	{
+		layout.entityIds.push_back(entity.id().id());
+	}
+}
+
+/**
+ * Takes the column snapshots of the tick.
+ */
+void LuaComponentBridge::update(entityx::EntityManager& es)
+{
+	m_pEntities = &es;
+
+	for (LuaComponentLayout& layout : m_layouts)
+	{
+		layout.entityIds.clear();
+		layout.gatherComponents(es, layout);
+	}
+}
+
+/**
+ * Generates the metatables of the component types and registers getComponent and getComponentColumn.
+ *
+ * @param isReadOnly Whether the views of the state can't write the components (the drone script states).
+ */
+void LuaComponentBridge::registerToLua(lua_State* state, bool isReadOnly)
+{
+	// component name -> metatable of its views
+	lua_newtable(state);
+	const int layoutsIndex = lua_gettop(state);
+
+	for (const LuaComponentLayout& layout : m_layouts)
+	{
+		lua_newtable(state);
+
+		// field name -> index in layout.fields
+		lua_newtable(state);
+		for (size_t i = 0; i < layout.fields.size(); ++i)
+		{
+			lua_pushinteger(state, (lua_Integer)i);
+			lua_setfield(state, -2, layout.fields[i].name.c_str());
+		}
+
+		lua_pushvalue(state, -1);
+		lua_setfield(state, -3, "__fields");
+
+		lua_pushvalue(state, -1);
+		lua_pushcclosure(state, &LuaComponentBridge::luaComponentIndex, 1);
+		lua_setfield(state, -3, "__index");
+
+		lua_pushboolean(state, isReadOnly);
+		lua_pushcclosure(state, &LuaComponentBridge::luaComponentNewIndex, 2);
+		lua_setfield(state, -2, "__newindex");
+
+		lua_pushlightuserdata(state, (void*)&layout);
+		lua_setfield(state, -2, "__layout");
+
+		lua_setfield(state, layoutsIndex, layout.name.c_str());
+	}
+
+	// metatable of the column views
+	lua_newtable(state);
+	const int columnIndex = lua_gettop(state);
+
+	lua_pushcfunction(state, &LuaComponentBridge::luaColumnIndex);
+	lua_setfield(state, columnIndex, "__index");
+
+	lua_pushboolean(state, isReadOnly);
+	lua_pushcclosure(state, &LuaComponentBridge::luaColumnNewIndex, 1);
+	lua_setfield(state, columnIndex, "__newindex");
+
+	lua_pushcfunction(state, &LuaComponentBridge::luaColumnLength);
+	lua_setfield(state, columnIndex, "__len");
+
+	lua_pushvalue(state, layoutsIndex);
+	lua_pushcclosure(state, &LuaComponentBridge::luaGetComponent, 1);
+	lua_setglobal(state, "getComponent");
+
+	lua_pushvalue(state, layoutsIndex);
+	lua_pushvalue(state, columnIndex);
+	lua_pushcclosure(state, &LuaComponentBridge::luaGetComponentColumn, 2);
+	lua_setglobal(state, "getComponentColumn");
+
+	lua_pop(state, 2);
+}
+
+void LuaComponentBridge::pushField(lua_State* state, ComponentBase* pComponent, const LuaFieldLayout& field)
+{
+	const char* pData = reinterpret_cast<const char*>(pComponent) + field.offset;
+
+	switch (field.type)
+	{
+		case LuaFieldType::BOOL:	lua_pushboolean(state, *reinterpret_cast<const bool*>(pData));			break;
+		case LuaFieldType::UINT8:	lua_pushinteger(state, *reinterpret_cast<const uint8_t*>(pData));		break;
+		case LuaFieldType::FLOAT:	lua_pushnumber(state, *reinterpret_cast<const float*>(pData));			break;
+		default:
+			lua_pushnil(state);
+			break;
+	}
+}
+
+void LuaComponentBridge::writeField(lua_State* state, int valueIndex, ComponentBase* pComponent, const LuaFieldLayout& field)
+{
+	char* pData = reinterpret_cast<char*>(pComponent) + field.offset;
+
+	switch (field.type)
+	{
+		case LuaFieldType::BOOL:	*reinterpret_cast<bool*>(pData) = lua_toboolean(state, valueIndex) != 0;										break;
+		case LuaFieldType::UINT8:	*reinterpret_cast<uint8_t*>(pData) = (uint8_t)std::min(std::max(luaL_checkint(state, valueIndex), 0), 255);	break;
+		case LuaFieldType::FLOAT:	*reinterpret_cast<float*>(pData) = (float)luaL_checknumber(state, valueIndex);									break;
+		default:
+			break;
+	}
+
+	if (field.attribBit >= 0)
+	{
+		pComponent->markAttribDirty((uint8_t)field.attribBit);
+	}
+}
+
+/**
+ * Resolves the component of the view at the given index and the field named by the key after it.
+ * The field table is the first upvalue of the calling metamethod.
+ */
+ComponentBase* LuaComponentBridge::getViewComponent(lua_State* state, int index, const LuaFieldLayout*& pField)
+{
+	const ComponentView* pView = static_cast<const ComponentView*>(lua_touserdata(state, index));
+	pField = nullptr;
+
+	lua_pushvalue(state, index + 1);
+	lua_rawget(state, lua_upvalueindex(1));
+	if (lua_isnumber(state, -1))
+	{
+		pField = &pView->pLayout->fields[(size_t)lua_tointeger(state, -1)];
+	}
+	lua_pop(state, 1);
+
+	entityx::EntityManager* pEntities = getInstance()->m_pEntities;
+	if (!pField || !pEntities)
+	{
+		return nullptr;
+	}
+
+	return pView->pLayout->getComponent(*pEntities, entityx::Entity::Id(pView->entityId));
+}
+
+/**
+ * The component of the i-th entity of the column snapshot, nullptr if the entity (or its component) is gone.
+ */
+ComponentBase* LuaComponentBridge::getColumnComponent(const LuaComponentLayout& layout, lua_Integer i)
+{
+	entityx::EntityManager* pEntities = getInstance()->m_pEntities;
+	if (!pEntities)
+	{
+		return nullptr;
+	}
+
+	return layout.getComponent(*pEntities, entityx::Entity::Id(layout.entityIds[i]));
+}
+
+// getComponent(entityId, componentName): a view of the component, nil if the entity has no such component
+int LuaComponentBridge::luaGetComponent(lua_State* state)
+{
+	const uint64_t entityId = (uint64_t)luaL_checknumber(state, 1);
+	luaL_checkstring(state, 2);
+
+	lua_pushvalue(state, 2);
+	lua_rawget(state, lua_upvalueindex(1));
+	if (lua_isnil(state, -1))
+	{
+		return luaL_error(state, "unknown component type: %s", lua_tostring(state, 2));
+	}
+
+	lua_getfield(state, 3, "__layout");
+	const LuaComponentLayout* pLayout = static_cast<const LuaComponentLayout*>(lua_touserdata(state, -1));
+	lua_pop(state, 1);
+
+	entityx::EntityManager* pEntities = getInstance()->m_pEntities;
+	if (!pEntities || !pLayout->getComponent(*pEntities, entityx::Entity::Id(entityId)))
+	{
+		lua_pushnil(state);
+		return 1;
+	}
+
+	ComponentView* pView = static_cast<ComponentView*>(lua_newuserdata(state, sizeof(ComponentView)));
+	pView->pLayout = pLayout;
+	pView->entityId = entityId;
+
+	lua_pushvalue(state, 3);
+	lua_setmetatable(state, -2);
+
+	return 1;
+}
+
+// getComponentColumn(componentName, fieldName): an array view of the field of every component of the type ("id": the entity ids)
+int LuaComponentBridge::luaGetComponentColumn(lua_State* state)
+{
+	luaL_checkstring(state, 1);
+	const char* fieldName = luaL_checkstring(state, 2);
+
+	lua_pushvalue(state, 1);
+	lua_rawget(state, lua_upvalueindex(1));
+	if (lua_isnil(state, -1))
+	{
+		return luaL_error(state, "unknown component type: %s", lua_tostring(state, 1));
+	}
+
+	lua_getfield(state, 3, "__layout");
+	const LuaComponentLayout* pLayout = static_cast<const LuaComponentLayout*>(lua_touserdata(state, -1));
+	lua_pop(state, 1);
+
+	int fieldIndex = -1;
+	if (strcmp(fieldName, "id") != 0)
+	{
+		lua_getfield(state, 3, "__fields");
+		lua_pushvalue(state, 2);
+		lua_rawget(state, -2);
+		if (!lua_isnumber(state, -1))
+		{
+			return luaL_error(state, "unknown field: %s.%s", pLayout->name.c_str(), fieldName);
+		}
+		fieldIndex = (int)lua_tointeger(state, -1);
+		lua_pop(state, 2);
+	}
+
+	ColumnView* pColumn = static_cast<ColumnView*>(lua_newuserdata(state, sizeof(ColumnView)));
+	pColumn->pLayout = pLayout;
+	pColumn->fieldIndex = fieldIndex;
+
+	lua_pushvalue(state, lua_upvalueindex(2));
+	lua_setmetatable(state, -2);
+
+	return 1;
+}
+
+int LuaComponentBridge::luaComponentIndex(lua_State* state)
+{
+	const LuaFieldLayout* pField;
+	ComponentBase* pComponent = getViewComponent(state, 1, pField);
+
+	if (pComponent)
+	{
+		pushField(state, pComponent, *pField);
+	}
+	else
+	{
+		lua_pushnil(state);
+	}
+
+	return 1;
+}
+
+int LuaComponentBridge::luaComponentNewIndex(lua_State* state)
+{
+	if (lua_toboolean(state, lua_upvalueindex(2)))
+	{
+		return luaL_error(state, "the components are read-only here");
+	}
+
+	const LuaFieldLayout* pField;
+	ComponentBase* pComponent = getViewComponent(state, 1, pField);
+
+	if (!pField)
+	{
+		return luaL_error(state, "unknown field: %s", lua_tostring(state, 2));
+	}
+	if (!pComponent)
+	{
+		return luaL_error(state, "the component does not exist anymore");
+	}
+
+	writeField(state, 3, pComponent, *pField);
+	return 0;
+}
+
+int LuaComponentBridge::luaColumnIndex(lua_State* state)
+{
+	const ColumnView* pColumn = static_cast<const ColumnView*>(lua_touserdata(state, 1));
+	const LuaComponentLayout& layout = *pColumn->pLayout;
+
+	const lua_Integer i = lua_tointeger(state, 2) - 1;
+	if (!lua_isnumber(state, 2) || i < 0 || i >= (lua_Integer)layout.entityIds.size())
+	{
+		lua_pushnil(state);
+		return 1;
+	}
+
+	if (pColumn->fieldIndex < 0)
+	{
+		lua_pushnumber(state, (lua_Number)layout.entityIds[i]);
+		return 1;
+	}
+
+	ComponentBase* pComponent = getColumnComponent(layout, i);
+	if (pComponent)
+	{
+		pushField(state, pComponent, layout.fields[pColumn->fieldIndex]);
+	}
+	else
+	{
+		lua_pushnil(state);
+	}
+
+	return 1;
+}
+
+int LuaComponentBridge::luaColumnNewIndex(lua_State* state)
+{
+	if (lua_toboolean(state, lua_upvalueindex(1)))
+	{
+		return luaL_error(state, "the components are read-only here");
+	}
+
+	const ColumnView* pColumn = static_cast<const ColumnView*>(lua_touserdata(state, 1));
+	const LuaComponentLayout& layout = *pColumn->pLayout;
+
+	const lua_Integer i = luaL_checkinteger(state, 2) - 1;
+	if (pColumn->fieldIndex < 0 || i < 0 || i >= (lua_Integer)layout.entityIds.size())
+	{
+		return luaL_error(state, "invalid column write");
+	}
+
+	ComponentBase* pComponent = getColumnComponent(layout, i);
+	if (!pComponent)
+	{
+		return luaL_error(state, "the component does not exist anymore");
+	}
+
+	writeField(state, 3, pComponent, layout.fields[pColumn->fieldIndex]);
+	return 0;
+}
+
+int LuaComponentBridge::luaColumnLength(lua_State* state)
+{
+	const ColumnView* pColumn = static_cast<const ColumnView*>(lua_touserdata(state, 1));
+
+	lua_pushinteger(state, (lua_Integer)pColumn->pLayout->entityIds.size());
+	return 1;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "GameLogic/Modules.h"
+
+#include <entityx/entityx.h>
+
+struct lua_State;
+
+
+enum class LuaFieldType
+{
+	BOOL,
+	UINT8,
+	FLOAT,
+};
+
+/**
+ * @brief A component field seen from lua: where it is and how to convert it.
+ */
+struct LuaFieldLayout
+{
+	std::string		name;
+	size_t			offset;			// from the ComponentBase of the component
+	LuaFieldType	type;
+	int				attribBit;		// the attribMask bit a write sets (like the set_ accessor), -1: none
+};
+
+/**
+ * @brief The fields of a component type, and the components of the type in the current tick.
+ */
+struct LuaComponentLayout
+{
+	std::string						name;
+	std::vector<LuaFieldLayout>		fields;
+
+	ComponentBase*	(*getComponent)(entityx::EntityManager& es, entityx::Entity::Id id);
+	void			(*gatherComponents)(entityx::EntityManager& es, LuaComponentLayout& layout);
+
+	// column snapshot of the current tick: the entities, their components are resolved at every access
+	std::vector<uint64_t>			entityIds;
+};
+
+/**
+ * @brief Exposes the entity components to lua as typed views over the component storage, without luabind.
+ *
+ * Every component type gets a generated metatable: __index/__newindex look the field up in a name -> field table
+ * and read/write it at its offset with its type, so a field access is one raw C call and boxes nothing.
+ *	- getComponent(entityId, "Movement") returns a view of one component, movement.posX reads the float in place
+ *	- getComponentColumn("Movement", "posX") returns an array style view over the field of every Movement
+ *	  of the current tick (column[i], #column), getComponentColumn("Movement", "id") the entity ids
+ *	  (column[i] of an entity destroyed since the snapshot is nil)
+ * The views are small userdata (lua 5.1 light userdata share one metatable, so they can't carry a type).
+ * In the drone script states the views are read-only, the scripts change the world through commands.
+ */
+class LuaComponentBridge : public Singleton<LuaComponentBridge>
+{
+public:
+	LuaComponentBridge();
+
+	void	registerToLua(lua_State* state, bool isReadOnly);
+
+	void	update(entityx::EntityManager& es);
+
+	// getters-setters
+	const std::vector<LuaComponentLayout>& getLayouts() const { return m_layouts; }
+
+private:
+	template <typename C>
+	LuaComponentLayout& addLayout(const std::string& name);
+
+	template <typename C, typename B, typename F>
+	void	addField(const std::string& name, F B::* member, int attribIndex = -1);
+
+	template <typename C, typename B>
+	void	addVec2Field(const std::string& name, vec2 B::* member, int attribIndex = -1);
+
+	template <typename C, typename B, typename F>
+	void	addFieldAt(const std::string& name, F B::* member, size_t subOffset, LuaFieldType type, int attribIndex);
+
+	template <typename C>
+	static ComponentBase* getComponentOf(entityx::EntityManager& es, entityx::Entity::Id id);
+
+	template <typename C>
+	static void	gatherComponentsOf(entityx::EntityManager& es, LuaComponentLayout& layout);
+
+	static ComponentBase* getViewComponent(lua_State* state, int index, const LuaFieldLayout*& pField);
+	static ComponentBase* getColumnComponent(const LuaComponentLayout& layout, lua_Integer i);
+
+	static void	pushField(lua_State* state, ComponentBase* pComponent, const LuaFieldLayout& field);
+	static void	writeField(lua_State* state, int valueIndex, ComponentBase* pComponent, const LuaFieldLayout& field);
+
+	// lua api
+	static int	luaGetComponent(lua_State* state);
+	static int	luaGetComponentColumn(lua_State* state);
+
+	static int	luaComponentIndex(lua_State* state);
+	static int	luaComponentNewIndex(lua_State* state);
+	static int	luaColumnIndex(lua_State* state);
+	static int	luaColumnNewIndex(lua_State* state);
+	static int	luaColumnLength(lua_State* state);
+
+private:
+	std::vector<LuaComponentLayout>	m_layouts;
+	entityx::EntityManager*			m_pEntities;
+};
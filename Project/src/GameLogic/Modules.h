@@ -93,19 +93,57 @@ struct RadioReceiver : public ModuleBase
 
 };
 
+/**
+ * An entity seen by a sensor. Written by the SensorSystem, ordered by distance.
+ * The entity may be destroyed before the contact is read: the readers check the id (index and version) first.
+ */
+struct SensorContact
+{
+	uint64_t	id;			// entityx::Entity::Id::id()
+	vec2		pos;
+	float		distance;
+};
+
 struct Sensor : public ModuleBase
 {
+	Sensor(float range = 0.0f, float coneAngle = 360.0f, float heading = 0.0f, bool needsLineOfSight = false, uint8_t maxContacts = 8)
+		: range(range)
+		, coneAngle(coneAngle)
+		, heading(heading)
+		, needsLineOfSight(needsLineOfSight)
+		, maxContacts(maxContacts)
+	{
+	}
+
+	float range;
+	float coneAngle;		// full opening angle in degrees (360: omnidirectional)
+	float heading;			// direction of the cone in degrees, set by the drone
+	bool needsLineOfSight;
+	uint8_t maxContacts;
+
+	std::vector<SensorContact> contacts;	// filled by the SensorSystem every tick, not serialized
+
 
+	SERIALIZABLE_CLASS;
+	SERIALIZE3(range, coneAngle, heading);
 };
 
+// long range, omnidirectional, sees through the other bodies
 struct Radar : public Sensor
 {
-
+	Radar(float range = 200.0f)
+		: Sensor(range, 360.0f, 0.0f, false, 16)
+	{
+	}
 };
 
+// short range, narrow cone, blocked by the other bodies
 struct Ladar : public Sensor
 {
-
+	Ladar(float range = 80.0f, float coneAngle = 30.0f)
+		: Sensor(range, coneAngle, 0.0f, true, 8)
+	{
+	}
 };
 
 struct FuelCreator : public ModuleBase
@@ -13,8 +13,8 @@
 
 
 #define SERIALIZE_I(idx0, name, attribIndex)	public: \
-												const decltype(name)& get_##name##() const { return name; } \
-												void set_##name##(const decltype(name)& newval) { name = newval; attribMask[attribIndex + idx0 + 2] = true; }
+												const decltype(name)& get_##name() const { return name; } \
+												void set_##name(const decltype(name)& newval) { name = newval; attribMask[attribIndex + idx0 + 2] = true; }
 
 #define SERIALIZE(name, attribIndex)			SERIALIZE_I(0, name, attribIndex)
 
@@ -101,6 +101,9 @@ public:
 
 	virtual void printInfo() const { }
 
+	// marks an attribute changed, like its set_ accessor does
+	void markAttribDirty(uint8_t attribBit) { attribMask[attribBit] = true; }
+
 protected:
 	template <typename Archive>
 	void serializeFields(Archive& ar) {}
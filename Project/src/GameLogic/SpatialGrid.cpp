@@ -0,0 +1,149 @@
+#include "GameStdAfx.h"
+#include "GameLogic/SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+SpatialGrid::SpatialGrid(float cellSize)
+	: m_bucketMask(0)
+{
+	setCellSize(cellSize);
+}
+
+void SpatialGrid::setCellSize(float cellSize)
+{
+	GX_ASSERT(cellSize > 0.0f);
+
+	m_cellSize = cellSize;
+	m_invCellSize = 1.0f / cellSize;
+}
+
+void SpatialGrid::clear()
+{
+	m_addedIds.clear();
+	m_addedPos.clear();
+}
+
+void SpatialGrid::add(uint64_t id, const vec2& pos)
+{
+	m_addedIds.push_back(id);
+	m_addedPos.push_back(pos);
+}
+
+/**
+ * Sorts the added entries into the bucket table. Has to be called after the last add() and before the queries.
+ */
+void SpatialGrid::build()
+{
+	const uint32_t numEntries = (uint32_t)m_addedIds.size();
+
+	// at least twice as many buckets as entries keeps the hash collisions rare
+	uint32_t numBuckets = 16;
+	while (numBuckets < numEntries * 2)
+	{
+		numBuckets <<= 1;
+	}
+	m_bucketMask = numBuckets - 1;
+
+	m_bucketStart.assign(numBuckets + 1, 0);
+	m_addedBuckets.resize(numEntries);
+
+	// count
+	for (uint32_t i = 0; i < numEntries; ++i)
+	{
+		const uint32_t bucket = getBucket(m_addedPos[i]);
+		m_addedBuckets[i] = bucket;
+		m_bucketStart[bucket + 1]++;
+	}
+
+	// prefix sum
+	for (uint32_t i = 0; i < numBuckets; ++i)
+	{
+		m_bucketStart[i + 1] += m_bucketStart[i];
+	}
+
+	// scatter
+	m_ids.resize(numEntries);
+	m_posX.resize(numEntries);
+	m_posY.resize(numEntries);
+
+	std::vector<uint32_t> insertPos(m_bucketStart.begin(), m_bucketStart.end() - 1);
+	for (uint32_t i = 0; i < numEntries; ++i)
+	{
+		const uint32_t slot = insertPos[m_addedBuckets[i]]++;
+
+		m_ids[slot] = m_addedIds[i];
+		m_posX[slot] = m_addedPos[i].x;
+		m_posY[slot] = m_addedPos[i].y;
+	}
+}
+
+/**
+ * Collects the slots of the entries in the cells overlapping the given circle.
+ * The result is conservative (whole cells and hash collisions), the caller does the exact distance tests.
+ *
+ * @param center	The center of the query circle.
+ * @param radius	The radius of the query circle.
+ * @param slots		The slots are appended to this array.
+ */
+void SpatialGrid::query(const vec2& center, float radius, std::vector<uint32_t>& slots) const
+{
+	if (m_ids.empty())
+	{
+		return;
+	}
+
+	const int minX = getCellCoord(center.x - radius);
+	const int maxX = getCellCoord(center.x + radius);
+	const int minY = getCellCoord(center.y - radius);
+	const int maxY = getCellCoord(center.y + radius);
+
+	// a large query would visit the same buckets many times: walk the whole grid instead
+	const uint64_t numCells = (uint64_t)(maxX - minX + 1) * (uint64_t)(maxY - minY + 1);
+	if (numCells > m_bucketMask)
+	{
+		for (uint32_t slot = 0; slot < size(); ++slot)
+		{
+			slots.push_back(slot);
+		}
+		return;
+	}
+
+	// different cells can hash to the same bucket: visit every bucket only once
+	m_queryBuckets.clear();
+	for (int y = minY; y <= maxY; ++y)
+	{
+		for (int x = minX; x <= maxX; ++x)
+		{
+			m_queryBuckets.push_back(getBucket(x, y));
+		}
+	}
+
+	std::sort(m_queryBuckets.begin(), m_queryBuckets.end());
+	m_queryBuckets.erase(std::unique(m_queryBuckets.begin(), m_queryBuckets.end()), m_queryBuckets.end());
+
+	for (const uint32_t bucket : m_queryBuckets)
+	{
+		for (uint32_t slot = m_bucketStart[bucket]; slot < m_bucketStart[bucket + 1]; ++slot)
+		{
+			slots.push_back(slot);
+		}
+	}
+}
+
+uint32_t SpatialGrid::getBucket(const vec2& pos) const
+{
+	return getBucket(getCellCoord(pos.x), getCellCoord(pos.y));
+}
+
+uint32_t SpatialGrid::getBucket(int cellX, int cellY) const
+{
+	// large primes from "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+	return (((uint32_t)cellX * 73856093u) ^ ((uint32_t)cellY * 19349663u)) & m_bucketMask;
+}
+
+int SpatialGrid::getCellCoord(float v) const
+{
+	return (int)std::floor(v * m_invCellSize);
+}
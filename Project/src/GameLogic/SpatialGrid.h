@@ -0,0 +1,56 @@
+#pragma once
+
+/**
+ * @brief Hashed uniform grid over the 2D positions of the entities.
+ *
+ * The grid is rebuilt once per tick: the entries are added in any order, then build() sorts them cell by cell
+ * (counting sort) into flat position/id arrays, so a query only walks a few contiguous ranges.
+ * The world is unbounded, the cells are hashed into a power of two bucket table sized to the entry count.
+ */
+class SpatialGrid
+{
+public:
+	SpatialGrid(float cellSize = 32.0f);
+
+	void		clear();
+	void		add(uint64_t id, const vec2& pos);
+	void		build();
+
+	void		query(const vec2& center, float radius, std::vector<uint32_t>& slots) const;
+
+	// getters-setters
+	uint32_t	size() const					{ return (uint32_t)m_ids.size(); }
+	uint64_t	getId(uint32_t slot) const		{ return m_ids[slot]; }
+	float		getX(uint32_t slot) const		{ return m_posX[slot]; }
+	float		getY(uint32_t slot) const		{ return m_posY[slot]; }
+
+	const float* getXArray() const				{ return m_posX.data(); }
+	const float* getYArray() const				{ return m_posY.data(); }
+
+	float		getCellSize() const				{ return m_cellSize; }
+	void		setCellSize(float cellSize);
+
+	uint32_t	getBucket(const vec2& pos) const;
+
+private:
+	uint32_t	getBucket(int cellX, int cellY) const;
+	int			getCellCoord(float v) const;
+
+private:
+	float					m_cellSize;
+	float					m_invCellSize;
+	uint32_t				m_bucketMask;
+
+	// staging area: filled by add() in insertion order
+	std::vector<uint64_t>	m_addedIds;
+	std::vector<vec2>		m_addedPos;
+	std::vector<uint32_t>	m_addedBuckets;
+
+	// built grid: entries sorted by bucket, bucket i owns the slots [m_bucketStart[i], m_bucketStart[i + 1])
+	std::vector<uint32_t>	m_bucketStart;
+	std::vector<uint64_t>	m_ids;
+	std::vector<float>		m_posX;
+	std::vector<float>		m_posY;
+
+	mutable std::vector<uint32_t>	m_queryBuckets;
+};
@@ -0,0 +1,190 @@
+#include "GameStdAfx.h"
+#include "GameLogic/Systems/SensorSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+SensorSystem::SensorSystem(float cellSize, float bodyRadius)
+	: m_grid(cellSize)
+	, m_bodyRadius(bodyRadius)
+{
+}
+
+void SensorSystem::update(entityx::EntityManager& es, entityx::EventManager& events, entityx::TimeDelta dt)
+{
+	// rebuild the spatial index
+	m_grid.clear();
+
+	entityx::ComponentHandle<Movement> movement;
+	for (entityx::Entity entity : es.entities_with_components(movement))
+	{
+		m_grid.add(entity.id().id(), movement->get_pos());
+	}
+
+	m_grid.build();
+
+	// collect the queries of the active sensors
+	m_queries.clear();
+	gatherQueries<Radar>(es);
+	gatherQueries<Ladar>(es);
+
+	// neighbouring queries touch the same buckets
+	std::sort(m_queries.begin(), m_queries.end(), [](const SensorQuery& a, const SensorQuery& b) { return a.bucket < b.bucket; });
+
+	for (const SensorQuery& query : m_queries)
+	{
+		runQuery(query);
+	}
+}
+
+template <typename S>
+void SensorSystem::gatherQueries(entityx::EntityManager& es)
+{
+	entityx::ComponentHandle<S> sensor;
+	entityx::ComponentHandle<Movement> movement;
+	for (entityx::Entity entity : es.entities_with_components(sensor, movement))
+	{
+		if (!sensor->isActive)
+		{
+			sensor->contacts.clear();
+			continue;
+		}
+
+		const vec2& pos = movement->get_pos();
+
+		SensorQuery query;
+		query.pSensor = sensor.get();
+		query.ownerId = entity.id().id();
+		query.pos = pos;
+		query.bucket = m_grid.getBucket(pos);
+
+		m_queries.push_back(query);
+	}
+}
+
+/**
+ * Runs the range, cone and line of sight tests of one sensor and fills its contact buffer.
+ */
+void SensorSystem::runQuery(const SensorQuery& query)
+{
+	Sensor& sensor = *query.pSensor;
+	sensor.contacts.clear();
+
+	m_candidates.clear();
+	m_grid.query(query.pos, sensor.range, m_candidates);
+
+	const uint32_t numCandidates = (uint32_t)m_candidates.size();
+	if (numCandidates == 0)
+	{
+		return;
+	}
+
+	m_dx.resize(numCandidates);
+	m_dy.resize(numCandidates);
+	m_distance.resize(numCandidates);
+	m_inRange.resize(numCandidates);
+	m_inCone.resize(numCandidates);
+
+	// gather the candidates into flat arrays
+	const float* posX = m_grid.getXArray();
+	const float* posY = m_grid.getYArray();
+	for (uint32_t i = 0; i < numCandidates; ++i)
+	{
+		const uint32_t slot = m_candidates[i];
+		m_dx[i] = posX[slot] - query.pos.x;
+		m_dy[i] = posY[slot] - query.pos.y;
+		m_inRange[i] = m_grid.getId(slot) != query.ownerId;
+	}
+
+	// range and cone tests: branchless loop over the flat arrays
+	const float rangeSq = sensor.range * sensor.range;
+	const float headingRad = sensor.heading * PI_DEG;
+	const float dirX = std::cos(headingRad);
+	const float dirY = std::sin(headingRad);
+	const float cosHalfAngle = std::cos(sensor.coneAngle * 0.5f * PI_DEG);
+	const uint8_t isOmni = sensor.coneAngle >= 360.0f;
+
+	const float* dx = m_dx.data();
+	const float* dy = m_dy.data();
+	float* distance = m_distance.data();
+	uint8_t* inRange = m_inRange.data();
+	uint8_t* inCone = m_inCone.data();
+
+	for (uint32_t i = 0; i < numCandidates; ++i)
+	{
+		const float distSq = dx[i] * dx[i] + dy[i] * dy[i];
+		const float dist = std::sqrt(distSq);
+		const float dot = dx[i] * dirX + dy[i] * dirY;
+
+		distance[i] = dist;
+		inRange[i] &= (uint8_t)(distSq <= rangeSq);
+		inCone[i] = inRange[i] & (isOmni | (uint8_t)(dot >= cosHalfAngle * dist));
+	}
+
+	// everything in range can occlude: order it by distance
+	m_order.clear();
+	for (uint32_t i = 0; i < numCandidates; ++i)
+	{
+		if (inRange[i])
+		{
+			m_order.push_back(i);
+		}
+	}
+
+	std::sort(m_order.begin(), m_order.end(), [distance](uint32_t a, uint32_t b) { return distance[a] < distance[b]; });
+
+	// nearest first until the buffer is full
+	for (uint32_t orderIndex = 0; orderIndex < m_order.size() && sensor.contacts.size() < sensor.maxContacts; ++orderIndex)
+	{
+		const uint32_t i = m_order[orderIndex];
+		if (!inCone[i] || (sensor.needsLineOfSight && isOccluded(orderIndex)))
+		{
+			continue;
+		}
+
+		const uint32_t slot = m_candidates[i];
+
+		SensorContact contact;
+		contact.id = m_grid.getId(slot);
+		contact.pos = vec2(m_grid.getX(slot), m_grid.getY(slot));
+		contact.distance = distance[i];
+
+		sensor.contacts.push_back(contact);
+	}
+}
+
+/**
+ * Checks whether a closer entity blocks the line of sight to the given candidate.
+ *
+ * @param orderIndex The index of the candidate in m_order.
+ */
+bool SensorSystem::isOccluded(uint32_t orderIndex) const
+{
+	const uint32_t target = m_order[orderIndex];
+	const float targetDist = m_distance[target];
+
+	if (targetDist <= 0.0f)
+	{
+		return false;
+	}
+
+	const float dirX = m_dx[target] / targetDist;
+	const float dirY = m_dy[target] / targetDist;
+
+	for (uint32_t j = 0; j < orderIndex; ++j)
+	{
+		const uint32_t occluder = m_order[j];
+
+		// projection onto the line of sight and distance from it
+		const float along = m_dx[occluder] * dirX + m_dy[occluder] * dirY;
+		const float across = std::abs(m_dx[occluder] * dirY - m_dy[occluder] * dirX);
+
+		if (along > 0.0f && along < targetDist && across < m_bodyRadius)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <entityx/entityx.h>
+#include "GameLogic/Modules.h"
+#include "GameLogic/SpatialGrid.h"
+
+/**
+ * @brief Answers the Radar and Ladar queries of the drones.
+ *
+ * Every tick the positions of the entities with Movement are put into a SpatialGrid, then all the active sensors
+ * are queried in one batch (sorted by grid bucket for locality). The range and cone tests run over flat float arrays,
+ * the line of sight test treats the other entities as circles of bodyRadius.
+ * The results are written into the contact buffers of the sensors, which the drone scripts read as arrays.
+ */
+class SensorSystem : public entityx::System<SensorSystem>
+{
+public:
+	SensorSystem(float cellSize = 32.0f, float bodyRadius = 1.0f);
+
+	void update(entityx::EntityManager& es, entityx::EventManager& events, entityx::TimeDelta dt) override;
+
+	const SpatialGrid& getGrid() const { return m_grid; }
+
+private:
+	struct SensorQuery
+	{
+		Sensor*		pSensor;
+		uint64_t	ownerId;
+		vec2		pos;
+		uint32_t	bucket;
+	};
+
+	template <typename S>
+	void gatherQueries(entityx::EntityManager& es);
+
+	void runQuery(const SensorQuery& query);
+	bool isOccluded(uint32_t orderIndex) const;
+
+private:
+	SpatialGrid					m_grid;
+	float						m_bodyRadius;
+
+	std::vector<SensorQuery>	m_queries;
+
+	// per query scratch arrays (candidates in range, sorted by distance)
+	std::vector<uint32_t>		m_candidates;
+	std::vector<float>			m_dx;
+	std::vector<float>			m_dy;
+	std::vector<float>			m_distance;
+	std::vector<uint8_t>		m_inRange;
+	std::vector<uint8_t>		m_inCone;
+	std::vector<uint32_t>		m_order;
+};
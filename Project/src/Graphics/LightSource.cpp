@@ -507,8 +507,9 @@ void LightSource::shadowingPass1(graphics::RenderContext& context)
 
 
 	// setup the render context
-	EngineCore::getInstance()->getShader("simplest")->bind();
-	context.m_pShader = EngineCore::getInstance()->getShader("simplest").get();
+	graphics::Shader* pSimplestShader = EngineCore::getInstance()->getSimplestShader();
+	pSimplestShader->bind();
+	context.m_pShader = pSimplestShader;
 	context.m_roleName = "none";
 	context.setEnableBit("shadow", false);
 
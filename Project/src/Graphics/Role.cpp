@@ -49,16 +49,18 @@ void Role::updateCommonUniforms(const graphics::RenderContext& context, const Ma
 	shader->setUniform1i("u_enableShadows", context.getEnableBit("shadow"));
 }
 
-void Role::render(const graphics::RenderContext& context, models::Mesh* pMesh)
+void Role::render(const graphics::RenderContext& context, models::Mesh* pMesh, Shader* pSkinningShader)
 {
-	const Shader* pEffect = context.m_pShader;
+	// the shader of the context first, the skinning one else
+	Shader* pCustomShader = context.m_pShader ? context.m_pShader : pSkinningShader;
+	const Shader* pEffect = pCustomShader;
 
 	const uint numSubmeshes = std::max(1u, pMesh->getNumObjects());
 	for (uint i = 0; i < numSubmeshes; i++)
 	{
 		if (i < m_materials.size())
 		{
-			pEffect = m_materials[i]->apply(context.m_pShader);
+			pEffect = m_materials[i]->apply(pCustomShader);
 		}
 
 
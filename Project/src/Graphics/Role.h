@@ -19,7 +19,8 @@ public:
 
 	void addMaterial(Material* pMaterial);
 
-	void render(const graphics::RenderContext& context, models::Mesh* pMesh);
+	// pSkinningShader: the shader of the mesh skinned on the gpu, used in place of the materials' ones
+	void render(const graphics::RenderContext& context, models::Mesh* pMesh, Shader* pSkinningShader = nullptr);
 
 	static void updateCommonUniforms(const graphics::RenderContext& context, const Matrix& modelMatrix = Matrix(), const graphics::Shader* customEffect = nullptr);
 
@@ -1,5 +1,6 @@
 #include "GameStdAfx.h"
 #include "Graphics/ShadedMesh.h"
+#include "Graphics/Camera.h"
 #include "Graphics/Role.h"
 #include "Graphics/RenderContext.h"
 #include "Models/mesh/Mesh.h"
@@ -41,6 +42,11 @@ ShadedMesh& ShadedMesh::operator=(const ShadedMesh& other)
 
 void ShadedMesh::render(const graphics::RenderContext& context/*, const Entity* pOwner*/)
 {
+	if (context.m_pCamera)
+	{
+		m_pMesh->setCameraDistance((context.getModelMatrix().getTranslation() - context.m_pCamera->getPos()).length());
+	}
+
 	if (m_roles.empty())
 	{
 		// no roles defined -> simply render the mesh
@@ -52,7 +58,8 @@ void ShadedMesh::render(const graphics::RenderContext& context/*, const Entity*
 	{
 		Role::updateCommonUniforms(context/*, pOwner*/);
 
-		const GLuint program = EngineCore::getInstance()->getShader("simplest")->getProgram();
+		const Shader* pSkinningShader = getSkinningShader();
+		const GLuint program = (pSkinningShader ? pSkinningShader : EngineCore::getInstance()->getSimplestShader())->getProgram();
 
 		const uint numSubmeshes = std::max(1u, m_pMesh->getNumObjects());
 		for (uint i = 0; i < numSubmeshes; i++)
@@ -68,10 +75,24 @@ void ShadedMesh::render(const graphics::RenderContext& context/*, const Entity*
 	auto iRole = m_roles.find(context.m_roleName);
 	if (iRole != m_roles.end())
 	{
-		iRole->second->render(context, m_pMesh/*, pOwner*/);
+		iRole->second->render(context, m_pMesh, getSkinningShader()/*, pOwner*/);
 	}
 }
 
+/**
+ * The skinning shader of the meshes skinned on the gpu (the md5 models within its joint palette), nullptr for the
+ * others. The shader of the render context overrides it, the mesh is then skinned on the cpu.
+ */
+Shader* ShadedMesh::getSkinningShader() const
+{
+	if (!m_pMesh->isGpuSkinnable())
+	{
+		return nullptr;
+	}
+
+	return EngineCore::getInstance()->getSkinningShader();
+}
+
 void ShadedMesh::addRole(const std::string& name, Role* pRole)
 {
 	m_roles[name] = pRole;
@@ -11,6 +11,7 @@ namespace graphics
 
 class Role;
 class RenderContext;
+class Shader;
 
 
 class ShadedMesh
@@ -30,6 +31,8 @@ public:
 	void setMesh(models::Mesh* mesh);
 	
 protected:
+	Shader* getSkinningShader() const;
+
 	models::Mesh* m_pMesh;
 	std::map<const std::string, Role*> m_roles;
 };
@@ -0,0 +1,341 @@
+#include "GameStdAfx.h"
+#include "Graphics/TextureCache.h"
+#include "Common/AssetLoader.h"
+#include "Common/AssetPack.h"
+#include "Common/LoggerSystem.h"
+#include "Common/MappedFile.h"
+#include "Common/TraceRecorder.h"
+
+#include <cmath>
+
+
+namespace graphics
+{
+
+TextureCache::TextureCache()
+	: m_isSupported(GLEW_EXT_texture_compression_s3tc != 0)
+{
+	if (!m_isSupported)
+	{
+		TRACE_INFO("No s3tc texture compression: the images are decoded at every load.", 0);
+	}
+}
+
+bool TextureCache::loadTexture(const std::string& fileName, GLuint& texId)
+{
+	if (TextureCache::hasInstance() && TextureCache::getInstance()->load(fileName, texId))
+	{
+		return true;
+	}
+
+	return ::loadTexture(fileName, texId);
+}
+
+/**
+ * The texture of the image with one more reference: loaded once whatever path it is asked by, in the background (its
+ * size is known after the upload).
+ */
+TextureHandle TextureCache::acquireTexture(const std::string& fileName, TexturePool& textures)
+{
+	const TextureHandle handle = textures.acquire(fileName);
+	if (handle.isValid())
+	{
+		return handle;
+	}
+
+	GLuint texId = 0;
+	const bool isLoaded = loadTextureAsync(fileName, texId, [&textures, fileName](const GLuint uploadedTexId)
+	{
+		textures.setSize(textures.find(fileName), utils::gfx::getTextureSize(uploadedTexId));
+	});
+
+	if (!isLoaded)
+	{
+		return TextureHandle();
+	}
+
+	// 0 bytes until the upload (a texture without levels), unless it was loaded without the asset loader
+	return textures.add(fileName, texId, utils::gfx::getTextureSize(texId));
+}
+
+/**
+ * The texture name is made right away (the models keep it) while a worker reads the cached file of the image, or
+ * decodes the image. The upload fills the texture between two frames, unless it was deleted meanwhile (erase():
+ * the name may be an other texture's by then). False if there is no such image.
+ */
+bool TextureCache::loadTextureAsync(const std::string& fileName, GLuint& texId, const UploadFunction& onUploaded)
+{
+	if (!AssetLoader::hasInstance() || !TextureCache::hasInstance())
+	{
+		if (!loadTexture(fileName, texId))
+		{
+			return false;
+		}
+
+		if (onUploaded)
+		{
+			onUploaded(texId);
+		}
+		return true;
+	}
+
+	const bool isCached = TextureCache::getInstance()->m_isSupported && utils::file::existFile(getCacheFile(fileName));
+	if (!isCached && !utils::file::existFile(fileName))
+	{
+		return false;
+	}
+
+	glGenTextures(1, &texId);
+	TextureCache::getInstance()->m_pendingUploads.insert(texId);
+
+	const std::shared_ptr<Image> pImage = std::make_shared<Image>();
+	const GLuint pendingTexId = texId;
+
+	AssetLoader::getInstance()->load(fileName,
+		[pImage, fileName, isCached]()
+		{
+			// a damaged cached file: the image is decoded
+			return (isCached && readCacheFile(fileName, *pImage)) || decodeImage(fileName, pImage->decoded);
+		},
+		[pImage, fileName, pendingTexId, onUploaded](const bool isLoaded)
+		{
+			// the loader is destroyed before the cache (EngineCore::release())
+			TextureCache* pCache = TextureCache::getInstance();
+			if (pCache->m_pendingUploads.erase(pendingTexId) == 0 || !isLoaded)
+			{
+				return;
+			}
+
+			if (!pImage->pCacheData)
+			{
+				uploadImage(pImage->decoded, pendingTexId);
+			}
+			else
+			{
+				Texture texture;
+				texture.texId = pendingTexId;
+				uploadLevels(*reinterpret_cast<const ctex::Header*>(pImage->pCacheData), pImage->pCacheData, texture, 0);
+
+				pCache->m_textures[fileName] = texture;
+			}
+
+			if (onUploaded)
+			{
+				onUploaded(pendingTexId);
+			}
+		});
+
+	return true;
+}
+
+/**
+ * The texture of the cached file of the image, from the level of the divisor on.
+ * False if there is no cached file (or it is damaged): the image is to be decoded.
+ */
+bool TextureCache::load(const std::string& fileName, GLuint& texId, const float resolutionDiv)
+{
+	if (!m_isSupported || !utils::file::existFile(getCacheFile(fileName)))
+	{
+		return false;
+	}
+
+	TRACE_ZONE("TextureCache::load");
+
+	Texture texture;
+	glGenTextures(1, &texture.texId);
+
+	if (!upload(fileName, texture, getTopLevel(resolutionDiv)))
+	{
+		glDeleteTextures(1, &texture.texId);
+		return false;
+	}
+
+	m_textures[fileName] = texture;
+
+	texId = texture.texId;
+
+	return true;
+}
+
+/**
+ * The levels of the texture from the top of the divisor, uploaded from the cached file again: no decoding, no
+ * scaling, and only the levels shown are in the vram.
+ */
+bool TextureCache::setResolution(const std::string& fileName, const float resolutionDiv)
+{
+	const auto it = m_textures.find(fileName);
+	if (it == m_textures.end())
+	{
+		return false;
+	}
+
+	const uint topLevel = getTopLevel(resolutionDiv);
+	if (it->second.topLevel == topLevel)
+	{
+		return true;
+	}
+
+	TRACE_ZONE("TextureCache::setResolution");
+
+	return upload(fileName, it->second, topLevel);
+}
+
+bool TextureCache::contains(const std::string& fileName) const
+{
+	return m_textures.count(fileName) > 0;
+}
+
+/**
+ * The name of a deleted texture is reused by glGenTextures: a stale entry would upload the levels of its image to
+ * another texture at setResolution().
+ */
+void TextureCache::erase(const GLuint texId)
+{
+	m_pendingUploads.erase(texId);
+
+	for (auto it = m_textures.begin(); it != m_textures.end(); ++it)
+	{
+		if (it->second.texId == texId)
+		{
+			m_textures.erase(it);
+			return;
+		}
+	}
+}
+
+std::string TextureCache::getCacheFile(const std::string& fileName)
+{
+	return fileName + ".ctex";
+}
+
+uint TextureCache::getTopLevel(const float resolutionDiv)
+{
+	return (uint)std::max(0.0f, std::floor(std::log2(std::max(1.0f, resolutionDiv)) + 0.5f));
+}
+
+size_t TextureCache::getResidentSize() const
+{
+	size_t residentSize = 0;
+	for (const auto& entry : m_textures)
+	{
+		residentSize += entry.second.residentSize;
+	}
+
+	return residentSize;
+}
+
+bool TextureCache::upload(const std::string& fileName, Texture& texture, const uint topLevel) const
+{
+	const std::string cacheFile = getCacheFile(fileName);
+
+	MappedFile file;
+	if (!file.open(cacheFile))
+	{
+		return false;
+	}
+
+	const ctex::Header* pHeader = getHeader(file.getData(), file.getSize(), cacheFile);
+	if (!pHeader)
+	{
+		return false;
+	}
+
+	uploadLevels(*pHeader, file.getData(), texture, topLevel);
+
+	return true;
+}
+
+const ctex::Header* TextureCache::getHeader(const uint8_t* pData, const size_t size, const std::string& cacheFile)
+{
+	using namespace ctex;
+
+	const Header* pHeader = size >= sizeof(Header) ? reinterpret_cast<const Header*>(pData) : nullptr;
+	bool isValid = pHeader && pHeader->magic == CTEX_MAGIC && pHeader->version == CTEX_VERSION && pHeader->fileSize == size
+		&& (pHeader->format == FORMAT_BC1 || pHeader->format == FORMAT_BC3) && pHeader->numLevels > 0 && pHeader->numLevels <= MAX_LEVELS;
+	for (uint i = 0; isValid && i < pHeader->numLevels; i++)
+	{
+		const Level& level = pHeader->levels[i];
+		isValid = level.size == getLevelSize(pHeader->format, level.width, level.height) && level.offset <= size && level.size <= size - level.offset;
+	}
+
+	if (!isValid)
+	{
+		TRACE_ERROR("Error: " << cacheFile << " is not a cached texture of version " << CTEX_VERSION << ", convert the image again.", 0);
+		return nullptr;
+	}
+
+	return pHeader;
+}
+
+/**
+ * The cached file of the image (on a worker): a view of the asset pack if it is stored in it (its pages loaded here),
+ * else read into the memory. The upload touches no page the worker has not.
+ */
+bool TextureCache::readCacheFile(const std::string& fileName, Image& image)
+{
+	const std::string cacheFile = getCacheFile(fileName);
+
+	// the pack stays mounted until the loader is destroyed
+	const uint8_t* pData = nullptr;
+	size_t size = 0;
+	if (AssetPack::hasInstance() && AssetPack::getInstance()->view(cacheFile, pData, size))
+	{
+		if (!getHeader(pData, size, cacheFile))
+		{
+			return false;
+		}
+
+		const volatile uint8_t* pPages = pData;
+		for (size_t offset = 0; offset < size; offset += 4096)
+		{
+			pPages[offset];
+		}
+
+		image.pCacheData = pData;
+		return true;
+	}
+
+	MappedFile file;
+	if (!file.open(cacheFile) || !getHeader(file.getData(), file.getSize(), cacheFile))
+	{
+		return false;
+	}
+
+	image.cacheFile.assign(file.getData(), file.getData() + file.getSize());
+	image.pCacheData = image.cacheFile.data();
+
+	return true;
+}
+
+/**
+ * Uploads the levels from topLevel on (the smallest one at least) as the levels of the texture from 0 on.
+ */
+void TextureCache::uploadLevels(const ctex::Header& header, const uint8_t* pData, Texture& texture, const uint topLevel)
+{
+	using namespace ctex;
+
+	const uint firstLevel = std::min(topLevel, header.numLevels - 1);
+	const GLenum internalFormat = header.format == FORMAT_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	glBindTexture(GL_TEXTURE_2D, texture.texId);
+
+	texture.residentSize = 0;
+	for (uint i = firstLevel; i < header.numLevels; i++)
+	{
+		const Level& level = header.levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D, i - firstLevel, internalFormat, level.width, level.height, 0, level.size, pData + level.offset);
+
+		texture.residentSize += level.size;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.numLevels - 1 - firstLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	texture.topLevel = topLevel;
+}
+
+} // namespace graphics
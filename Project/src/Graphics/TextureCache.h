@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Common/ResourcePool.h"
+#include "Graphics/TextureCacheFormat.h"
+
+#include <imageLoad.h>
+
+#include <functional>
+#include <set>
+
+
+namespace graphics
+{
+
+/**
+ * @brief The textures of the images baked by the CrimsonTextureConverter (TextureCacheFormat.h): block compressed, with
+ * their mip chains, uploaded from the mapped files without decoding.
+ *
+ * A resolution divisor (the texture quality of the menu) drops the largest levels: getTopLevel() is the level
+ * resident at the top of the texture. setResolution() uploads the levels from the new top again, the texture keeps
+ * its name. The images without a cached file go to loadTexture() of the image loader as before.
+ *
+ * loadTextureAsync() reads the cached file (or decodes the image) on a worker of the AssetLoader, the texture is
+ * filled between two frames.
+ */
+class TextureCache : public Singleton<TextureCache>
+{
+public:
+	TextureCache();
+
+	// the cached texture of the image if it is baked, else loadTexture() of the image loader
+	static bool loadTexture(const std::string& fileName, GLuint& texId);
+
+	typedef std::function<void(const GLuint texId)> UploadFunction;
+
+	// loadTexture() on the AssetLoader: texId is made right away, empty until the image is uploaded to it (then onUploaded)
+	static bool loadTextureAsync(const std::string& fileName, GLuint& texId, const UploadFunction& onUploaded = UploadFunction());
+
+	// loadTextureAsync() once per image of the pool, with one more reference: invalid if there is no such image
+	static TextureHandle acquireTexture(const std::string& fileName, TexturePool& textures);
+
+	bool	load(const std::string& fileName, GLuint& texId, const float resolutionDiv = 1.0f);
+
+	// false if the texture of the image is not a cached one
+	bool	setResolution(const std::string& fileName, const float resolutionDiv);
+
+	bool	contains(const std::string& fileName) const;
+
+	// the cached file of an image: next to it
+	static std::string	getCacheFile(const std::string& fileName);
+
+	// the level of the top of the texture at the divisor: 1 -> 0, 2 -> 1, 4 -> 2
+	static uint			getTopLevel(const float resolutionDiv);
+
+	// getters-setters
+	bool	isSupported() const { return m_isSupported; }
+
+	// the bytes of the resident levels of the cached textures
+	size_t	getResidentSize() const;
+
+	// the texture is deleted (the release function of the pool): it is forgotten, its upload dropped if not done yet
+	void	erase(const GLuint texId);
+
+private:
+	struct Texture
+	{
+		GLuint	texId;
+		uint	topLevel;
+		size_t	residentSize;
+	};
+
+	// what a worker read of an image: its cached file (a view of the asset pack, or read into cacheFile), else its texels
+	struct Image
+	{
+		Image() : pCacheData(nullptr) {}
+
+		const uint8_t*			pCacheData;
+		std::vector<uint8_t>	cacheFile;
+		DecodedImage			decoded;
+	};
+
+	bool	upload(const std::string& fileName, Texture& texture, const uint topLevel) const;
+
+	// the header of a cached file, nullptr if it is not a valid one
+	static const ctex::Header*	getHeader(const uint8_t* pData, const size_t size, const std::string& cacheFile);
+	static bool					readCacheFile(const std::string& fileName, Image& image);
+
+	static void	uploadLevels(const ctex::Header& header, const uint8_t* pData, Texture& texture, const uint topLevel);
+
+private:
+	std::map<std::string, Texture>	m_textures;
+	bool							m_isSupported;
+
+	// the textures of loadTextureAsync() waiting for their upload
+	std::set<GLuint>				m_pendingUploads;
+};
+
+} // namespace graphics
@@ -0,0 +1,386 @@
+#include "GameStdAfx.h"
+#include "Graphics/TextureCacheBuilder.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+
+#include <algorithm>
+
+
+namespace graphics
+{
+
+static uint16_t toRgb565(const uint8_t* pColor)
+{
+	return (uint16_t)((((pColor[0] * 31 + 127) / 255) << 11) | (((pColor[1] * 63 + 127) / 255) << 5) | ((pColor[2] * 31 + 127) / 255));
+}
+
+static void fromRgb565(const uint16_t color, uint8_t* pColor)
+{
+	const uint r = (color >> 11) & 31;
+	const uint g = (color >> 5) & 63;
+	const uint b = color & 31;
+
+	pColor[0] = (uint8_t)((r << 3) | (r >> 2));
+	pColor[1] = (uint8_t)((g << 2) | (g >> 4));
+	pColor[2] = (uint8_t)((b << 3) | (b >> 2));
+}
+
+static uint colorDistance(const uint8_t* pColor1, const uint8_t* pColor2)
+{
+	const int r = pColor1[0] - pColor2[0];
+	const int g = pColor1[1] - pColor2[1];
+	const int b = pColor1[2] - pColor2[2];
+
+	return (uint)(r * r + g * g + b * b);
+}
+
+
+TextureCacheBuilder::TextureCacheBuilder()
+	: m_format(ctex::FORMAT_BC1)
+{
+}
+
+void TextureCacheBuilder::build(const uint8_t* pTexels, const uint width, const uint height, const ctex::Format format)
+{
+	TRACE_ZONE("TextureCacheBuilder::build");
+
+	m_format = format;
+	m_levels.clear();
+
+	const uint blockSize = ctex::getBlockSize(format);
+
+	std::vector<uint8_t> texels(pTexels, pTexels + (size_t)width * height * 4);
+	uint levelWidth = std::max(1u, width);
+	uint levelHeight = std::max(1u, height);
+
+	for (;;)
+	{
+		m_levels.push_back(Level());
+		Level& level = m_levels.back();
+
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.blocks.resize(ctex::getLevelSize(format, levelWidth, levelHeight));
+
+		// the rows of blocks on the job pool
+		const uint numBlocksX = (levelWidth + 3) / 4;
+		const uint numBlocksY = (levelHeight + 3) / 4;
+
+		JobPool::run(numBlocksY, 1, [&texels, &level, numBlocksX, blockSize, format](size_t begin, size_t end)
+		{
+			uint8_t blockTexels[16 * 4];
+
+			for (size_t blockY = begin; blockY < end; blockY++)
+			{
+				for (uint blockX = 0; blockX < numBlocksX; blockX++)
+				{
+					// the texels past the edges repeat the last ones
+					for (uint y = 0; y < 4; y++)
+					{
+						const size_t texelY = std::min<size_t>(blockY * 4 + y, level.height - 1);
+						for (uint x = 0; x < 4; x++)
+						{
+							const size_t texelX = std::min<size_t>(blockX * 4 + x, level.width - 1);
+							memcpy(&blockTexels[(y * 4 + x) * 4], &texels[(texelY * level.width + texelX) * 4], 4);
+						}
+					}
+
+					compressBlock(blockTexels, format, &level.blocks[(blockY * numBlocksX + blockX) * blockSize]);
+				}
+			}
+		});
+
+		if ((levelWidth == 1 && levelHeight == 1) || m_levels.size() == ctex::MAX_LEVELS)
+		{
+			break;
+		}
+
+		// the next level: the average of 2x2 texels (the last row or column of an odd size is taken twice)
+		const uint nextWidth = std::max(1u, levelWidth / 2);
+		const uint nextHeight = std::max(1u, levelHeight / 2);
+
+		std::vector<uint8_t> nextTexels((size_t)nextWidth * nextHeight * 4);
+		for (uint y = 0; y < nextHeight; y++)
+		{
+			const size_t y0 = std::min(y * 2, levelHeight - 1) * (size_t)levelWidth;
+			const size_t y1 = std::min(y * 2 + 1, levelHeight - 1) * (size_t)levelWidth;
+
+			for (uint x = 0; x < nextWidth; x++)
+			{
+				const size_t x0 = std::min(x * 2, levelWidth - 1);
+				const size_t x1 = std::min(x * 2 + 1, levelWidth - 1);
+
+				for (uint c = 0; c < 4; c++)
+				{
+					const uint sum = texels[(y0 + x0) * 4 + c] + texels[(y0 + x1) * 4 + c] + texels[(y1 + x0) * 4 + c] + texels[(y1 + x1) * 4 + c];
+					nextTexels[((size_t)y * nextWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+				}
+			}
+		}
+
+		texels.swap(nextTexels);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+}
+
+bool TextureCacheBuilder::save(const std::string& fileName) const
+{
+	using namespace ctex;
+
+	const auto align = [](const uint32_t offset) { return (offset + CTEX_ALIGNMENT - 1) / CTEX_ALIGNMENT * CTEX_ALIGNMENT; };
+
+	Header header = {};
+	header.magic = CTEX_MAGIC;
+	header.version = CTEX_VERSION;
+	header.format = m_format;
+	header.numLevels = (uint32_t)m_levels.size();
+
+	uint32_t offset = align(sizeof(Header));
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		header.levels[i].offset = offset;
+		header.levels[i].size = (uint32_t)m_levels[i].blocks.size();
+		header.levels[i].width = m_levels[i].width;
+		header.levels[i].height = m_levels[i].height;
+
+		offset = align(offset + header.levels[i].size);
+	}
+	header.fileSize = offset;
+
+	FILE* fp = fopen(fileName.c_str(), "wb");
+	if (!fp)
+	{
+		TRACE_ERROR("Error: can't write " << fileName, 0);
+		return false;
+	}
+
+	static const uint8_t padding[CTEX_ALIGNMENT] = {};
+
+	bool isWritten = fwrite(&header, sizeof(header), 1, fp) == 1;
+	isWritten = isWritten && fwrite(padding, 1, align(sizeof(Header)) - sizeof(Header), fp) == align(sizeof(Header)) - sizeof(Header);
+	for (size_t i = 0; i < m_levels.size() && isWritten; i++)
+	{
+		const uint32_t size = header.levels[i].size;
+		isWritten = fwrite(m_levels[i].blocks.data(), 1, size, fp) == size
+			&& fwrite(padding, 1, align(size) - size, fp) == align(size) - size;
+	}
+	isWritten = fclose(fp) == 0 && isWritten;
+
+	if (!isWritten)
+	{
+		TRACE_ERROR("Error: can't write " << fileName, 0);
+		remove(fileName.c_str());
+	}
+
+	return isWritten;
+}
+
+uint TextureCacheBuilder::getSize() const
+{
+	uint size = 0;
+	for (const Level& level : m_levels)
+	{
+		size += (uint)level.blocks.size();
+	}
+
+	return size;
+}
+
+void TextureCacheBuilder::compressBlock(const uint8_t* pTexels, const ctex::Format format, uint8_t* pBlock)
+{
+	if (format == ctex::FORMAT_BC3)
+	{
+		compressAlpha(pTexels, pBlock);
+		compressColors(pTexels, pBlock + 8);
+	}
+	else
+	{
+		compressColors(pTexels, pBlock);
+	}
+}
+
+/**
+ * The color end points and the 2 bit indices of the texels.
+ */
+void TextureCacheBuilder::compressColors(const uint8_t* pTexels, uint8_t* pBlock)
+{
+	uint8_t minColor[3] = { 255, 255, 255 };
+	uint8_t maxColor[3] = { 0, 0, 0 };
+
+	for (uint i = 0; i < 16; i++)
+	{
+		for (uint c = 0; c < 3; c++)
+		{
+			minColor[c] = std::min(minColor[c], pTexels[i * 4 + c]);
+			maxColor[c] = std::max(maxColor[c], pTexels[i * 4 + c]);
+		}
+	}
+
+	// the box is inset by 1/16 of its size: the end points get closer to the texels around them
+	for (uint c = 0; c < 3; c++)
+	{
+		const uint8_t inset = (uint8_t)((maxColor[c] - minColor[c]) >> 4);
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+
+	// color0 > color1: the 4 color mode of bc1
+	uint16_t color0 = toRgb565(maxColor);
+	uint16_t color1 = toRgb565(minColor);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		uint8_t palette[4][3];
+		fromRgb565(color0, palette[0]);
+		fromRgb565(color1, palette[1]);
+		for (uint c = 0; c < 3; c++)
+		{
+			palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+
+		for (uint i = 0; i < 16; i++)
+		{
+			uint bestIndex = 0;
+			uint bestDistance = colorDistance(&pTexels[i * 4], palette[0]);
+			for (uint j = 1; j < 4; j++)
+			{
+				const uint distance = colorDistance(&pTexels[i * 4], palette[j]);
+				if (distance < bestDistance)
+				{
+					bestIndex = j;
+					bestDistance = distance;
+				}
+			}
+
+			indices |= bestIndex << (i * 2);
+		}
+	}
+
+	pBlock[0] = (uint8_t)(color0 & 0xff);
+	pBlock[1] = (uint8_t)(color0 >> 8);
+	pBlock[2] = (uint8_t)(color1 & 0xff);
+	pBlock[3] = (uint8_t)(color1 >> 8);
+	for (uint i = 0; i < 4; i++)
+	{
+		pBlock[4 + i] = (uint8_t)(indices >> (i * 8));
+	}
+}
+
+/**
+ * The alpha end points (alpha0 > alpha1: the 8 alpha mode of bc3) and the 3 bit indices of the texels.
+ */
+void TextureCacheBuilder::compressAlpha(const uint8_t* pTexels, uint8_t* pBlock)
+{
+	uint8_t minAlpha = 255;
+	uint8_t maxAlpha = 0;
+
+	for (uint i = 0; i < 16; i++)
+	{
+		minAlpha = std::min(minAlpha, pTexels[i * 4 + 3]);
+		maxAlpha = std::max(maxAlpha, pTexels[i * 4 + 3]);
+	}
+
+	uint64_t indices = 0;
+	if (minAlpha != maxAlpha)
+	{
+		uint8_t palette[8] = { maxAlpha, minAlpha };
+		for (uint j = 2; j < 8; j++)
+		{
+			palette[j] = (uint8_t)(((8 - j) * maxAlpha + (j - 1) * minAlpha) / 7);
+		}
+
+		for (uint i = 0; i < 16; i++)
+		{
+			uint bestIndex = 0;
+			int bestDistance = 256;
+			for (uint j = 0; j < 8; j++)
+			{
+				const int distance = std::abs(pTexels[i * 4 + 3] - palette[j]);
+				if (distance < bestDistance)
+				{
+					bestIndex = j;
+					bestDistance = distance;
+				}
+			}
+
+			indices |= (uint64_t)bestIndex << (i * 3);
+		}
+	}
+
+	pBlock[0] = maxAlpha;
+	pBlock[1] = minAlpha;
+	for (uint i = 0; i < 6; i++)
+	{
+		pBlock[2 + i] = (uint8_t)(indices >> (i * 8));
+	}
+}
+
+void TextureCacheBuilder::decompressBlock(const uint8_t* pBlock, const ctex::Format format, uint8_t* pTexels)
+{
+	const uint8_t* pColorBlock = format == ctex::FORMAT_BC3 ? pBlock + 8 : pBlock;
+
+	const uint16_t color0 = (uint16_t)(pColorBlock[0] | (pColorBlock[1] << 8));
+	const uint16_t color1 = (uint16_t)(pColorBlock[2] | (pColorBlock[3] << 8));
+	const uint32_t colorIndices = pColorBlock[4] | (pColorBlock[5] << 8) | (pColorBlock[6] << 16) | ((uint32_t)pColorBlock[7] << 24);
+
+	uint8_t palette[4][3];
+	fromRgb565(color0, palette[0]);
+	fromRgb565(color1, palette[1]);
+	for (uint c = 0; c < 3; c++)
+	{
+		// the 3 color mode of bc1 (its 4th color is black), bc3 has only the 4 color one
+		if (color0 > color1 || format == ctex::FORMAT_BC3)
+		{
+			palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+		else
+		{
+			palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+			palette[3][c] = 0;
+		}
+	}
+
+	uint8_t alphaPalette[8] = { 255, 255, 255, 255, 255, 255, 255, 255 };
+	uint64_t alphaIndices = 0;
+	if (format == ctex::FORMAT_BC3)
+	{
+		alphaPalette[0] = pBlock[0];
+		alphaPalette[1] = pBlock[1];
+		for (uint j = 2; j < 8; j++)
+		{
+			if (pBlock[0] > pBlock[1])
+			{
+				alphaPalette[j] = (uint8_t)(((8 - j) * pBlock[0] + (j - 1) * pBlock[1]) / 7);
+			}
+			else
+			{
+				alphaPalette[j] = j < 6 ? (uint8_t)(((6 - j) * pBlock[0] + (j - 1) * pBlock[1]) / 5) : (j == 6 ? 0 : 255);
+			}
+		}
+
+		for (uint i = 0; i < 6; i++)
+		{
+			alphaIndices |= (uint64_t)pBlock[2 + i] << (i * 8);
+		}
+	}
+
+	for (uint i = 0; i < 16; i++)
+	{
+		const uint8_t* pColor = palette[(colorIndices >> (i * 2)) & 3];
+		pTexels[i * 4 + 0] = pColor[0];
+		pTexels[i * 4 + 1] = pColor[1];
+		pTexels[i * 4 + 2] = pColor[2];
+		pTexels[i * 4 + 3] = alphaPalette[(alphaIndices >> (i * 3)) & 7];
+	}
+}
+
+} // namespace graphics
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Graphics/TextureCacheFormat.h"
+
+
+namespace graphics
+{
+
+/**
+ * @brief Writes the cached textures loaded by the TextureCache (TextureCacheFormat.h), used by the
+ * CrimsonTextureConverter.
+ *
+ * The mip chain is box filtered from the image, the blocks of the levels are compressed on the threads of the JobPool:
+ * the end points of a block are the corners of its color box (inset a little), every texel takes the closest color
+ * between them.
+ */
+class TextureCacheBuilder
+{
+public:
+	TextureCacheBuilder();
+
+	// the mip chain of the image: width x height rgba texels, in the row order of the upload
+	void	build(const uint8_t* pTexels, const uint width, const uint height, const ctex::Format format);
+
+	bool	save(const std::string& fileName) const;
+
+	// a 4x4 block of rgba texels (row by row) to its bc1 / bc3 bytes and back
+	static void	compressBlock(const uint8_t* pTexels, const ctex::Format format, uint8_t* pBlock);
+	static void	decompressBlock(const uint8_t* pBlock, const ctex::Format format, uint8_t* pTexels);
+
+	// getters-setters
+	ctex::Format	getFormat() const { return m_format; }
+	uint			getNumLevels() const { return (uint)m_levels.size(); }
+	uint			getSize() const;
+
+private:
+	struct Level
+	{
+		uint					width;
+		uint					height;
+		std::vector<uint8_t>	blocks;
+	};
+
+	static void	compressColors(const uint8_t* pTexels, uint8_t* pBlock);
+	static void	compressAlpha(const uint8_t* pTexels, uint8_t* pBlock);
+
+private:
+	ctex::Format		m_format;
+	std::vector<Level>	m_levels;
+};
+
+} // namespace graphics
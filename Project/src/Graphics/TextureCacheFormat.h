@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace graphics
+{
+
+/**
+ * The cached texture (.ctex): the mip chain of an image, block compressed, written by the CrimsonTextureConverter
+ * next to the image (<image>.ctex) and uploaded from a file mapping as it is (TextureCache).
+ *
+ * The levels follow the header from the largest one to 1x1, each at an offset aligned to CTEX_ALIGNMENT. Their rows
+ * are in the order loadTexture() uploads the image in: the cached texture looks the same.
+ */
+namespace ctex
+{
+
+static const uint32_t CTEX_MAGIC		= 0x58544343;	// "CCTX"
+static const uint32_t CTEX_VERSION		= 1;
+static const uint32_t CTEX_ALIGNMENT	= 16;
+
+static const uint32_t MAX_LEVELS		= 16;
+
+enum Format : uint32_t
+{
+	FORMAT_BC1 = 0,		// rgb, 8 bytes per 4x4 block
+	FORMAT_BC3 = 1,		// rgba, 16 bytes per 4x4 block (the normal-height maps: the height is in the alpha)
+};
+
+struct Level
+{
+	uint32_t	offset;
+	uint32_t	size;
+	uint32_t	width;
+	uint32_t	height;
+};
+
+struct Header
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	fileSize;
+
+	uint32_t	format;
+	uint32_t	numLevels;
+	uint32_t	reserved;
+
+	Level		levels[MAX_LEVELS];
+};
+
+inline uint32_t getBlockSize(const uint32_t format)
+{
+	return format == FORMAT_BC1 ? 8 : 16;
+}
+
+// the bytes of a level: the blocks cover the texels of its edges
+inline uint32_t getLevelSize(const uint32_t format, const uint32_t width, const uint32_t height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+} // namespace ctex
+
+} // namespace graphics
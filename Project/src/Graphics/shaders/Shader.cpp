@@ -23,14 +23,14 @@ Shader* Shader::getActiveShader()
 
 
 
-Shader::Shader(const std::string& shaderName, const uint glslVersion)
+Shader::Shader(const std::string& shaderName, const uint glslVersion, const std::string& defines)
 {
 	if (shaderName == "")
 	{
 		return;
 	}
 
-	load(shaderName, glslVersion);
+	load(shaderName, glslVersion, defines);
 }
 
 Shader::Shader(const std::string& vertexFile, const std::string& fragmentFile, const uint glslVersion)
@@ -234,7 +234,7 @@ GLuint Shader::getProgram() const
 	return m_shaderProg;
 }
 
-GLuint loadShaderFile(const GLenum type, const char* filename, const uint glslVersion)
+GLuint loadShaderFile(const GLenum type, const char* filename, const uint glslVersion, const std::string& defines = "")
 {
 	GLuint shader;
 	GLint compiled;
@@ -297,6 +297,12 @@ GLuint loadShaderFile(const GLenum type, const char* filename, const uint glslVe
 
 	delete[] shaderSrc;
 
+	// the definitions of the shader, after the #version of the common ones
+	if (!defines.empty())
+	{
+		shaderSource += "\n" + defines + "\n";
+	}
+
 
 	// load the file
 	FILE* shaderFile;
@@ -356,8 +362,9 @@ GLuint loadShaderFile(const GLenum type, const char* filename, const uint glslVe
 /**
  * Loads the shaders from the vertex ([filename].vert) and fragment ([filename].frag) shader files.
  * @param filename	The name of the shader files without the extension.
+ * @param defines	The preprocessor definitions inserted in both files.
  */
-void Shader::load(const std::string& shaderName, const uint glslVersion)
+void Shader::load(const std::string& shaderName, const uint glslVersion, const std::string& defines)
 {
 	TRACE_INFO("Loading shader" << shaderName, 0);
 
@@ -369,8 +376,8 @@ void Shader::load(const std::string& shaderName, const uint glslVersion)
 	}
 
 	//creation of shaders and program
-	const GLuint vertexShaderHandle = loadShaderFile(GL_VERTEX_SHADER, (const char*)(shaderName + ".vert").c_str(), glslVersion);
-	const GLuint fragmentShaderHandle = loadShaderFile(GL_FRAGMENT_SHADER, (const char*)(shaderName + ".frag").c_str(), glslVersion);
+	const GLuint vertexShaderHandle = loadShaderFile(GL_VERTEX_SHADER, (const char*)(shaderName + ".vert").c_str(), glslVersion, defines);
+	const GLuint fragmentShaderHandle = loadShaderFile(GL_FRAGMENT_SHADER, (const char*)(shaderName + ".frag").c_str(), glslVersion, defines);
 
 
 	// create the program object
@@ -8,10 +8,11 @@ namespace graphics
 class Shader
 {
 public:
-	Shader(const std::string& shaderName = "", const uint glslVersion = 0);
+	// defines: the preprocessor definitions of both stages (e.g. "#define MAX_BONE_COUNT 100"), after the common ones
+	Shader(const std::string& shaderName = "", const uint glslVersion = 0, const std::string& defines = "");
 	Shader(const std::string& vertexFile, const std::string& fragmentFile, const uint glslVersion = 0);
 
-	void load(const std::string& shaderName, const uint glslVersion = 0);
+	void load(const std::string& shaderName, const uint glslVersion = 0, const std::string& defines = "");
 	void load(const std::string& vertexFile, const std::string& fragmentFile, const uint glslVersion = 0);
 
 	void setupCommonUniforms();
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#define	PI 3.14159263f
+#define PIHALF 1.57079632679f
+#define PI_DEG 0.01745329f	//angle * PI_DEG = radians
+#define EPSILON 0.001
+
+#define VEC3_TO_F3(v)		(float)v.x,(float)v.y,(float)v.z
+
+
+/*
+ * The instruction sets of the math kernels, taken from the compiler flags (MATH_NO_SIMD: the scalar code).
+ *  - MATH_SSE: sse2 (the default of x64 and of msvc x86)
+ *  - MATH_SSE4: sse4.1 dot products (gcc/clang -msse4.1, msvc /arch:AVX)
+ *  - MATH_AVX: the batched transforms run on 8 vectors (-mavx/-mavx2, /arch:AVX, /arch:AVX2)
+ * With USE_GLM the kernels are glm calls, the build flags select glm's own simd code.
+ */
+#if !defined(USE_GLM) && !defined(MATH_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SSE
+#include <emmintrin.h>
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define MATH_SSE4
+#include <smmintrin.h>
+#endif
+
+#if defined(__AVX__)
+#define MATH_AVX
+#include <immintrin.h>
+#endif
+#endif
+#endif
+
+
+#ifdef MATH_SSE
+inline float simdDot4(const __m128 a, const __m128 b)
+{
+#ifdef MATH_SSE4
+	return _mm_cvtss_f32(_mm_dp_ps(a, b, 0xF1));
+#else
+	const __m128 products = _mm_mul_ps(a, b);
+	const __m128 swapped = _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1));
+	const __m128 sums = _mm_add_ps(products, swapped);			// (0 + 1, 0 + 1, 2 + 3, 2 + 3)
+	return _mm_cvtss_f32(_mm_add_ss(sums, _mm_movehl_ps(swapped, sums)));
+#endif
+}
+#endif
@@ -1,11 +1,18 @@
 #pragma once
 
+#include "Math/mathDefs.h"
+#include "Math/vec3.h"
+
 #define vec3ToFloatA4(v,fa)	fa[0]=v.x; fa[1]=v.y; fa[2]=v.z; fa[3]=0;
 
 class Matrix
 {
 	float m[4][4];
 
+	// the results of the kernels are written without the identity being loaded first
+	struct Uninitialized {};
+	explicit Matrix(Uninitialized) {}
+
 public:
 	Matrix();
 
@@ -26,7 +33,6 @@ public:
 	bool operator==(const Matrix& mat) const;
 	bool operator!=(const Matrix& mat) const;
 
-	Matrix& operator=(const Matrix& mat);
 	Matrix operator+(const Matrix& mat) const;
 	Matrix operator*(const Matrix& mat) const;
 	vec3 operator*(const vec3& v) const;
@@ -43,6 +49,10 @@ public:
 	vec3 invTransform(const vec3& v) const;
 	vec3 invTransform3x3(const vec3& v) const;
 
+	// batched transform of vector arrays (the skinning, the scene traversal): pIn and pOut may be the same array
+	void transformArray(const vec3* pIn, vec3* pOut, size_t count) const;
+	void transform3x3Array(const vec3* pIn, vec3* pOut, size_t count) const;
+
 	// getters-setters
 	void setPerspective(float fovY, float aspect, float nearPlane, float farPlane);
 
@@ -78,6 +88,514 @@ public:
 	{
 		ar& m;
 	}
+
+private:
+	template <bool hasTranslation>
+	void transformArrayImpl(const vec3* pIn, vec3* pOut, size_t count) const;
 };
 
-extern vec3 transformVector(const vec3& v, const vec3& trans, vec3 rot);
+inline vec3 transformVector(const vec3& v, const vec3& trans, vec3 rot);
+
+
+inline Matrix::Matrix()
+{
+	loadIdentity();
+}
+
+inline Matrix::Matrix(float d1, float d2, float d3)
+{
+	clear();
+	m[0][0] = d1;
+	m[1][1] = d2;
+	m[2][2] = d3;
+	m[3][3] = 1;
+}
+
+inline Matrix::Matrix(float x1, float y1, float z1, float w1, float x2, float y2, float z2, float w2, float x3, float y3, float z3, float w3, float x4, float y4, float z4, float w4)
+{
+	m[0][0] = x1;
+	m[0][1] = y1;
+	m[0][2] = z1;
+	m[0][3] = w1;
+	m[1][0] = x2;
+	m[1][1] = y2;
+	m[1][2] = z2;
+	m[1][3] = w2;
+	m[2][0] = x3;
+	m[2][1] = y3;
+	m[2][2] = z3;
+	m[2][3] = w3;
+	m[3][0] = x4;
+	m[3][1] = y4;
+	m[3][2] = z4;
+	m[3][3] = w4;
+}
+
+inline Matrix::Matrix(const vec3& v1, const vec3& v2, const vec3& v3, const vec3& v4)
+{
+	vec3ToFloatA4(v1, m[0]);
+	vec3ToFloatA4(v2, m[1]);
+	vec3ToFloatA4(v3, m[2]);
+	vec3ToFloatA4(v4, m[3]);
+	m[3][3] = 1;
+}
+
+inline Matrix::Matrix(float mf[4][4])
+{
+	set(mf);
+}
+
+inline Matrix::Matrix(float mf[16])
+{
+	set(mf);
+}
+
+inline void Matrix::set(float mf[4][4])
+{
+	memcpy(m, mf, sizeof(m));
+}
+
+inline void Matrix::set(float mf[16])
+{
+	memcpy(m, mf, sizeof(m));
+}
+
+inline Matrix::Matrix(const vec3& pos, const vec3& rot, const vec3& scale)
+{
+	loadIdentity();
+	setRotation(rot);
+	setScale(scale);
+	setTranslation(pos);
+}
+
+inline void Matrix::clear()
+{
+	memset(&m[0][0], 0, sizeof(m));
+}
+
+inline void Matrix::loadIdentity()
+{
+	clear();
+	m[0][0] = m[1][1] = m[2][2] = m[3][3] = 1;
+}
+
+inline bool Matrix::operator==(const Matrix& mat) const
+{
+	for (int x = 0; x < 4; x++)
+		for (int y = 0; y < 4; y++)
+			if (fabs(m[x][y] - mat.m[x][y]) > EPSILON)
+			{
+				return false;
+			}
+
+	return true;
+}
+
+inline bool Matrix::operator!=(const Matrix& mat) const
+{
+	return !(*this == mat);
+}
+
+inline Matrix Matrix::operator+(const Matrix& mat) const
+{
+	Matrix result(Uninitialized{});
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			result.m[i][j] = m[i][j] + mat.m[i][j];
+		}
+	}
+
+	return result;
+}
+
+/**
+ * The rows of the result are the combinations of our rows, weighted by the rows of mat.
+ */
+inline Matrix Matrix::operator*(const Matrix& mat) const
+{
+	Matrix result(Uninitialized{});
+
+#if defined(USE_GLM)
+	// the rows are glm's columns
+	const glm::mat4 product = glm::make_mat4(&m[0][0]) * glm::make_mat4(&mat.m[0][0]);
+	memcpy(result.m, glm::value_ptr(product), sizeof(m));
+#elif defined(MATH_SSE)
+	const __m128 row0 = _mm_loadu_ps(m[0]);
+	const __m128 row1 = _mm_loadu_ps(m[1]);
+	const __m128 row2 = _mm_loadu_ps(m[2]);
+	const __m128 row3 = _mm_loadu_ps(m[3]);
+
+	for (int i = 0; i < 4; i++)
+	{
+		__m128 row = _mm_mul_ps(_mm_set1_ps(mat.m[i][0]), row0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(mat.m[i][1]), row1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(mat.m[i][2]), row2));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(mat.m[i][3]), row3));
+		_mm_storeu_ps(result.m[i], row);
+	}
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			result.m[i][j] = mat.m[i][0] * m[0][j] + mat.m[i][1] * m[1][j] + mat.m[i][2] * m[2][j] + mat.m[i][3] * m[3][j];
+		}
+	}
+#endif
+
+	return result;
+}
+
+inline vec3 Matrix::operator*(const vec3& v) const
+{
+	float Xh = m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z + m[3][0];
+	float Yh = m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z + m[3][1];
+	float Zh = m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z + m[3][2];
+	float h = m[0][3] * v.x + m[1][3] * v.y + m[2][3] * v.z + m[3][3];
+
+	return vec3(Xh / h, Yh / h, Zh / h);
+}
+
+inline float Matrix::operator[](int index) const
+{
+	return m[index / 4][index % 4];
+}
+
+
+inline void Matrix::setPerspective(float fovY, float aspect, float nearPlane, float farPlane)
+{
+	float height	= 2.0f * nearPlane * tanf(fovY * PI / 360.0f);
+	float width		= height * aspect;
+	float n2		= 2.0f * nearPlane;
+	float rcpnmf	= 1.0f / (nearPlane - farPlane);
+
+	m[0][0] = n2 / width;
+	m[1][0] = 0;
+	m[2][0] = 0;
+	m[3][0] = 0;
+
+	m[0][1] = 0;
+	m[1][1] = n2 / height;
+	m[2][1] = 0;
+	m[3][1] = 0;
+
+	m[0][2] = 0;
+	m[1][2] = 0;
+	m[2][2] = (farPlane + nearPlane) * rcpnmf;
+	m[3][2] = farPlane * rcpnmf * n2;
+
+	m[0][3] = 0;
+	m[1][3] = 0;
+	m[2][3] = -1.f;
+	m[3][3] = 0;
+}
+
+inline void Matrix::setTranslation(const vec3& translation)
+{
+	m[3][0] = translation.x;
+	m[3][1] = translation.y;
+	m[3][2] = translation.z;
+}
+
+inline vec3 Matrix::getTranslation() const
+{
+	return vec3(m[3][0], m[3][1], m[3][2]);
+}
+
+inline void Matrix::setScale(const vec3& scale)
+{
+	Matrix mat = Matrix(scale.x, scale.y, scale.z);
+	*this = *this * mat;
+}
+
+inline void Matrix::setRotation(const vec3& rotation)
+{
+	vec3 rot = rotation;
+	rot *= -PI_DEG;
+
+	float cr = cos(rot.x);
+	float sr = sin(rot.x);
+	float cp = cos(rot.y);
+	float sp = sin(rot.y);
+	float cy = cos(rot.z);
+	float sy = sin(rot.z);
+
+	float srsp = sr * sp;
+	float crsp = cr * sp;
+
+	m[0][0] = (float) (cp * cy);
+	m[1][0] = (float) (cp * sy);
+	m[2][0] = (float) (-sp);
+
+	m[0][1] = (float) (srsp * cy - cr * sy);
+	m[1][1] = (float) (srsp * sy + cr * cy);
+	m[2][1] = (float) (sr * cp);
+
+	m[0][2] = (float) (crsp * cy + sr * sy);
+	m[1][2] = (float) (crsp * sy - sr * cy);
+	m[2][2] = (float) (cr * cp);
+}
+
+inline void Matrix::setInverseRotation(const vec3& rotation)
+{
+	vec3 rot = rotation;
+	rot *= -PI_DEG;
+
+	float cr = cos(rot.x);
+	float sr = sin(rot.x);
+	float cp = cos(rot.y);
+	float sp = sin(rot.y);
+	float cy = cos(rot.z);
+	float sy = sin(rot.z);
+
+	float srsp = sr * sp;
+	float crsp = cr * sp;
+
+	m[0][0] = (float) (cp * cy);
+	m[0][1] = (float) (cp * sy);
+	m[0][2] = (float) (-sp);
+
+	m[1][0] = (float) (srsp * cy - cr * sy);
+	m[1][1] = (float) (srsp * sy + cr * cy);
+	m[1][2] = (float) (sr * cp);
+
+	m[2][0] = (float) (crsp * cy + sr * sy);
+	m[2][1] = (float) (crsp * sy - sr * cy);
+	m[2][2] = (float) (cr * cp);
+}
+
+inline vec3 Matrix::getUpVec() const
+{
+	return vec3(m[0][1], m[1][1], m[2][1]);
+}
+
+inline vec3 Matrix::getRightVec() const
+{
+	return vec3(m[0][0], m[1][0], m[2][0]);
+}
+
+inline vec3 Matrix::getForwardVec() const
+{
+	return vec3(m[0][2], m[1][2], m[2][2]);
+}
+
+/**
+ * Transposing our matrix.
+ */
+inline Matrix Matrix::transpose() const
+{
+	Matrix result(Uninitialized{});
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			result.m[j][i] = m[i][j];
+		}
+	}
+
+	return result;
+}
+
+inline Matrix Matrix::inverse() const
+{
+	Matrix res(Uninitialized{});
+
+	const vec3 T(m[3][0], m[3][1], m[3][2]);
+
+	const vec3 Rx(m[0][0], m[0][1], m[0][2]);
+	const vec3 Ry(m[1][0], m[1][1], m[1][2]);
+	const vec3 Rz(m[2][0], m[2][1], m[2][2]);
+
+	const float Tx = dot(Rx, T);
+	const float Ty = dot(Ry, T);
+	const float Tz = dot(Rz, T);
+
+	res.m[0][0] = m[0][0];
+	res.m[0][1] = m[1][0];
+	res.m[0][2] = m[2][0];
+	res.m[0][3] = 0;
+	res.m[1][0] = m[0][1];
+	res.m[1][1] = m[1][1];
+	res.m[1][2] = m[2][1];
+	res.m[1][3] = 0;
+	res.m[2][0] = m[0][2];
+	res.m[2][1] = m[1][2];
+	res.m[2][2] = m[2][2];
+	res.m[2][3] = 0;
+	res.m[3][0] = Tx;
+	res.m[3][1] = Ty;
+	res.m[3][2] = Tz;
+	res.m[3][3] = 1;
+
+	return res;
+}
+
+/**
+ * Transforming the given vector with our matrix.
+ */
+inline vec3 Matrix::transform(const vec3& v) const
+{
+#if defined(USE_GLM)
+	return vec3(glm::make_mat4(&m[0][0]) * glm::vec4(v, 1.0f));
+#elif defined(MATH_SSE)
+	__m128 result = _mm_mul_ps(_mm_set1_ps(v.x), _mm_loadu_ps(m[0]));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(v.y), _mm_loadu_ps(m[1])));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(v.z), _mm_loadu_ps(m[2])));
+	result = _mm_add_ps(result, _mm_loadu_ps(m[3]));
+
+	float out[4];
+	_mm_storeu_ps(out, result);
+	return vec3(out[0], out[1], out[2]);
+#else
+	return vec3(v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0] + m[3][0], v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1] + m[3][1], v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2] + m[3][2]);
+#endif
+}
+
+/**
+ * Transforming the given vector with our matrix's upper left 3x3 corner.
+ */
+inline vec3 Matrix::transform3x3(const vec3& v) const
+{
+	return vec3(v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0], v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1], v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2]);
+}
+
+/**
+ * Transforming the given vector with our matrix's inverse.
+ */
+inline vec3 Matrix::invTransform(const vec3& v) const
+{
+	return vec3(v.x * m[0][0] + v.y * m[0][1] + v.z * m[0][2] + m[0][3], v.x * m[1][0] + v.y * m[1][1] + v.z * m[1][2] + m[1][3], v.x * m[2][0] + v.y * m[2][1] + v.z * m[2][2] + m[2][3]);
+}
+
+/**
+ * Transforming the given vector with our matrix's inverse upper left 3x3 corner.
+ */
+inline vec3 Matrix::invTransform3x3(const vec3& v) const
+{
+	return vec3(v.x * m[0][0] + v.y * m[0][1] + v.z * m[0][2], v.x * m[1][0] + v.y * m[1][1] + v.z * m[1][2], v.x * m[2][0] + v.y * m[2][1] + v.z * m[2][2]);
+}
+
+/**
+ * Transforming the given points with our matrix (transform() of every point).
+ */
+inline void Matrix::transformArray(const vec3* pIn, vec3* pOut, size_t count) const
+{
+	transformArrayImpl<true>(pIn, pOut, count);
+}
+
+/**
+ * Transforming the given directions with our matrix's upper left 3x3 corner (transform3x3() of every direction).
+ */
+inline void Matrix::transform3x3Array(const vec3* pIn, vec3* pOut, size_t count) const
+{
+	transformArrayImpl<false>(pIn, pOut, count);
+}
+
+template <bool hasTranslation>
+inline void Matrix::transformArrayImpl(const vec3* pIn, vec3* pOut, size_t count) const
+{
+	size_t i = 0;
+
+#if defined(USE_GLM)
+	const glm::mat4 mat = glm::make_mat4(&m[0][0]);
+	for (; i < count; i++)
+	{
+		pOut[i] = vec3(mat * glm::vec4(pIn[i], hasTranslation ? 1.0f : 0.0f));
+	}
+#else
+	static_assert(sizeof(vec3) == 3 * sizeof(float), "the vectors are read as packed floats");
+
+#if defined(MATH_AVX)
+	// 8 vectors at a time: 3 loads, the x, y, z lanes are shuffled apart (and back after the transform)
+	const __m256 m00 = _mm256_set1_ps(m[0][0]), m01 = _mm256_set1_ps(m[0][1]), m02 = _mm256_set1_ps(m[0][2]);
+	const __m256 m10 = _mm256_set1_ps(m[1][0]), m11 = _mm256_set1_ps(m[1][1]), m12 = _mm256_set1_ps(m[1][2]);
+	const __m256 m20 = _mm256_set1_ps(m[2][0]), m21 = _mm256_set1_ps(m[2][1]), m22 = _mm256_set1_ps(m[2][2]);
+	const __m256 m30 = _mm256_set1_ps(hasTranslation ? m[3][0] : 0.0f);
+	const __m256 m31 = _mm256_set1_ps(hasTranslation ? m[3][1] : 0.0f);
+	const __m256 m32 = _mm256_set1_ps(hasTranslation ? m[3][2] : 0.0f);
+
+	for (; i + 8 <= count; i += 8)
+	{
+		const float* pSrc = &pIn[i].x;
+		float* pDst = &pOut[i].x;
+
+		__m256 m03 = _mm256_castps128_ps256(_mm_loadu_ps(pSrc));
+		__m256 m14 = _mm256_castps128_ps256(_mm_loadu_ps(pSrc + 4));
+		__m256 m25 = _mm256_castps128_ps256(_mm_loadu_ps(pSrc + 8));
+		m03 = _mm256_insertf128_ps(m03, _mm_loadu_ps(pSrc + 12), 1);
+		m14 = _mm256_insertf128_ps(m14, _mm_loadu_ps(pSrc + 16), 1);
+		m25 = _mm256_insertf128_ps(m25, _mm_loadu_ps(pSrc + 20), 1);
+
+		const __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+		const __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+		const __m256 x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+		const __m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+		const __m256 z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+
+		const __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m00), _mm256_mul_ps(y, m10)), _mm256_add_ps(_mm256_mul_ps(z, m20), m30));
+		const __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m01), _mm256_mul_ps(y, m11)), _mm256_add_ps(_mm256_mul_ps(z, m21), m31));
+		const __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m02), _mm256_mul_ps(y, m12)), _mm256_add_ps(_mm256_mul_ps(z, m22), m32));
+
+		const __m256 rxy = _mm256_shuffle_ps(rx, ry, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 ryz = _mm256_shuffle_ps(ry, rz, _MM_SHUFFLE(3, 1, 3, 1));
+		const __m256 rzx = _mm256_shuffle_ps(rz, rx, _MM_SHUFFLE(3, 1, 2, 0));
+		const __m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+		const __m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+
+		_mm_storeu_ps(pDst, _mm256_castps256_ps128(r03));
+		_mm_storeu_ps(pDst + 4, _mm256_castps256_ps128(r14));
+		_mm_storeu_ps(pDst + 8, _mm256_castps256_ps128(r25));
+		_mm_storeu_ps(pDst + 12, _mm256_extractf128_ps(r03, 1));
+		_mm_storeu_ps(pDst + 16, _mm256_extractf128_ps(r14, 1));
+		_mm_storeu_ps(pDst + 20, _mm256_extractf128_ps(r25, 1));
+	}
+#endif
+
+#if defined(MATH_SSE)
+	const __m128 row0 = _mm_loadu_ps(m[0]);
+	const __m128 row1 = _mm_loadu_ps(m[1]);
+	const __m128 row2 = _mm_loadu_ps(m[2]);
+	const __m128 row3 = hasTranslation ? _mm_loadu_ps(m[3]) : _mm_setzero_ps();
+
+	for (; i < count; i++)
+	{
+		__m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pIn[i].x), row0), row3);
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(pIn[i].y), row1));
+		result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(pIn[i].z), row2));
+
+		// 3 floats: the next vector may not be read yet (in place)
+		_mm_storel_pi(reinterpret_cast<__m64*>(&pOut[i].x), result);
+		_mm_store_ss(&pOut[i].z, _mm_movehl_ps(result, result));
+	}
+#else
+	for (; i < count; i++)
+	{
+		pOut[i] = hasTranslation ? transform(pIn[i]) : transform3x3(pIn[i]);
+	}
+#endif
+#endif // USE_GLM
+}
+
+inline float* Matrix::getArray() const
+{
+	return (float*)(&m[0][0]);
+}
+
+inline void Matrix::toArray(float matrixArray[16]) const
+{
+	memcpy(matrixArray, &m[0][0], 16 * sizeof(float));
+}
+
+inline vec3 transformVector(const vec3& v, const vec3& trans, vec3 rot)
+{
+	Matrix mat;
+	mat.setInverseRotation(rot);
+	mat.setTranslation(trans);
+
+	return mat * v;
+}
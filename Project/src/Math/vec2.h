@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Math/mathDefs.h"
+
 #ifdef USE_GLM
 typedef glm::vec2 vec2;
 
@@ -72,7 +74,7 @@ public:
 	//----------------------------------------------------------
 	// Special Operations
 	void normalize();
-	vec2 normalized();
+	vec2 normalized() const;
 
 	float dot(const vec2& v) const;
 	vec2 rotate(float angle) const;
@@ -92,9 +94,291 @@ public:
 };
 
 // compatible with glm
-float dot(const vec2& v1, const vec2& v2);
-vec2 normalize(const vec2& v1);
+inline float dot(const vec2& v1, const vec2& v2);
+inline vec2 normalize(const vec2& v1);
+
+inline vec2 operator*(float f, const vec2& v)
+{
+	return v * f;
+}
+
+inline vec2::vec2()
+{
+	x = y = 0;
+}
+
+inline vec2::vec2(float a)
+{
+	set(a);
+}
+
+inline vec2::vec2(float a, float b)
+{
+	set(a, b);
+}
+
+inline vec2::vec2(float t[2])
+{
+	set(t);
+}
+
+inline void vec2::set(float a)
+{
+	x = y = a;
+}
+
+inline void vec2::set(float a, float b)
+{
+	x = a;
+	y = b;
+}
+
+inline void vec2::set(float t[2])
+{
+	x = t[0];
+	y = t[1];
+}
+
+// Unary minus
+
+inline vec2 vec2::operator-() const
+{
+	vec2 v;
+	v.x = -x;
+	v.y = -y;
+
+	return v;
+}
+
+//----------------------------------------------------------
+// Scalar multiplication
+
+inline vec2 vec2::operator*(float f) const
+{
+	return vec2(x * f, y * f);
+}
+
+inline vec2 vec2::operator*(const vec2& v) const
+{
+	return vec2(x * v.x, y * v.y);
+}
+
+// Scalar division
+
+inline vec2 vec2::operator/(float f) const
+{
+	return vec2(x / f, y / f);
+}
+
+inline vec2 vec2::operator/(const vec2& v) const
+{
+	return vec2(x / v.x, y / v.y);
+}
+
+//----------------------------------------------------------
+// vec2 Arithmetic Operations
+
+inline vec2 vec2::operator+(const vec2& v) const
+{
+	vec2 result;
+	result.x = x + v.x;
+	result.y = y + v.y;
+
+	return result;
+}
+
+inline vec2 vec2::operator-(const vec2& v) const
+{
+	vec2 result;
+	result.x = x - v.x;
+	result.y = y - v.y;
+
+	return result;
+}
+
+//----------------------------------------------------------
+// Shorthand Ops
+
+inline vec2& vec2::operator*=(float c)
+{
+	x *= c;
+	y *= c;
+
+	return *this;
+}
+
+inline vec2& vec2::operator/=(float c)
+{
+	x /= c;
+	y /= c;
+
+	return *this;
+}
+
+inline vec2& vec2::operator*=(const vec2& v)
+{
+	x *= v.x;
+	y *= v.y;
+
+	return *this;
+}
+
+inline vec2& vec2::operator/=(const vec2& v)
+{
+	x /= v.x;
+	y /= v.y;
+
+	return *this;
+}
+
+inline vec2& vec2::operator+=(const vec2& v)
+{
+	x += v.x;
+	y += v.y;
+
+	return *this;
+}
+
+inline vec2& vec2::operator-=(const vec2& v)
+{
+	x -= v.x;
+	y -= v.y;
+
+	return *this;
+}
+
+inline bool vec2::operator==(const vec2& v) const
+{
+	return (fabs(x - v.x) < EPSILON) && (fabs(y - v.y) < EPSILON);
+}
+
+inline bool vec2::operator!=(const vec2& v) const
+{
+	return (fabs(x - v.x) > EPSILON) || (fabs(y - v.y) > EPSILON);
+}
+
+inline float vec2::operator[](int i) const
+{
+	switch (i)
+	{
+		case 0:
+			return x;
+		case 1:
+			return y;
+	}
+	return 0;
+}
+
+//----------------------------------------------------------
+// vec2 Properties
+
+inline vec2 vec2::abs()
+{
+	return vec2(fabs(x), fabs(y));
+}
+
+inline float vec2::length() const
+{
+	return sqrt(x * x + y * y);
+}
+
+inline float vec2::length2() const
+{
+	return (x * x + y * y);
+}
+
+inline void vec2::setLength(float l)
+{
+	float len = length();
+	x *= l / len;
+	y *= l / len;
+}
+
+//----------------------------------------------------------
+// Special Operations
+
+inline void vec2::normalize()
+{
+	const float len = length();
+	if (len == 0)
+	{
+		return;
+	}
+
+	x /= len;
+	y /= len;
+}
+
+inline vec2 vec2::normalized() const
+{
+	vec2 result(x, y);
+
+	const float len = result.length();
+	if (len == 0)
+	{
+		return vec2(0.0f);
+	}
+
+	result.x /= len;
+	result.y /= len;
+
+	return result;
+}
+
+inline float vec2::dot(const vec2& v) const
+{
+	return (x * v.x + y * v.y);
+}
+
+inline vec2 vec2::rotate(float angle) const
+{
+	const float theta = angle * PI_DEG;
+
+	const float cs = cos(theta);
+	const float sn = sin(theta);
+
+	return vec2(x * cs - y * sn, x * sn + y * cs);
+}
+
+inline vec2 vec2::interpolate(vec2 v, float t) const
+{
+	const float inv_t = 1.0f - t;
+
+	v.x = x * inv_t + v.x * t;
+	v.y = y * inv_t + v.y * t;
+
+	return v;
+}
+
+inline bool vec2::isZeroVector() const
+{
+	if ((fabs(x) < EPSILON) && (fabs(y) < EPSILON))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+inline float dot(const vec2& v1, const vec2& v2)
+{
+	return v1.dot(v2);
+}
+
+inline vec2 normalize(const vec2& v)
+{
+	return v.normalized();
+}
 
 #endif // USE_GLM
 
-vec2 interpolate(const vec2& v1, vec2 v, float t);
+inline vec2 interpolate(const vec2& v1, vec2 v2, float t)
+{
+	const float inv_t = 1.0f - t;
+
+	v2.x = v1.x * inv_t + v2.x * t;
+	v2.y = v1.y * inv_t + v2.y * t;
+
+	return v2;
+}
+
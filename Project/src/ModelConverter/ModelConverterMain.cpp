@@ -0,0 +1,174 @@
+#include "GameStdAfx.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Models/3ds/Model3ds.h"
+#include "Models/md2/ModelMd2.h"
+#include "Models/md5/ModelMd5.h"
+
+
+/**
+ * Bakes the models into the binary files loaded instead of them: the text md5 models into .md5bin files
+ * (md5bin::Header), the md2 and 3ds models into .md2bin and .3dsbin files (meshbin::Header).
+ *
+ *     CrimsonModelConverter <model.md5mesh> [<clip.md5anim> ...] [-o <model.md5bin>]
+ *     CrimsonModelConverter <model.md2|model.3ds> [-o <model.md2bin|model.3dsbin>]
+ *
+ * The baked model is written next to the mesh by default, an md5 one has every clip given.
+ */
+static void printUsage(std::ostream& out)
+{
+	out << "usage: CrimsonModelConverter <model.md5mesh> [<clip.md5anim> ...] [-o <model.md5bin>]" << std::endl;
+	out << "       CrimsonModelConverter <model.md2|model.3ds> [-o <model.md2bin|model.3dsbin>]" << std::endl;
+	out << "  bakes the mesh (and the clips of an md5 mesh) into a binary model, next to the mesh by default" << std::endl;
+	out << "  md2: the frames with their normals and tangents, 3ds: the welded vertex and index buffers" << std::endl;
+}
+
+static bool bakeMd2(const std::string& meshFile, const std::string& outputFile)
+{
+	TexturePool textures("textures");
+
+	models::ModelMd2 model;
+	if (!model.load(meshFile.c_str(), textures, true))
+	{
+		std::cerr << "can't load " << meshFile << std::endl;
+		return false;
+	}
+
+	if (!model.saveBinary(outputFile.c_str()))
+	{
+		std::cerr << "can't write " << outputFile << std::endl;
+		return false;
+	}
+
+	std::cout << outputFile << std::endl;
+
+	return true;
+}
+
+static bool bake3ds(const std::string& meshFile, const std::string& outputFile)
+{
+	TexturePool textures("textures");
+
+	models::Model3ds model;
+	if (!model.loadFile(meshFile.c_str(), textures, true))
+	{
+		std::cerr << "can't load " << meshFile << std::endl;
+		return false;
+	}
+
+	if (!model.saveBinary(outputFile.c_str()))
+	{
+		std::cerr << "can't write " << outputFile << std::endl;
+		return false;
+	}
+
+	std::cout << outputFile << ": " << model.getNumObjects() << " objects, " << model.getNumPolygons() << " triangles" << std::endl;
+
+	return true;
+}
+
+static bool bakeMd5(const std::string& meshFile, const std::vector<std::string>& animFiles, const std::string& outputFile)
+{
+	models::ModelMd5Resource resource;
+	if (!resource.loadMesh(meshFile.c_str()))
+	{
+		std::cerr << "can't load " << meshFile << std::endl;
+		return false;
+	}
+
+	for (const std::string& animFile : animFiles)
+	{
+		if (!resource.loadAnim(animFile.c_str()))
+		{
+			std::cerr << "can't load " << animFile << std::endl;
+			return false;
+		}
+	}
+
+	if (!resource.saveBinary(outputFile.c_str()))
+	{
+		std::cerr << "can't write " << outputFile << std::endl;
+		return false;
+	}
+
+	std::cout << outputFile << ": " << resource.getNumMeshes() << " meshes, " << resource.getNumJoints() << " joints, " << animFiles.size() << " clips" << std::endl;
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string meshFile;
+	std::string outputFile;
+	std::vector<std::string> animFiles;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		std::string extension = utils::file::getExtension(arg);
+		utils::toLowerCase(extension);
+
+		if (arg == "-o" && i + 1 < argc)
+		{
+			outputFile = argv[++i];
+		}
+		else if (arg == "-h" || arg == "--help")
+		{
+			printUsage(std::cout);
+			return EXIT_SUCCESS;
+		}
+		else if ((extension == "md5mesh" || extension == "md2" || extension == "3ds") && meshFile.empty())
+		{
+			meshFile = arg;
+		}
+		else if (extension == "md5anim")
+		{
+			animFiles.push_back(arg);
+		}
+		else
+		{
+			printUsage(std::cerr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::string meshExtension = utils::file::getExtension(meshFile);
+	utils::toLowerCase(meshExtension);
+
+	// the clips are baked into the md5 models only
+	if (meshFile.empty() || (meshExtension != "md5mesh" && !animFiles.empty()))
+	{
+		printUsage(std::cerr);
+		return EXIT_FAILURE;
+	}
+
+	// where the loaders look for them (Mesh::getBakedFile())
+	if (outputFile.empty())
+	{
+		outputFile = meshExtension == "md5mesh" ? utils::file::getDir(meshFile) + utils::file::getFileName(meshFile) + ".md5bin" : meshFile + "bin";
+	}
+
+	new LoggerSystem(LogLevel::ERR);
+	new TraceRecorder();
+
+	bool isBaked = false;
+	if (meshExtension == "md2")
+	{
+		isBaked = bakeMd2(meshFile, outputFile);
+	}
+	else if (meshExtension == "3ds")
+	{
+		isBaked = bake3ds(meshFile, outputFile);
+	}
+	else
+	{
+		isBaked = bakeMd5(meshFile, animFiles, outputFile);
+	}
+
+	// the logger flushes what is left
+	TraceRecorder::destroyInstance();
+	LoggerSystem::destroyInstance();
+
+	return isBaked ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,8 +1,13 @@
 #include "GameStdAfx.h"
 #include "Models/3ds/Model3ds.h"
 
+#include "Common/BakedFile.h"
 #include "Common/LuaManager.h"
 #include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Graphics/TextureCache.h"
+#include "Models/mesh/MeshBinary.h"
+#include "Models/mesh/MeshOptimizer.h"
 
 
 namespace models
@@ -11,30 +16,38 @@ namespace models
 #define debugging 0
 
 
-Model3ds::Model3ds() : m_pVertexOffsets(nullptr), m_pVerticesArray(nullptr)
+Model3ds::Model3ds()
 {
 }
 
 Model3ds::~Model3ds()
 {
-	SAFEDEL2(m_pVertexOffsets);
-	SAFEDEL2(m_pVerticesArray);
 	//MQLOG("dest Model3ds", 0);
 }
 
-bool Model3ds::loadFile(const char* filename, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const bool justData)
+bool Model3ds::loadFile(const char* filename, TexturePool& textures, const bool justData)
 {
+	// the baked buffers have no objects to collide with
+	if (!justData)
+	{
+		const std::string bakedFile = getBakedFile(filename);
+		if (!bakedFile.empty() && loadBinary(bakedFile.c_str(), textures))
+		{
+			return true;
+		}
+	}
+
 	uint numMaterials = 0;
 	std::vector<Material3ds> materialsv;
 
-	std::ifstream file;
-
-	file.open(filename, std::ifstream::in | std::ifstream::binary);
-	if (!file.is_open())
+	// from the mounted asset pack or the disk
+	std::string data;
+	if (!utils::file::readFile(filename, data))
 	{
 		TRACE_ERROR("\tError: Cannot open 3ds file " << filename << ".", 0);
 		return false;
 	}
+	std::istringstream file(data, std::ios::in | std::ios::binary);
 
 	// get file length
 	file.seekg(0, std::ios::end);
@@ -119,7 +132,6 @@ bool Model3ds::loadFile(const char* filename, MeshDirectory& meshDirectory, Text
 				file.seekg(chunkInfo.lenght - 6, std::ios::cur);
 		}
 	}
-	file.close();
 
 	for (uint o_i = 0; o_i < m_numObjects; o_i++)
 	{
@@ -155,39 +167,29 @@ bool Model3ds::loadFile(const char* filename, MeshDirectory& meshDirectory, Text
 		return true;
 	}
 
-	loadTextures(filename, textureDirectory);
-	buildVBOBuffers();
+	loadTextures(filename, getTextureNames(), textures);
+
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+	buildMeshData(vertices, indices);
+	buildVBOBuffers(vertices.data(), vertices.size(), indices.data(), indices.size());
 
 	m_objectTextureCache.clear();
 
 	return true;
 }
 
-void Model3ds::buildVBOBuffers()
+void Model3ds::buildMeshData(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
 {
 	vec3* tmpPolyNormals	= new vec3[getNumPolygons()];
 	vec3* tmpVertNormals	= new vec3[getNumVertices()];
-	m_pVerticesArray		= new Vertex[getNumPolygons() * 3];
-
-	m_pVertexOffsets = new int[m_numObjects];
+	Vertex* pTriangleVertices = new Vertex[getNumPolygons() * 3];
 
 
 	uint v_i = 0;
 	uint n_i = 0;
 	uint tp_i = 0;
 
-	for (uint o_i = 0; o_i < m_numObjects; o_i++)
-	{
-		if (o_i == 0)
-		{
-			m_pVertexOffsets[o_i] = 0;
-		}
-		else
-		{
-			m_pVertexOffsets[o_i] = m_pVertexOffsets[o_i - 1] + m_objects[o_i]->m_numTriangles * 3;
-		}
-	}
-
 	// filling up the vertex and texcoord arrays
 	for (uint o_i = 0; o_i < m_numObjects; o_i++)
 	{
@@ -196,32 +198,32 @@ void Model3ds::buildVBOBuffers()
 			// vertex 1
 			const poly3& currentTriangle = m_objects[o_i]->m_pTriangles[p_i];
 
-			m_pVerticesArray[v_i].pos = m_objects[o_i]->m_pVertices[currentTriangle.a];
+			pTriangleVertices[v_i].pos = m_objects[o_i]->m_pVertices[currentTriangle.a];
 
-			m_pVerticesArray[v_i].texcoord.u = m_objects[o_i]->m_pTexcoords[currentTriangle.a].u;
-			m_pVerticesArray[v_i].texcoord.v = m_objects[o_i]->m_pTexcoords[currentTriangle.a].v;
+			pTriangleVertices[v_i].texcoord.u = m_objects[o_i]->m_pTexcoords[currentTriangle.a].u;
+			pTriangleVertices[v_i].texcoord.v = m_objects[o_i]->m_pTexcoords[currentTriangle.a].v;
 
 			// vertex 2
-			m_pVerticesArray[v_i + 1].pos = m_objects[o_i]->m_pVertices[currentTriangle.b];
+			pTriangleVertices[v_i + 1].pos = m_objects[o_i]->m_pVertices[currentTriangle.b];
 
-			m_pVerticesArray[v_i + 1].texcoord.u = m_objects[o_i]->m_pTexcoords[currentTriangle.b].u;
-			m_pVerticesArray[v_i + 1].texcoord.v = m_objects[o_i]->m_pTexcoords[currentTriangle.b].v;
+			pTriangleVertices[v_i + 1].texcoord.u = m_objects[o_i]->m_pTexcoords[currentTriangle.b].u;
+			pTriangleVertices[v_i + 1].texcoord.v = m_objects[o_i]->m_pTexcoords[currentTriangle.b].v;
 
 			// vertex 3
-			m_pVerticesArray[v_i + 2].pos = m_objects[o_i]->m_pVertices[currentTriangle.c];
+			pTriangleVertices[v_i + 2].pos = m_objects[o_i]->m_pVertices[currentTriangle.c];
 
-			m_pVerticesArray[v_i + 2].texcoord.u = m_objects[o_i]->m_pTexcoords[currentTriangle.c].u;
-			m_pVerticesArray[v_i + 2].texcoord.v = m_objects[o_i]->m_pTexcoords[currentTriangle.c].v;
+			pTriangleVertices[v_i + 2].texcoord.u = m_objects[o_i]->m_pTexcoords[currentTriangle.c].u;
+			pTriangleVertices[v_i + 2].texcoord.v = m_objects[o_i]->m_pTexcoords[currentTriangle.c].v;
 
 			// computing the polygon's tangent and bitangent vector
 			vec3 tangent, bitangent;
-			calculateTangent(m_pVerticesArray[v_i].pos, m_pVerticesArray[v_i + 1].pos, m_pVerticesArray[v_i + 2].pos, m_pVerticesArray[v_i].texcoord, m_pVerticesArray[v_i + 1].texcoord, m_pVerticesArray[v_i + 2].texcoord, tangent, bitangent);
-			m_pVerticesArray[v_i].tangent = m_pVerticesArray[v_i + 1].tangent = m_pVerticesArray[v_i + 2].tangent = tangent;
-			m_pVerticesArray[v_i].bitangent = m_pVerticesArray[v_i + 1].bitangent = m_pVerticesArray[v_i + 2].bitangent = bitangent;
+			calculateTangent(pTriangleVertices[v_i].pos, pTriangleVertices[v_i + 1].pos, pTriangleVertices[v_i + 2].pos, pTriangleVertices[v_i].texcoord, pTriangleVertices[v_i + 1].texcoord, pTriangleVertices[v_i + 2].texcoord, tangent, bitangent);
+			pTriangleVertices[v_i].tangent = pTriangleVertices[v_i + 1].tangent = pTriangleVertices[v_i + 2].tangent = tangent;
+			pTriangleVertices[v_i].bitangent = pTriangleVertices[v_i + 1].bitangent = pTriangleVertices[v_i + 2].bitangent = bitangent;
 
 			// computing the polygon's normal
-			const vec3 v1 = m_pVerticesArray[v_i + 1].pos - m_pVerticesArray[v_i].pos;
-			const vec3 v2 = m_pVerticesArray[v_i + 2].pos - m_pVerticesArray[v_i].pos;
+			const vec3 v1 = pTriangleVertices[v_i + 1].pos - pTriangleVertices[v_i].pos;
+			const vec3 v2 = pTriangleVertices[v_i + 2].pos - pTriangleVertices[v_i].pos;
 
 			tmpPolyNormals[tp_i] = cross(v1, v2);
 			tmpPolyNormals[tp_i] = normalize(tmpPolyNormals[tp_i]);
@@ -267,62 +269,84 @@ void Model3ds::buildVBOBuffers()
 		{
 			const poly3& currentTriangle = m_objects[o_i]->m_pTriangles[p_i];
 
-			m_pVerticesArray[n_i].normal		= tmpVertNormals[tp_i + currentTriangle.a];
-			m_pVerticesArray[n_i + 1].normal	= tmpVertNormals[tp_i + currentTriangle.b];
-			m_pVerticesArray[n_i + 2].normal	= tmpVertNormals[tp_i + currentTriangle.c];
+			pTriangleVertices[n_i].normal		= tmpVertNormals[tp_i + currentTriangle.a];
+			pTriangleVertices[n_i + 1].normal	= tmpVertNormals[tp_i + currentTriangle.b];
+			pTriangleVertices[n_i + 2].normal	= tmpVertNormals[tp_i + currentTriangle.c];
 
 			n_i += 3;
 		}
 		tp_i += m_objects[o_i]->m_numVertices;
 	}
 
+	// the corners of the triangles welded: indexed, the triangles of the objects in the order of the vertex cache
+	std::vector<uint> numObjectVertices(m_numObjects);
+	for (uint o_i = 0; o_i < m_numObjects; o_i++)
+	{
+		numObjectVertices[o_i] = m_objects[o_i]->m_numTriangles * 3;
+	}
+
+	MeshOptimizer::build(pTriangleVertices, numObjectVertices, vertices, indices, m_subsets);
+
+	delete[] tmpPolyNormals;
+	delete[] tmpVertNormals;
+	delete[] pTriangleVertices;
+}
+
+void Model3ds::buildVBOBuffers(const Vertex* pVertices, const size_t numVertices, const GLuint* pIndices, const size_t numIndices)
+{
 	glGenBuffers(1, &m_verticesVboId);
 	glBindBuffer(GL_ARRAY_BUFFER, m_verticesVboId);
-	glBufferData(GL_ARRAY_BUFFER, getNumPolygons() * 3 * sizeof(Vertex), m_pVerticesArray, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Vertex), pVertices, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	delete[] tmpPolyNormals;
-	delete[] tmpVertNormals;
+	glGenBuffers(1, &m_indicesVboId);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indicesVboId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), pIndices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+std::vector<std::string> Model3ds::getTextureNames() const
+{
+	std::vector<std::string> textureNames(m_numObjects);
+	if (m_objectTextureCache.empty())
+	{
+		return textureNames;
+	}
+
+	// the material is resolved for the last object, the others take it too
+	std::string texturename(m_objectTextureCache[m_numObjects - 1].m_textureName);
+	utils::toLowerCase(texturename);	// Max stores the texture names in upper case letters
+
+	for (uint o_i = 0; o_i < m_numObjects; o_i++)
+	{
+		textureNames[o_i] = texturename;
+	}
+
+	return textureNames;
 }
 
-bool Model3ds::loadTextures(const char* location, TextureDirectory& textureDirectory)
+bool Model3ds::loadTextures(const char* location, const std::vector<std::string>& textureNames, TexturePool& textures)
 {
+	const std::string locationtemp = utils::file::getDir(location);
+
 	for (uint o_i = 0; o_i < m_numObjects; o_i++)
 	{
-		if (m_objectTextureCache[m_numObjects - 1].m_textureName[0] == 0)
+		if (textureNames[o_i].empty())
 		{
 			continue;
 		}
 
-		std::string texturename(m_objectTextureCache[m_numObjects - 1].m_textureName);
-		const std::string locationtemp = utils::file::getDir(location);
-		utils::toLowerCase(texturename);
-		//strupr((char*)texturename.c_str());
-
-		/*	##
-		 for (int i = 0; i < texturename.length(); i++) {
-		 // Max stores the texture names in upper case letters
-		 if (isalpha(texturename[i]) && isupper(texturename[i])) {
-		 texturename[i] += 32; // lower -> upper
-		 }
-		 }
-		 */
-
-		std::string textemp = locationtemp + texturename;
+		std::string textemp = locationtemp + textureNames[o_i];
 
 		if (textemp.length() > locationtemp.length())
 		{
 			// texture map
-			loadTexture((char*) textemp.c_str(), m_objects[o_i]->m_decalMap, textureDirectory);
+			m_objects[o_i]->m_decalMap = addTexture(textures, graphics::TextureCache::acquireTexture(textemp, textures));
 
-			// normalheight map
+			// normalheight map, no nh texture -> 0: the blank texture
 			std::string nhtemp = locationtemp + utils::file::getFileName(textemp) + "_nh.png";
 
-			if (!loadTexture((char*) nhtemp.c_str(), m_objects[o_i]->m_normalHeightMap, textureDirectory))
-			{
-				// no nh texture -> use the blank texture
-				m_objects[o_i]->m_normalHeightMap = 0;
-			}
+			m_objects[o_i]->m_normalHeightMap = addTexture(textures, graphics::TextureCache::acquireTexture(nhtemp, textures));
 		}
 
 
@@ -331,46 +355,120 @@ bool Model3ds::loadTextures(const char* location, TextureDirectory& textureDirec
 	return true;
 }
 
-void Model3ds::render()
+bool Model3ds::saveBinary(const char* filename)
 {
-	uint v_i = 0;
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+	buildMeshData(vertices, indices);
+
+	const std::vector<std::string> textureNames = getTextureNames();
 
-	std::vector<Object*>::iterator it = m_objects.begin();
-	while (it != m_objects.end())
+	std::vector<meshbin::Object> objects(m_numObjects);
+	std::vector<meshbin::Subset> subsets(m_numObjects);
+	for (uint o_i = 0; o_i < m_numObjects; o_i++)
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, (*it)->m_decalMap);
+		copyName(m_objects[o_i]->m_name, objects[o_i].name);
+		copyName(textureNames[o_i], objects[o_i].texture);
+		objects[o_i].numVertices = m_objects[o_i]->m_numVertices;
+		objects[o_i].numTriangles = m_objects[o_i]->m_numTriangles;
 
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, (*it)->m_normalHeightMap);
+		subsets[o_i].first = m_subsets[o_i].first;
+		subsets[o_i].count = m_subsets[o_i].count;
+	}
 
-		glDrawArrays(GL_TRIANGLES, v_i, (*it)->m_numTriangles * 3);
-		v_i += (*it)->m_numTriangles * 3;
+	BakedFileWriter writer(sizeof(meshbin::Header), meshbin::MESHBIN_ALIGNMENT);
 
-		++it;
-	}
+	meshbin::Header header = {};
+	header.magic = meshbin::MESHBIN_MAGIC;
+	header.version = meshbin::MESHBIN_VERSION;
+	header.type = meshbin::TYPE_3DS;
+	header.vertexSize = sizeof(Vertex);
+
+	header.numObjects = m_numObjects;
+	header.objectsOffset = writer.append(objects);
+
+	header.numVertices = (uint32_t)vertices.size();
+	header.numIndices = (uint32_t)indices.size();
+	header.verticesOffset = writer.append(vertices);
+	header.indicesOffset = writer.append(indices);
+	header.subsetsOffset = writer.append(subsets);
+
+	header.fileSize = writer.getSize();
+	writer.write(0, &header, 1);
+
+	return writer.save(filename);
 }
 
-void Model3ds::renderSubset(const uint subset)
+/**
+ * Loads a baked model: the buffers are uploaded from the file mapping, without a copy.
+ */
+bool Model3ds::loadBinary(const char* filename, TexturePool& textures)
 {
-	// drawing
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_objects[subset]->m_decalMap);
+	TRACE_ZONE("Model3ds::loadBinary");
 
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, m_objects[subset]->m_normalHeightMap);
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		return false;
+	}
 
-	int v_i = 0;
-	uint i = 0;
-	std::vector<Object*>::iterator it = m_objects.begin();
-	while (i < subset)
+	const meshbin::Header* pHeader = file.getArray<meshbin::Header>(0, 1);
+	if (!pHeader || pHeader->magic != meshbin::MESHBIN_MAGIC || pHeader->version != meshbin::MESHBIN_VERSION || pHeader->fileSize != file.getSize()
+		|| pHeader->type != meshbin::TYPE_3DS)
 	{
-		v_i += (*it)->m_numTriangles * 3;
-		i++;
-		++it;
+		TRACE_ERROR(filename << " is not a baked 3ds model of version " << meshbin::MESHBIN_VERSION << ", bake it again.", 0);
+		return false;
 	}
 
-	glDrawArrays(GL_TRIANGLES, v_i, m_objects[subset]->m_numTriangles * 3);
+	const meshbin::Header& header = *pHeader;
+	if (header.vertexSize != sizeof(Vertex))
+	{
+		TRACE_ERROR(filename << " was baked with an other vertex layout, bake it again.", 0);
+		return false;
+	}
+
+	const meshbin::Object* pObjects = file.getArray<meshbin::Object>(header.objectsOffset, header.numObjects);
+	const meshbin::Subset* pSubsets = file.getArray<meshbin::Subset>(header.subsetsOffset, header.numObjects);
+	const Vertex* pVertices = file.getArray<Vertex>(header.verticesOffset, header.numVertices);
+	const GLuint* pIndices = file.getArray<GLuint>(header.indicesOffset, header.numIndices);
+
+	// the render uses them unchecked
+	bool isValid = pObjects && pSubsets && pVertices && pIndices;
+	for (uint32_t i = 0; i < header.numIndices && isValid; i++)
+	{
+		isValid = pIndices[i] < header.numVertices;
+	}
+	for (uint32_t o_i = 0; o_i < header.numObjects && isValid; o_i++)
+	{
+		isValid = pSubsets[o_i].first >= 0 && pSubsets[o_i].count >= 0 && (uint64_t)pSubsets[o_i].first + pSubsets[o_i].count <= header.numIndices;
+	}
+
+	if (!isValid)
+	{
+		TRACE_ERROR(filename << " is corrupt, bake it again.", 0);
+		return false;
+	}
+
+	std::vector<std::string> textureNames(header.numObjects);
+	m_subsets.resize(header.numObjects);
+	for (uint32_t o_i = 0; o_i < header.numObjects; o_i++)
+	{
+		Object* pObject = new Object();
+		pObject->m_name = readName(pObjects[o_i].name);
+		pObject->m_numVertices = pObjects[o_i].numVertices;
+		pObject->m_numTriangles = pObjects[o_i].numTriangles;
+		addObject(pObject);
+
+		textureNames[o_i] = readName(pObjects[o_i].texture);
+
+		m_subsets[o_i].first = pSubsets[o_i].first;
+		m_subsets[o_i].count = pSubsets[o_i].count;
+	}
+
+	loadTextures(filename, textureNames, textures);
+	buildVBOBuffers(pVertices, header.numVertices, pIndices, header.numIndices);
+
+	return true;
 }
 
 
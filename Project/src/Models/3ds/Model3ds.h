@@ -71,39 +71,42 @@ class Model3ds : public Mesh
 
 
 public:
-	static bool load(const char* meshFile, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const char* name, const bool justData = false);
+	static bool load(const char* meshFile, MeshDirectory& meshDirectory, TexturePool& textures, const char* name, const bool justData = false);
 
 	Model3ds();
 	~Model3ds();
 
-	bool loadFile(const char* filename, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const bool justData = false);
+	// the .3dsbin baked from the file if it is newer (justData: the objects with their vertices, from the 3ds file)
+	bool loadFile(const char* filename, TexturePool& textures, const bool justData = false);
 
-	virtual void render();
-	virtual void renderSubset(const uint subset);
+	// the welded buffers of a model loaded with justData (meshbin::Header)
+	bool saveBinary(const char* filename);
+	bool loadBinary(const char* filename, TexturePool& textures);
 
 	// register to lua
 	static void registerMethodsToLua();
 
 
 private:
-	void loadObjectBlock(std::ifstream* file);
-	void loadVertexBlock(std::ifstream* file);
-	void loadPolygonBlock(std::ifstream* file);
-	void loadTextureBlock(std::ifstream* file, std::vector<Material3ds>& materialsv);
-	void loadTexCoordsBlock(std::ifstream* file);
-	void loadMaterialIdsBlock(std::ifstream* file, std::vector<Material3ds>& materialsv);
-	void loadMaterialNamesBlock(std::ifstream* file);
-
-
-	bool loadTextures(const char* location, TextureDirectory& textureDirectory);
+	void loadObjectBlock(std::istream* file);
+	void loadVertexBlock(std::istream* file);
+	void loadPolygonBlock(std::istream* file);
+	void loadTextureBlock(std::istream* file, std::vector<Material3ds>& materialsv);
+	void loadTexCoordsBlock(std::istream* file);
+	void loadMaterialIdsBlock(std::istream* file, std::vector<Material3ds>& materialsv);
+	void loadMaterialNamesBlock(std::istream* file);
+
+
+	// the texture file of each object, "" if it has none
+	std::vector<std::string> getTextureNames() const;
+	bool loadTextures(const char* location, const std::vector<std::string>& textureNames, TexturePool& textures);
 	void calculateTangentArray();
-	void buildVBOBuffers();
+	void buildMeshData(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+	void buildVBOBuffers(const Vertex* pVertices, const size_t numVertices, const GLuint* pIndices, const size_t numIndices);
 
 
 protected:
 	uint	m_numTexcoords;
-	int*	m_pVertexOffsets;
-	Vertex* m_pVerticesArray;
 
 	std::vector<ObjectTextureCache> m_objectTextureCache;
 };
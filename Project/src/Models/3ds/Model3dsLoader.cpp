@@ -1,15 +1,18 @@
 #include "GameStdAfx.h"
 #include "Models/3ds/Model3ds.h"
+#include "Common/TraceRecorder.h"
 
 
 namespace models
 {
 
-bool Model3ds::load(const char* meshFile, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const char* name, const bool justData)
+bool Model3ds::load(const char* meshFile, MeshDirectory& meshDirectory, TexturePool& textures, const char* name, const bool justData)
 {
+	TRACE_ZONE("Model3ds::load");
+
 	Model3ds* model = new Model3ds();
 
-	if (model->loadFile(meshFile, meshDirectory, textureDirectory, justData))
+	if (model->loadFile(meshFile, textures, justData))
 	{
 		meshDirectory[name] = model;
 
@@ -28,7 +31,7 @@ bool Model3ds::load(const char* meshFile, MeshDirectory& meshDirectory, TextureD
 // Chunk ID: 4000(hex)
 // Chunk Lenght: len(object name) + sub chunks
 //-------------------------------------------
-void Model3ds::loadObjectBlock(std::ifstream* file)
+void Model3ds::loadObjectBlock(std::istream* file)
 {
 	uint8_t* pChar = new uint8_t;
 
@@ -57,7 +60,7 @@ void Model3ds::loadObjectBlock(std::ifstream* file)
 //			+ 3 x float(vertex coordinates) x(number of vertices)
 //			+ sub chunks
 //-------------------------------------------
-void Model3ds::loadVertexBlock(std::ifstream* file)
+void Model3ds::loadVertexBlock(std::istream* file)
 {
 	unsigned short* pQty = new unsigned short;
 
@@ -84,7 +87,7 @@ void Model3ds::loadVertexBlock(std::ifstream* file)
 //			+ 3 x unsigned short(polygon points) x(number of polygons)
 //			+ sub chunks
 //-------------------------------------------
-void Model3ds::loadPolygonBlock(std::ifstream* file)
+void Model3ds::loadPolygonBlock(std::istream* file)
 {
 	unsigned short* pQty = new unsigned short;
 	unsigned short* pShort = new unsigned short;
@@ -123,7 +126,7 @@ void Model3ds::loadPolygonBlock(std::ifstream* file)
 // Chunk Lenght: KITOLTENI
 // Desc : dealing with only one texture per material
 //-------------------------------------------
-void Model3ds::loadTextureBlock(std::ifstream* file, std::vector<Material3ds>& materialsv)
+void Model3ds::loadTextureBlock(std::istream* file, std::vector<Material3ds>& materialsv)
 {
 	uint8_t* pChar = new uint8_t;
 
@@ -148,7 +151,7 @@ void Model3ds::loadTextureBlock(std::ifstream* file, std::vector<Material3ds>& m
 //			+ 2 x float(mapping coordinates) x(number of mapping points)
 //			+ sub chunks
 //-------------------------------------------
-void Model3ds::loadTexCoordsBlock(std::ifstream* file)
+void Model3ds::loadTexCoordsBlock(std::istream* file)
 {
 	unsigned short* pQty = new unsigned short;
 
@@ -172,7 +175,7 @@ void Model3ds::loadTexCoordsBlock(std::ifstream* file)
 // Chunk ID: A000(hex)
 // Chunk Lenght: KITOLTENI
 //-------------------------------------------
-void Model3ds::loadMaterialIdsBlock(std::ifstream* file, std::vector<Material3ds>& materialsv)
+void Model3ds::loadMaterialIdsBlock(std::istream* file, std::vector<Material3ds>& materialsv)
 {
 	uint8_t* pChar = new uint8_t;
 
@@ -195,7 +198,7 @@ void Model3ds::loadMaterialIdsBlock(std::ifstream* file, std::vector<Material3ds
 // Chunk ID: 4130(hex)
 // Chunk Lenght: KITOLTENI
 //-------------------------------------------
-void Model3ds::loadMaterialNamesBlock(std::ifstream* file)
+void Model3ds::loadMaterialNamesBlock(std::istream* file)
 {
 	unsigned short* pQty = new unsigned short;
 	uint8_t* pChar = new uint8_t;
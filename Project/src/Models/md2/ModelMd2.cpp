@@ -1,5 +1,10 @@
 #include "GameStdAfx.h"
 #include "Models/md2/ModelMd2.h"
+#include "Common/BakedFile.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Graphics/TextureCache.h"
+#include "Models/mesh/MeshBinary.h"
 
 #include <algorithm>
 
@@ -12,16 +17,19 @@ namespace models
 // Magic number
 #define MD2_MAGIC_NUM	(('2'<<24) + ('P'<<16) + ('D'<<8) + 'I')
 
-bool ModelMd2::load(const char* meshFile, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const char* name, const bool justData)
+bool ModelMd2::load(const char* meshFile, MeshDirectory& meshDirectory, TexturePool& textures, const char* name, const bool justData)
 {
+	TRACE_ZONE("ModelMd2::load");
+
 	ModelMd2* model = new ModelMd2();
 
-	if (model->load(meshFile, textureDirectory, justData))
+	if (model->load(meshFile, textures, justData))
 	{
 		meshDirectory[name] = model;
 		return true;
 	}
 
+	delete model;
 	return false;
 }
 
@@ -121,6 +129,8 @@ void ModelMd2::copy(const ModelMd2& other)
 	m_normalMap = other.m_normalMap;
 	m_heightMap = other.m_heightMap;
 	m_normalHeightMap = other.m_normalHeightMap;
+	m_skinName = other.m_skinName;
+	copyTextures(other);
 
 	m_time = 0;
 	m_animationSpeed = 1;
@@ -158,29 +168,29 @@ bool filter(char c)
 	return c == '"' || c == '_';
 }
 
-bool ModelMd2::load(const char* filename, TextureDirectory& textureDirectory, const bool justData)
+bool ModelMd2::load(const char* filename, TexturePool& textures, const bool justData)
 {
-	std::ifstream file(filename, std::ios::in | std::ios::binary);
+	TRACE_ZONE("ModelMd2::load");
 
-	if (file.fail())
+	const std::string bakedFile = getBakedFile(filename);
+	if (!bakedFile.empty() && loadBinary(bakedFile.c_str(), textures, justData))
 	{
-		return false;
+		return true;
 	}
 
-	int fileSize;
-	file.seekg(0, std::ios::end);
-	fileSize = file.tellg();
-	file.seekg(0, std::ios::beg);
+	// from the mounted asset pack (a view if it is stored) or the disk, without a copy
+	MappedFile file;
+	if (!file.open(filename) || file.getSize() < sizeof(Header))
+	{
+		return false;
+	}
 
-	char* buffer = new char[fileSize];
-	file.read((char*) buffer, fileSize);
-	file.close();
+	const char* buffer = reinterpret_cast<const char*>(file.getData());
 
 	// header
-	Header* header = reinterpret_cast<Header*>(buffer);
+	const Header* header = reinterpret_cast<const Header*>(buffer);
 	if ((header->magic != MD2_MAGIC_NUM) && (header->version != 8))
 	{
-		file.close();
 		return false;
 	}
 
@@ -225,14 +235,14 @@ bool ModelMd2::load(const char* filename, TextureDirectory& textureDirectory, co
 #include "anorms.h"
 	};
 
-	FrameMd2* frame;
+	const FrameMd2* frame;
 	std::string lastname;
 	std::string filteredLastname;
 
 	// animációk, vertexek kiolvasása, beállítása
 	for (int i = 0; i < numFrames; i++)
 	{
-		frame = (FrameMd2*) &buffer[ header->offsetFrames + i * header->frameSize ];
+		frame = (const FrameMd2*) &buffer[ header->offsetFrames + i * header->frameSize ];
 
 		// az azonos nevű frameket egy animációba pakoljuk (pl. stand_1, stand_2 ...)
 		if (lastname == "" || strncmp(lastname.c_str(), frame->name, lastname.size()) > 0)
@@ -282,6 +292,29 @@ bool ModelMd2::load(const char* filename, TextureDirectory& textureDirectory, co
 		}
 	}
 
+	buildTriangleArrays();
+
+	// the name of the texture is usually not stored n the file
+	if (header->numSkins > 0 && header->offsetSkins >= 0 && (size_t)header->offsetSkins + 64 <= file.getSize())
+	{
+		char textureNameTmp[64];
+		memcpy(textureNameTmp, &buffer[header->offsetSkins], 64 * sizeof(char));
+
+		m_skinName = readName(textureNameTmp);
+		utils::toLowerCase(m_skinName);
+	}
+
+	// load textures
+	if (!justData)
+	{
+		loadTextures(filename, textures);
+	}
+
+	return true;
+}
+
+void ModelMd2::buildTriangleArrays()
+{
 	int v_i = 0;
 	for (int j = 0; j < m_numTriangles; j++)
 	{
@@ -295,38 +328,169 @@ bool ModelMd2::load(const char* filename, TextureDirectory& textureDirectory, co
 
 		v_i += 3;
 	}
+}
 
-	// load textures
-	if (!justData)
+void ModelMd2::loadTextures(const char* location, TexturePool& textures)
+{
+	std::string locationtemp = utils::file::getDir(std::string(location));
+	std::string textemp = locationtemp + m_skinName;
+
+	if (textemp.length() > locationtemp.length())
 	{
-		// the name of the texture is usually not stored n the file
-		char textureNameTmp[64];
-		memcpy(textureNameTmp, &buffer[header->offsetSkins], 64 * sizeof(char));
+		// texture map
+		m_decalMap = addTexture(textures, graphics::TextureCache::acquireTexture(textemp, textures));
 
+		// normalheight map, no nh texture -> 0: the blank texture
+		std::string nhtemp = locationtemp + utils::file::getFileName(textemp) + "_nh.png";
 
-		std::string locationtemp = utils::file::getDir(std::string(filename));
-		std::string textureName(textureNameTmp);
-		utils::toLowerCase(textureName);
+		m_normalHeightMap = addTexture(textures, graphics::TextureCache::acquireTexture(nhtemp, textures));
+	}
+}
 
-		std::string textemp = locationtemp + textureName;
+bool ModelMd2::saveBinary(const char* filename) const
+{
+	// the clips are in the order of the frames
+	int numFrames = 0;
+	std::vector<meshbin::Anim> anims;
+	for (const auto& entry : m_animations)
+	{
+		meshbin::Anim record = {};
+		copyName(entry.first, record.name);
+		record.start = entry.second.start;
+		record.end = entry.second.end;
+		anims.push_back(record);
 
-		if (textemp.length() > locationtemp.length())
-		{
-			// texture map
-			loadTexture((char*) textemp.c_str(), m_decalMap, textureDirectory);
+		numFrames = std::max(numFrames, entry.second.start + entry.second.end + 1);
+	}
 
-			// normalheight map
-			std::string nhtemp = locationtemp + utils::file::getFileName(textemp) + "_nh.png";
+	meshbin::Object object = {};
+	copyName(m_skinName, object.texture);
+	object.numVertices = m_numVertices;
+	object.numTriangles = m_numTriangles;
 
-			if (!loadTexture((char*) nhtemp.c_str(), m_normalHeightMap, textureDirectory))
-			{
-				// no nh texture -> use the blank texture
-				m_normalHeightMap = 0;
-			}
+	static_assert(sizeof(TriangleMd2) == sizeof(meshbin::Triangle), "the md2 triangle is stored as it is");
+
+	BakedFileWriter writer(sizeof(meshbin::Header), meshbin::MESHBIN_ALIGNMENT);
+
+	meshbin::Header header = {};
+	header.magic = meshbin::MESHBIN_MAGIC;
+	header.version = meshbin::MESHBIN_VERSION;
+	header.type = meshbin::TYPE_MD2;
+	header.vertexSize = sizeof(Vertex);
+
+	header.numObjects = 1;
+	header.objectsOffset = writer.append(&object, 1);
+
+	header.numFrames = numFrames;
+	header.numFrameVertices = m_numVertices;
+	header.numTexcoords = m_numTexCoords;
+	header.numTriangles = m_numTriangles;
+	header.numAnims = (uint32_t)anims.size();
+
+	const size_t numFrameVertices = (size_t)numFrames * m_numVertices;
+	header.positionsOffset = writer.append(m_pVertices, numFrameVertices);
+	header.normalsOffset = writer.append(m_pNormals, numFrameVertices);
+	header.tangentsOffset = writer.append(m_pTangents, numFrameVertices);
+	header.texcoordsOffset = writer.append(m_pTexcoords, m_numTexCoords);
+	header.trianglesOffset = writer.append(reinterpret_cast<const meshbin::Triangle*>(m_pTriangles), m_numTriangles);
+	header.animsOffset = writer.append(anims);
+
+	header.fileSize = writer.getSize();
+	writer.write(0, &header, 1);
+
+	return writer.save(filename);
+}
+
+/**
+ * Loads a baked model: the frames are copied from the file mapping, only the corners of the triangles are computed.
+ */
+bool ModelMd2::loadBinary(const char* filename, TexturePool& textures, const bool justData)
+{
+	TRACE_ZONE("ModelMd2::loadBinary");
+
+	MappedFile file;
+	if (!file.open(filename))
+	{
+		return false;
+	}
+
+	const meshbin::Header* pHeader = file.getArray<meshbin::Header>(0, 1);
+	if (!pHeader || pHeader->magic != meshbin::MESHBIN_MAGIC || pHeader->version != meshbin::MESHBIN_VERSION || pHeader->fileSize != file.getSize()
+		|| pHeader->type != meshbin::TYPE_MD2)
+	{
+		TRACE_ERROR(filename << " is not a baked md2 model of version " << meshbin::MESHBIN_VERSION << ", bake it again.", 0);
+		return false;
+	}
+
+	const meshbin::Header& header = *pHeader;
+	const size_t numFrameVertices = (size_t)header.numFrames * header.numFrameVertices;
+
+	const meshbin::Object* pObject = file.getArray<meshbin::Object>(header.objectsOffset, 1);
+	const vec3* pPositions = file.getArray<vec3>(header.positionsOffset, numFrameVertices);
+	const vec3* pNormals = file.getArray<vec3>(header.normalsOffset, numFrameVertices);
+	const vec3* pTangents = file.getArray<vec3>(header.tangentsOffset, numFrameVertices);
+	const texCoord* pTexcoords = file.getArray<texCoord>(header.texcoordsOffset, header.numTexcoords);
+	const meshbin::Triangle* pTriangles = file.getArray<meshbin::Triangle>(header.trianglesOffset, header.numTriangles);
+	const meshbin::Anim* pAnims = file.getArray<meshbin::Anim>(header.animsOffset, header.numAnims);
+
+	// the animation and the render use them unchecked
+	bool isValid = header.numObjects == 1 && pObject && pPositions && pNormals && pTangents && pTexcoords && pTriangles && pAnims;
+	for (uint32_t j = 0; j < header.numTriangles && isValid; j++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			isValid = isValid && pTriangles[j].vertIdx[k] >= 0 && (uint32_t)pTriangles[j].vertIdx[k] < header.numFrameVertices
+				&& pTriangles[j].texIdx[k] >= 0 && (uint32_t)pTriangles[j].texIdx[k] < header.numTexcoords;
 		}
 	}
+	for (uint32_t i = 0; i < header.numAnims && isValid; i++)
+	{
+		isValid = pAnims[i].start >= 0 && pAnims[i].end >= 0 && (uint64_t)pAnims[i].start + pAnims[i].end < header.numFrames;
+	}
 
-	delete[] buffer;
+	if (!isValid)
+	{
+		TRACE_ERROR(filename << " is corrupt, bake it again.", 0);
+		return false;
+	}
+
+	m_numVertices = header.numFrameVertices;
+	m_numTexCoords = header.numTexcoords;
+	m_numTriangles = header.numTriangles;
+
+	m_pTexcoords = new texCoord[m_numTexCoords];
+	std::copy(pTexcoords, pTexcoords + m_numTexCoords, m_pTexcoords);
+
+	m_pTriangles = new TriangleMd2[m_numTriangles];
+	memcpy(m_pTriangles, pTriangles, m_numTriangles * sizeof(TriangleMd2));
+
+	m_pVertices = new vec3[numFrameVertices];
+	m_pNormals = new vec3[numFrameVertices];
+	m_pTangents = new vec3[numFrameVertices];
+	std::copy(pPositions, pPositions + numFrameVertices, m_pVertices);
+	std::copy(pNormals, pNormals + numFrameVertices, m_pNormals);
+	std::copy(pTangents, pTangents + numFrameVertices, m_pTangents);
+
+	m_pVertexArray = new vec3[m_numTriangles * 3];
+	m_pNormalArray = new vec3[m_numTriangles * 3];
+	m_pTangentArray = new vec3[m_numTriangles * 3];
+	m_pTexcoordArray = new texCoord[m_numTriangles * 3];
+
+	m_numAnims = header.numAnims;
+	for (uint32_t i = 0; i < header.numAnims; i++)
+	{
+		AnimMd2& anim = m_animations[readName(pAnims[i].name)];
+		anim.start = pAnims[i].start;
+		anim.end = pAnims[i].end;
+	}
+
+	buildTriangleArrays();
+
+	m_skinName = readName(pObject->texture);
+	if (!justData)
+	{
+		loadTextures(filename, textures);
+	}
 
 	return true;
 }
@@ -23,7 +23,7 @@ protected:
 
 
 public:
-	static bool load(const char* meshFile, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const char* name, const bool justData = false);
+	static bool load(const char* meshFile, MeshDirectory& meshDirectory, TexturePool& textures, const char* name, const bool justData = false);
 
 	ModelMd2();
 	~ModelMd2();
@@ -33,7 +33,12 @@ public:
 
 	void copy(const ModelMd2& other);
 
-	bool load(const char* filename, TextureDirectory& textureDirectory, const bool justData = false);
+	// the .md2bin baked from the file if it is newer
+	bool load(const char* filename, TexturePool& textures, const bool justData = false);
+
+	// the frames and the clips of a loaded model (meshbin::Header)
+	bool saveBinary(const char* filename) const;
+	bool loadBinary(const char* filename, TexturePool& textures, const bool justData = false);
 
 
 	virtual void animate(const float dt);
@@ -50,11 +55,18 @@ public:
 	virtual void setFrameTime(float time);
 
 
+protected:
+	// the normals and texcoords of the corners of the triangles
+	void buildTriangleArrays();
+	void loadTextures(const char* location, TexturePool& textures);
+
+
 protected:
 	GLuint									m_decalMap;
 	GLuint									m_normalMap;
 	GLuint									m_heightMap;
 	GLuint									m_normalHeightMap;
+	std::string								m_skinName;		// the texture file, "" if the model names none
 
 	int										m_numTriangles;
 	TriangleMd2*							m_pTriangles;
@@ -2,7 +2,7 @@
 
 #include <imageLoad.h>
 
-#include "Models/md5/Skeleton.h"
+#include "Models/md5/ModelMd5Resource.h"
 #include "Models/mesh/AnimatedMesh.h"
 
 
@@ -15,30 +15,52 @@ class ModelMd5 : public AnimatedMesh
 
 	// member structure declarations
 private:
-	struct JointInfoMd5;
-	struct MeshMd5;
-	struct AnimMd5;
+	struct AnimMd5Info;
 
 
 public:
-	static bool load(const char* meshFile, const char* animFile, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const char* name = "", const bool justData = false);
+	// the size of the joint palette of skinning.vert (its MAX_BONE_COUNT), the models with more joints are skinned on the cpu
+	static const uint MAX_GPU_JOINTS = 100;
+
+	// the animation lods: 0 updates the pose every tick, every level halves the update rate and the blend steps,
+	// MAX_ANIMATION_LOD is the off-screen one
+	static const uint MAX_ANIMATION_LOD = 3;
+
+	static bool load(const char* meshFile, const char* animFile, MeshDirectory& meshDirectory, TexturePool& textures, const char* name = "", const bool justData = false);
+
+	// load() on the AssetLoader: the model is returned right away, empty until the loaded one is uploaded (its copies too)
+	static ModelMd5* loadAsync(const std::string& meshFile, const std::string& animFile);
 
 	ModelMd5();
+	ModelMd5(const std::shared_ptr<ModelMd5Resource>& pResource);
 	~ModelMd5();
 
+	// a new instance of the model: it shares the resource, only the animation state and the buffers are its own
 	ModelMd5* copy();
 
-	// mesh
-	bool loadMesh(const char* filename, TextureDirectory& textureDirectory, bool justSkeleton = false);	// justSkeleton for the server
-	// anim
-	bool loadAnim(const char* filename);
+	virtual void preRender(const GLuint program, const bool bindVbos = true);
+	virtual void postRender() const;
 
 	virtual void render();
 	virtual void renderSubset(const uint subset);
 	virtual void renderSkeleton();
 
+	virtual bool isGpuSkinnable() const;
+
 	virtual void animate(const float dt);
 
+	// evaluates the poses of the models animated since the last call, each missing pose once (in parallel)
+	static void updatePoses();
+
+	// a new frame of the render pass: the models not rendered in it are off screen at the next animate()
+	static void beginRenderFrame() { s_renderFrame++; }
+
+	// cpu skinning of every mesh to the current frame, without the upload: the meshes follow each other in vertices
+	void skinMeshes(std::vector<Vertex>& vertices) const;
+	void skinMeshesAoS(std::vector<Vertex>& vertices) const;
+
+	static void skinModels(const std::vector<const ModelMd5*>& models, std::vector<std::vector<Vertex>>& vertices, const bool isParallel = true);
+
 
 	virtual void kill();
 
@@ -50,210 +72,110 @@ public:
 		return m_pCurrentFrame;
 	}
 
+	const std::shared_ptr<ModelMd5Resource>& getResource() const
+	{
+		return m_pResource;
+	}
+
 	virtual float getFrame() const;
 	virtual void setFrame(float time);
 
 	virtual float getFrameTime() const;
 	virtual void setFrameTime(float time);
 
+	uint getAnimationLod() const
+	{
+		return m_animationLod;
+	}
+
+	// animate() sets it from the last rendered frame, these are for the models animated without a render pass
+	void setAnimationLod(const uint animationLod);
+	void setAnimationLodByDistance(const float distance, const bool isVisible);
+
+	virtual void setCameraDistance(const float distance) { m_cameraDistance = distance; }
+
 
 private:
-	void normalizeVertexGroups();
+	ModelMd5(const ModelMd5& other);
+	ModelMd5& operator=(const ModelMd5& other);
 
-	void computeWeightNormals();
-	void computeWeightTangents();
+	void setupBuffers();
 
-	bool buildFrameSkeleton(AnimMd5& anim, JointInfoMd5* pJointInfos, std::vector<JointMd5>& baseFrameJoints, const float* pAnimFrameData, int frameIndex);
+	// the baked model next to the text one if there is one, else the text one (nullptr if neither loads)
+	static std::shared_ptr<ModelMd5Resource> loadResource(const char* meshFile, const char* animFile, const bool justData);
 
-	void prepareMesh(const MeshMd5& mesh, std::vector<JointMd5>& skeleton);
-	void interpolateSkeletons(AnimMd5& anim, int frame1, int frame2, float interp);
+	// an other resource for the model (the loaded one of a placeholder): the animation state starts again
+	void setResource(const std::shared_ptr<ModelMd5Resource>& pResource);
 
+	// the instances of the placeholder get the loaded resource (they stay empty without one)
+	static void finishLoading(ModelMd5Resource* pPlaceholder, const std::shared_ptr<ModelMd5Resource>& pResource);
 
-private:
-	uint									m_numJoints;
-	uint									m_numMeshes;
+	void skinMesh(const MeshMd5& mesh, const std::vector<JointMd5>& skeleton, Vertex* pVertices) const;
+	void prepareMesh(const uint meshIndex);
+	const std::vector<Vertex>& getSkinnedVertices();
+
+	void applyPose();
+
+	void updateJointPalette();
 
-	std::vector<JointMd5>					m_joints;
-	std::vector<MeshMd5>					m_meshes;
+	void computeSkinPalette(const std::vector<JointMd5>& skeleton, AlignedVector<float>& palette) const;
+	void skinVertexGroups(const uint meshIndex, const float* pPalette, const uint firstGroup, const uint endGroup, Vertex* pVertices) const;
+
+
+private:
+	std::shared_ptr<ModelMd5Resource>		m_pResource;
 
-	FrameMd5*								m_pBaseFrame;
 	FrameMd5*								m_pCurrentFrame;
 
-	uint									m_maxVertices;
-	uint									m_maxTriangles;
+	// the pose shown (shared with the instances at the same clip time) and the one to show after the next updatePoses()
+	std::shared_ptr<PoseMd5>				m_pPose;
+	PoseKeyMd5								m_poseKey;
+	bool									m_isPosePending;
 
-	// TODO
-	GLuint*									m_pVertexIndices;
-	Vertex*									m_pVertexArrayDynamic;
+	uint									m_animationLod;
+	uint									m_numSkippedUpdates;
 
+	// what the render pass saw of the instance: its distance to the camera, the last frame it was rendered in
+	float									m_cameraDistance;
+	uint									m_lastRenderFrame;
 
-	// animations and ragdoll
-	std::map<const std::string, AnimMd5>	m_animations;
+	// the cpu skinned meshes without a pose (no animation), the mesh in the dynamic vbo
+	std::vector<Vertex>						m_skinnedVertices;
+	int										m_uploadedMesh;
 
+	// gpu skinning: the joint palette of the current frame
+	bool									m_isGpuSkinned;
+	bool									m_hasPaletteChanged;
 
-#ifdef GX_DEBUG_INFO
-	std::string				m_debug_animFileName;
-#endif
+	std::vector<Matrix>						m_jointPalette;
 
+	GLint									m_bonesLoc;
+	GLint									m_boneIdsLoc;
+	GLint									m_boneWeightsLoc;
 
-// member structure definitions
-private:
-	// structs
-	struct VertexMd5
-	{
-		//vert vertIndex ( s t ) startWeight countWeight
-		int			weightIndex;
-		int			weightCount;
+	// cpu skinning
+	static const uint						SKIN_GROUPS_PER_JOB = 32;
 
-		texCoord	texCoord;
-	};
 
-	struct JointInfoMd5
-	{
-		//"name" parent flags startIndex
-		std::string	name;
-		int			parent;
-		int			flags;
-		int			startIndex;
-	};
+	// the playback of the animation clips of the resource
+	std::map<const std::string, AnimMd5Info>	m_animInfos;
 
-	struct Weight
-	{
-		int			joint;
-		float		w;
-		vec3		pos;
-		vec3		normal;
-		vec3		tangent;
-		vec3		bitangent;
-	};
+	static std::vector<ModelMd5*>			s_pendingPoses;
 
-	struct MeshMd5
-	{
-		GLuint		texid;
-		GLuint		normalMap;
-		GLuint		heightMap;
-		GLuint		normalHeightMap;
-
-		uint		numVertices;
-		uint		numTriangles;
-		uint		numWeights;
-
-		VertexMd5*	pVertices;
-		poly3*		pTriangles;
-		Weight*		pWeights;
-
-		MeshMd5()
-			: texid(0)
-			, normalMap(0)
-			, heightMap(0)
-			, normalHeightMap(0)
-
-			, numVertices(0)
-			, numTriangles(0)
-			, numWeights(0)
-
-			, pVertices(nullptr)
-			, pTriangles(nullptr)
-			, pWeights(nullptr)
-		{
-		}
+	// the instances of the placeholders of loadAsync()
+	static std::vector<ModelMd5*>			s_loadingModels;
 
-		MeshMd5(const MeshMd5& o)
-		{
-			texid = o.texid;
-			normalMap = o.normalMap;
-			heightMap = o.heightMap;
-			normalHeightMap = o.normalHeightMap;
-
-			numVertices = o.numVertices;
-			numTriangles = o.numTriangles;
-			numWeights = o.numWeights;
-
-			if (numVertices > 0)
-			{
-				pVertices = new VertexMd5[numVertices];
-			}
-
-			for (uint i = 0; i < numVertices; i++)
-			{
-				pVertices[i] = o.pVertices[i];
-			}
-
-			if (numTriangles > 0)
-			{
-				pTriangles = new poly3[numTriangles];
-			}
-
-			for (uint i = 0; i < numTriangles; i++)
-			{
-				pTriangles[i] = o.pTriangles[i];
-			}
-
-			if (numWeights > 0)
-			{
-				pWeights = new Weight[numWeights];
-			}
-
-			for (uint i = 0; i < numWeights; i++)
-			{
-				pWeights[i] = o.pWeights[i];
-			}
-		}
+	// 0 without a render pass (the tools, the benchmarks): the lods are set by hand there
+	static uint								s_renderFrame;
 
-		MeshMd5& operator=(const MeshMd5& o)
-		{
-			if (this != &o)
-			{
-				texid = o.texid;
-				normalMap = o.normalMap;
-				heightMap = o.heightMap;
-				normalHeightMap = o.normalHeightMap;
-
-				numVertices = o.numVertices;
-				numTriangles = o.numTriangles;
-				numWeights = o.numWeights;
-
-				if (numVertices > 0)
-				{
-					pVertices = new VertexMd5[numVertices];
-				}
-
-				for (uint i = 0; i < numVertices; i++)
-				{
-					pVertices[i] = o.pVertices[i];
-				}
-
-				if (numTriangles > 0)
-				{
-					pTriangles = new poly3[numTriangles];
-				}
-
-				for (uint i = 0; i < numTriangles; i++)
-				{
-					pTriangles[i] = o.pTriangles[i];
-				}
-
-				if (numWeights > 0)
-				{
-					pWeights = new Weight[numWeights];
-				}
-
-				for (uint i = 0; i < numWeights; i++)
-				{
-					pWeights[i] = o.pWeights[i];
-				}
-			}
-			return *this;
-		}
 
-		~MeshMd5()
-		{
-			SAFEDEL2(pVertices);
-			SAFEDEL2(pTriangles);
-			SAFEDEL2(pWeights);
-		}
-	};
+#ifdef GX_DEBUG_INFO
+	std::string				m_debug_animFileName;
+#endif
 
+
+// member structure definitions
+private:
 	struct AnimMd5Info
 	{
 		int		currentFrame;
@@ -270,24 +192,6 @@ private:
 		}
 	};
 
-	struct AnimMd5
-	{
-		uint					numFrames;
-		uint					frameRate;
-		AnimMd5Info				animInfo;
-		std::vector<FrameMd5>	frames;
-
-		AnimMd5()
-			: numFrames(0)
-			, frameRate(0)
-		{
-		}
-
-		~AnimMd5()
-		{
-		}
-	};
-
 
 
 public:
@@ -297,4 +201,3 @@ public:
 };
 
 } // namespace models
-
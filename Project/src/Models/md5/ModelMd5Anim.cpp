@@ -1,12 +1,13 @@
 #include "GameStdAfx.h"
 #include "Models/md5/ModelMd5.h"
+#include "Common/JobPool.h"
+#include "Common/TraceRecorder.h"
 
 namespace models
 {
 
-bool ModelMd5::loadAnim(const char* filename)
+bool ModelMd5Resource::loadAnim(const char* filename)
 {
-	FILE* fp = nullptr;
 	char buff[512];
 
 	JointInfoMd5* pJointInfos = nullptr;
@@ -19,26 +20,27 @@ bool ModelMd5::loadAnim(const char* filename)
 
 	uint i;
 
-	fp = fopen(filename, "rb");
-	if (!fp)
+	// from the mounted asset pack or the disk
+	std::string data;
+	if (!utils::file::readFile(filename, data))
 	{
 		fprintf(stderr, "error: couldn't open \"%s\"!\n", filename);
 		return 0;
 	}
+	std::istringstream file(data);
 
 	m_animations[utils::file::getFileName(filename)] = AnimMd5();
 	AnimMd5* pAnim = &m_animations[utils::file::getFileName(filename)];
 
-	while (!feof(fp))
+	while (file)
 	{
-		fgets(buff, sizeof(buff), fp);
+		utils::file::getLine(file, buff, sizeof(buff));
 
 		if (sscanf(buff, " MD5Version %d", &version) == 1)
 		{
 			if (version != 10)
 			{
 				fprintf(stderr, "Error: bad animation version\n");
-				fclose(fp);
 				return 0;
 			}
 		}
@@ -61,7 +63,6 @@ bool ModelMd5::loadAnim(const char* filename)
 		}
 		else if (sscanf(buff, " frameRate %d", &pAnim->frameRate) == 1)
 		{
-			pAnim->animInfo.maxTime = 1.0 / pAnim->frameRate;
 			// printf ("md5anim: animation's frame rate is %d\n", anim->frameRate);
 		}
 		else if (sscanf(buff, " numAnimatedComponents %d", &numAnimatedComponents) == 1)
@@ -77,7 +78,7 @@ bool ModelMd5::loadAnim(const char* filename)
 			for (i = 0; i < m_numJoints; ++i)
 			{
 				// Read whole line
-				fgets(buff, sizeof(buff), fp);
+				utils::file::getLine(file, buff, sizeof(buff));
 				char name[64];
 				// Read joint info
 				sscanf(buff, " %63s %d %d %d", name, &pJointInfos[i].parent, &pJointInfos[i].flags, &pJointInfos[i].startIndex);
@@ -103,7 +104,7 @@ bool ModelMd5::loadAnim(const char* filename)
 			for (i = 0; i < pAnim->numFrames; ++i)
 			{
 				// Read whole line
-				fgets(buff, sizeof(buff), fp);
+				utils::file::getLine(file, buff, sizeof(buff));
 
 				pAnim->frames[i] = FrameMd5(m_numJoints);
 				// Read bounding box
@@ -118,7 +119,7 @@ bool ModelMd5::loadAnim(const char* filename)
 			for (i = 0; i < m_numJoints; ++i)
 			{
 				// Read whole line
-				fgets(buff, sizeof(buff), fp);
+				utils::file::getLine(file, buff, sizeof(buff));
 
 				// Read base frame joint
 				JointMd5& baseFrameJoint = baseFrameJoints[i];
@@ -134,14 +135,13 @@ bool ModelMd5::loadAnim(const char* filename)
 			// Read frame data
 			for (i = 0; i < (uint) numAnimatedComponents; ++i)
 			{
-				fscanf(fp, "%f", &pAnimFrameData[i]);
+				file >> pAnimFrameData[i];
 			}
 
 			// Build frame skeleton from the collected data
 			buildFrameSkeleton(*pAnim, pJointInfos, baseFrameJoints, pAnimFrameData, frameIndex);
 		}
 	}
-	fclose(fp);
 
 	// Free temporary data allocated
 	SAFEDEL2(pAnimFrameData);
@@ -155,15 +155,13 @@ bool ModelMd5::loadAnim(const char* filename)
 
 		computeWeightNormals();
 		computeWeightTangents();
-
-		m_pCurrentFrame = new FrameMd5();
-		*m_pCurrentFrame = *m_pBaseFrame;
+		buildSkinWeights();
 	}
 
 	return true;
 }
 
-bool ModelMd5::buildFrameSkeleton(AnimMd5& anim, JointInfoMd5* pJointInfos, std::vector<JointMd5>& baseFrameJoints, const float* pAnimFrameData, int frameIndex)
+bool ModelMd5Resource::buildFrameSkeleton(AnimMd5& anim, JointInfoMd5* pJointInfos, std::vector<JointMd5>& baseFrameJoints, const float* pAnimFrameData, int frameIndex)
 {
 	static const vec3 scale(1.2);
 
@@ -276,7 +274,7 @@ inline vec3 computeTriangleNormal(const vec3& p1, const vec3& p2, const vec3& p3
 /**
  * Computes the normals of the weights from the bind pose.
  */
-void ModelMd5::computeWeightNormals()
+void ModelMd5Resource::computeWeightNormals()
 {
 	for (uint m = 0; m < m_numMeshes; m++)
 	{
@@ -289,11 +287,11 @@ void ModelMd5::computeWeightNormals()
 			bindposeVerts[i] = vec3(0.0f);
 			bindposeNorms[i] = vec3(0.0f);
 
-			VertexMd5& currentVertex = m_meshes[m].pVertices[i];
+			VertexMd5& currentVertex = m_meshes[m].vertices[i];
 
 			for (int j = 0; j < currentVertex.weightCount; ++j)
 			{
-				const Weight* pWeight = &m_meshes[m].pWeights[currentVertex.weightIndex + j];
+				const WeightMd5* pWeight = &m_meshes[m].weights[currentVertex.weightIndex + j];
 				JointMd5* pJoint = &m_pBaseFrame->m_joints[pWeight->joint];
 
 				vec3 wv = pWeight->pos;
@@ -308,7 +306,7 @@ void ModelMd5::computeWeightNormals()
 		// Compute triangle normals
 		for (uint i = 0; i < m_meshes[m].numTriangles; ++i)
 		{
-			const poly3* pTri = &m_meshes[m].pTriangles[i];
+			const poly3* pTri = &m_meshes[m].triangles[i];
 			vec3 triNorm = -computeTriangleNormal(bindposeVerts[pTri->a], bindposeVerts[pTri->b], bindposeVerts[pTri->c]);
 
 			for (int j = 0; j < 3; j++)
@@ -326,17 +324,17 @@ void ModelMd5::computeWeightNormals()
 		// Zero out all weight normals
 		for (uint i = 0; i < m_meshes[m].numWeights; ++i)
 		{
-			m_meshes[m].pWeights[i].normal = vec3(0.0f);
+			m_meshes[m].weights[i].normal = vec3(0.0f);
 		}
 
 		// Compute weight normals by invert-transforming the normal by the bone-space matrix
 		for (uint i = 0; i < m_meshes[m].numVertices; ++i)
 		{
-			VertexMd5& currentVertex = m_meshes[m].pVertices[i];
+			VertexMd5& currentVertex = m_meshes[m].vertices[i];
 
 			for (int j = 0; j < currentVertex.weightCount; ++j)
 			{
-				Weight* pWeight = &m_meshes[m].pWeights[currentVertex.weightIndex + j];
+				WeightMd5* pWeight = &m_meshes[m].weights[currentVertex.weightIndex + j];
 				const JointMd5* pJoint = &m_pBaseFrame->m_joints[pWeight->joint];
 
 				vec3 wn = bindposeNorms[i];
@@ -354,7 +352,7 @@ void ModelMd5::computeWeightNormals()
 		// Normalize all weight normals
 		for (uint i = 0; i < m_meshes[m].numWeights; ++i)
 		{
-			m_meshes[m].pWeights[i].normal = normalize(m_meshes[m].pWeights[i].normal);
+			m_meshes[m].weights[i].normal = normalize(m_meshes[m].weights[i].normal);
 		}
 	}
 }
@@ -362,7 +360,7 @@ void ModelMd5::computeWeightNormals()
 /**
  * Computes the tangents of the weights from the bind pose.
  */
-void ModelMd5::computeWeightTangents()
+void ModelMd5Resource::computeWeightTangents()
 {
 	for (uint m = 0; m < m_numMeshes; m++)
 	{
@@ -379,11 +377,11 @@ void ModelMd5::computeWeightTangents()
 			bindposeTangents[i] = vec3(0.0f);
 			bindposeBitangents[i] = vec3(0.0f);
 
-			const VertexMd5& currentVertex = m_meshes[m].pVertices[i];
+			const VertexMd5& currentVertex = m_meshes[m].vertices[i];
 
 			for (int j = 0; j < currentVertex.weightCount; ++j)
 			{
-				const Weight* pWeight = &m_meshes[m].pWeights[currentVertex.weightIndex + j];
+				const WeightMd5* pWeight = &m_meshes[m].weights[currentVertex.weightIndex + j];
 				const JointMd5* pJoint = &m_pBaseFrame->m_joints[pWeight->joint];
 
 				vec3 wv = pWeight->pos;
@@ -398,13 +396,13 @@ void ModelMd5::computeWeightTangents()
 
 		for (uint i = 0; i < m_meshes[m].numTriangles; ++i)
 		{
-			const poly3* pTri = &m_meshes[m].pTriangles[i];
+			const poly3* pTri = &m_meshes[m].triangles[i];
 
 			vec3 triTang, triBitang;
 
-			texCoord t1 = m_meshes[m].pVertices[pTri->a].texCoord;
-			texCoord t2 = m_meshes[m].pVertices[pTri->b].texCoord;
-			texCoord t3 = m_meshes[m].pVertices[pTri->c].texCoord;
+			texCoord t1 = m_meshes[m].vertices[pTri->a].texCoord;
+			texCoord t2 = m_meshes[m].vertices[pTri->b].texCoord;
+			texCoord t3 = m_meshes[m].vertices[pTri->c].texCoord;
 
 			calculateTangent(bindposeVerts[pTri->a], bindposeVerts[pTri->b], bindposeVerts[pTri->c], t1, t2, t3, triTang, triBitang);
 
@@ -441,18 +439,18 @@ void ModelMd5::computeWeightTangents()
 		// Zero out all weight normals
 		for (uint i = 0; i < m_meshes[m].numWeights; ++i)
 		{
-			m_meshes[m].pWeights[i].tangent = vec3(0.0f);
+			m_meshes[m].weights[i].tangent = vec3(0.0f);
 		}
 
 		// Compute weight normals by invert-transforming the normal
 		// by the bone-space matrix
 		for (uint i = 0; i < m_meshes[m].numVertices; ++i)
 		{
-			const VertexMd5& currentVertex = m_meshes[m].pVertices[i];
+			const VertexMd5& currentVertex = m_meshes[m].vertices[i];
 
 			for (int j = 0; j < currentVertex.weightCount; ++j)
 			{
-				Weight* pWeight = &m_meshes[m].pWeights[currentVertex.weightIndex + j];
+				WeightMd5* pWeight = &m_meshes[m].weights[currentVertex.weightIndex + j];
 				const JointMd5* pJoint = &m_pBaseFrame->m_joints[pWeight->joint];
 
 				vec3 wt = bindposeTangents[i];
@@ -469,85 +467,320 @@ void ModelMd5::computeWeightTangents()
 		// Normalize all weight normals
 		for (uint j = 0; j < m_meshes[m].numWeights; ++j)
 		{
-			m_meshes[m].pWeights[j].tangent = normalize(m_meshes[m].pWeights[j].tangent);
+			m_meshes[m].weights[j].tangent = normalize(m_meshes[m].weights[j].tangent);
 		}
 	}
 }
 
-void ModelMd5::prepareMesh(const MeshMd5& mesh, std::vector<JointMd5>& skeleton)
+/**
+ * Skins every mesh with the weight loop of skinMesh(): the reference of the skinning kernels (eg. for the benchmarks).
+ */
+void ModelMd5::skinMeshesAoS(std::vector<Vertex>& vertices) const
+{
+	uint numVertices = 0;
+	for (const MeshMd5& mesh : m_pResource->m_meshes)
+	{
+		numVertices += mesh.numVertices;
+	}
+	vertices.resize(numVertices);
+
+	uint firstVertex = 0;
+	for (const MeshMd5& mesh : m_pResource->m_meshes)
+	{
+		skinMesh(mesh, m_pCurrentFrame->m_joints, &vertices[firstVertex]);
+		firstVertex += mesh.numVertices;
+	}
+}
+
+void ModelMd5::skinMesh(const MeshMd5& mesh, const std::vector<JointMd5>& skeleton, Vertex* pVertices) const
 {
 	static const vec3 scale(1.2);
 
-	// TMP
-	if (m_hasStanceChanged)
+	vec3 wv, wn, wt;
+	// Setup vertices
+	for (uint i = 0; i < mesh.numVertices; i++)
+	{
+		vec3 finalVertex;
+		vec3 finalNormal;
+		vec3 finalTangent;
+
+		// Calculate final vertex to draw with weights
+		for (int j = 0; j < mesh.vertices[i].weightCount; j++)
+		{
+			const WeightMd5* pWeight = &mesh.weights[mesh.vertices[i].weightIndex + j];
+			const JointMd5* pJoint = &skeleton[pWeight->joint];
+
+			//if (pJoint->updated) {
+
+			// Calculate transformed vertex for this weight
+			// The sum of all weight->bias should be 1.0
+			wv = pJoint->orientation.rotateVec(pWeight->pos) * scale;
+			finalVertex += (pJoint->pos + wv) * pWeight->w;
+
+			// Calculate transformed normal for this weight
+			wn = pJoint->orientation.rotateVec(pWeight->normal);
+			finalNormal += wn * pWeight->w;
+
+			wt = pJoint->orientation.rotateVec(pWeight->tangent);
+			finalTangent += wt * pWeight->w;
+
+			//}
+		}
+
+		pVertices[i] = Vertex(finalVertex, -finalNormal, finalTangent, cross(-finalNormal, finalTangent), mesh.vertices[i].texCoord);
+	}
+}
+
+/**
+ * Uploads the cpu skinned vertices of a mesh to the dynamic buffers, if the pose changed or an other mesh is in them.
+ */
+void ModelMd5::prepareMesh(const uint meshIndex)
+{
+	if (!m_hasStanceChanged && m_uploadedMesh == (int)meshIndex)
+	{
+		return;
+	}
+
+	const std::vector<Vertex>& vertices = getSkinnedVertices();
+	const MeshMd5& mesh = m_pResource->m_meshes[meshIndex];
+
+	uint firstVertex = 0;
+	for (uint m = 0; m < meshIndex; m++)
+	{
+		firstVertex += m_pResource->m_meshes[m].numVertices;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_verticesVboId);
+	glBufferData(GL_ARRAY_BUFFER, mesh.numVertices * sizeof(Vertex), &vertices[firstVertex], GL_STREAM_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indicesVboId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.numTriangles * 3 * sizeof(GLuint), mesh.triangles.data(), GL_STREAM_DRAW);
+
+	m_hasStanceChanged = false;
+	m_uploadedMesh = meshIndex;
+}
+
+/**
+ * The cpu skinned meshes of the current pose: the first instance showing a pose skins it for the others.
+ */
+const std::vector<Vertex>& ModelMd5::getSkinnedVertices()
+{
+	if (m_pPose)
+	{
+		if (m_pPose->vertices.empty())
+		{
+			skinMeshes(m_pPose->vertices);
+		}
+
+		return m_pPose->vertices;
+	}
+
+	if (m_hasStanceChanged || m_skinnedVertices.empty())
+	{
+		skinMeshes(m_skinnedVertices);
+	}
+
+	return m_skinnedVertices;
+}
+
+/**
+ * The static buffers of the gpu skinning: the bind pose vertices of every mesh (one after the other)
+ * with their 4 strongest joint weights, renormalized. skinning.vert moves them with the joint palette.
+ */
+void ModelMd5Resource::buildGpuSkinning(std::vector<Vertex>& vertices, std::vector<SkinInfluenceMd5>& influences, std::vector<GLuint>& indices, std::vector<uint>& firstIndices) const
+{
+	const std::vector<JointMd5>& bindJoints = m_pBaseFrame->m_joints;
+
+	vertices.clear();
+	influences.clear();
+	indices.clear();
+	firstIndices.clear();
+
+	for (const MeshMd5& mesh : m_meshes)
 	{
-		//if (1) {
-		vec3 wv, wn, wt;
-		// Setup vertices
+		const GLuint firstVertex = vertices.size();
+		firstIndices.push_back(indices.size());
+
 		for (uint i = 0; i < mesh.numVertices; i++)
 		{
-			vec3 finalVertex;
-			vec3 finalNormal;
-			vec3 finalTangent;
+			const VertexMd5& currentVertex = mesh.vertices[i];
 
-			// Calculate final vertex to draw with weights
-			for (int j = 0; j < mesh.pVertices[i].weightCount; j++)
-			{
-				const Weight* pWeight = &mesh.pWeights[mesh.pVertices[i].weightIndex + j];
-				const JointMd5* pJoint = &skeleton[pWeight->joint];
+			vec3 bindVertex;
+			vec3 bindNormal;
+			vec3 bindTangent;
+			SkinInfluenceMd5 influence = {};
 
-				//if (pJoint->updated) {
+			for (int j = 0; j < currentVertex.weightCount; j++)
+			{
+				const WeightMd5& weight = mesh.weights[currentVertex.weightIndex + j];
+				const JointMd5& joint = bindJoints[weight.joint];
 
-				// Calculate transformed vertex for this weight
-				// The sum of all weight->bias should be 1.0
-				wv = pJoint->orientation.rotateVec(pWeight->pos) * scale;
-				finalVertex += (pJoint->pos + wv) * pWeight->w;
+				bindVertex += (joint.pos + joint.orientation.rotateVec(weight.pos)) * weight.w;
+				bindNormal += joint.orientation.rotateVec(weight.normal) * weight.w;
+				bindTangent += joint.orientation.rotateVec(weight.tangent) * weight.w;
 
-				// Calculate transformed normal for this weight
-				wn = pJoint->orientation.rotateVec(pWeight->normal);
-				finalNormal += wn * pWeight->w;
+				// insertion into the strongest 4 (in decreasing order)
+				int k = 4;
+				while (k > 0 && influence.weights[k - 1] < weight.w)
+				{
+					if (k < 4)
+					{
+						influence.weights[k] = influence.weights[k - 1];
+						influence.joints[k] = influence.joints[k - 1];
+					}
+					k--;
+				}
 
-				wt = pJoint->orientation.rotateVec(pWeight->tangent);
-				finalTangent += wt * pWeight->w;
+				if (k < 4)
+				{
+					influence.weights[k] = weight.w;
+					influence.joints[k] = (GLubyte) weight.joint;
+				}
+			}
 
-				//}
+			const float sum = influence.weights[0] + influence.weights[1] + influence.weights[2] + influence.weights[3];
+			for (int j = 0; j < 4 && sum > 0.0f; j++)
+			{
+				influence.weights[j] /= sum;
 			}
 
-			m_pVertexArrayDynamic[i] = Vertex(finalVertex, -finalNormal, finalTangent, cross(-finalNormal, finalTangent), mesh.pVertices[i].texCoord);
+			vertices.push_back(Vertex(bindVertex, -bindNormal, bindTangent, cross(-bindNormal, bindTangent), currentVertex.texCoord));
+			influences.push_back(influence);
+		}
+
+		for (uint i = 0; i < mesh.numTriangles; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				indices.push_back(firstVertex + mesh.triangles[i].at(j));
+			}
 		}
-		m_hasStanceChanged = false;
+	}
+}
+
+/**
+ * Uploads the static buffers of the gpu skinning: from the baked model if it is still mapped, else built.
+ */
+void ModelMd5Resource::setupGpuSkinning()
+{
+	if (m_pBakedFile)
+	{
+		uploadBakedGpuSkinning();
+		m_pBakedFile.reset();
+		return;
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<SkinInfluenceMd5> influences;
+	std::vector<GLuint> indices;
+
+	buildGpuSkinning(vertices, influences, indices, m_skinFirstIndices);
+	uploadGpuSkinning(vertices.data(), vertices.size(), influences.data(), influences.size(), indices.data(), indices.size());
+}
+
+void ModelMd5Resource::uploadGpuSkinning(const Vertex* pVertices, const size_t numVertices, const SkinInfluenceMd5* pInfluences, const size_t numInfluences, const GLuint* pIndices, const size_t numIndices)
+{
+	glGenBuffers(1, &m_skinVerticesVboId);
+	glGenBuffers(1, &m_skinInfluencesVboId);
+	glGenBuffers(1, &m_skinIndicesVboId);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_skinVerticesVboId);
+	glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(Vertex), pVertices, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_skinInfluencesVboId);
+	glBufferData(GL_ARRAY_BUFFER, numInfluences * sizeof(SkinInfluenceMd5), pInfluences, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_skinIndicesVboId);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), pIndices, GL_STATIC_DRAW);
+}
 
-		glBindBuffer(GL_ARRAY_BUFFER, m_verticesVboId);
-		glBufferData(GL_ARRAY_BUFFER, mesh.numVertices * sizeof(Vertex), m_pVertexArrayDynamic, GL_STREAM_DRAW);
+/**
+ * The joint palette of the current frame: the bind pose -> current pose matrix of every joint.
+ * (It moves a bind pose vertex the same way skinMesh() moves its weights.)
+ */
+void ModelMd5::updateJointPalette()
+{
+	static const vec3 scale(1.2);
+	const Matrix scaleMatrix(scale.x, scale.y, scale.z);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indicesVboId);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.numTriangles * 3 * sizeof(GLuint), mesh.pTriangles, GL_STREAM_DRAW);
+	for (uint i = 0; i < m_pResource->m_numJoints; i++)
+	{
+		const JointMd5& bindJoint = m_pResource->m_pBaseFrame->m_joints[i];
+		const JointMd5& currentJoint = m_pCurrentFrame->m_joints[i];
+
+		Matrix& jointMatrix = m_jointPalette[i];
+		jointMatrix = (currentJoint.orientation * bindJoint.orientation.conjugate()).getMatrix() * scaleMatrix;
+		jointMatrix.setTranslation(currentJoint.pos - jointMatrix.transform3x3(bindJoint.pos));
 	}
+
+	m_hasPaletteChanged = false;
 }
 
-void ModelMd5::interpolateSkeletons(AnimMd5& anim, int frame1, int frame2, float interp)
+/**
+ * Interpolates the joints of a pose between its key frames.
+ */
+void ModelMd5Resource::evaluatePose(const PoseKeyMd5& key, PoseMd5& pose) const
 {
+	const float interp = (float)key.blend / POSE_BLEND_STEPS;
+	const FrameMd5& frame1 = key.pAnim->frames[key.frame1];
+	const FrameMd5& frame2 = key.pAnim->frames[key.frame2];
+
+	pose.joints = frame1.m_joints;
 	for (uint i = 0; i < m_numJoints; i++)
 	{
-		const JointMd5& jointFrame1 = anim.frames[frame1].m_joints[i];
-		const JointMd5& jointFrame2 = anim.frames[frame2].m_joints[i];
+		const JointMd5& jointFrame1 = frame1.m_joints[i];
+		const JointMd5& jointFrame2 = frame2.m_joints[i];
 
-		JointMd5& currentJoint = m_pCurrentFrame->m_joints[i];
-		currentJoint.pos = jointFrame1.pos + (jointFrame2.pos - jointFrame1.pos) * interp;
-		currentJoint.orientation = Quat::slerp(jointFrame1.orientation, jointFrame2.orientation, interp);
-		currentJoint.orientation.normalize();
+		JointMd5& joint = pose.joints[i];
+		joint.pos = jointFrame1.pos + (jointFrame2.pos - jointFrame1.pos) * interp;
+		joint.orientation = Quat::slerp(jointFrame1.orientation, jointFrame2.orientation, interp);
+		joint.orientation.normalize();
+	}
+}
+
+/**
+ * Drops the cached poses no instance shows, when there are more than MAX_CACHED_POSES.
+ */
+void ModelMd5Resource::trimPoseCache()
+{
+	if (m_poseCache.size() <= MAX_CACHED_POSES)
+	{
+		return;
 	}
+
+	for (auto it = m_poseCache.begin(); it != m_poseCache.end();)
+	{
+		if (it->second.use_count() == 1)
+		{
+			it = m_poseCache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+/**
+ * Shows the pose found by updatePoses().
+ */
+void ModelMd5::applyPose()
+{
+	m_pCurrentFrame->m_joints = m_pPose->joints;
+
+	m_isPosePending = false;
 	m_hasStanceChanged = true;
+	m_hasPaletteChanged = true;
 }
 
 void ModelMd5::renderSkeleton()
 {
 #ifdef DEBUG_TBN
 	glBegin(GL_LINES);
-	for (int i = 0; i < m_numMeshes; i++)
+	for (int i = 0; i < m_pResource->m_numMeshes; i++)
 	{
-		prepareMesh(m_meshes[i], m_pCurrentFrame->m_joints);
-		for (int j = 0; j < m_meshes[i].numVertices; j++)
+		prepareMesh(i);
+		for (int j = 0; j < m_pResource->m_meshes[i].numVertices; j++)
 		{
 			glColor3f(1.0f, 0.0f, 0.0f);
 			glVertex3f(VEC3_TO_F3(m_pVertexArray[j]));
@@ -596,21 +829,113 @@ void ModelMd5::renderSkeleton()
 	//glPopMatrix();
 }
 
+/**
+ * The models within the joint palette of the skinning shader, with a bind pose to skin from.
+ */
+bool ModelMd5::isGpuSkinnable() const
+{
+	return m_pResource->m_numJoints <= MAX_GPU_JOINTS && m_pResource->m_pBaseFrame;
+}
+
+/**
+ * Initialize the vertex attributes and the buffers. With a skinning shader (u_bones, a_boneIds, a_boneWeights)
+ * the static bind pose buffers are bound and only the joint palette is uploaded, else the meshes are skinned on the cpu.
+ *
+ * @param program	the openGL shader program used for the rendering.
+ * @param bindVbos	if true bind the available VBO buffers (the gpu skinning always binds its own).
+ */
+void ModelMd5::preRender(const GLuint program, const bool bindVbos)
+{
+	// animated after the updatePoses() of the tick
+	if (m_isPosePending)
+	{
+		updatePoses();
+	}
+
+	if (m_lastShaderProg != program)
+	{
+		m_bonesLoc = glGetUniformLocation(program, "u_bones");
+		m_boneIdsLoc = glGetAttribLocation(program, "a_boneIds");
+		m_boneWeightsLoc = glGetAttribLocation(program, "a_boneWeights");
+	}
+
+	ModelMd5Resource& resource = *m_pResource;
+
+	m_isGpuSkinned = m_bonesLoc != -1 && m_boneIdsLoc != -1 && m_boneWeightsLoc != -1 && isGpuSkinnable();
+
+	if (!m_isGpuSkinned)
+	{
+		Mesh::preRender(program, bindVbos);
+		return;
+	}
+
+	// the static buffers are shared by the instances, the palette is per instance
+	if (!resource.m_skinVerticesVboId)
+	{
+		resource.setupGpuSkinning();
+	}
+
+	if (m_jointPalette.size() != resource.m_numJoints)
+	{
+		m_jointPalette.resize(resource.m_numJoints);
+		m_hasPaletteChanged = true;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, resource.m_skinVerticesVboId);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, resource.m_skinIndicesVboId);
+	Mesh::preRender(program, false);
+
+	glBindBuffer(GL_ARRAY_BUFFER, resource.m_skinInfluencesVboId);
+
+	glEnableVertexAttribArray(m_boneIdsLoc);
+	glVertexAttribIPointer(m_boneIdsLoc,		4, GL_UNSIGNED_BYTE, sizeof(SkinInfluenceMd5), (const void*)0);
+
+	glEnableVertexAttribArray(m_boneWeightsLoc);
+	glVertexAttribPointer(m_boneWeightsLoc,		4, GL_FLOAT, GL_FALSE, sizeof(SkinInfluenceMd5), (const void*)(4 * sizeof(GLubyte)));
+
+	if (m_hasPaletteChanged)
+	{
+		updateJointPalette();
+	}
+
+	glUniformMatrix4fv(m_bonesLoc, resource.m_numJoints, GL_FALSE, m_jointPalette[0].getArray());
+}
+
+void ModelMd5::postRender() const
+{
+	if (m_isGpuSkinned)
+	{
+		glDisableVertexAttribArray(m_boneIdsLoc);
+		glDisableVertexAttribArray(m_boneWeightsLoc);
+	}
+
+	Mesh::postRender();
+}
+
 void ModelMd5::render()
 {
 	// renderSkeleton();
-	for (uint i = 0; i < m_numMeshes; i++)
+	for (uint i = 0; i < m_pResource->m_numMeshes; i++)
 	{
-		prepareMesh(m_meshes[i], m_pCurrentFrame->m_joints);
-		glDrawElements(GL_TRIANGLES, m_meshes[i].numTriangles * 3, GL_UNSIGNED_INT, 0);
+		renderSubset(i);
 	}
 }
 
 void ModelMd5::renderSubset(const uint subset)
 {
 	// renderSkeleton();
-	prepareMesh(m_meshes[subset], m_pCurrentFrame->m_joints);
-	glDrawElements(GL_TRIANGLES, m_meshes[subset].numTriangles * 3, GL_UNSIGNED_INT, 0);
+	const MeshMd5& mesh = m_pResource->m_meshes[subset];
+
+	m_lastRenderFrame = s_renderFrame;
+
+	if (m_isGpuSkinned)
+	{
+		glDrawElements(GL_TRIANGLES, mesh.numTriangles * 3, GL_UNSIGNED_INT, (const void*)(m_pResource->m_skinFirstIndices[subset] * sizeof(GLuint)));
+		return;
+	}
+
+	prepareMesh(subset);
+	glDrawElements(GL_TRIANGLES, mesh.numTriangles * 3, GL_UNSIGNED_INT, 0);
 }
 
 void ModelMd5::animate(const float dt)
@@ -621,8 +946,14 @@ void ModelMd5::animate(const float dt)
 	//	return;
 	//}
 
-	AnimMd5* pAnim = &m_animations[m_currentAnimationName];
-	AnimMd5Info& animInfo = pAnim->animInfo;
+	const auto animationIt = m_pResource->m_animations.find(m_currentAnimationName);
+	if (animationIt == m_pResource->m_animations.end())
+	{
+		return;
+	}
+
+	const AnimMd5* pAnim = &animationIt->second;
+	AnimMd5Info& animInfo = m_animInfos[m_currentAnimationName];
 
 	int maxFrames = pAnim->numFrames - 1;
 
@@ -665,9 +996,103 @@ void ModelMd5::animate(const float dt)
 		}
 	}
 
-	interpolateSkeletons(*pAnim, animInfo.currentFrame, animInfo.nextFrame, animInfo.lastTime * pAnim->frameRate);
+	// the lod of the last rendered frame: by the distance to the camera, the lowest one off screen
+	if (s_renderFrame > 0)
+	{
+		setAnimationLodByDistance(m_cameraDistance, m_lastRenderFrame == s_renderFrame);
+	}
+
+	// the lower lods skip updates (the clock runs on) and quantize the time coarser: more instances share a pose
+	if (m_pPose && ++m_numSkippedUpdates < (1u << m_animationLod))
+	{
+		return;
+	}
+	m_numSkippedUpdates = 0;
+
+	const uint blendSteps = POSE_BLEND_STEPS >> m_animationLod;
+	const float interp = (float)(animInfo.lastTime * pAnim->frameRate);
+
+	PoseKeyMd5 poseKey;
+	poseKey.pAnim = pAnim;
+	poseKey.frame1 = animInfo.currentFrame;
+	poseKey.frame2 = animInfo.nextFrame;
+	poseKey.blend = std::min(blendSteps, (uint)(interp * blendSteps + 0.5f)) * (POSE_BLEND_STEPS / blendSteps);
+
+	// the same pose (eg. a paused animation): nothing to skin again
+	if (m_pPose && poseKey == m_poseKey)
+	{
+		return;
+	}
+
+	m_poseKey = poseKey;
+	if (!m_isPosePending)
+	{
+		m_isPosePending = true;
+		s_pendingPoses.push_back(this);
+	}
 }
 
+/**
+ * Finds the poses of the models animated since the last call in the pose caches of their resources, the missing
+ * ones are evaluated on the JobPool (once, however many instances show them).
+ */
+void ModelMd5::updatePoses()
+{
+	if (s_pendingPoses.empty())
+	{
+		return;
+	}
+
+	TRACE_ZONE("ModelMd5::updatePoses");
+
+	struct PoseJob
+	{
+		const ModelMd5Resource*	pResource;
+		const PoseKeyMd5*		pKey;
+		PoseMd5*				pPose;
+	};
+
+	std::vector<PoseJob> jobs;
+	std::set<ModelMd5Resource*> resources;
+
+	for (ModelMd5* pModel : s_pendingPoses)
+	{
+		ModelMd5Resource& resource = *pModel->m_pResource;
+
+		std::shared_ptr<PoseMd5>& pPose = resource.m_poseCache[pModel->m_poseKey];
+		if (!pPose)
+		{
+			pPose = std::make_shared<PoseMd5>();
+			jobs.push_back({ &resource, &pModel->m_poseKey, pPose.get() });
+		}
+
+		pModel->m_pPose = pPose;
+		resources.insert(&resource);
+	}
+
+	JobPool::run(jobs.size(), 4, [&jobs](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			jobs[i].pResource->evaluatePose(*jobs[i].pKey, *jobs[i].pPose);
+		}
+	});
+
+	for (ModelMd5* pModel : s_pendingPoses)
+	{
+		pModel->applyPose();
+	}
+	s_pendingPoses.clear();
+
+	for (ModelMd5Resource* pResource : resources)
+	{
+		pResource->trimPoseCache();
+	}
+}
+
+std::vector<ModelMd5*> ModelMd5::s_pendingPoses;
+uint ModelMd5::s_renderFrame = 0;
+
 
 void ModelMd5::kill()
 {
@@ -682,9 +1107,9 @@ void ModelMd5::kill()
 
 float ModelMd5::getFrame() const
 {
-	if (m_animations.find(m_currentAnimationName) != m_animations.end())
+	if (m_animInfos.find(m_currentAnimationName) != m_animInfos.end())
 	{
-		return m_animations.at(m_currentAnimationName).animInfo.currentFrame;
+		return m_animInfos.at(m_currentAnimationName).currentFrame;
 	}
 
 	return 0;
@@ -692,29 +1117,30 @@ float ModelMd5::getFrame() const
 
 void ModelMd5::setFrame(float time)
 {
-	AnimMd5* anim = &m_animations.at(m_currentAnimationName);
+	const AnimMd5& anim = m_pResource->m_animations.at(m_currentAnimationName);
+	AnimMd5Info& animInfo = m_animInfos.at(m_currentAnimationName);
 
-	anim->animInfo.currentFrame = time;
-	anim->animInfo.nextFrame = time + 1;
+	animInfo.currentFrame = time;
+	animInfo.nextFrame = time + 1;
 
-	int maxFrames = anim->numFrames - 1;
+	int maxFrames = anim.numFrames - 1;
 
-	if (anim->animInfo.currentFrame > maxFrames)
+	if (animInfo.currentFrame > maxFrames)
 	{
-		anim->animInfo.currentFrame = 0;
+		animInfo.currentFrame = 0;
 	}
 
-	if (anim->animInfo.nextFrame > maxFrames)
+	if (animInfo.nextFrame > maxFrames)
 	{
-		anim->animInfo.nextFrame = 0;
+		animInfo.nextFrame = 0;
 	}
 }
 
 float ModelMd5::getFrameTime() const
 {
-	if (m_animations.find(m_currentAnimationName) != m_animations.end())
+	if (m_animInfos.find(m_currentAnimationName) != m_animInfos.end())
 	{
-		return m_animations.at(m_currentAnimationName).animInfo.lastTime;
+		return m_animInfos.at(m_currentAnimationName).lastTime;
 	}
 
 	return 0;
@@ -722,7 +1148,26 @@ float ModelMd5::getFrameTime() const
 
 void ModelMd5::setFrameTime(float time)
 {
-	m_animations.at(m_currentAnimationName).animInfo.lastTime = time;
+	m_animInfos.at(m_currentAnimationName).lastTime = time;
+}
+
+void ModelMd5::setAnimationLod(const uint animationLod)
+{
+	m_animationLod = std::min(animationLod, MAX_ANIMATION_LOD);
+}
+
+/**
+ * The animation lod of an instance from its distance to the camera (Animation::LodDistance constants).
+ */
+void ModelMd5::setAnimationLodByDistance(const float distance, const bool isVisible)
+{
+	uint animationLod = MAX_ANIMATION_LOD;
+	if (isVisible)
+	{
+		animationLod = distance < CONST_FLOAT("Animation::LodDistance1") ? 0 : distance < CONST_FLOAT("Animation::LodDistance2") ? 1 : 2;
+	}
+
+	setAnimationLod(animationLod);
 }
 
 } // namespace models
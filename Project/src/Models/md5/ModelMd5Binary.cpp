@@ -0,0 +1,465 @@
+#include "GameStdAfx.h"
+#include "Models/md5/ModelMd5.h"
+#include "Models/md5/ModelMd5Binary.h"
+#include "Common/BakedFile.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace models
+{
+
+/**
+ * Whether the indices of a loaded mesh are within their arrays: the skinning and the render use them unchecked.
+ */
+static bool hasValidIndices(const MeshMd5& mesh, const SkinWeightsMd5& skin, const uint numJoints, const uint32_t numSkinSlots)
+{
+	for (const VertexMd5& vertex : mesh.vertices)
+	{
+		if (vertex.weightIndex < 0 || vertex.weightCount < 0 || (size_t)vertex.weightIndex + (size_t)vertex.weightCount > mesh.numWeights)
+		{
+			return false;
+		}
+	}
+
+	for (const poly3& triangle : mesh.triangles)
+	{
+		if (triangle.a >= mesh.numVertices || triangle.b >= mesh.numVertices || triangle.c >= mesh.numVertices)
+		{
+			return false;
+		}
+	}
+
+	for (const WeightMd5& weight : mesh.weights)
+	{
+		if (weight.joint < 0 || (uint)weight.joint >= numJoints)
+		{
+			return false;
+		}
+	}
+
+	// the slots of the groups go up to the end of the slots
+	if (skin.groupFirstSlots.empty() || skin.groupFirstSlots.front() != 0 || skin.groupFirstSlots.back() != numSkinSlots)
+	{
+		return false;
+	}
+
+	for (size_t g = 1; g < skin.groupFirstSlots.size(); g++)
+	{
+		if (skin.groupFirstSlots[g] < skin.groupFirstSlots[g - 1])
+		{
+			return false;
+		}
+	}
+
+	for (const uint vertexIndex : skin.laneVertices)
+	{
+		if (vertexIndex != UINT32_MAX && vertexIndex >= mesh.numVertices)
+		{
+			return false;
+		}
+	}
+
+	for (const int32_t joint : skin.joints)
+	{
+		if (joint < 0 || (uint)joint >= numJoints)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Whether the gpu skinning buffers in the file refer to the vertices and joints they have.
+ */
+static bool hasValidIndices(const SkinInfluenceMd5* pInfluences, const uint32_t numVertices, const GLuint* pIndices, const uint32_t numIndices,
+	const std::vector<MeshMd5>& meshes, const std::vector<uint>& firstIndices, const uint numJoints)
+{
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		for (uint k = 0; k < 4; k++)
+		{
+			if (pInfluences[i].joints[k] >= numJoints)
+			{
+				return false;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < numIndices; i++)
+	{
+		if (pIndices[i] >= numVertices)
+		{
+			return false;
+		}
+	}
+
+	for (size_t m = 0; m < meshes.size(); m++)
+	{
+		if ((size_t)firstIndices[m] + (size_t)meshes[m].numTriangles * 3 > numIndices)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Bakes the model with its clips (md5bin::Header).
+ */
+bool ModelMd5Resource::saveBinary(const char* filename) const
+{
+	BakedFileWriter writer(sizeof(md5bin::Header), md5bin::MD5BIN_ALIGNMENT);
+
+	md5bin::Header header = {};
+	header.magic = md5bin::MD5BIN_MAGIC;
+	header.version = md5bin::MD5BIN_VERSION;
+
+	header.vertexSize = sizeof(Vertex);
+	header.vertexMd5Size = sizeof(VertexMd5);
+	header.weightMd5Size = sizeof(WeightMd5);
+	header.influenceSize = sizeof(SkinInfluenceMd5);
+
+	header.numJoints = m_numJoints;
+	header.numMeshes = m_numMeshes;
+	header.numAnims = (uint32_t)m_animations.size();
+	header.maxVertices = m_maxVertices;
+	header.maxTriangles = m_maxTriangles;
+	header.hasBaseFrame = m_pBaseFrame != nullptr;
+
+	// bind pose
+	std::vector<md5bin::Joint> joints(m_numJoints);
+	for (uint i = 0; i < m_numJoints; i++)
+	{
+		const JointMd5& joint = m_joints[i];
+
+		copyName(joint.name, joints[i].name);
+		joints[i].parent = joint.parent;
+		joints[i].pos[0] = joint.pos.x;
+		joints[i].pos[1] = joint.pos.y;
+		joints[i].pos[2] = joint.pos.z;
+		joints[i].orientation[0] = joint.orientation.s;
+		joints[i].orientation[1] = joint.orientation.x;
+		joints[i].orientation[2] = joint.orientation.y;
+		joints[i].orientation[3] = joint.orientation.z;
+	}
+	header.jointsOffset = writer.append(joints);
+
+	// meshes
+	header.meshesOffset = writer.reserve<md5bin::Mesh>(m_numMeshes);
+	for (uint m = 0; m < m_numMeshes; m++)
+	{
+		const MeshMd5& mesh = m_meshes[m];
+		const SkinWeightsMd5& skin = m_skinWeights[m];
+
+		md5bin::Mesh record = {};
+		record.numVertices = mesh.numVertices;
+		record.numTriangles = mesh.numTriangles;
+		record.numWeights = mesh.numWeights;
+		record.verticesOffset = writer.append(mesh.vertices);
+		record.trianglesOffset = writer.append(mesh.triangles);
+		record.weightsOffset = writer.append(mesh.weights);
+
+		record.numSkinGroups = skin.getNumGroups();
+		record.numSkinSlots = skin.groupFirstSlots.back();
+		record.groupFirstSlotsOffset = writer.append(skin.groupFirstSlots);
+		record.laneVerticesOffset = writer.append(skin.laneVertices);
+
+		record.slotsOffset = writer.append(skin.joints.data(), skin.joints.size());
+		for (const AlignedVector<float>* pSlots : { &skin.bias, &skin.posX, &skin.posY, &skin.posZ, &skin.normalX, &skin.normalY, &skin.normalZ, &skin.tangentX, &skin.tangentY, &skin.tangentZ })
+		{
+			writer.append(pSlots->data(), pSlots->size());
+		}
+
+		writer.write(header.meshesOffset + m * sizeof(md5bin::Mesh), &record, 1);
+	}
+
+	// clips: the joint positions quantized in their range in the clip
+	header.animsOffset = writer.reserve<md5bin::Anim>(m_animations.size());
+
+	uint a = 0;
+	for (const auto& animation : m_animations)
+	{
+		const AnimMd5& anim = animation.second;
+
+		md5bin::Anim record = {};
+		copyName(animation.first, record.name);
+		record.numFrames = anim.numFrames;
+		record.frameRate = anim.frameRate;
+
+		std::vector<float> bounds;
+		for (const FrameMd5& frame : anim.frames)
+		{
+			bounds.insert(bounds.end(), { frame.m_bbox.minp.x, frame.m_bbox.minp.y, frame.m_bbox.minp.z, frame.m_bbox.maxp.x, frame.m_bbox.maxp.y, frame.m_bbox.maxp.z });
+		}
+		record.boundsOffset = writer.append(bounds);
+
+		std::vector<md5bin::JointRange> ranges(m_numJoints, md5bin::JointRange());
+		for (uint j = 0; j < m_numJoints; j++)
+		{
+			md5bin::JointRange& range = ranges[j];
+			if (anim.frames.empty())
+			{
+				continue;
+			}
+
+			float maxPos[3];
+			for (int c = 0; c < 3; c++)
+			{
+				range.min[c] = maxPos[c] = anim.frames[0].m_joints[j].pos[c];
+			}
+
+			for (const FrameMd5& frame : anim.frames)
+			{
+				const vec3& pos = frame.m_joints[j].pos;
+				for (int c = 0; c < 3; c++)
+				{
+					range.min[c] = std::min(range.min[c], pos[c]);
+					maxPos[c] = std::max(maxPos[c], pos[c]);
+				}
+			}
+
+			for (int c = 0; c < 3; c++)
+			{
+				range.scale[c] = (maxPos[c] - range.min[c]) / 65535.0f;
+			}
+		}
+		record.rangesOffset = writer.append(ranges);
+
+		std::vector<md5bin::JointKey> keys(anim.frames.size() * m_numJoints);
+		for (uint f = 0; f < anim.frames.size(); f++)
+		{
+			for (uint j = 0; j < m_numJoints; j++)
+			{
+				const JointMd5& joint = anim.frames[f].m_joints[j];
+				const md5bin::JointRange& range = ranges[j];
+				md5bin::JointKey& key = keys[f * m_numJoints + j];
+
+				for (int c = 0; c < 3; c++)
+				{
+					key.pos[c] = range.scale[c] > 0.0f ? (uint16_t)std::min(65535.0f, std::floor((joint.pos[c] - range.min[c]) / range.scale[c] + 0.5f)) : 0;
+				}
+
+				const float orientation[4] = { joint.orientation.s, joint.orientation.x, joint.orientation.y, joint.orientation.z };
+				for (int c = 0; c < 4; c++)
+				{
+					key.orientation[c] = (int16_t)std::floor(std::max(-1.0f, std::min(1.0f, orientation[c])) * 32767.0f + 0.5f);
+				}
+			}
+		}
+		record.keysOffset = writer.append(keys);
+
+		writer.write(header.animsOffset + a * sizeof(md5bin::Anim), &record, 1);
+		a++;
+	}
+
+	// the gpu skinning buffers (the bind pose is the base frame)
+	if (m_pBaseFrame)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<SkinInfluenceMd5> influences;
+		std::vector<GLuint> indices;
+		std::vector<uint> firstIndices;
+		buildGpuSkinning(vertices, influences, indices, firstIndices);
+
+		header.numSkinVertices = (uint32_t)vertices.size();
+		header.numSkinIndices = (uint32_t)indices.size();
+		header.skinVerticesOffset = writer.append(vertices);
+		header.skinInfluencesOffset = writer.append(influences);
+		header.skinIndicesOffset = writer.append(indices);
+		header.skinFirstIndicesOffset = writer.append(firstIndices);
+	}
+
+	header.fileSize = writer.getSize();
+	writer.write(0, &header, 1);
+
+	if (!writer.save(filename))
+	{
+		TRACE_ERROR("Can't write " << filename, 0);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Loads a baked model: the sections are copied from the file mapping, the gpu skinning buffers are uploaded from it
+ * (by the first render) without a copy.
+ */
+bool ModelMd5Resource::loadBinary(const char* filename)
+{
+	TRACE_ZONE("ModelMd5Resource::loadBinary");
+
+	std::shared_ptr<MappedFile> pFile = std::make_shared<MappedFile>();
+	if (!pFile->open(filename))
+	{
+		return false;
+	}
+
+	const MappedFile& file = *pFile;
+	const md5bin::Header* pHeader = file.getArray<md5bin::Header>(0, 1);
+
+	if (!pHeader || pHeader->magic != md5bin::MD5BIN_MAGIC || pHeader->version != md5bin::MD5BIN_VERSION || pHeader->fileSize != file.getSize())
+	{
+		TRACE_ERROR(filename << " is not a baked md5 model of version " << md5bin::MD5BIN_VERSION << ", bake it again.", 0);
+		return false;
+	}
+
+	const md5bin::Header& header = *pHeader;
+	if (header.vertexSize != sizeof(Vertex) || header.vertexMd5Size != sizeof(VertexMd5) || header.weightMd5Size != sizeof(WeightMd5) || header.influenceSize != sizeof(SkinInfluenceMd5))
+	{
+		TRACE_ERROR(filename << " was baked with an other vertex layout, bake it again.", 0);
+		return false;
+	}
+
+	const md5bin::Joint* pJoints = file.getArray<md5bin::Joint>(header.jointsOffset, header.numJoints);
+	const md5bin::Mesh* pMeshes = file.getArray<md5bin::Mesh>(header.meshesOffset, header.numMeshes);
+	const md5bin::Anim* pAnims = file.getArray<md5bin::Anim>(header.animsOffset, header.numAnims);
+
+	bool isValid = pJoints && pMeshes && pAnims;
+
+	// bind pose
+	m_numJoints = isValid ? header.numJoints : 0;
+	m_joints.resize(m_numJoints);
+	for (uint i = 0; i < m_numJoints; i++)
+	{
+		JointMd5& joint = m_joints[i];
+
+		joint.name = readName(pJoints[i].name);
+		joint.parent = pJoints[i].parent;
+		joint.pos = vec3(pJoints[i].pos[0], pJoints[i].pos[1], pJoints[i].pos[2]);
+		joint.orientation = Quat(pJoints[i].orientation[0], pJoints[i].orientation[1], pJoints[i].orientation[2], pJoints[i].orientation[3]);
+
+		isValid = isValid && joint.parent >= -1 && joint.parent < (int)i;
+	}
+
+	// meshes
+	m_numMeshes = isValid ? header.numMeshes : 0;
+	m_meshes.resize(m_numMeshes);
+	m_skinWeights.resize(m_numMeshes);
+	for (uint m = 0; m < m_numMeshes && isValid; m++)
+	{
+		const md5bin::Mesh& record = pMeshes[m];
+		MeshMd5& mesh = m_meshes[m];
+		SkinWeightsMd5& skin = m_skinWeights[m];
+
+		mesh.numVertices = record.numVertices;
+		mesh.numTriangles = record.numTriangles;
+		mesh.numWeights = record.numWeights;
+
+		const size_t numSlotValues = (size_t)record.numSkinSlots * SKIN_LANES;
+		const uint32_t slotsSize = (uint32_t)(numSlotValues * sizeof(float));
+
+		isValid = readArray<VertexMd5>(file, record.verticesOffset, record.numVertices, mesh.vertices)
+			&& readArray<poly3>(file, record.trianglesOffset, record.numTriangles, mesh.triangles)
+			&& readArray<WeightMd5>(file, record.weightsOffset, record.numWeights, mesh.weights)
+			&& readArray<uint32_t>(file, record.groupFirstSlotsOffset, (size_t)record.numSkinGroups + 1, skin.groupFirstSlots)
+			&& readArray<uint32_t>(file, record.laneVerticesOffset, (size_t)record.numSkinGroups * SKIN_LANES, skin.laneVertices)
+			&& file.getArray<float>(record.slotsOffset, numSlotValues * md5bin::SKIN_SLOT_ARRAYS) != nullptr;
+
+		if (!isValid)
+		{
+			break;
+		}
+
+		uint32_t slotsOffset = record.slotsOffset;
+		readArray<int32_t>(file, slotsOffset, numSlotValues, skin.joints);
+		for (AlignedVector<float>* pSlots : { &skin.bias, &skin.posX, &skin.posY, &skin.posZ, &skin.normalX, &skin.normalY, &skin.normalZ, &skin.tangentX, &skin.tangentY, &skin.tangentZ })
+		{
+			slotsOffset += slotsSize;
+			readArray<float>(file, slotsOffset, numSlotValues, *pSlots);
+		}
+
+		isValid = hasValidIndices(mesh, skin, m_numJoints, record.numSkinSlots);
+	}
+
+	m_maxVertices = header.maxVertices;
+	m_maxTriangles = header.maxTriangles;
+
+	// clips
+	for (uint a = 0; a < header.numAnims && isValid; a++)
+	{
+		const md5bin::Anim& record = pAnims[a];
+
+		const float* pBounds = file.getArray<float>(record.boundsOffset, (size_t)record.numFrames * 6);
+		const md5bin::JointRange* pRanges = file.getArray<md5bin::JointRange>(record.rangesOffset, m_numJoints);
+		const md5bin::JointKey* pKeys = file.getArray<md5bin::JointKey>(record.keysOffset, (size_t)record.numFrames * m_numJoints);
+
+		isValid = pBounds && pRanges && pKeys;
+		if (!isValid)
+		{
+			break;
+		}
+
+		AnimMd5& anim = m_animations[readName(record.name)];
+		anim.numFrames = record.numFrames;
+		anim.frameRate = record.frameRate;
+		anim.frames.assign(anim.numFrames, FrameMd5(m_numJoints));
+
+		for (uint f = 0; f < anim.numFrames; f++)
+		{
+			FrameMd5& frame = anim.frames[f];
+			frame.m_bbox.minp = vec3(pBounds[f * 6 + 0], pBounds[f * 6 + 1], pBounds[f * 6 + 2]);
+			frame.m_bbox.maxp = vec3(pBounds[f * 6 + 3], pBounds[f * 6 + 4], pBounds[f * 6 + 5]);
+
+			for (uint j = 0; j < m_numJoints; j++)
+			{
+				const md5bin::JointRange& range = pRanges[j];
+				const md5bin::JointKey& key = pKeys[f * m_numJoints + j];
+
+				JointMd5& joint = frame.m_joints[j];
+				joint.name = m_joints[j].name;
+				joint.parent = m_joints[j].parent;
+				joint.pos = vec3(range.min[0] + key.pos[0] * range.scale[0], range.min[1] + key.pos[1] * range.scale[1], range.min[2] + key.pos[2] * range.scale[2]);
+				joint.orientation = Quat(key.orientation[0] / 32767.0f, key.orientation[1] / 32767.0f, key.orientation[2] / 32767.0f, key.orientation[3] / 32767.0f);
+				joint.orientation.normalize();
+			}
+		}
+	}
+
+	// the gpu skinning buffers stay in the file till the upload
+	isValid = isValid && (!header.numSkinVertices
+		|| (file.getArray<Vertex>(header.skinVerticesOffset, header.numSkinVertices)
+			&& file.getArray<SkinInfluenceMd5>(header.skinInfluencesOffset, header.numSkinVertices)
+			&& file.getArray<GLuint>(header.skinIndicesOffset, header.numSkinIndices)
+			&& readArray<uint32_t>(file, header.skinFirstIndicesOffset, header.numMeshes, m_skinFirstIndices)
+			&& hasValidIndices(file.getArray<SkinInfluenceMd5>(header.skinInfluencesOffset, header.numSkinVertices), header.numSkinVertices,
+				file.getArray<GLuint>(header.skinIndicesOffset, header.numSkinIndices), header.numSkinIndices, m_meshes, m_skinFirstIndices, m_numJoints)));
+
+	if (!isValid)
+	{
+		TRACE_ERROR(filename << " is corrupt, bake it again.", 0);
+		return false;
+	}
+
+	if (header.hasBaseFrame)
+	{
+		m_pBaseFrame = new FrameMd5();
+		m_pBaseFrame->m_joints = m_joints;
+	}
+
+	if (header.numSkinVertices)
+	{
+		m_pBakedFile = pFile;
+	}
+
+	return true;
+}
+
+void ModelMd5Resource::uploadBakedGpuSkinning()
+{
+	const MappedFile& file = *m_pBakedFile;
+	const md5bin::Header& header = *file.getArray<md5bin::Header>(0, 1);
+
+	uploadGpuSkinning(file.getArray<Vertex>(header.skinVerticesOffset, header.numSkinVertices), header.numSkinVertices,
+		file.getArray<SkinInfluenceMd5>(header.skinInfluencesOffset, header.numSkinVertices), header.numSkinVertices,
+		file.getArray<GLuint>(header.skinIndicesOffset, header.numSkinIndices), header.numSkinIndices);
+}
+
+} // namespace models
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace models
+{
+
+/**
+ * The baked md5 model (.md5bin), written by the CrimsonModelConverter from the text md5mesh and md5anim files and
+ * used in place from a file mapping (ModelMd5Resource::loadBinary()).
+ *
+ * Every section is an array of the records below (or of the runtime structs of the model, their sizes are in the
+ * header: a file baked with an other vertex layout is rejected), at an offset from the start of the file aligned to
+ * MD5BIN_ALIGNMENT. The data is what the text loader computes: the normalized vertex groups, the weight normals and
+ * tangents, the skinning layouts, the skeletons of the frames. The frames are quantized (MD5BIN_VERSION 1: 16 bits
+ * per component).
+ */
+namespace md5bin
+{
+
+static const uint32_t MD5BIN_MAGIC		= 0x42354d43;	// "CM5B"
+static const uint32_t MD5BIN_VERSION	= 1;
+static const uint32_t MD5BIN_ALIGNMENT	= 32;
+
+static const uint32_t MAX_NAME_LENGTH	= 64;
+
+struct Header
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	fileSize;
+
+	// the sizes of the runtime structs stored as they are
+	uint32_t	vertexSize;
+	uint32_t	vertexMd5Size;
+	uint32_t	weightMd5Size;
+	uint32_t	influenceSize;
+
+	uint32_t	numJoints;
+	uint32_t	numMeshes;
+	uint32_t	numAnims;
+	uint32_t	maxVertices;
+	uint32_t	maxTriangles;
+	uint32_t	hasBaseFrame;
+
+	uint32_t	jointsOffset;			// Joint[numJoints]: the bind pose
+	uint32_t	meshesOffset;			// Mesh[numMeshes]
+	uint32_t	animsOffset;			// Anim[numAnims]
+
+	// the gpu skinning buffers of all meshes (ModelMd5Resource::buildGpuSkinning())
+	uint32_t	numSkinVertices;
+	uint32_t	numSkinIndices;
+	uint32_t	skinVerticesOffset;		// Vertex[numSkinVertices]
+	uint32_t	skinInfluencesOffset;	// SkinInfluenceMd5[numSkinVertices]
+	uint32_t	skinIndicesOffset;		// uint32_t[numSkinIndices]
+	uint32_t	skinFirstIndicesOffset;	// uint32_t[numMeshes]
+};
+
+struct Joint
+{
+	char		name[MAX_NAME_LENGTH];
+	int32_t		parent;
+	float		pos[3];
+	float		orientation[4];			// s, x, y, z
+};
+
+struct Mesh
+{
+	uint32_t	numVertices;
+	uint32_t	numTriangles;
+	uint32_t	numWeights;
+
+	uint32_t	verticesOffset;			// VertexMd5[numVertices]
+	uint32_t	trianglesOffset;		// poly3[numTriangles]
+	uint32_t	weightsOffset;			// WeightMd5[numWeights]
+
+	// SkinWeightsMd5
+	uint32_t	numSkinGroups;
+	uint32_t	numSkinSlots;
+	uint32_t	groupFirstSlotsOffset;	// uint32_t[numSkinGroups + 1]
+	uint32_t	laneVerticesOffset;		// uint32_t[numSkinGroups * SKIN_LANES]
+	uint32_t	slotsOffset;			// SKIN_SLOT_ARRAYS arrays of numSkinSlots * SKIN_LANES 32 bit values, one after the other
+};
+
+// joints, bias, posX, posY, posZ, normalX, normalY, normalZ, tangentX, tangentY, tangentZ
+static const uint32_t SKIN_SLOT_ARRAYS = 11;
+
+struct Anim
+{
+	char		name[MAX_NAME_LENGTH];
+	uint32_t	numFrames;
+	uint32_t	frameRate;
+
+	uint32_t	boundsOffset;			// float[numFrames][6]: min, max
+	uint32_t	rangesOffset;			// JointRange[numJoints]
+	uint32_t	keysOffset;				// JointKey[numFrames][numJoints]
+};
+
+// the positions of a joint in a clip: pos = min + key * scale
+struct JointRange
+{
+	float		min[3];
+	float		scale[3];
+};
+
+// a joint of a frame in the model space
+struct JointKey
+{
+	uint16_t	pos[3];
+	int16_t		orientation[4];			// s, x, y, z * 32767
+};
+
+} // namespace md5bin
+
+} // namespace models
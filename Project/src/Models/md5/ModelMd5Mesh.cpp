@@ -1,22 +1,28 @@
 #include "GameStdAfx.h"
 #include "Models/md5/ModelMd5.h"
 
+#include "Common/AssetLoader.h"
 #include "Common/LuaManager.h"
 #include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+
+#include <algorithm>
 
 
 namespace models
 {
 
-bool ModelMd5::load(const char* meshFile, const char* animFile, MeshDirectory& meshDirectory, TextureDirectory& textureDirectory, const char* name, const bool justData)
+bool ModelMd5::load(const char* meshFile, const char* animFile, MeshDirectory& meshDirectory, TexturePool& textures, const char* name, const bool justData)
 {
-	ModelMd5* md5 = new ModelMd5();
+	TRACE_ZONE("ModelMd5::load");
 
-	if (md5->loadMesh(meshFile, textureDirectory, justData))
+	const std::shared_ptr<ModelMd5Resource> pResource = loadResource(meshFile, animFile, justData);
+	if (pResource)
 	{
-		if (animFile)
+		ModelMd5* md5 = new ModelMd5(pResource);
+		if (!justData)
 		{
-			md5->loadAnim(animFile);
+			md5->setupBuffers();
 		}
 		meshDirectory[name] = md5;
 
@@ -32,7 +38,189 @@ bool ModelMd5::load(const char* meshFile, const char* animFile, MeshDirectory& m
 	return false;
 }
 
-bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory, bool justSkeleton)
+/**
+ * The files are parsed by a worker of the asset loader, the buffers of the gpu skinning are built there too: only
+ * their upload is left to the main thread. The upload hands the resource to the instances of the placeholder alive
+ * by then (the model and its copies), it is dropped if there is none left.
+ * Without an asset loader (the tools) it is load(), nullptr if the model can't be loaded.
+ */
+ModelMd5* ModelMd5::loadAsync(const std::string& meshFile, const std::string& animFile)
+{
+	if (!AssetLoader::hasInstance())
+	{
+		const std::shared_ptr<ModelMd5Resource> pResource = loadResource(meshFile.c_str(), animFile.empty() ? nullptr : animFile.c_str(), false);
+		if (!pResource)
+		{
+			return nullptr;
+		}
+
+		ModelMd5* md5 = new ModelMd5(pResource);
+		md5->setupBuffers();
+		md5->m_currentAnimationName = utils::file::getFileName(animFile);
+
+		return md5;
+	}
+
+	// the placeholder: no meshes to render, no clips to play
+	std::shared_ptr<ModelMd5Resource> pPlaceholder = std::make_shared<ModelMd5Resource>();
+	pPlaceholder->m_isLoading = true;
+
+	ModelMd5* md5 = new ModelMd5(pPlaceholder);
+	md5->setupBuffers();
+
+	md5->m_currentAnimationName = utils::file::getFileName(animFile);
+
+#ifdef GX_DEBUG_INFO
+	md5->m_debug_meshFileName = meshFile;
+	md5->m_debug_animFileName = meshFile;
+#endif
+
+	// what the worker hands to the upload
+	struct LoadedMd5
+	{
+		std::shared_ptr<ModelMd5Resource>	pResource;
+
+		std::vector<Vertex>					skinVertices;
+		std::vector<SkinInfluenceMd5>		skinInfluences;
+		std::vector<GLuint>					skinIndices;
+	};
+
+	const std::shared_ptr<LoadedMd5> pLoaded = std::make_shared<LoadedMd5>();
+
+	// the instances own the placeholder: it is gone with the last of them
+	const std::weak_ptr<ModelMd5Resource> pWaitingPlaceholder = pPlaceholder;
+	pPlaceholder.reset();
+
+	AssetLoader::getInstance()->load(meshFile,
+		[pLoaded, meshFile, animFile]()
+		{
+			pLoaded->pResource = loadResource(meshFile.c_str(), animFile.empty() ? nullptr : animFile.c_str(), false);
+			if (!pLoaded->pResource)
+			{
+				return false;
+			}
+
+			// the baked buffers are uploaded from the mapping as they are
+			ModelMd5Resource& resource = *pLoaded->pResource;
+			if (!resource.m_pBakedFile && resource.m_pBaseFrame && resource.m_numJoints <= MAX_GPU_JOINTS)
+			{
+				resource.buildGpuSkinning(pLoaded->skinVertices, pLoaded->skinInfluences, pLoaded->skinIndices, resource.m_skinFirstIndices);
+			}
+
+			return true;
+		},
+		[pWaitingPlaceholder, pLoaded](const bool isLoaded)
+		{
+			const std::shared_ptr<ModelMd5Resource> pPlaceholder = pWaitingPlaceholder.lock();
+			if (!pPlaceholder)
+			{
+				return;
+			}
+
+			if (!isLoaded)
+			{
+				finishLoading(pPlaceholder.get(), nullptr);
+				return;
+			}
+
+			ModelMd5Resource& resource = *pLoaded->pResource;
+			if (resource.m_pBakedFile && resource.m_pBaseFrame && resource.m_numJoints <= MAX_GPU_JOINTS)
+			{
+				resource.setupGpuSkinning();
+			}
+			else if (!pLoaded->skinVertices.empty())
+			{
+				resource.uploadGpuSkinning(pLoaded->skinVertices.data(), pLoaded->skinVertices.size(), pLoaded->skinInfluences.data(), pLoaded->skinInfluences.size(),
+					pLoaded->skinIndices.data(), pLoaded->skinIndices.size());
+			}
+
+			finishLoading(pPlaceholder.get(), pLoaded->pResource);
+			pLoaded->pResource.reset();
+		});
+
+	return md5;
+}
+
+/**
+ * The instances are the models made by the placeholder: loadAsync() and the copies of its model.
+ */
+void ModelMd5::finishLoading(ModelMd5Resource* pPlaceholder, const std::shared_ptr<ModelMd5Resource>& pResource)
+{
+	std::vector<ModelMd5*> instances;
+	for (auto it = s_loadingModels.begin(); it != s_loadingModels.end(); )
+	{
+		if ((*it)->m_pResource.get() == pPlaceholder)
+		{
+			instances.push_back(*it);
+			it = s_loadingModels.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	pPlaceholder->m_isLoading = false;
+
+	if (pResource)
+	{
+		for (ModelMd5* pInstance : instances)
+		{
+			pInstance->setResource(pResource);
+		}
+	}
+}
+
+std::vector<ModelMd5*> ModelMd5::s_loadingModels;
+
+/**
+ * Whether the text files were edited after the model was baked: they are loaded instead till it is baked again.
+ */
+static bool isBakedFileStale(const std::string& bakedFile, const char* meshFile, const char* animFile)
+{
+	const time_t bakeTime = utils::file::getModificationTime(bakedFile);
+	const bool isStale = utils::file::getModificationTime(meshFile) > bakeTime
+		|| (animFile && utils::file::getModificationTime(animFile) > bakeTime);
+
+	if (isStale)
+	{
+		TRACE_INFO(bakedFile << " is older than its md5mesh/md5anim files, they are loaded instead (bake it again).", 0);
+	}
+
+	return isStale;
+}
+
+std::shared_ptr<ModelMd5Resource> ModelMd5::loadResource(const char* meshFile, const char* animFile, const bool justData)
+{
+	std::shared_ptr<ModelMd5Resource> pResource = std::make_shared<ModelMd5Resource>();
+
+	// the model baked by the CrimsonModelConverter next to the text one: no parsing, its clips are in it
+	bool isLoaded = false;
+
+	const std::string bakedFile = utils::file::getDir(meshFile) + utils::file::getFileName(meshFile) + ".md5bin";
+	if (utils::file::existFile(bakedFile) && !isBakedFileStale(bakedFile, meshFile, animFile))
+	{
+		isLoaded = pResource->loadBinary(bakedFile.c_str());
+		if (!isLoaded)
+		{
+			pResource = std::make_shared<ModelMd5Resource>();
+		}
+	}
+
+	if (!isLoaded && !pResource->loadMesh(meshFile, justData))
+	{
+		return nullptr;
+	}
+
+	if (animFile && pResource->getAnimations().count(utils::file::getFileName(animFile)) == 0)
+	{
+		pResource->loadAnim(animFile);
+	}
+
+	return pResource;
+}
+
+bool ModelMd5Resource::loadMesh(const char* filename, bool justSkeleton)
 {
 	char buff[512];
 	uint curr_mesh = 0;
@@ -40,18 +228,19 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 
 	int maxWeightCount = 0;
 
-	FILE* fp;
-	fp = fopen(filename, "rb");
-	if (!fp)
+	// from the mounted asset pack or the disk
+	std::string data;
+	if (!utils::file::readFile(filename, data))
 	{
 		TRACE_ERROR("Error: couldn't open " << filename, 0);
 		return 0;
 	}
+	std::istringstream file(data);
 
-	while (!feof(fp))
+	while (file)
 	{
 		// Read whole line
-		fgets(buff, sizeof(buff), fp);
+		utils::file::getLine(file, buff, sizeof(buff));
 
 		int version;
 		if (sscanf(buff, " MD5Version %d", &version) == 1)
@@ -60,7 +249,6 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 			{
 				// Bad version
 				fprintf(stderr, "Error: bad model version\n");
-				fclose(fp);
 				return 0;
 			}
 		}
@@ -79,8 +267,6 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 				// Allocate memory for meshes
 				m_meshes.resize(m_numMeshes);
 			}
-
-			m_numObjects = m_numMeshes;
 		}
 		else if (strncmp(buff, "joints {", 8) == 0)
 		{
@@ -89,7 +275,7 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 			{
 				char name[64];
 				// Read whole line
-				fgets(buff, sizeof(buff), fp);
+				utils::file::getLine(file, buff, sizeof(buff));
 
 				/*
 				 if (sscanf(buff, "%s %d ( %f %f %f ) ( %f %f %f )", name, &joint->parent, &joint->pos.x, &joint->pos.y, &joint->pos.z, &joint->orientation.x, &joint->orientation.y,
@@ -130,10 +316,10 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 			float fdata[4];
 			int idata[3];
 
-			while ((buff[0] != '}') && !feof(fp))
+			while ((buff[0] != '}') && file)
 			{
 				// Read whole line
-				fgets(buff, sizeof(buff), fp);
+				utils::file::getLine(file, buff, sizeof(buff));
 
 				if (strstr(buff, "shader "))
 				{
@@ -159,7 +345,7 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 				{
 					if (mesh->numVertices > 0)
 					{
-						mesh->pVertices = new VertexMd5[mesh->numVertices];
+						mesh->vertices.resize(mesh->numVertices);
 					}
 
 					if (mesh->numVertices > m_maxVertices)
@@ -172,7 +358,7 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 				{
 					if (mesh->numTriangles > 0)
 					{
-						mesh->pTriangles = new poly3[mesh->numTriangles];
+						mesh->triangles.resize(mesh->numTriangles);
 					}
 
 					if (mesh->numTriangles > m_maxTriangles)
@@ -185,16 +371,16 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 				{
 					if (mesh->numWeights > 0)
 					{
-						mesh->pWeights = new Weight[mesh->numWeights];
+						mesh->weights.resize(mesh->numWeights);
 					}
 				}
 				else if (sscanf(buff, " vert %d ( %f %f ) %d %d", &vert_index, &fdata[0], &fdata[1], &idata[0], &idata[1]) == 5)
 				{
 					// Copy vertex data
-					mesh->pVertices[vert_index].texCoord.u = fdata[0];
-					mesh->pVertices[vert_index].texCoord.v = 1.0f - fdata[1];
-					mesh->pVertices[vert_index].weightIndex = idata[0];
-					mesh->pVertices[vert_index].weightCount = idata[1];
+					mesh->vertices[vert_index].texCoord.u = fdata[0];
+					mesh->vertices[vert_index].texCoord.v = 1.0f - fdata[1];
+					mesh->vertices[vert_index].weightIndex = idata[0];
+					mesh->vertices[vert_index].weightCount = idata[1];
 
 					if (idata[1] > maxWeightCount)
 					{
@@ -205,36 +391,29 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 				else if (sscanf(buff, " tri %d %d %d %d", &tri_index, &idata[0], &idata[1], &idata[2]) == 4)
 				{
 					// Copy triangle data
-					mesh->pTriangles[tri_index].a = idata[2];
-					mesh->pTriangles[tri_index].b = idata[1];
-					mesh->pTriangles[tri_index].c = idata[0];
+					mesh->triangles[tri_index].a = idata[2];
+					mesh->triangles[tri_index].b = idata[1];
+					mesh->triangles[tri_index].c = idata[0];
 
 				}
 				else if (sscanf(buff, " weight %d %d %f ( %f %f %f )", &weight_index, &idata[0], &fdata[3], &fdata[0], &fdata[1], &fdata[2]) == 6)
 				{
 					// Copy vertex data
-					mesh->pWeights[weight_index].joint = idata[0];
-					mesh->pWeights[weight_index].w = fdata[3];
-					mesh->pWeights[weight_index].pos.x = fdata[0];
-					mesh->pWeights[weight_index].pos.y = fdata[1];
-					mesh->pWeights[weight_index].pos.z = fdata[2];
+					mesh->weights[weight_index].joint = idata[0];
+					mesh->weights[weight_index].w = fdata[3];
+					mesh->weights[weight_index].pos.x = fdata[0];
+					mesh->weights[weight_index].pos.y = fdata[1];
+					mesh->weights[weight_index].pos.z = fdata[2];
 				}
 			}
 
 			curr_mesh++;
 		}
 	}
-	fclose(fp);
 
 	if (!justSkeleton)
 	{
-		m_pVertexIndices = new GLuint[m_maxTriangles * 3];
-		m_pVertexArrayDynamic = new Vertex[m_maxVertices];
-
 		normalizeVertexGroups();
-
-		glGenBuffers(1, &m_indicesVboId);
-		glGenBuffers(1, &m_verticesVboId);
 	}
 
 	return true;
@@ -242,12 +421,12 @@ bool ModelMd5::loadMesh(const char* filename, TextureDirectory& textureDirectory
 
 //#define SERIALIZE_FIXED_DATA
 
-void ModelMd5::normalizeVertexGroups()
+void ModelMd5Resource::normalizeVertexGroups()
 {
 	float epsilon = 0.3;
 
-	VertexMd5* vertices = 0;
-	Weight* weights = 0;
+	std::vector<VertexMd5> vertices;
+	std::vector<WeightMd5> weights;
 
 #ifdef SERIALIZE_FIXED_DATA
 	std::ofstream out;
@@ -260,7 +439,7 @@ void ModelMd5::normalizeVertexGroups()
 
 		for (uint wi = 0; wi < mesh.numWeights; wi++)
 		{
-			if (mesh.pWeights[wi].w <= epsilon)
+			if (mesh.weights[wi].w <= epsilon)
 			{
 				numWeights--;
 			}
@@ -269,14 +448,14 @@ void ModelMd5::normalizeVertexGroups()
 		// are there any isolated vertices?
 		for (uint vi = 0; vi < mesh.numVertices; vi++)
 		{
-			VertexMd5* vert = &mesh.pVertices[vi];
+			VertexMd5* vert = &mesh.vertices[vi];
 
 			bool allZero = true;
-			int wi = mesh.pVertices[vi].weightIndex;
+			int wi = mesh.vertices[vi].weightIndex;
 
-			while (wi < mesh.pVertices[vi].weightIndex + mesh.pVertices[vi].weightCount)
+			while (wi < mesh.vertices[vi].weightIndex + mesh.vertices[vi].weightCount)
 			{
-				if (mesh.pWeights[wi].w > epsilon)
+				if (mesh.weights[wi].w > epsilon)
 				{
 					allZero = false;
 				}
@@ -286,27 +465,24 @@ void ModelMd5::normalizeVertexGroups()
 			if (allZero)
 			{
 				numWeights++;
-				int wi = mesh.pVertices[vi].weightIndex;
-				while (wi < mesh.pVertices[vi].weightIndex + mesh.pVertices[vi].weightCount)
+				int wi = mesh.vertices[vi].weightIndex;
+				while (wi < mesh.vertices[vi].weightIndex + mesh.vertices[vi].weightCount)
 				{
-					mesh.pWeights[wi].w = 0.0f;
+					mesh.weights[wi].w = 0.0f;
 					wi++;
 				}
 
-				mesh.pWeights[mesh.pVertices[vi].weightIndex].w = 1.0f;
-				wi = mesh.pVertices[vi].weightIndex + 1;
-				while (wi < mesh.pVertices[vi].weightIndex + mesh.pVertices[vi].weightCount)
+				mesh.weights[mesh.vertices[vi].weightIndex].w = 1.0f;
+				wi = mesh.vertices[vi].weightIndex + 1;
+				while (wi < mesh.vertices[vi].weightIndex + mesh.vertices[vi].weightCount)
 				{
 					++wi;
 				}
 			}
 		}
 
-		//SAFEDEL2(weights);
-		weights = new Weight[numWeights];
-
-		//SAFEDEL2(vertices);
-		vertices = new VertexMd5[mesh.numVertices];
+		weights.assign(numWeights, WeightMd5());
+		vertices.assign(mesh.numVertices, VertexMd5());
 
 		TRACE_INFO("old numWeights: " << mesh.numWeights, 0);
 		TRACE_INFO("new numWeights: " << numWeights, 0);
@@ -319,26 +495,26 @@ void ModelMd5::normalizeVertexGroups()
 		{
 			float sum = 0.0f;
 			int badWeights = 0;
-			int wi = mesh.pVertices[vi].weightIndex;
+			int wi = mesh.vertices[vi].weightIndex;
 
 			vertices[vi].weightIndex = weightIdx;
-			while (wi < mesh.pVertices[vi].weightIndex + mesh.pVertices[vi].weightCount)
+			while (wi < mesh.vertices[vi].weightIndex + mesh.vertices[vi].weightCount)
 			{
-				if (mesh.pWeights[wi].w <= epsilon)
+				if (mesh.weights[wi].w <= epsilon)
 				{
 					badWeights++;
 				}
 				else
 				{
-					weights[weightIdx] = mesh.pWeights[wi];
-					sum += mesh.pWeights[wi].w;
+					weights[weightIdx] = mesh.weights[wi];
+					sum += mesh.weights[wi].w;
 					weightIdx++;
 				}
 				++wi;
 			}
 
-			vertices[vi].texCoord = mesh.pVertices[vi].texCoord;
-			vertices[vi].weightCount = mesh.pVertices[vi].weightCount - badWeights;
+			vertices[vi].texCoord = mesh.vertices[vi].texCoord;
+			vertices[vi].weightCount = mesh.vertices[vi].weightCount - badWeights;
 
 			//float sum2 = 0.0;
 			// normalizing the weights
@@ -362,7 +538,7 @@ void ModelMd5::normalizeVertexGroups()
 		for (int ti = 0; ti < mesh.numTriangles; ti++)
 		{
 			// tri [triIndex] [vertIndex1] [vertIndex2] [vertIndex3]
-			out << "\ttri " << ti << " " << mesh.pTriangles[ti].a << " " << mesh.pTriangles[ti].b << " " << mesh.pTriangles[ti].c << std::endl;
+			out << "\ttri " << ti << " " << mesh.triangles[ti].a << " " << mesh.triangles[ti].b << " " << mesh.triangles[ti].c << std::endl;
 		}
 
 		out << std::endl;
@@ -373,12 +549,9 @@ void ModelMd5::normalizeVertexGroups()
 			out << "\tweight " << i << " " << weights[i].joint << " " << weights[i].w << " ( " << weights[i].pos.x << " " << weights[i].pos.y << " " << weights[i].pos.z << " )" << std::endl;
 		}
 #endif
-		SAFEDEL2(mesh.pVertices);
-		SAFEDEL2(mesh.pWeights);
-
 		mesh.numWeights = numWeights;
-		mesh.pVertices = vertices;
-		mesh.pWeights = weights;
+		mesh.vertices.swap(vertices);
+		mesh.weights.swap(weights);
 	}
 
 #ifdef SERIALIZE_FIXED_DATA
@@ -389,52 +562,135 @@ void ModelMd5::normalizeVertexGroups()
 // --------------------------------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------------------------------
 
-ModelMd5::ModelMd5()
-	: m_pVertexIndices(nullptr)
-	, m_pVertexArrayDynamic(nullptr)
-
-	, m_numJoints(0)
+ModelMd5Resource::ModelMd5Resource()
+	: m_numJoints(0)
 	, m_numMeshes(0)
 
 	, m_pBaseFrame(nullptr)
-	, m_pCurrentFrame(nullptr)
 
 	, m_maxVertices(0)
 	, m_maxTriangles(0)
+
+	, m_skinVerticesVboId(0)
+	, m_skinInfluencesVboId(0)
+	, m_skinIndicesVboId(0)
+
+	, m_isLoading(false)
 {
 }
 
-ModelMd5* ModelMd5::copy()
+ModelMd5Resource::~ModelMd5Resource()
+{
+	if (m_skinVerticesVboId)
+	{
+		const GLuint skinVbos[3] = { m_skinVerticesVboId, m_skinInfluencesVboId, m_skinIndicesVboId };
+		glDeleteBuffers(3, skinVbos);
+	}
+
+	SAFEDEL(m_pBaseFrame)
+}
+
+
+ModelMd5::ModelMd5()
+	: ModelMd5(std::make_shared<ModelMd5Resource>())
+{
+}
+
+ModelMd5::ModelMd5(const std::shared_ptr<ModelMd5Resource>& pResource)
+	: m_pCurrentFrame(nullptr)
+
+	, m_poseKey()
+	, m_isPosePending(false)
+
+	, m_animationLod(0)
+	, m_numSkippedUpdates(0)
+
+	, m_cameraDistance(0.0f)
+	, m_lastRenderFrame(0)
+
+	, m_uploadedMesh(-1)
+
+	, m_isGpuSkinned(false)
+	, m_hasPaletteChanged(true)
+
+	, m_bonesLoc(-1)
+	, m_boneIdsLoc(-1)
+	, m_boneWeightsLoc(-1)
+{
+	setResource(pResource);
+}
+
+void ModelMd5::setResource(const std::shared_ptr<ModelMd5Resource>& pResource)
 {
-	ModelMd5* copy = new ModelMd5();
+	if (m_isPosePending)
+	{
+		s_pendingPoses.erase(std::find(s_pendingPoses.begin(), s_pendingPoses.end(), this));
+		m_isPosePending = false;
+	}
 
-	copy->m_numJoints = m_numJoints;
-	copy->m_numMeshes = m_numMeshes;
-	copy->m_maxVertices = m_maxVertices;
-	copy->m_maxTriangles = m_maxTriangles;
+	// the instances of a placeholder wait for the loaded resource
+	if (m_pResource != pResource)
+	{
+		if (m_pResource && m_pResource->m_isLoading)
+		{
+			s_loadingModels.erase(std::find(s_loadingModels.begin(), s_loadingModels.end(), this));
+		}
 
-	copy->m_meshes = m_meshes;
-	copy->m_joints = m_joints;
-	copy->m_animations = m_animations;
+		if (pResource->m_isLoading)
+		{
+			s_loadingModels.push_back(this);
+		}
+	}
 
-	copy->m_pVertexIndices = new GLuint[m_maxTriangles * 3];
-	copy->m_pVertexArrayDynamic = new Vertex[m_maxVertices];
+	m_pResource = pResource;
+	m_numObjects = m_pResource->m_numMeshes;
 
-	copy->m_pBaseFrame = new FrameMd5();
-	copy->m_pBaseFrame->m_joints.resize(copy->m_joints.size());
-	copy->m_pBaseFrame->m_joints = copy->m_joints;
+	m_pPose.reset();
+	m_poseKey = PoseKeyMd5();
 
-	AnimMd5& currentAnimation = copy->m_animations[m_currentAnimationName];
-	currentAnimation.animInfo.currentFrame = 0;
-	currentAnimation.animInfo.nextFrame = 1;
-	currentAnimation.animInfo.lastTime = 0;
-	currentAnimation.animInfo.maxTime = 1.0 / copy->m_animations[m_currentAnimationName].frameRate;
+	SAFEDEL(m_pCurrentFrame)
+	if (m_pResource->m_pBaseFrame)
+	{
+		m_pCurrentFrame = new FrameMd5();
+		*m_pCurrentFrame = *m_pResource->m_pBaseFrame;
+	}
+
+	m_animInfos.clear();
+	for (const auto& animation : m_pResource->m_animations)
+	{
+		m_animInfos[animation.first].maxTime = 1.0 / animation.second.frameRate;
+	}
+
+	m_skinnedVertices.clear();
+	m_uploadedMesh = -1;
+
+	m_hasStanceChanged = true;
+	m_hasPaletteChanged = true;
+}
+
+/**
+ * The buffers of the cpu skinning, the server (justData) does not need them.
+ */
+void ModelMd5::setupBuffers()
+{
+	glGenBuffers(1, &m_indicesVboId);
+	glGenBuffers(1, &m_verticesVboId);
+}
+
+ModelMd5* ModelMd5::copy()
+{
+	ModelMd5* copy = new ModelMd5(m_pResource);
+
+	copy->m_currentAnimationName = m_currentAnimationName;
+	copy->m_animationLod = m_animationLod;
 
 	copy->m_isAnimationOn = true;
 	copy->m_hasStanceChanged = true;
 
-	copy->m_pCurrentFrame = new FrameMd5();
-	*copy->m_pCurrentFrame = *copy->m_pBaseFrame;
+	if (m_verticesVboId)
+	{
+		copy->setupBuffers();
+	}
 
 	//copy->ragdoll->setupRagdoll(copy->currentFrame);
 
@@ -443,10 +699,22 @@ ModelMd5* ModelMd5::copy()
 
 ModelMd5::~ModelMd5()
 {
-	SAFEDEL2(m_pVertexIndices);
-	SAFEDEL2(m_pVertexArrayDynamic);
+	if (m_isPosePending)
+	{
+		s_pendingPoses.erase(std::find(s_pendingPoses.begin(), s_pendingPoses.end(), this));
+	}
+
+	if (m_pResource->m_isLoading)
+	{
+		s_loadingModels.erase(std::find(s_loadingModels.begin(), s_loadingModels.end(), this));
+	}
+
+	if (m_verticesVboId)
+	{
+		const GLuint vbos[2] = { m_indicesVboId, m_verticesVboId };
+		glDeleteBuffers(2, vbos);
+	}
 
-	SAFEDEL(m_pBaseFrame)
 	SAFEDEL(m_pCurrentFrame)
 }
 
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <tuple>
+#include <boost/align/aligned_allocator.hpp>
+
+#include "Models/md5/Skeleton.h"
+#include "Models/mesh/Object.h"
+
+class MappedFile;
+
+
+namespace models
+{
+
+template <typename T>
+using AlignedVector = std::vector<T, boost::alignment::aligned_allocator<T, 32>>;
+
+// the vertices of the cpu skinning kernels are skinned in groups of SKIN_LANES
+static const uint SKIN_LANES = 8;
+
+// the time between two key frames is quantized into POSE_BLEND_STEPS poses (at the full animation lod)
+static const uint POSE_BLEND_STEPS = 16;
+
+
+struct VertexMd5
+{
+	//vert vertIndex ( s t ) startWeight countWeight
+	int			weightIndex;
+	int			weightCount;
+
+	texCoord	texCoord;
+};
+
+struct JointInfoMd5
+{
+	//"name" parent flags startIndex
+	std::string	name;
+	int			parent;
+	int			flags;
+	int			startIndex;
+};
+
+struct WeightMd5
+{
+	int			joint;
+	float		w;
+	vec3		pos;
+	vec3		normal;
+	vec3		tangent;
+	vec3		bitangent;
+};
+
+struct MeshMd5
+{
+	GLuint						texid;
+	GLuint						normalMap;
+	GLuint						heightMap;
+	GLuint						normalHeightMap;
+
+	uint						numVertices;
+	uint						numTriangles;
+	uint						numWeights;
+
+	std::vector<VertexMd5>		vertices;
+	std::vector<poly3>			triangles;
+	std::vector<WeightMd5>		weights;
+
+	MeshMd5()
+		: texid(0)
+		, normalMap(0)
+		, heightMap(0)
+		, normalHeightMap(0)
+
+		, numVertices(0)
+		, numTriangles(0)
+		, numWeights(0)
+	{
+	}
+};
+
+// an animation clip: the skeletons of its frames
+struct AnimMd5
+{
+	uint					numFrames;
+	uint					frameRate;
+	std::vector<FrameMd5>	frames;
+
+	AnimMd5()
+		: numFrames(0)
+		, frameRate(0)
+	{
+	}
+};
+
+// a clip at a quantized time: the key frames and the blend step between them
+struct PoseKeyMd5
+{
+	const AnimMd5*	pAnim;
+	int				frame1;
+	int				frame2;
+	uint			blend;		// [0, POSE_BLEND_STEPS]
+
+	bool operator==(const PoseKeyMd5& other) const
+	{
+		return pAnim == other.pAnim && frame1 == other.frame1 && frame2 == other.frame2 && blend == other.blend;
+	}
+
+	bool operator<(const PoseKeyMd5& other) const
+	{
+		return std::tie(pAnim, frame1, frame2, blend) < std::tie(other.pAnim, other.frame1, other.frame2, other.blend);
+	}
+};
+
+// a pose shared by the instances showing the same clip at the same quantized time
+struct PoseMd5
+{
+	std::vector<JointMd5>	joints;
+	std::vector<Vertex>		vertices;	// the cpu skinned meshes one after the other, empty until the first cpu skinning
+};
+
+// the 4 strongest weights of a vertex (a_boneIds, a_boneWeights)
+struct SkinInfluenceMd5
+{
+	GLubyte		joints[4];
+	float		weights[4];
+};
+
+// the weights of a mesh for the cpu skinning kernels: the vertices in groups of SKIN_LANES, the weights of a group
+// in slots (one weight of every vertex of the group, zero weights after the last one), every attribute in its own
+// array indexed by slot * SKIN_LANES + lane
+struct SkinWeightsMd5
+{
+	std::vector<uint>		groupFirstSlots;	// numGroups + 1
+	std::vector<uint>		laneVertices;		// the vertex of a lane, UINT32_MAX: no vertex
+
+	AlignedVector<int32_t>	joints;
+	AlignedVector<float>	bias;
+	AlignedVector<float>	posX, posY, posZ;	// scaled like in skinMesh()
+	AlignedVector<float>	normalX, normalY, normalZ;
+	AlignedVector<float>	tangentX, tangentY, tangentZ;
+
+	uint getNumGroups() const { return (uint)groupFirstSlots.size() - 1; }
+};
+
+
+/**
+ * @brief The data of an md5 model shared by its instances (ModelMd5): the meshes, the bind pose, the animation clips
+ * and the skinning layouts built from them.
+ *
+ * It does not change after the loading (except the gl buffers of the gpu skinning, created by the first render, and
+ * the cache of the poses shown by the instances), the state of an instance (clip, time, dynamic buffers) is in the ModelMd5.
+ */
+class ModelMd5Resource
+{
+	friend class ModelMd5;
+
+public:
+	ModelMd5Resource();
+	~ModelMd5Resource();
+
+	// mesh
+	bool loadMesh(const char* filename, bool justSkeleton = false);	// justSkeleton for the server
+	// anim
+	bool loadAnim(const char* filename);
+
+	// the baked model (md5bin::Header) with its clips
+	bool loadBinary(const char* filename);
+	bool saveBinary(const char* filename) const;
+
+	void setupGpuSkinning();
+
+	// getters-setters
+	uint getNumJoints() const { return m_numJoints; }
+	uint getNumMeshes() const { return m_numMeshes; }
+
+	const std::map<const std::string, AnimMd5>& getAnimations() const { return m_animations; }
+	uint getNumCachedPoses() const { return (uint)m_poseCache.size(); }
+
+private:
+	ModelMd5Resource(const ModelMd5Resource& other);
+	ModelMd5Resource& operator=(const ModelMd5Resource& other);
+
+	void normalizeVertexGroups();
+
+	void computeWeightNormals();
+	void computeWeightTangents();
+
+	bool buildFrameSkeleton(AnimMd5& anim, JointInfoMd5* pJointInfos, std::vector<JointMd5>& baseFrameJoints, const float* pAnimFrameData, int frameIndex);
+
+	void evaluatePose(const PoseKeyMd5& key, PoseMd5& pose) const;
+	void trimPoseCache();
+
+	void buildSkinWeights();
+
+	void buildGpuSkinning(std::vector<Vertex>& vertices, std::vector<SkinInfluenceMd5>& influences, std::vector<GLuint>& indices, std::vector<uint>& firstIndices) const;
+	void uploadGpuSkinning(const Vertex* pVertices, const size_t numVertices, const SkinInfluenceMd5* pInfluences, const size_t numInfluences, const GLuint* pIndices, const size_t numIndices);
+	void uploadBakedGpuSkinning();
+
+private:
+	uint									m_numJoints;
+	uint									m_numMeshes;
+
+	std::vector<JointMd5>					m_joints;
+	std::vector<MeshMd5>					m_meshes;
+
+	FrameMd5*								m_pBaseFrame;
+
+	uint									m_maxVertices;
+	uint									m_maxTriangles;
+
+	std::map<const std::string, AnimMd5>	m_animations;
+
+	// cpu skinning
+	std::vector<SkinWeightsMd5>				m_skinWeights;
+
+	// gpu skinning: the bind pose vertices, their joint weights and the indices of every mesh
+	GLuint									m_skinVerticesVboId;
+	GLuint									m_skinInfluencesVboId;
+	GLuint									m_skinIndicesVboId;
+	std::vector<uint>						m_skinFirstIndices;
+
+	// the baked model the gpu skinning buffers are uploaded from, released after the upload
+	std::shared_ptr<MappedFile>				m_pBakedFile;
+
+	// the poses of the instances (ModelMd5::updatePoses()), the ones no instance shows are dropped above MAX_CACHED_POSES
+	static const uint						MAX_CACHED_POSES = 256;
+
+	std::map<PoseKeyMd5, std::shared_ptr<PoseMd5>>	m_poseCache;
+
+	// the placeholder of ModelMd5::loadAsync(): its instances get the loaded resource
+	bool									m_isLoading;
+};
+
+} // namespace models
@@ -0,0 +1,363 @@
+#include "GameStdAfx.h"
+#include "Models/md5/ModelMd5.h"
+#include "Common/JobPool.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+namespace models
+{
+
+/**
+ * Lays out the weights for the skinning kernels (SkinWeightsMd5). The vertices are sorted by their weight count,
+ * so the vertices of a group have about the same number of weights (and the slots little padding).
+ */
+void ModelMd5Resource::buildSkinWeights()
+{
+	static const float scale = 1.2f;
+
+	m_skinWeights.clear();
+	m_skinWeights.resize(m_meshes.size());
+
+	for (uint m = 0; m < m_meshes.size(); m++)
+	{
+		const MeshMd5& mesh = m_meshes[m];
+		SkinWeightsMd5& skin = m_skinWeights[m];
+
+		std::vector<uint> vertexOrder(mesh.numVertices);
+		std::iota(vertexOrder.begin(), vertexOrder.end(), 0);
+		std::stable_sort(vertexOrder.begin(), vertexOrder.end(), [&mesh](uint a, uint b)
+		{
+			return mesh.vertices[a].weightCount < mesh.vertices[b].weightCount;
+		});
+
+		const uint numGroups = (mesh.numVertices + SKIN_LANES - 1) / SKIN_LANES;
+		skin.groupFirstSlots.resize(numGroups + 1);
+		skin.laneVertices.assign(numGroups * SKIN_LANES, UINT32_MAX);
+
+		uint numSlots = 0;
+		for (uint g = 0; g < numGroups; g++)
+		{
+			skin.groupFirstSlots[g] = numSlots;
+
+			int maxWeightCount = 0;
+			for (uint lane = 0; lane < SKIN_LANES && g * SKIN_LANES + lane < mesh.numVertices; lane++)
+			{
+				const uint vertexIndex = vertexOrder[g * SKIN_LANES + lane];
+				skin.laneVertices[g * SKIN_LANES + lane] = vertexIndex;
+				maxWeightCount = std::max(maxWeightCount, mesh.vertices[vertexIndex].weightCount);
+			}
+
+			numSlots += maxWeightCount;
+		}
+		skin.groupFirstSlots[numGroups] = numSlots;
+
+		// the empty slots are zero weights of the joint 0
+		const size_t numElements = numSlots * SKIN_LANES;
+		skin.joints.assign(numElements, 0);
+		for (AlignedVector<float>* pArray : { &skin.bias, &skin.posX, &skin.posY, &skin.posZ, &skin.normalX, &skin.normalY, &skin.normalZ, &skin.tangentX, &skin.tangentY, &skin.tangentZ })
+		{
+			pArray->assign(numElements, 0.0f);
+		}
+
+		for (uint g = 0; g < numGroups; g++)
+		{
+			for (uint lane = 0; lane < SKIN_LANES; lane++)
+			{
+				const uint vertexIndex = skin.laneVertices[g * SKIN_LANES + lane];
+				if (vertexIndex == UINT32_MAX)
+				{
+					continue;
+				}
+
+				const VertexMd5& currentVertex = mesh.vertices[vertexIndex];
+				for (int j = 0; j < currentVertex.weightCount; j++)
+				{
+					const WeightMd5& weight = mesh.weights[currentVertex.weightIndex + j];
+					const size_t i = (skin.groupFirstSlots[g] + j) * SKIN_LANES + lane;
+
+					skin.joints[i] = weight.joint;
+					skin.bias[i] = weight.w;
+
+					skin.posX[i] = weight.pos.x * scale;
+					skin.posY[i] = weight.pos.y * scale;
+					skin.posZ[i] = weight.pos.z * scale;
+
+					skin.normalX[i] = weight.normal.x;
+					skin.normalY[i] = weight.normal.y;
+					skin.normalZ[i] = weight.normal.z;
+
+					skin.tangentX[i] = weight.tangent.x;
+					skin.tangentY[i] = weight.tangent.y;
+					skin.tangentZ[i] = weight.tangent.z;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * The joints of a skeleton as the rows of their 3x4 matrices (rotation | position), 12 floats per joint.
+ */
+void ModelMd5::computeSkinPalette(const std::vector<JointMd5>& skeleton, AlignedVector<float>& palette) const
+{
+	palette.resize(skeleton.size() * 12);
+
+	for (uint i = 0; i < skeleton.size(); i++)
+	{
+		const JointMd5& joint = skeleton[i];
+
+		float rotation[16];
+		joint.orientation.toFloatMatrix(rotation);
+
+		float* pRows = &palette[i * 12];
+		const float position[3] = { joint.pos.x, joint.pos.y, joint.pos.z };
+		for (int row = 0; row < 3; row++)
+		{
+			pRows[row * 4 + 0] = rotation[row];
+			pRows[row * 4 + 1] = rotation[4 + row];
+			pRows[row * 4 + 2] = rotation[8 + row];
+			pRows[row * 4 + 3] = position[row];
+		}
+	}
+}
+
+
+#ifdef MATH_SSE
+/**
+ * Loads a row of the joint matrices of 4 lanes, transposed: c0..c3 hold the columns of the row in the lanes.
+ */
+static inline void loadJointRows(const float* pPalette, const int32_t* pJoints, const int row, __m128& c0, __m128& c1, __m128& c2, __m128& c3)
+{
+	c0 = _mm_load_ps(pPalette + pJoints[0] * 12 + row * 4);
+	c1 = _mm_load_ps(pPalette + pJoints[1] * 12 + row * 4);
+	c2 = _mm_load_ps(pPalette + pJoints[2] * 12 + row * 4);
+	c3 = _mm_load_ps(pPalette + pJoints[3] * 12 + row * 4);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+}
+#endif
+
+/**
+ * Skins the vertex groups [firstGroup, endGroup) of a mesh with the joint rows of pPalette into pVertices
+ * (indexed by the vertex index of the mesh). The lanes of a group are skinned at once: 8 with avx, 4 with sse.
+ */
+void ModelMd5::skinVertexGroups(const uint meshIndex, const float* pPalette, const uint firstGroup, const uint endGroup, Vertex* pVertices) const
+{
+	const MeshMd5& mesh = m_pResource->m_meshes[meshIndex];
+	const SkinWeightsMd5& skin = m_pResource->m_skinWeights[meshIndex];
+
+	// position, normal, tangent (xyz) of the lanes
+	alignas(32) float results[9][SKIN_LANES];
+
+	for (uint g = firstGroup; g < endGroup; g++)
+	{
+		const size_t firstElement = skin.groupFirstSlots[g] * SKIN_LANES;
+		const size_t endElement = skin.groupFirstSlots[g + 1] * SKIN_LANES;
+
+#if defined(MATH_AVX)
+		__m256 sums[9];
+		for (__m256& sum : sums)
+		{
+			sum = _mm256_setzero_ps();
+		}
+
+		for (size_t i = firstElement; i < endElement; i += SKIN_LANES)
+		{
+			const __m256 bias = _mm256_load_ps(&skin.bias[i]);
+			const __m256 px = _mm256_load_ps(&skin.posX[i]);
+			const __m256 py = _mm256_load_ps(&skin.posY[i]);
+			const __m256 pz = _mm256_load_ps(&skin.posZ[i]);
+			const __m256 nx = _mm256_load_ps(&skin.normalX[i]);
+			const __m256 ny = _mm256_load_ps(&skin.normalY[i]);
+			const __m256 nz = _mm256_load_ps(&skin.normalZ[i]);
+			const __m256 tx = _mm256_load_ps(&skin.tangentX[i]);
+			const __m256 ty = _mm256_load_ps(&skin.tangentY[i]);
+			const __m256 tz = _mm256_load_ps(&skin.tangentZ[i]);
+
+			for (int row = 0; row < 3; row++)
+			{
+				__m128 lo[4], hi[4];
+				loadJointRows(pPalette, &skin.joints[i], row, lo[0], lo[1], lo[2], lo[3]);
+				loadJointRows(pPalette, &skin.joints[i + 4], row, hi[0], hi[1], hi[2], hi[3]);
+
+				__m256 c[4];
+				for (int k = 0; k < 4; k++)
+				{
+					c[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo[k]), hi[k], 1);
+				}
+
+				const __m256 pos = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0], px), _mm256_mul_ps(c[1], py)), _mm256_add_ps(_mm256_mul_ps(c[2], pz), c[3]));
+				const __m256 normal = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0], nx), _mm256_mul_ps(c[1], ny)), _mm256_mul_ps(c[2], nz));
+				const __m256 tangent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0], tx), _mm256_mul_ps(c[1], ty)), _mm256_mul_ps(c[2], tz));
+
+				sums[row] = _mm256_add_ps(sums[row], _mm256_mul_ps(bias, pos));
+				sums[3 + row] = _mm256_add_ps(sums[3 + row], _mm256_mul_ps(bias, normal));
+				sums[6 + row] = _mm256_add_ps(sums[6 + row], _mm256_mul_ps(bias, tangent));
+			}
+		}
+
+		for (int k = 0; k < 9; k++)
+		{
+			_mm256_store_ps(results[k], sums[k]);
+		}
+#elif defined(MATH_SSE)
+		for (uint half = 0; half < SKIN_LANES; half += 4)
+		{
+			__m128 sums[9];
+			for (__m128& sum : sums)
+			{
+				sum = _mm_setzero_ps();
+			}
+
+			for (size_t i = firstElement + half; i < endElement; i += SKIN_LANES)
+			{
+				const __m128 bias = _mm_load_ps(&skin.bias[i]);
+				const __m128 px = _mm_load_ps(&skin.posX[i]);
+				const __m128 py = _mm_load_ps(&skin.posY[i]);
+				const __m128 pz = _mm_load_ps(&skin.posZ[i]);
+				const __m128 nx = _mm_load_ps(&skin.normalX[i]);
+				const __m128 ny = _mm_load_ps(&skin.normalY[i]);
+				const __m128 nz = _mm_load_ps(&skin.normalZ[i]);
+				const __m128 tx = _mm_load_ps(&skin.tangentX[i]);
+				const __m128 ty = _mm_load_ps(&skin.tangentY[i]);
+				const __m128 tz = _mm_load_ps(&skin.tangentZ[i]);
+
+				for (int row = 0; row < 3; row++)
+				{
+					__m128 c0, c1, c2, c3;
+					loadJointRows(pPalette, &skin.joints[i], row, c0, c1, c2, c3);
+
+					const __m128 pos = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, px), _mm_mul_ps(c1, py)), _mm_add_ps(_mm_mul_ps(c2, pz), c3));
+					const __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, nx), _mm_mul_ps(c1, ny)), _mm_mul_ps(c2, nz));
+					const __m128 tangent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, tx), _mm_mul_ps(c1, ty)), _mm_mul_ps(c2, tz));
+
+					sums[row] = _mm_add_ps(sums[row], _mm_mul_ps(bias, pos));
+					sums[3 + row] = _mm_add_ps(sums[3 + row], _mm_mul_ps(bias, normal));
+					sums[6 + row] = _mm_add_ps(sums[6 + row], _mm_mul_ps(bias, tangent));
+				}
+			}
+
+			for (int k = 0; k < 9; k++)
+			{
+				_mm_store_ps(&results[k][half], sums[k]);
+			}
+		}
+#else
+		memset(results, 0, sizeof(results));
+
+		for (size_t i = firstElement; i < endElement; i += SKIN_LANES)
+		{
+			for (uint lane = 0; lane < SKIN_LANES; lane++)
+			{
+				const float* pRows = pPalette + skin.joints[i + lane] * 12;
+				const float bias = skin.bias[i + lane];
+
+				for (int row = 0; row < 3; row++)
+				{
+					const float* r = pRows + row * 4;
+					results[row][lane] += bias * (r[0] * skin.posX[i + lane] + r[1] * skin.posY[i + lane] + r[2] * skin.posZ[i + lane] + r[3]);
+					results[3 + row][lane] += bias * (r[0] * skin.normalX[i + lane] + r[1] * skin.normalY[i + lane] + r[2] * skin.normalZ[i + lane]);
+					results[6 + row][lane] += bias * (r[0] * skin.tangentX[i + lane] + r[1] * skin.tangentY[i + lane] + r[2] * skin.tangentZ[i + lane]);
+				}
+			}
+		}
+#endif
+
+		for (uint lane = 0; lane < SKIN_LANES; lane++)
+		{
+			const uint vertexIndex = skin.laneVertices[g * SKIN_LANES + lane];
+			if (vertexIndex == UINT32_MAX)
+			{
+				continue;
+			}
+
+			const vec3 finalVertex(results[0][lane], results[1][lane], results[2][lane]);
+			const vec3 finalNormal(results[3][lane], results[4][lane], results[5][lane]);
+			const vec3 finalTangent(results[6][lane], results[7][lane], results[8][lane]);
+
+			pVertices[vertexIndex] = Vertex(finalVertex, -finalNormal, finalTangent, cross(-finalNormal, finalTangent), mesh.vertices[vertexIndex].texCoord);
+		}
+	}
+}
+
+/**
+ * Skins every mesh to the current frame on the cpu, without uploading them: the meshes follow each other in vertices.
+ * It is the cpu work of a render (eg. for the benchmarks and the server, it needs no gl context).
+ */
+void ModelMd5::skinMeshes(std::vector<Vertex>& vertices) const
+{
+	std::vector<std::vector<Vertex>> modelVertices(1);
+	modelVertices[0].swap(vertices);
+
+	skinModels({ this }, modelVertices);
+
+	vertices.swap(modelVertices[0]);
+}
+
+/**
+ * Skins the meshes of several models (like skinMeshes() does), the vertex groups of all of them are shared
+ * between the threads of the JobPool.
+ */
+void ModelMd5::skinModels(const std::vector<const ModelMd5*>& models, std::vector<std::vector<Vertex>>& vertices, const bool isParallel)
+{
+	struct SkinJob
+	{
+		const ModelMd5*	pModel;
+		uint			meshIndex;
+		uint			firstGroup;
+		uint			endGroup;
+		const float*	pPalette;
+		Vertex*			pVertices;
+	};
+
+	std::vector<AlignedVector<float>> palettes(models.size());
+	std::vector<SkinJob> jobs;
+
+	vertices.resize(models.size());
+	for (uint k = 0; k < models.size(); k++)
+	{
+		const ModelMd5* pModel = models[k];
+		const ModelMd5Resource& resource = *pModel->m_pResource;
+		pModel->computeSkinPalette(pModel->m_pCurrentFrame->m_joints, palettes[k]);
+
+		uint numVertices = 0;
+		for (const MeshMd5& mesh : resource.m_meshes)
+		{
+			numVertices += mesh.numVertices;
+		}
+		vertices[k].resize(numVertices);
+
+		uint firstVertex = 0;
+		for (uint m = 0; m < resource.m_meshes.size(); m++)
+		{
+			const uint numGroups = resource.m_skinWeights[m].getNumGroups();
+			for (uint g = 0; g < numGroups; g += SKIN_GROUPS_PER_JOB)
+			{
+				jobs.push_back({ pModel, m, g, std::min(g + SKIN_GROUPS_PER_JOB, numGroups), palettes[k].data(), vertices[k].data() + firstVertex });
+			}
+
+			firstVertex += resource.m_meshes[m].numVertices;
+		}
+	}
+
+	const JobPool::RangeFunction skinJobs = [&jobs](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const SkinJob& job = jobs[i];
+			job.pModel->skinVertexGroups(job.meshIndex, job.pPalette, job.firstGroup, job.endGroup, job.pVertices);
+		}
+	};
+
+	if (isParallel)
+	{
+		JobPool::run(jobs.size(), 1, skinJobs);
+	}
+	else
+	{
+		skinJobs(0, jobs.size());
+	}
+}
+
+} // namespace models
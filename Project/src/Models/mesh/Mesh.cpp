@@ -10,6 +10,7 @@ Mesh::Mesh()
 	: m_numObjects(0)
 	, m_verticesVboId(0)
 	, m_indicesVboId(0)
+	, m_pTextures(nullptr)
 	, m_lastShaderProg(UINT32_MAX)
 {
 }
@@ -27,6 +28,8 @@ Mesh::~Mesh()
 	{
 		delete object;
 	}
+
+	releaseTextures();
 }
 
 void Mesh::addObject(Object* object)
@@ -49,22 +52,19 @@ void Mesh::animate(const float dt)
 
 void Mesh::render()
 {
-	GLint v_i = 0;
-	for (const Object* object : m_objects)
+	for (uint i = 0; i < m_numObjects; i++)
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, object->m_decalMap);
-
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, object->m_normalHeightMap);
-
-		glDrawArrays(GL_TRIANGLES, v_i, object->m_numTriangles * 3);
-		v_i += object->m_numTriangles * 3;
+		Mesh::renderSubset(i);
 	}
 }
 
 void Mesh::renderSubset(const uint subset)
 {
+	if (m_subsets.size() != m_numObjects)
+	{
+		setupSubsets();
+	}
+
 	// drawing
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, m_objects[subset]->m_decalMap);
@@ -72,17 +72,29 @@ void Mesh::renderSubset(const uint subset)
 	glActiveTexture(GL_TEXTURE1);
 	glBindTexture(GL_TEXTURE_2D, m_objects[subset]->m_normalHeightMap);
 
-	GLint v_i = 0;
-	uint i = 0;
-	std::vector<Object*>::iterator it = m_objects.begin();
-	while (i < subset)
+	const Subset& range = m_subsets[subset];
+	if (m_indicesVboId)
+	{
+		glDrawElements(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (const void*)(range.first * sizeof(GLuint)));
+	}
+	else
 	{
-		v_i += (*it)->m_numTriangles * 3;
-		i++;
-		++it;
+		glDrawArrays(GL_TRIANGLES, range.first, range.count);
 	}
+}
+
+void Mesh::setupSubsets()
+{
+	m_subsets.resize(m_numObjects);
 
-	glDrawArrays(GL_TRIANGLES, v_i, m_objects[subset]->m_numTriangles * 3);
+	GLint first = 0;
+	for (uint i = 0; i < m_numObjects; i++)
+	{
+		m_subsets[i].first = first;
+		m_subsets[i].count = m_objects[i]->m_numTriangles * 3;
+
+		first += m_subsets[i].count;
+	}
 }
 
 Mesh& Mesh::operator=(const Mesh& other)
@@ -91,13 +103,75 @@ Mesh& Mesh::operator=(const Mesh& other)
 	{
 		m_numObjects = other.m_numObjects;
 		m_objects = other.m_objects;
+		m_subsets = other.m_subsets;
 
 		m_indicesVboId	= other.m_indicesVboId;
 		m_verticesVboId	= other.m_verticesVboId;
+
+		copyTextures(other);
 	}
 	return *this;
 }
 
+GLuint Mesh::addTexture(TexturePool& textures, const TextureHandle& handle)
+{
+	const uint32_t* pTexId = textures.get(handle);
+	if (!pTexId)
+	{
+		return 0;
+	}
+
+	m_pTextures = &textures;
+	m_textureHandles.push_back(handle);
+
+	return *pTexId;
+}
+
+void Mesh::copyTextures(const Mesh& other)
+{
+	if (this == &other)
+	{
+		return;
+	}
+
+	releaseTextures();
+
+	m_pTextures = other.m_pTextures;
+	m_textureHandles = other.m_textureHandles;
+
+	for (const TextureHandle& handle : m_textureHandles)
+	{
+		m_pTextures->addReference(handle);
+	}
+}
+
+void Mesh::releaseTextures()
+{
+	for (const TextureHandle& handle : m_textureHandles)
+	{
+		m_pTextures->release(handle);
+	}
+
+	m_textureHandles.clear();
+}
+
+std::string Mesh::getBakedFile(const char* filename)
+{
+	const std::string bakedFile = std::string(filename) + "bin";
+	if (!utils::file::existFile(bakedFile))
+	{
+		return "";
+	}
+
+	if (utils::file::getModificationTime(filename) > utils::file::getModificationTime(bakedFile))
+	{
+		TRACE_INFO(bakedFile << " is older than " << filename << ", it is loaded instead (bake it again).", 0);
+		return "";
+	}
+
+	return bakedFile;
+}
+
 GLuint vec3Offset  = 3 * sizeof(GLfloat);
 GLsizei vertStride = sizeof(Vertex);
 
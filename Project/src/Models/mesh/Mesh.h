@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Common/ResourcePool.h"
 #include "Models/mesh/Object.h"
 
 /**
@@ -11,6 +12,13 @@ namespace models
 class Mesh
 {
 public:
+	// the triangles of an object: the first index and the count of the indices (the vertices if not indexed)
+	struct Subset
+	{
+		GLint	first;
+		GLsizei	count;
+	};
+
 	Mesh();
 	Mesh(const Mesh& other);
 	virtual ~Mesh();
@@ -30,6 +38,12 @@ public:
 
 	virtual bool isMesh() {	return true; }
 
+	// the distance of the instance to the camera of the render pass (the animated models pick their lod by it)
+	virtual void setCameraDistance(const float distance) {}
+
+	// if true the mesh is rendered with the skinning shader, else with the shader of its role
+	virtual bool isGpuSkinnable() const { return false; }
+
 	Mesh& operator=(const Mesh& other);
 
 
@@ -40,14 +54,32 @@ public:
 	uint	getObjIndexByName(const std::string& objname) const;
 	Object*	getObject(const uint index) const;
 
+protected:
+	// the subsets of the vertices of the objects in a row (the meshes without indices)
+	void	setupSubsets();
+
+	// the texture of the acquired handle, its reference released with the mesh (0 if the handle is invalid)
+	GLuint	addTexture(TexturePool& textures, const TextureHandle& handle);
+	// the copy shares the textures of the other mesh: one more reference of each
+	void	copyTextures(const Mesh& other);
+	void	releaseTextures();
+
+	// the model baked by the CrimsonModelConverter next to the file (model.md2 -> model.md2bin), "" if there is none
+	// or the file was edited after the bake
+	static std::string getBakedFile(const char* filename);
+
 protected:
 	uint					m_numObjects;
 	std::vector<Object*>	m_objects;
+	std::vector<Subset>		m_subsets;
 
 
 	GLuint					m_verticesVboId;
 	GLuint					m_indicesVboId;
 
+	TexturePool*				m_pTextures;
+	std::vector<TextureHandle>	m_textureHandles;
+
 	GLuint					m_lastShaderProg;
 	GLint					m_posLoc;
 	GLint					m_normLoc;
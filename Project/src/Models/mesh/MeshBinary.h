@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace models
+{
+
+/**
+ * The baked md2 and 3ds models (.md2bin, .3dsbin), written by the CrimsonModelConverter and used in place from a file
+ * mapping (ModelMd2::loadBinary(), Model3ds::loadBinary()).
+ *
+ * The sections are laid out as the ones of the md5bin::Header (aligned to MESHBIN_ALIGNMENT). A 3ds model has its
+ * welded vertices, indices and subsets (MeshOptimizer::build()), uploaded from the mapping; an md2 model has its
+ * frames with the normals and tangents, and its clips. The textures are named relative to the directory of the model.
+ */
+namespace meshbin
+{
+
+static const uint32_t MESHBIN_MAGIC		= 0x42534d43;	// "CMSB"
+static const uint32_t MESHBIN_VERSION	= 1;
+static const uint32_t MESHBIN_ALIGNMENT	= 32;
+
+static const uint32_t MAX_NAME_LENGTH	= 64;
+
+enum Type : uint32_t
+{
+	TYPE_3DS = 1,
+	TYPE_MD2 = 2,
+};
+
+struct Header
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	fileSize;
+	uint32_t	type;
+
+	// the size of the runtime Vertex stored as it is
+	uint32_t	vertexSize;
+
+	uint32_t	numObjects;
+	uint32_t	objectsOffset;			// Object[numObjects]
+
+	// 3ds: the buffers of all objects, a subset per object
+	uint32_t	numVertices;
+	uint32_t	numIndices;
+	uint32_t	verticesOffset;			// Vertex[numVertices]
+	uint32_t	indicesOffset;			// uint32_t[numIndices]
+	uint32_t	subsetsOffset;			// Subset[numObjects]
+
+	// md2: the frames
+	uint32_t	numFrames;
+	uint32_t	numFrameVertices;
+	uint32_t	numTexcoords;
+	uint32_t	numTriangles;
+	uint32_t	numAnims;
+	uint32_t	positionsOffset;		// float[numFrames * numFrameVertices][3]
+	uint32_t	normalsOffset;			// float[numFrames * numFrameVertices][3]
+	uint32_t	tangentsOffset;			// float[numFrames * numFrameVertices][3]
+	uint32_t	texcoordsOffset;		// float[numTexcoords][2]
+	uint32_t	trianglesOffset;		// Triangle[numTriangles]
+	uint32_t	animsOffset;			// Anim[numAnims]
+};
+
+struct Object
+{
+	char		name[MAX_NAME_LENGTH];
+	char		texture[MAX_NAME_LENGTH];	// empty: no texture
+	uint32_t	numVertices;
+	uint32_t	numTriangles;
+};
+
+struct Subset
+{
+	int32_t		first;
+	int32_t		count;
+};
+
+// the md2 triangle: the indices of the frame vertices and of the texcoords
+struct Triangle
+{
+	int16_t		vertIdx[3];
+	int16_t		texIdx[3];
+};
+
+struct Anim
+{
+	char		name[MAX_NAME_LENGTH];
+	int32_t		start;
+	int32_t		end;
+};
+
+} // namespace meshbin
+
+} // namespace models
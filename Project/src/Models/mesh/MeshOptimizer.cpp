@@ -0,0 +1,378 @@
+#include "GameStdAfx.h"
+#include "Models/mesh/MeshOptimizer.h"
+#include "Common/TraceRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+
+namespace models
+{
+
+namespace
+{
+
+// the attributes the welded vertices share (the tangents are averaged, their handedness kept)
+struct WeldKey
+{
+	float	values[10];
+	int		handedness;
+
+	bool operator==(const WeldKey& other) const
+	{
+		return std::memcmp(this, &other, sizeof(WeldKey)) == 0;
+	}
+};
+
+struct WeldKeyHash
+{
+	size_t operator()(const WeldKey& key) const
+	{
+		// fnv-1a
+		const uint8_t* pBytes = (const uint8_t*)&key;
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(WeldKey); i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ull;
+		}
+		return (size_t)hash;
+	}
+};
+
+WeldKey getWeldKey(const Vertex& vertex)
+{
+	WeldKey key;
+	std::memset(&key, 0, sizeof(WeldKey));
+
+	const float values[10] = {
+		vertex.pos.x, vertex.pos.y, vertex.pos.z,
+		vertex.normal.x, vertex.normal.y, vertex.normal.z,
+		vertex.texcoord.u, vertex.texcoord.v,
+		vertex.lightmapCoord.u, vertex.lightmapCoord.v
+	};
+
+	for (uint i = 0; i < 10; i++)
+	{
+		// -0 is 0
+		key.values[i] = values[i] == 0.0f ? 0.0f : values[i];
+	}
+
+	key.handedness = dot(cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f ? -1 : 1;
+
+	return key;
+}
+
+// the scoring of Forsyth's "Linear-Speed Vertex Cache Optimisation"
+const int	CACHE_SIZE = 32;
+const float	CACHE_DECAY_POWER = 1.5f;
+const float	LAST_TRIANGLE_SCORE = 0.75f;
+const float	VALENCE_BOOST_SCALE = 2.0f;
+const float	VALENCE_BOOST_POWER = 0.5f;
+
+float getVertexScore(const int cachePosition, const uint numTrianglesLeft)
+{
+	if (numTrianglesLeft == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// the vertices of the last triangle score the same: which one is used first does not matter
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			const float scale = 1.0f / (CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+		}
+	}
+
+	// the vertices with few triangles left go first: no lonely triangles left behind
+	score += VALENCE_BOOST_SCALE * std::pow((float)numTrianglesLeft, -VALENCE_BOOST_POWER);
+
+	return score;
+}
+
+} // namespace
+
+void MeshOptimizer::build(const Vertex* pVertices, const std::vector<uint>& numSubsetVertices,
+	std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<Mesh::Subset>& subsets)
+{
+	TRACE_ZONE("MeshOptimizer::build");
+
+	vertices.clear();
+	indices.clear();
+	subsets.clear();
+
+	std::vector<Vertex> subsetVertices;
+	std::vector<GLuint> subsetIndices;
+
+	uint firstVertex = 0;
+	for (const uint numVertices : numSubsetVertices)
+	{
+		weldVertices(pVertices + firstVertex, numVertices, subsetVertices, subsetIndices);
+		optimizeVertexCache(subsetIndices.data(), (uint)subsetIndices.size(), (uint)subsetVertices.size());
+
+		Mesh::Subset subset;
+		subset.first = (GLint)indices.size();
+		subset.count = (GLsizei)subsetIndices.size();
+		subsets.push_back(subset);
+
+		const GLuint baseVertex = (GLuint)vertices.size();
+		for (const GLuint index : subsetIndices)
+		{
+			indices.push_back(baseVertex + index);
+		}
+		vertices.insert(vertices.end(), subsetVertices.begin(), subsetVertices.end());
+
+		firstVertex += numVertices;
+	}
+
+	// the subsets stay in their ranges: the vertices of a subset are used by it only
+	optimizeVertexFetch(vertices, indices);
+}
+
+void MeshOptimizer::weldVertices(const Vertex* pVertices, const uint numVertices, std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	vertices.clear();
+	indices.resize(numVertices);
+
+	std::unordered_map<WeldKey, GLuint, WeldKeyHash> weldedIndices;
+	weldedIndices.reserve(numVertices);
+
+	for (uint i = 0; i < numVertices; i++)
+	{
+		const auto result = weldedIndices.insert(std::make_pair(getWeldKey(pVertices[i]), (GLuint)vertices.size()));
+		if (result.second)
+		{
+			vertices.push_back(pVertices[i]);
+		}
+		else
+		{
+			Vertex& vertex = vertices[result.first->second];
+			vertex.tangent += pVertices[i].tangent;
+			vertex.bitangent += pVertices[i].bitangent;
+		}
+
+		indices[i] = result.first->second;
+	}
+
+	// the sums of the tangents of the faces (a degenerate sum keeps the tangent of the first face)
+	std::vector<bool> isFirst(vertices.size(), true);
+	for (uint i = 0; i < numVertices; i++)
+	{
+		const GLuint index = indices[i];
+		if (!isFirst[index])
+		{
+			continue;
+		}
+		isFirst[index] = false;
+
+		Vertex& vertex = vertices[index];
+		vertex.tangent = vertex.tangent.length2() > 1e-12f ? normalize(vertex.tangent) : pVertices[i].tangent;
+		vertex.bitangent = vertex.bitangent.length2() > 1e-12f ? normalize(vertex.bitangent) : pVertices[i].bitangent;
+	}
+}
+
+void MeshOptimizer::optimizeVertexCache(GLuint* pIndices, const uint numIndices, const uint numVertices)
+{
+	const uint numTriangles = numIndices / 3;
+	if (numTriangles < 2)
+	{
+		return;
+	}
+
+	// the triangles of the vertices
+	std::vector<uint> numVertexTriangles(numVertices, 0);
+	for (uint i = 0; i < numTriangles * 3; i++)
+	{
+		numVertexTriangles[pIndices[i]]++;
+	}
+
+	std::vector<uint> firstVertexTriangle(numVertices + 1, 0);
+	for (uint v = 0; v < numVertices; v++)
+	{
+		firstVertexTriangle[v + 1] = firstVertexTriangle[v] + numVertexTriangles[v];
+	}
+
+	std::vector<uint> vertexTriangles(numTriangles * 3);
+	std::vector<uint> numTrianglesLeft(numVertices, 0);
+	for (uint t = 0; t < numTriangles; t++)
+	{
+		for (uint k = 0; k < 3; k++)
+		{
+			const GLuint v = pIndices[t * 3 + k];
+			vertexTriangles[firstVertexTriangle[v] + numTrianglesLeft[v]++] = t;
+		}
+	}
+
+	// the scores
+	std::vector<int> cachePositions(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for (uint v = 0; v < numVertices; v++)
+	{
+		vertexScores[v] = getVertexScore(-1, numTrianglesLeft[v]);
+	}
+
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<bool> isTriangleAdded(numTriangles, false);
+	for (uint t = 0; t < numTriangles; t++)
+	{
+		triangleScores[t] = vertexScores[pIndices[t * 3]] + vertexScores[pIndices[t * 3 + 1]] + vertexScores[pIndices[t * 3 + 2]];
+	}
+
+	// the cache: the vertices of the last triangle at the front, 3 more for the vertices pushed out
+	std::vector<GLuint> cache;
+	std::vector<GLuint> newCache;
+	cache.reserve(CACHE_SIZE + 3);
+	newCache.reserve(CACHE_SIZE + 3);
+
+	std::vector<GLuint> orderedIndices;
+	orderedIndices.reserve(numTriangles * 3);
+
+	uint bestTriangle = 0;
+	for (uint t = 1; t < numTriangles; t++)
+	{
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	uint nextTriangle = 0;
+	for (uint numAdded = 0; numAdded < numTriangles; numAdded++)
+	{
+		// no triangle of the cached vertices left: the next one in the order of the file
+		if (bestTriangle == UINT32_MAX)
+		{
+			while (isTriangleAdded[nextTriangle])
+			{
+				nextTriangle++;
+			}
+			bestTriangle = nextTriangle;
+		}
+
+		isTriangleAdded[bestTriangle] = true;
+
+		const GLuint* pTriangle = pIndices + bestTriangle * 3;
+		orderedIndices.insert(orderedIndices.end(), pTriangle, pTriangle + 3);
+
+		newCache.clear();
+		for (uint k = 0; k < 3; k++)
+		{
+			// a degenerate triangle has a vertex twice
+			const GLuint v = pTriangle[k];
+			if (std::find(newCache.begin(), newCache.end(), v) != newCache.end())
+			{
+				continue;
+			}
+			newCache.push_back(v);
+
+			// the triangle is not one of the vertex any more
+			uint* pBegin = &vertexTriangles[firstVertexTriangle[v]];
+			uint* pEnd = pBegin + numTrianglesLeft[v];
+			for (uint* pFound = std::find(pBegin, pEnd, bestTriangle); pFound != pEnd; pFound = std::find(pBegin, pEnd, bestTriangle))
+			{
+				std::swap(*pFound, *(--pEnd));
+				numTrianglesLeft[v]--;
+			}
+		}
+
+		for (const GLuint v : cache)
+		{
+			if (v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2])
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		// the new positions and the scores of the cached vertices (and of the ones pushed out)
+		for (uint i = 0; i < newCache.size(); i++)
+		{
+			const GLuint v = newCache[i];
+			cachePositions[v] = i < (uint)CACHE_SIZE ? (int)i : -1;
+			vertexScores[v] = getVertexScore(cachePositions[v], numTrianglesLeft[v]);
+		}
+
+		// the best triangle of the cached vertices goes next
+		bestTriangle = UINT32_MAX;
+		float bestScore = -1.0f;
+		for (const GLuint v : newCache)
+		{
+			for (uint i = 0; i < numTrianglesLeft[v]; i++)
+			{
+				const uint t = vertexTriangles[firstVertexTriangle[v] + i];
+				const float score = vertexScores[pIndices[t * 3]] + vertexScores[pIndices[t * 3 + 1]] + vertexScores[pIndices[t * 3 + 2]];
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > (size_t)CACHE_SIZE)
+		{
+			newCache.resize(CACHE_SIZE);
+		}
+		cache.swap(newCache);
+	}
+
+	std::copy(orderedIndices.begin(), orderedIndices.end(), pIndices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	static const GLuint unused = UINT32_MAX;
+
+	std::vector<GLuint> remap(vertices.size(), unused);
+	std::vector<Vertex> orderedVertices;
+	orderedVertices.reserve(vertices.size());
+
+	for (GLuint& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (GLuint)orderedVertices.size();
+			orderedVertices.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(orderedVertices);
+}
+
+float MeshOptimizer::getAverageCacheMissRatio(const GLuint* pIndices, const uint numIndices, const uint cacheSize)
+{
+	const uint numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+	{
+		return 0.0f;
+	}
+
+	// the cache entry of the vertices: the fifo position they were pushed at
+	std::unordered_map<GLuint, uint> pushTimes;
+	uint numMisses = 0;
+
+	for (uint i = 0; i < numTriangles * 3; i++)
+	{
+		const auto it = pushTimes.find(pIndices[i]);
+		if (it == pushTimes.end() || numMisses - it->second >= cacheSize)
+		{
+			pushTimes[pIndices[i]] = ++numMisses;
+		}
+	}
+
+	return (float)numMisses / numTriangles;
+}
+
+} // namespace models
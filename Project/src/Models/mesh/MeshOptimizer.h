@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Models/mesh/Mesh.h"
+
+
+namespace models
+{
+
+/**
+ * @brief The indexed buffers of the triangle soups of the loaders: the vertices welded, the triangles reordered for the
+ * post-transform vertex cache, the offsets of the subsets precomputed.
+ *
+ * The vertices equal in position, normal, texture coordinates and tangent handedness are one vertex, their tangents
+ * averaged. The triangles of a subset are ordered by Tom Forsyth's linear-speed vertex cache optimization (the
+ * triangles of the cached vertices first), then the vertices in the order of their first use.
+ */
+class MeshOptimizer
+{
+public:
+	// the subsets are numSubsetVertices[i] vertices in a row, three per triangle
+	static void build(const Vertex* pVertices, const std::vector<uint>& numSubsetVertices,
+		std::vector<Vertex>& vertices, std::vector<GLuint>& indices, std::vector<Mesh::Subset>& subsets);
+
+	// the unique vertices of the triangles and their indices
+	static void weldVertices(const Vertex* pVertices, const uint numVertices, std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	// the triangles reordered in place, the indices refer to numVertices vertices
+	static void optimizeVertexCache(GLuint* pIndices, const uint numIndices, const uint numVertices);
+
+	// the vertices in the order of their first use, the indices remapped
+	static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	// the vertices transformed per triangle with a fifo cache of the size: 3 without reuse, 0.5 at best
+	static float getAverageCacheMissRatio(const GLuint* pIndices, const uint numIndices, const uint cacheSize = 16);
+};
+
+} // namespace models
@@ -3,7 +3,6 @@
 
 #include "GameLogic/EngineCore.h"
 #include "GameLogic/SerializationDefs.h"
-#include "console/GameConsole.h"
 
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/map.hpp>
@@ -1,8 +1,10 @@
 #include "GameStdAfx.h"
 #include "Common/LoggerSystem.h"
-#include "Console/GameConsole.h"
+#include "Common/TraceRecorder.h"
+#include "Common/PerformanceMetrics.h"
 
 #ifdef CLIENT_SIDE
+#include "Console/GameConsole.h"
 #include "Client/ClientMain.h"
 #endif
 
@@ -36,6 +38,9 @@ void shutDown()
 #ifdef SERVER_SIDE
 	SAFEDEL(server);
 #endif
+
+	// the log is written on a background thread
+	LoggerSystem::getInstance()->flush();
 }
 
 int serverMain(const int argc, char* argv[])
@@ -227,6 +232,8 @@ int clientMain(int argc, char* argv[], const bool isThickClient)
 int main(int argc, char* argv[])
 {
 	new LoggerSystem();
+	new TraceRecorder();
+	new PerformanceMetrics();
 	new ComponentFactory();
 	entityx::EntityX ex;
 
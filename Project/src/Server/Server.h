@@ -37,6 +37,7 @@ private:
 	void initEngineCore();
 
 	void run();
+	void collectLuaGarbage(float timeLeft);
 
 	// networking
 	void initNetwork(ushort port);
@@ -61,6 +62,9 @@ private:
 	long						m_lastAnimationTime;
 	bool						m_isGamePaused;
 
+	float						m_tickPeriod;		// ms
+	float						m_luaGcBudget;		// ms of the idle time of a tick
+
 	ClientTable					m_clientTable;
 
 
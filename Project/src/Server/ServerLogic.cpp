@@ -1,7 +1,13 @@
 #include "GameStdAfx.h"
 #include "Server/Server.h"
+#include "Common/AssetPack.h"
 #include "Common/LuaManager.h"
+#include "Common/ScriptSandbox.h"
 #include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Common/PerformanceMetrics.h"
+
+#include <chrono>
 
 
 namespace network
@@ -21,6 +27,9 @@ Server::Server(ushort port, short broadcastRate)
 
 	, m_isGamePaused(true)
 	, m_pEngineCore(nullptr)
+
+	, m_tickPeriod(10.0f)
+	, m_luaGcBudget(2.0f)
 {
 	//pBackBuffer = &eventBuffer1;
 	//pFrontBuffer = &eventBuffer2;
@@ -37,10 +46,12 @@ Server::~Server()
 	EngineCore::destroyInstance();
 	LuaManager::destroyInstance();
 	ConstantManager::destroyInstance();
+	AssetPack::destroyInstance();
 }
 
 /**
  * Starts the server:
+ *	- mounts the asset pack of the data dir
  *	- opens the network log file
  *	- initializes the engine core
  *	- initializes the ENet networking
@@ -49,7 +60,11 @@ Server::~Server()
  */
 void Server::start()
 {
-	ConstantManager::getInstance()->loadConstants(CONST_STR("dataDir") + "/settings/constants.xml");
+	new AssetPack();
+	AssetPack::getInstance()->mountDataDir();
+
+	ConstantManager::getInstance()->loadConstants(CONST_STR("dataDir") + "/settings/constants.json");
+	ConstantManager::getInstance()->watchConstants();
 
 	// open network log file (tries to find a new name for it)
 	int networkLogFileIndex = 2;
@@ -75,6 +90,8 @@ void Server::start()
 	m_listenEventThread = boost::thread(boost::bind(&Server::listen, this));
 	//processEventThread = boost::thread(boost::bind(&Server::processEvents, this));
 
+	TraceRecorder::getInstance()->setThreadName("server sim");
+
 	m_isServerRunning = true;
 	while (m_isServerRunning)
 	{
@@ -85,11 +102,20 @@ void Server::start()
 			m_isGamePaused = false;
 		}
 
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point tickStartTime = Clock::now();
+
 		if (!m_isGamePaused)
 		{
 			run();
+
+			const float runTime = std::chrono::duration<float, std::milli>(Clock::now() - tickStartTime).count();
+			collectLuaGarbage(m_tickPeriod - runTime);
 		}
-		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+
+		// the rest of the tick period
+		const float tickTime = std::chrono::duration<float, std::milli>(Clock::now() - tickStartTime).count();
+		boost::this_thread::sleep(boost::posix_time::microseconds((long)(std::max(0.0f, m_tickPeriod - tickTime) * 1000.0f)));
 	}
 
 	m_listenEventThread.join();
@@ -112,6 +138,9 @@ void Server::initEngineCore()
 
 void Server::run()
 {
+	TRACE_ZONE("Server::run");
+	MEASURE_METRIC(Metric::TICK_TIME);
+
 	boost::mutex::scoped_lock lock(m_clientTableMutex);
 
 	m_dt = std::min(0.1f, (m_pEngineCore->getElapsedTime() - m_lastAnimationTime) / 200.0f);
@@ -126,6 +155,26 @@ void Server::run()
 	m_luaProcessingMutex.unlock();
 }
 
+/**
+ * Spends a part of the idle time of the tick on the lua garbage collectors (the main state and the script shards),
+ * so the collection is not done in the allocations of the next tick.
+ *
+ * @param timeLeft The ms left of the tick period: an overrun tick does not collect.
+ */
+void Server::collectLuaGarbage(float timeLeft)
+{
+	const float budget = std::min(m_luaGcBudget, timeLeft);
+	if (budget <= 0.0f)
+	{
+		return;
+	}
+
+	boost::mutex::scoped_lock lock(m_luaProcessingMutex);
+
+	LuaManager::getInstance()->stepGarbageCollector(budget * 0.5f);
+	ScriptSandbox::getInstance()->stepGarbageCollector(budget * 0.5f);
+}
+
 bool Server::isRunning() const
 {
 	return !m_isGamePaused;
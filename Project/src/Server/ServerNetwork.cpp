@@ -2,10 +2,12 @@
 #include "Server/Server.h"
 
 #include "Common/LuaManager.h"
+#include "Common/ScriptSandbox.h"
 #include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Common/PerformanceMetrics.h"
 #include "GameLogic/SerializationDefs.h"
 
-#include "Graphics/Camera.h"
 
 #include "Network/connection.h"
 #include "Network/events/KeyEvent.h"
@@ -76,6 +78,8 @@ void Server::initNetwork(ushort port)
  */
 void Server::listen()
 {
+	TraceRecorder::getInstance()->setThreadName("server listen");
+
 	std::string stringData;
 
 	int startTime = 0;
@@ -114,9 +118,13 @@ void Server::listen()
 						break;
 
 					case ENET_EVENT_TYPE_RECEIVE:
+					{
+						MEASURE_METRIC(Metric::NETWORK_RECEIVE_TIME);
+
 						stringData = std::string((char*) m_event.packet->data, m_event.packet->dataLength);
 
 						processEvent(stringData);
+					}
 						//pBackBuffer->push_back(m_event);
 
 						//m_eventBufferMutex.lock();
@@ -147,6 +155,9 @@ void Server::listen()
 							///m_pEngineCore->getRootNode()->removeByName(m_clientTable.at(m_disconnectingClient).clientName);
 							m_clientTable.erase(m_disconnectingClient);
 							TRACE_NETWORK("Client erased from client list.", 0);
+
+							boost::mutex::scoped_lock luaLock(m_luaProcessingMutex);
+							ScriptSandbox::getInstance()->removeScriptsOf(m_disconnectingClient);
 						}
 
 						if (m_clientTable.size() < 1)
@@ -283,16 +294,77 @@ void Server::processEvent(const std::string& stringData)
 						//	TRACE_LUA(entry.first << "\t(" << entry.second->getId() << ")\t\t" << entry.second->getName(), 0);
 						//}
 					}
+					else if (luaCommand.command.compare(0, 6, "drone ") == 0)
+					{
+						// "drone <entity id> <script>": the script runs for the drone (on the lua state of the drone)
+						char* pSource = nullptr;
+						const uint64_t droneId = strtoull(luaCommand.command.c_str() + 6, &pSource, 10);
+
+						if (droneId == 0 || pSource == luaCommand.command.c_str() + 6)
+						{
+							TRACE_ERROR("Error: usage: drone <entity id> <script>", 0);
+						}
+						else
+						{
+							boost::mutex::scoped_lock lock(m_luaProcessingMutex);
+							ScriptSandbox::getInstance()->addScript(m_event.peer->connectID, droneId, pSource,
+								utils::formatStr("client %u drone %llu", m_event.peer->connectID, (unsigned long long)droneId));
+						}
+					}
 					else if (luaCommand.command.find("speed") != std::string::npos)
 					{
 						float speedMultiplier;
 						sscanf(luaCommand.command.c_str(), "speed %f", &speedMultiplier);
 						ConstantManager::getInstance()->setFloatConstant("Gameplay::GameSpeedMultiplier", speedMultiplier);
 					}
+					else if (luaCommand.command == "profile")
+					{
+						// toggles the lua profiler, the profile is written when it stops
+						boost::mutex::scoped_lock lock(m_luaProcessingMutex);
+						LuaManager::getInstance()->toggleProfiling("lua_profile_server.folded");
+					}
+					else if (luaCommand.command == "stats" || luaCommand.command == "stats reset")
+					{
+						// the report goes back to the client too
+						std::stringstream report;
+						PerformanceMetrics::getInstance()->writeReport(report);
+						TRACE_INFO(report.str(), 0);
+
+						events::LuaCommand response(report.str());
+						send(response, m_event.peer);
+
+						if (luaCommand.command == "stats reset")
+						{
+							PerformanceMetrics::getInstance()->reset();
+						}
+					}
+					else if (luaCommand.command == "trace")
+					{
+						// toggles the trace recording, the capture is written when it stops
+						TraceRecorder::getInstance()->toggle("trace_server.json");
+					}
+					else if (luaCommand.command == "gc")
+					{
+						boost::mutex::scoped_lock lock(m_luaProcessingMutex);
+
+						const LuaGcStats& mainStats = LuaManager::getInstance()->getGcStats();
+						const LuaGcStats scriptStats = ScriptSandbox::getInstance()->getGcStats();
+
+						TRACE_LUA("main:    " << mainStats.memory / 1024 << " kb, " << mainStats.numSteps << " steps, " << mainStats.numCycles << " cycles, "
+							<< mainStats.lastStepTime << " ms (max " << mainStats.maxStepTime << " ms)", 0);
+						TRACE_LUA("scripts: " << scriptStats.memory / 1024 << " kb, " << scriptStats.numSteps << " steps, " << scriptStats.numCycles << " cycles, "
+							<< scriptStats.lastStepTime << " ms (max " << scriptStats.maxStepTime << " ms)", 0);
+					}
+					else if (luaCommand.command == "stop")
+					{
+						boost::mutex::scoped_lock lock(m_luaProcessingMutex);
+						ScriptSandbox::getInstance()->removeScriptsOf(m_event.peer->connectID);
+					}
 					else
 					{
+						// the command runs as a script of the client without a drone, within the script budgets
 						boost::mutex::scoped_lock lock(m_luaProcessingMutex);
-						LuaManager::getInstance()->doString(luaCommand.command);
+						ScriptSandbox::getInstance()->addScript(m_event.peer->connectID, 0, luaCommand.command, utils::formatStr("client %u", m_event.peer->connectID));
 					}
 				}
 			}
@@ -344,6 +416,9 @@ void Server::broadcast()
 		return;
 	}
 
+	TRACE_ZONE("Server::broadcast");
+	MEASURE_METRIC(Metric::BROADCAST_TIME);
+
 	///m_pEngineCore->getCamera()->setPerspective(45, 800, 600, 1.0f, 400.0f);
 	//m_pEngineCore->getMap()->updateObservers(m_pEngineCore->getCamera());
 	//m_serverState = getNodeDirectory();
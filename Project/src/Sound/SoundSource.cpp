@@ -1,6 +1,8 @@
 #include "GameStdAfx.h"
 #include "Sound/SoundSource.h"
+#include "Common/AssetLoader.h"
 #include "Common/LoggerSystem.h"
+#include "Common/MappedFile.h"
 
 #define vec3ToFloatA6(f, v1, v2)	{ f[0]=v1.x; f[1]=v1.y; f[2]=v1.z; f[3]=v2.x; f[4]=v2.y; f[5]=v2.z; }
 #define SET_AF3(fa,x,y,z)			{ fa[0]=x; fa[1]=y; fa[2]=z; }
@@ -47,6 +49,61 @@ bool SoundSource::load(const std::string& filename)
 
 	m_buffer = alutCreateBufferFromFile(filename.c_str());
 
+	return setupSource(filename);
+}
+
+/**
+ * The sound from the bytes of its file: they are read already, only the decoding is left.
+ */
+bool SoundSource::load(const std::string& filename, const void* pData, const size_t size)
+{
+	m_buffer = alutCreateBufferFromFileImage(pData, (ALsizei)size);
+
+	return setupSource(filename);
+}
+
+void SoundSource::loadAsync(const std::shared_ptr<SoundSource>& pSound, const std::string& filename, const bool playWhenLoaded)
+{
+	if (!AssetLoader::hasInstance())
+	{
+		if (pSound->load(filename) && playWhenLoaded)
+		{
+			pSound->play();
+		}
+		return;
+	}
+
+	// copied out of the mapping: the pages are read by the worker, not by the first access on the main thread
+	const std::shared_ptr<std::vector<uint8_t>> pBytes = std::make_shared<std::vector<uint8_t>>();
+
+	AssetLoader::getInstance()->load(filename,
+		[pBytes, filename]()
+		{
+			MappedFile file;
+			if (!file.open(filename))
+			{
+				return false;
+			}
+
+			pBytes->assign(file.getData(), file.getData() + file.getSize());
+			return true;
+		},
+		[pSound, pBytes, filename, playWhenLoaded](const bool isLoaded)
+		{
+			if (isLoaded && pSound->load(filename, pBytes->data(), pBytes->size()) && playWhenLoaded)
+			{
+				pSound->play();
+			}
+
+			std::vector<uint8_t>().swap(*pBytes);
+		});
+}
+
+/**
+ * The source of the buffer made by load().
+ */
+bool SoundSource::setupSource(const std::string& filename)
+{
 	ALenum error = alutGetError();
 	if (error != ALUT_ERROR_NO_ERROR)
 	{
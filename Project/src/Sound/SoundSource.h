@@ -12,10 +12,14 @@ public:
 	static void audioExit();
 	static void setListener(const vec3& pos, const vec3& vel, const vec3& ori1, const vec3& ori2);
 
+	// the file is read by the AssetLoader, the sound is made (and played) on the main thread
+	static void loadAsync(const std::shared_ptr<SoundSource>& pSound, const std::string& filename, const bool playWhenLoaded = false);
+
 	SoundSource(const std::string& filename = "");
 	~SoundSource();
 
 	bool load(const std::string& filename);
+	bool load(const std::string& filename, const void* pData, const size_t size);
 	void play();
 	void stop();
 	void update();
@@ -30,6 +34,8 @@ public:
 	int getState() const;
 
 private:
+	bool setupSource(const std::string& filename);
+
 	static bool checkError(const std::string& message, const bool isAlError = true);
 
 protected:
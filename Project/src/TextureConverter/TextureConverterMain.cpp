@@ -0,0 +1,195 @@
+#include "GameStdAfx.h"
+#include "Common/JobPool.h"
+#include "Common/LoggerSystem.h"
+#include "Common/TraceRecorder.h"
+#include "Graphics/TextureCache.h"
+#include "Graphics/TextureCacheBuilder.h"
+
+#include <imageLoad.h>
+#include <IL/il.h>
+#include <IL/ilu.h>
+
+#include <boost/filesystem.hpp>
+
+
+/**
+ * Bakes the images into the cached textures loaded by the TextureCache instead of them (ctex::Header).
+ *
+ *     CrimsonTextureConverter <image or dir>... [-bc1 | -bc3]
+ *
+ * The cached texture is written next to the image (<image>.ctex), the images of a dir are baked recursively. The
+ * images with alpha and the normal-height maps (*_nh) are bc3, the others bc1, unless the format is given.
+ */
+static const char* s_imageExtensions[] = { "png", "jpg", "jpeg", "tga", "bmp" };
+
+static void printUsage(std::ostream& out)
+{
+	out << "usage: CrimsonTextureConverter <image or dir>... [-bc1 | -bc3]" << std::endl;
+	out << "  bakes the mip chains of the images, block compressed, next to them" << std::endl;
+	out << "  -bc1 -bc3  the format of every image (by default: bc3 with alpha and for the normal-height maps)" << std::endl;
+}
+
+static bool isImage(const std::string& fileName)
+{
+	const std::string extension = utils::file::getExtension(fileName);
+	for (const char* imageExtension : s_imageExtensions)
+	{
+		if (extension == imageExtension)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * The image as loadTexture() uploads it: rgba, the rows of the jpg and png images flipped.
+ */
+static bool decodeImage(const std::string& fileName, std::vector<uint8_t>& texels, uint& width, uint& height)
+{
+	ILuint image;
+	ilGenImages(1, &image);
+	ilBindImage(image);
+
+	bool isDecoded = ilLoadImage(fileName.c_str()) && ilConvertImage(IL_RGBA, IL_UNSIGNED_BYTE);
+	if (isDecoded)
+	{
+		const std::string extension = utils::file::getExtension(fileName);
+		if (extension == "jpg" || extension == "png")
+		{
+			iluFlipImage();
+		}
+
+		width = ilGetInteger(IL_IMAGE_WIDTH);
+		height = ilGetInteger(IL_IMAGE_HEIGHT);
+
+		const uint8_t* pData = ilGetData();
+		texels.assign(pData, pData + (size_t)width * height * 4);
+	}
+
+	ilDeleteImages(1, &image);
+
+	return isDecoded;
+}
+
+static bool convertImage(const std::string& fileName, const int forcedFormat)
+{
+	std::vector<uint8_t> texels;
+	uint width = 0;
+	uint height = 0;
+	if (!decodeImage(fileName, texels, width, height))
+	{
+		std::cerr << "can't load " << fileName << std::endl;
+		return false;
+	}
+
+	graphics::ctex::Format format = graphics::ctex::FORMAT_BC1;
+	if (forcedFormat >= 0)
+	{
+		format = (graphics::ctex::Format)forcedFormat;
+	}
+	else
+	{
+		// bc1 has no alpha: the height of the normal-height maps, the alpha of the decals
+		const std::string name = utils::file::getFileName(fileName);
+		bool hasAlpha = name.size() > 3 && name.compare(name.size() - 3, 3, "_nh") == 0;
+		for (size_t i = 3; i < texels.size() && !hasAlpha; i += 4)
+		{
+			hasAlpha = texels[i] != 255;
+		}
+
+		// the bmp and tga images are uploaded as rgb
+		const std::string extension = utils::file::getExtension(fileName);
+		if (hasAlpha && extension != "bmp" && extension != "tga")
+		{
+			format = graphics::ctex::FORMAT_BC3;
+		}
+	}
+
+	graphics::TextureCacheBuilder builder;
+	builder.build(texels.data(), width, height, format);
+
+	const std::string cacheFile = graphics::TextureCache::getCacheFile(fileName);
+	if (!builder.save(cacheFile))
+	{
+		std::cerr << "can't write " << cacheFile << std::endl;
+		return false;
+	}
+
+	std::cout << cacheFile << ": " << width << "x" << height << " " << (format == graphics::ctex::FORMAT_BC1 ? "bc1" : "bc3") << ", "
+		<< builder.getNumLevels() << " levels, " << texels.size() / 1024 << " KB -> " << builder.getSize() / 1024 << " KB" << std::endl;
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> fileNames;
+	int forcedFormat = -1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+
+		if (arg == "-bc1")
+		{
+			forcedFormat = graphics::ctex::FORMAT_BC1;
+		}
+		else if (arg == "-bc3")
+		{
+			forcedFormat = graphics::ctex::FORMAT_BC3;
+		}
+		else if (arg == "-h" || arg == "--help")
+		{
+			printUsage(std::cout);
+			return EXIT_SUCCESS;
+		}
+		else if (arg[0] != '-' && boost::filesystem::is_directory(arg))
+		{
+			boost::system::error_code error;
+			for (boost::filesystem::recursive_directory_iterator it(arg, error), end; it != end && !error; it.increment(error))
+			{
+				if (boost::filesystem::is_regular_file(it->status()) && isImage(it->path().string()))
+				{
+					fileNames.push_back(it->path().string());
+				}
+			}
+		}
+		else if (arg[0] != '-' && isImage(arg))
+		{
+			fileNames.push_back(arg);
+		}
+		else
+		{
+			printUsage(std::cerr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (fileNames.empty())
+	{
+		printUsage(std::cerr);
+		return EXIT_FAILURE;
+	}
+
+	new LoggerSystem(LogLevel::ERR);
+	new TraceRecorder();
+	new JobPool();
+
+	devilInit();
+
+	int result = EXIT_SUCCESS;
+	for (const std::string& fileName : fileNames)
+	{
+		if (!convertImage(fileName, forcedFormat))
+		{
+			result = EXIT_FAILURE;
+		}
+	}
+
+	JobPool::destroyInstance();
+	LoggerSystem::getInstance()->flush();
+
+	return result;
+}